@@ -0,0 +1,6 @@
+TEMPLATE = subdirs
+SUBDIRS = commandbatching \
+	  framecodec \
+	  idleoverhead \
+	  protocolsuite \
+	  transportlatency
@@ -0,0 +1,308 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+// Measures the cost of the command round trips that happen when the
+// debugger populates its views (e.g. the Locals), sending one frame per
+// command versus one CommandBatchFrame for the whole burst.
+//
+// The target engine runs on the main thread and is interrupted by the
+// debugger backend on connect. A client thread speaks the wire protocol
+// directly, so the numbers don't include any widget work.
+
+#include <QtCore>
+#include <QtNetwork>
+#include <QtScript>
+#include <qscriptdebuggerengine.h>
+#include <qscriptdebuggerprotocol_p.h>
+#include <private/qscriptdebuggercommand_p.h>
+#include <private/qscriptdebuggerevent_p.h>
+#include <private/qscriptdebuggerresponse_p.h>
+
+#include <stdio.h>
+
+void qScriptDebugRegisterMetaTypes();
+
+class Client : public QThread
+{
+public:
+    Client(quint16 port, int commands, int rounds)
+        : m_port(port), m_commands(commands), m_rounds(rounds) {}
+
+protected:
+    void run();
+
+private:
+    bool readFrame(quint8 *type, quint32 *channel, QByteArray *payload);
+    void writeFrame(quint8 type, quint32 channel, const QByteArray &payload);
+    QList<QScriptDebuggerCommand> makeCommands() const;
+    bool runRound(bool batched, const QList<QScriptDebuggerCommand> &commands,
+                  int *framesWritten, int *framesRead);
+
+    QTcpSocket *m_socket;
+    quint16 m_port;
+    int m_commands;
+    int m_rounds;
+    qint32 m_nextId;
+};
+
+bool Client::readFrame(quint8 *type, quint32 *channel, QByteArray *payload)
+{
+    while (m_socket->bytesAvailable() < (int)sizeof(quint32)) {
+        if (!m_socket->waitForReadyRead(5000))
+            return false;
+    }
+    QDataStream in(m_socket);
+    in.setVersion(QDataStream::Qt_4_5);
+    quint32 size;
+    in >> size;
+    while (m_socket->bytesAvailable() < size) {
+        if (!m_socket->waitForReadyRead(5000))
+            return false;
+    }
+    in >> *type >> *channel;
+    *payload = m_socket->read(size - QScriptDebuggerProtocol::FrameHeaderSize);
+    return true;
+}
+
+void Client::writeFrame(quint8 type, quint32 channel, const QByteArray &payload)
+{
+    QByteArray block;
+    QDataStream out(&block, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_5);
+    out << (quint32)(QScriptDebuggerProtocol::FrameHeaderSize + payload.size());
+    out << type << channel;
+    block.append(payload);
+    m_socket->write(block);
+    m_socket->flush();
+}
+
+// roughly what the debugger asks for when it stops and fills the stack
+// and locals views
+QList<QScriptDebuggerCommand> Client::makeCommands() const
+{
+    QList<QScriptDebuggerCommand> result;
+    for (int i = 0; i < m_commands; ++i) {
+        switch (i % 6) {
+        case 0: result.append(QScriptDebuggerCommand::getContextCountCommand()); break;
+        case 1: result.append(QScriptDebuggerCommand::getContextInfoCommand(0)); break;
+        case 2: result.append(QScriptDebuggerCommand::getContextStateCommand(0)); break;
+        case 3: result.append(QScriptDebuggerCommand::getScopeChainCommand(0)); break;
+        case 4: result.append(QScriptDebuggerCommand::getThisObjectCommand(0)); break;
+        case 5: result.append(QScriptDebuggerCommand::getActivationObjectCommand(0)); break;
+        }
+    }
+    return result;
+}
+
+bool Client::runRound(bool batched, const QList<QScriptDebuggerCommand> &commands,
+                      int *framesWritten, int *framesRead)
+{
+    if (batched) {
+        QByteArray payload;
+        QDataStream out(&payload, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_4_5);
+        out << (quint32)commands.size();
+        for (int i = 0; i < commands.size(); ++i)
+            out << m_nextId++ << commands.at(i);
+        writeFrame(QScriptDebuggerProtocol::CommandBatchFrame, 0, payload);
+        ++*framesWritten;
+    } else {
+        for (int i = 0; i < commands.size(); ++i) {
+            QByteArray payload;
+            QDataStream out(&payload, QIODevice::WriteOnly);
+            out.setVersion(QDataStream::Qt_4_5);
+            out << m_nextId++ << commands.at(i);
+            writeFrame(QScriptDebuggerProtocol::CommandFrame, 0, payload);
+            ++*framesWritten;
+        }
+    }
+    int pending = commands.size();
+    while (pending > 0) {
+        quint8 type;
+        quint32 channel;
+        QByteArray payload;
+        if (!readFrame(&type, &channel, &payload))
+            return false;
+        ++*framesRead;
+        if (type == QScriptDebuggerProtocol::ResponseFrame) {
+            --pending;
+        } else if (type == QScriptDebuggerProtocol::ResponseBatchFrame) {
+            QDataStream in(payload);
+            in.setVersion(QDataStream::Qt_4_5);
+            quint32 count;
+            in >> count;
+            pending -= count;
+        }
+    }
+    return true;
+}
+
+void Client::run()
+{
+    QTcpSocket socket;
+    m_socket = &socket;
+    m_nextId = 0;
+    socket.connectToHost(QHostAddress::LocalHost, m_port);
+    if (!socket.waitForConnected(5000)) {
+        fprintf(stderr, "failed to connect: %s\n", qPrintable(socket.errorString()));
+        return;
+    }
+    socket.setSocketOption(QAbstractSocket::LowDelayOption, 1);
+    // ask for no optional capabilities, so that only framing is measured
+    QByteArray handshake = QScriptDebuggerProtocol::handshakeData();
+    uchar field[sizeof(quint16) + sizeof(quint32)];
+    qToBigEndian<quint16>(QScriptDebuggerProtocol::ProtocolVersion, field);
+    qToBigEndian<quint32>(0, field + sizeof(quint16));
+    socket.write(handshake);
+    socket.write(reinterpret_cast<const char*>(field), sizeof(field));
+    while (socket.bytesAvailable() < QScriptDebuggerProtocol::HandshakeSize) {
+        if (!socket.waitForReadyRead(5000))
+            return;
+    }
+    if (socket.read(handshake.size()) != handshake) {
+        fprintf(stderr, "handshake failed\n");
+        return;
+    }
+    socket.read(sizeof(quint16) + sizeof(quint32));
+
+    // wait until the target has stopped
+    for (;;) {
+        quint8 type;
+        quint32 channel;
+        QByteArray payload;
+        if (!readFrame(&type, &channel, &payload)) {
+            fprintf(stderr, "target didn't stop\n");
+            return;
+        }
+        if (type == QScriptDebuggerProtocol::EventFrame)
+            break;
+    }
+
+    QList<QScriptDebuggerCommand> commands = makeCommands();
+    // warm up both paths before measuring
+    int framesWritten = 0;
+    int framesRead = 0;
+    runRound(false, commands, &framesWritten, &framesRead);
+    runRound(true, commands, &framesWritten, &framesRead);
+
+    fprintf(stdout, "%-10s %8s %8s %14s %14s %12s\n", "mode", "commands", "rounds",
+            "ns/round", "ns/command", "frames/round");
+    for (int batched = 0; batched < 2; ++batched) {
+        framesWritten = 0;
+        framesRead = 0;
+        QTime timer;
+        timer.start();
+        for (int i = 0; i < m_rounds; ++i) {
+            if (!runRound(batched, commands, &framesWritten, &framesRead)) {
+                fprintf(stderr, "timed out waiting for responses\n");
+                return;
+            }
+        }
+        qint64 total = qint64(timer.elapsed()) * 1000000;
+        fprintf(stdout, "%-10s %8d %8d %14lld %14lld %12.1f\n",
+                batched ? "batched" : "per-frame", m_commands, m_rounds,
+                total / m_rounds, total / (qint64(m_rounds) * m_commands),
+                double(framesWritten + framesRead) / m_rounds);
+    }
+
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_5);
+    out << m_nextId++ << QScriptDebuggerCommand::resumeCommand();
+    writeFrame(QScriptDebuggerProtocol::CommandFrame, 0, payload);
+    socket.disconnectFromHost();
+    if (socket.state() != QAbstractSocket::UnconnectedState)
+        socket.waitForDisconnected(5000);
+}
+
+class Target : public QObject
+{
+    Q_OBJECT
+public:
+    Target(QScriptEngine *engine) : m_engine(engine) {}
+
+public slots:
+    void run()
+    {
+        // stops at the first statement, since the backend interrupts
+        // evaluation when the debugger connects
+        m_engine->evaluate(QString::fromLatin1(
+            "function f(a, b) {\n"
+            "    var o = { x: 1, y: 'two', z: [1, 2, 3] };\n"
+            "    return a + b + o.x;\n"
+            "}\n"
+            "f(1, 2);\n"));
+    }
+    void quit()
+    {
+        QCoreApplication::quit();
+    }
+
+private:
+    QScriptEngine *m_engine;
+};
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    quint16 port = 2049;
+    int commands = 24;
+    int rounds = 1000;
+    bool threaded = false;
+    QStringList args = app.arguments();
+    for (int i = 1; i < args.size(); ++i) {
+        QString arg = args.at(i);
+        if (arg.startsWith(QLatin1String("--port=")))
+            port = arg.mid(7).toUShort();
+        else if (arg.startsWith(QLatin1String("--commands=")))
+            commands = qMax(1, arg.mid(11).toInt());
+        else if (arg.startsWith(QLatin1String("--rounds=")))
+            rounds = qMax(1, arg.mid(9).toInt());
+        else if (arg == QLatin1String("--threaded"))
+            threaded = true;
+        else {
+            fprintf(stdout, "Usage: commandbatching [--port=NUM] [--commands=N] [--rounds=N] [--threaded]\n");
+            return 0;
+        }
+    }
+
+    qScriptDebugRegisterMetaTypes();
+    QScriptEngine engine;
+    QScriptDebuggerEngine debugger;
+    if (threaded)
+        debugger.setNetworkThreadEnabled(true);
+    debugger.setTarget(&engine);
+    if (!debugger.listen(QHostAddress::LocalHost, port)) {
+        fprintf(stderr, "failed to listen on port %d\n", port);
+        return 1;
+    }
+    Target target(&engine);
+    QObject::connect(&debugger, SIGNAL(connected()), &target, SLOT(run()), Qt::QueuedConnection);
+    QObject::connect(&debugger, SIGNAL(disconnected()), &target, SLOT(quit()), Qt::QueuedConnection);
+
+    Client client(port, commands, rounds);
+    client.start();
+    int ret = app.exec();
+    client.wait();
+    return ret;
+}
+
+#include "main.moc"
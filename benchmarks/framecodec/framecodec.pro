@@ -0,0 +1,18 @@
+TEMPLATE = app
+TARGET = 
+DEPENDPATH += .
+INCLUDEPATH += .
+QT += network script scripttools
+CONFIG += release
+win32: CONFIG += console
+mac:CONFIG -= app_bundle
+INCLUDEPATH += ../../src
+SOURCES += main.cpp ../../src/qscriptdebuggerframecodec.cpp \
+           ../../src/qscriptdebuggercompactencoding.cpp ../../src/qscriptdebuggermetatypes.cpp \
+           ../../src/qscriptdebuggertrace.cpp ../../src/qscriptdebuggertransport.cpp \
+           ../../src/qscriptdebuggermetrics.cpp
+HEADERS += ../../src/qscriptdebuggerframecodec_p.h ../../src/qscriptdebuggerprotocol_p.h \
+           ../../src/qscriptdebuggercompactencoding_p.h ../../src/qscriptdebuggermetatypes_p.h \
+           ../../src/qscriptdebuggertrace_p.h ../../src/qscriptdebuggertransport_p.h \
+           ../../src/qscriptdebuggermetrics_p.h
+DEFINES += QT_BUILD_INTERNAL
@@ -0,0 +1,309 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+// Compares the per-frame cost of the frame codec with building a fresh
+// QByteArray and QDataStream for every frame, as the connections used to
+// do. Reports heap allocations and nanoseconds per frame, for encoding
+// and for decoding. Also compares the size of typical responses in the
+// QDataStream encoding with the compact encoding.
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <QtCore>
+#include <qscriptdebuggerprotocol_p.h>
+#include <qscriptdebuggerframecodec_p.h>
+#include <qscriptdebuggercompactencoding_p.h>
+#include <qscriptdebuggermetatypes_p.h>
+
+static qint64 allocations = 0;
+
+#if defined(__GLIBC__)
+// count every heap allocation, including the ones made inside QtCore
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size)
+{ ++allocations; return __libc_malloc(size); }
+void *calloc(size_t count, size_t size)
+{ ++allocations; return __libc_calloc(count, size); }
+void *realloc(void *ptr, size_t size)
+{ ++allocations; return __libc_realloc(ptr, size); }
+}
+static const char allocationSource[] = "malloc";
+#else
+// elsewhere, only allocations made with operator new are counted; Qt's
+// containers allocate with qMalloc() and won't show up
+void *operator new(size_t size)
+{ ++allocations; return malloc(size); }
+void *operator new[](size_t size)
+{ ++allocations; return malloc(size); }
+void operator delete(void *ptr) throw()
+{ free(ptr); }
+void operator delete[](void *ptr) throw()
+{ free(ptr); }
+static const char allocationSource[] = "operator new";
+#endif
+
+// swallows whatever is written to it, like a socket that never blocks
+class NullDevice : public QIODevice
+{
+public:
+    NullDevice() { open(QIODevice::WriteOnly | QIODevice::Unbuffered); }
+    bool isSequential() const { return true; }
+protected:
+    qint64 readData(char *, qint64) { return -1; }
+    qint64 writeData(const char *, qint64 size) { return size; }
+};
+
+static QScriptDebuggerResponse makeResponse()
+{
+    QScriptDebuggerResponse response;
+    response.setResult(QVariant(QString::fromLatin1("a property value of typical length")));
+    return response;
+}
+
+static void legacyEncode(QIODevice *device, const QScriptDebuggerResponse &response, int frames)
+{
+    for (int i = 0; i < frames; ++i) {
+        QByteArray block;
+        QDataStream out(&block, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_4_5);
+        out << (quint32)0;
+        out << (quint8)QScriptDebuggerProtocol::ResponseFrame;
+        out << (quint32)0;
+        out << (qint32)i;
+        out << response;
+        out.device()->seek(0);
+        out << (quint32)(block.size() - sizeof(quint32));
+        device->write(block);
+    }
+}
+
+static void codecEncode(QScriptDebuggerFrameCodec *codec, QIODevice *device,
+                        const QScriptDebuggerResponse &response, int frames)
+{
+    for (int i = 0; i < frames; ++i) {
+        QDataStream &out = codec->beginFrame(QScriptDebuggerProtocol::ResponseFrame, 0);
+        out << (qint32)i;
+        out << response;
+        codec->endFrame();
+        codec->writeTo(device);
+    }
+}
+
+static int legacyDecode(QIODevice *device, int frames)
+{
+    int decoded = 0;
+    QDataStream in(device);
+    in.setVersion(QDataStream::Qt_4_5);
+    for (int i = 0; i < frames; ++i) {
+        quint32 blockSize;
+        in >> blockSize;
+        if (device->bytesAvailable() < blockSize)
+            break;
+        quint8 type;
+        quint32 channel;
+        qint32 id;
+        QScriptDebuggerResponse response;
+        in >> type >> channel >> id >> response;
+        ++decoded;
+    }
+    return decoded;
+}
+
+static int codecDecode(QScriptDebuggerFrameCodec *codec, QIODevice *device, int frames)
+{
+    int decoded = 0;
+    while (decoded < frames) {
+        quint8 type;
+        quint32 channel;
+        QScriptDebuggerFrameCodec::Status status = codec->peekFrame(&type, &channel);
+        if (status == QScriptDebuggerFrameCodec::NeedMoreData) {
+            if (codec->readFrom(device) == 0)
+                break;
+            continue;
+        }
+        if (status == QScriptDebuggerFrameCodec::FrameError)
+            break;
+        QDataStream &in = codec->beginRead();
+        qint32 id;
+        QScriptDebuggerResponse response;
+        in >> id >> response;
+        if (!codec->endRead())
+            break;
+        ++decoded;
+    }
+    return decoded;
+}
+
+// the response to a GetPropertiesCommand for a small object, which is what
+// the locals view asks for every time the target stops
+static QScriptDebuggerResponse makePropertiesResponse()
+{
+    QScriptDebuggerValuePropertyList props;
+    props.append(QScriptDebuggerValueProperty(QString::fromLatin1("index"), QScriptDebuggerValue(42.0),
+                                              QString::fromLatin1("42"), QScriptValue::PropertyFlags(0)));
+    props.append(QScriptDebuggerValueProperty(QString::fromLatin1("name"),
+                                              QScriptDebuggerValue(QString::fromLatin1("item")),
+                                              QString::fromLatin1("item"), QScriptValue::PropertyFlags(0)));
+    props.append(QScriptDebuggerValueProperty(QString::fromLatin1("visible"), QScriptDebuggerValue(true),
+                                              QString::fromLatin1("true"), QScriptValue::PropertyFlags(0)));
+    props.append(QScriptDebuggerValueProperty(QString::fromLatin1("length"), QScriptDebuggerValue(3.0),
+                                              QString::fromLatin1("3"), QScriptValue::ReadOnly
+                                              | QScriptValue::Undeletable | QScriptValue::SkipInEnumeration));
+    props.append(QScriptDebuggerValueProperty(QString::fromLatin1("parent"),
+                                              QScriptDebuggerValue(QScriptDebuggerValue::NullValue),
+                                              QString::fromLatin1("null"), QScriptValue::PropertyFlags(0)));
+    QScriptDebuggerResponse response;
+    response.setResult(qVariantFromValue(props));
+    return response;
+}
+
+// the response to a GetBacktrace command for a stack 20 frames deep
+static QScriptDebuggerResponse makeBacktraceResponse()
+{
+    QStringList backtrace;
+    for (int i = 0; i < 20; ++i)
+        backtrace.append(QString::fromLatin1("<anonymous>() at example.qs:%0").arg(10 + i));
+    backtrace.append(QString::fromLatin1("<global>() at example.qs:3"));
+    QScriptDebuggerResponse response;
+    response.setResult(QVariant(backtrace));
+    return response;
+}
+
+// the response to a GetScriptData command for a script of 50 lines
+static QScriptDebuggerResponse makeScriptDataResponse()
+{
+    QString contents;
+    for (int i = 0; i < 50; ++i)
+        contents.append(QString::fromLatin1("    var item%0 = items[%0];\n").arg(i));
+    QScriptDebuggerResponse response;
+    response.setResult(qVariantFromValue(QScriptScriptData(contents, QString::fromLatin1("example.qs"),
+                                                           1, QDateTime::currentDateTime())));
+    return response;
+}
+
+static int legacySize(const QScriptDebuggerResponse &response)
+{
+    QByteArray bytes;
+    QDataStream out(&bytes, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_5);
+    out << response;
+    return bytes.size();
+}
+
+static int compactSize(const QScriptDebuggerResponse &response)
+{
+    QByteArray bytes;
+    QDataStream out(&bytes, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_5);
+    QScriptDebuggerCompactEncoding::writeResponse(out, response);
+    return bytes.size();
+}
+
+static void reportSize(const char *name, const QScriptDebuggerResponse &response)
+{
+    int legacy = legacySize(response);
+    int compact = compactSize(response);
+    fprintf(stdout, "%-14s %10d %10d %9.0f%%\n", name, legacy, compact,
+            100.0 * compact / legacy);
+}
+
+static void report(const char *name, int frames, int elapsed, qint64 allocs)
+{
+    fprintf(stdout, "%-14s %10d %14.1f %18.2f\n", name, frames,
+            double(elapsed) * 1000000.0 / frames, double(allocs) / frames);
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    qScriptDebugRegisterMetaTypes();
+    int frames = 200000;
+    QStringList args = app.arguments();
+    for (int i = 1; i < args.size(); ++i) {
+        if (args.at(i).startsWith(QLatin1String("--frames=")))
+            frames = qMax(1, args.at(i).mid(9).toInt());
+        else {
+            fprintf(stdout, "Usage: framecodec [--frames=N]\n");
+            return 0;
+        }
+    }
+
+    QScriptDebuggerResponse response = makeResponse();
+    NullDevice sink;
+    QScriptDebuggerFrameCodec codec;
+    QTime timer;
+    qint64 before;
+
+    // the encoded stream that both decoders read
+    QByteArray stream;
+    {
+        QBuffer buffer(&stream);
+        buffer.open(QIODevice::WriteOnly);
+        legacyEncode(&buffer, response, frames);
+    }
+
+    // warm up, so that the codec's buffers have reached their working size
+    legacyEncode(&sink, response, 100);
+    codecEncode(&codec, &sink, response, 100);
+
+    fprintf(stdout, "%-14s %10s %14s %18s\n", "path", "frames", "ns/frame", "allocations/frame");
+    fprintf(stdout, "(allocations counted through %s)\n", allocationSource);
+
+    before = allocations;
+    timer.start();
+    legacyEncode(&sink, response, frames);
+    report("legacy-encode", frames, timer.elapsed(), allocations - before);
+
+    before = allocations;
+    timer.start();
+    codecEncode(&codec, &sink, response, frames);
+    report("codec-encode", frames, timer.elapsed(), allocations - before);
+
+    {
+        QBuffer source(&stream);
+        source.open(QIODevice::ReadOnly);
+        before = allocations;
+        timer.start();
+        int decoded = legacyDecode(&source, frames);
+        report("legacy-decode", decoded, timer.elapsed(), allocations - before);
+    }
+
+    {
+        QBuffer source(&stream);
+        source.open(QIODevice::ReadOnly);
+        before = allocations;
+        timer.start();
+        int decoded = codecDecode(&codec, &source, frames);
+        report("codec-decode", decoded, timer.elapsed(), allocations - before);
+    }
+
+    fprintf(stdout, "\n%-14s %10s %10s %10s\n", "response", "datastream", "compact", "ratio");
+    reportSize("string", response);
+    reportSize("properties", makePropertiesResponse());
+    reportSize("backtrace", makeBacktraceResponse());
+    reportSize("script data", makeScriptDataResponse());
+    return 0;
+}
@@ -0,0 +1,10 @@
+TEMPLATE = app
+TARGET = 
+DEPENDPATH += .
+INCLUDEPATH += .
+QT += network script scripttools
+CONFIG += release
+win32: CONFIG += console
+mac:CONFIG -= app_bundle
+include(../../src/debuggerengine.pri)
+SOURCES += main.cpp
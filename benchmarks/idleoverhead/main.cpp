@@ -0,0 +1,126 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+// Measures the statement throughput of an engine that is listening for a
+// debugger that never connects, with the debugger's agent put on the
+// engine right away (the default) and with lazy attach, against an
+// engine that isn't set up for debugging at all.
+
+#include <QtCore>
+#include <QtNetwork>
+#include <QtScript>
+#include <qscriptdebuggerengine.h>
+
+#include <stdio.h>
+
+void qScriptDebugRegisterMetaTypes();
+
+enum Mode {
+    NoDebugging,
+    EagerAttach,
+    LazyAttach
+};
+
+static const char *modeName(int mode)
+{
+    switch (mode) {
+    case NoDebugging: return "none";
+    case EagerAttach: return "eager";
+    case LazyAttach: return "lazy";
+    }
+    return "";
+}
+
+// the loop body is two statements; the loop's own test and update are
+// counted as one
+static QString program(int iterations)
+{
+    return QString::fromLatin1(
+        "var sum = 0;\n"
+        "for (var i = 0; i < %0; ++i) {\n"
+        "    var x = i * 2;\n"
+        "    sum += x;\n"
+        "}\n"
+        "sum;\n").arg(iterations);
+}
+
+// returns the best time of the given number of runs, in ms
+static int measure(int mode, int iterations, int runs)
+{
+    QScriptEngine engine;
+    QScriptDebuggerEngine debugger;
+    if (mode != NoDebugging) {
+        debugger.setLazyAttachEnabled(mode == LazyAttach);
+        debugger.setTarget(&engine);
+        if (!debugger.listen(QHostAddress::LocalHost, 0)) {
+            fprintf(stderr, "failed to listen\n");
+            return -1;
+        }
+    }
+    QString code = program(iterations);
+    // warm up
+    engine.evaluate(program(iterations / 10));
+    int best = -1;
+    for (int i = 0; i < runs; ++i) {
+        QTime timer;
+        timer.start();
+        engine.evaluate(code);
+        int elapsed = timer.elapsed();
+        if ((best == -1) || (elapsed < best))
+            best = elapsed;
+    }
+    return best;
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    int iterations = 2000000;
+    int runs = 5;
+    QStringList args = app.arguments();
+    for (int i = 1; i < args.size(); ++i) {
+        QString arg = args.at(i);
+        if (arg.startsWith(QLatin1String("--iterations=")))
+            iterations = qMax(10, arg.mid(13).toInt());
+        else if (arg.startsWith(QLatin1String("--runs=")))
+            runs = qMax(1, arg.mid(7).toInt());
+        else {
+            fprintf(stdout, "Usage: idleoverhead [--iterations=N] [--runs=N]\n");
+            return 0;
+        }
+    }
+
+    qScriptDebugRegisterMetaTypes();
+    qint64 statements = qint64(iterations) * 3;
+    int baseline = 0;
+    fprintf(stdout, "%-8s %12s %10s %16s %10s\n", "mode", "statements", "ms",
+            "statements/s", "relative");
+    for (int mode = NoDebugging; mode <= LazyAttach; ++mode) {
+        int ms = measure(mode, iterations, runs);
+        if (ms < 0)
+            return 1;
+        if (mode == NoDebugging)
+            baseline = qMax(1, ms);
+        fprintf(stdout, "%-8s %12lld %10d %16.0f %10.2f\n", modeName(mode), statements, ms,
+                double(statements) * 1000 / qMax(1, ms), double(ms) / baseline);
+    }
+    return 0;
+}
@@ -0,0 +1,904 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+// A headless benchmark of the whole protocol path: QScriptDebuggerEngine
+// on one side and a scripted client that speaks the wire protocol on the
+// other, so that no widget work is included. It measures
+//
+//   latency     the round trip of each command type, while stopped
+//   throughput  frames and bytes per second for batched command bursts
+//   attach      the time to attach and fetch every script, for several
+//               numbers and sizes of loaded scripts
+//   overhead    the time per statement without a debugger, with the
+//               agent attached and with a debugger connected
+//   output      how fast what a target print()s in a tight loop reaches
+//               the client, with output batching on and off
+//
+// By default the client runs in a thread of this process; with --remote
+// the targets run in a child process (this program started with --host)
+// and are reached over loopback TCP.
+//
+// Every result is printed as one JSON object per line, so the output can
+// be collected and compared between builds.
+
+#include <QtCore>
+#include <QtNetwork>
+#include <QtScript>
+#include <qscriptdebuggerengine.h>
+#include <qscriptdebuggerprotocol_p.h>
+#include <private/qscriptdebuggercommand_p.h>
+#include <private/qscriptdebuggerevent_p.h>
+#include <private/qscriptdebuggerresponse_p.h>
+#include <qscriptdebuggermetatypes_p.h>
+
+#include <stdio.h>
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+void qScriptDebugRegisterMetaTypes();
+
+// QTime only has ms resolution, which is too coarse for a single round trip
+static qint64 nanoTime()
+{
+#ifdef Q_OS_WIN
+    static LARGE_INTEGER frequency;
+    if (frequency.QuadPart == 0)
+        QueryPerformanceFrequency(&frequency);
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return qint64(double(counter.QuadPart) * 1000000000.0 / frequency.QuadPart);
+#else
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return qint64(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+static QString program(int iterations)
+{
+    return QString::fromLatin1(
+        "var sum = 0;\n"
+        "for (var i = 0; i < %0; ++i) {\n"
+        "    var x = i * 2;\n"
+        "    sum += x;\n"
+        "}\n"
+        "sum;\n").arg(iterations);
+}
+
+static QString script(int index, int lines)
+{
+    QString code = QString::fromLatin1("function f%0() {\n").arg(index);
+    for (int i = 0; i < lines; ++i)
+        code += QString::fromLatin1("    var v%0 = %0 * 2;\n").arg(i);
+    code += QLatin1String("}\n");
+    return code;
+}
+
+// Owns the targets; lives in the thread that runs the script engines.
+class Host : public QObject
+{
+    Q_OBJECT
+public:
+    Host(quint16 basePort)
+        : m_engine(0), m_debugger(0), m_nextPort(basePort), m_running(false), m_prints(0) {}
+    ~Host() { cleanup(); }
+
+    // Creates a target with the given number of scripts loaded and
+    // returns the port it listens on, or 0. If stop is true, the target
+    // starts evaluating, and is interrupted, once a client connects.
+    Q_INVOKABLE int prepare(int scripts, int lines, bool stop)
+    {
+        cleanup();
+        m_engine = new QScriptEngine();
+        for (int i = 0; i < scripts; ++i)
+            m_engine->evaluate(script(i, lines), QString::fromLatin1("script%0.js").arg(i));
+        m_debugger = new QScriptDebuggerEngine();
+        m_debugger->setTarget(m_engine);
+        for (int attempt = 0; attempt < 100; ++attempt) {
+            quint16 port = m_nextPort++;
+            if (m_debugger->listen(QHostAddress::LocalHost, port)) {
+                if (stop) {
+                    QObject::connect(m_debugger, SIGNAL(connected()), this, SLOT(run()),
+                                     Qt::QueuedConnection);
+                }
+                return port;
+            }
+        }
+        cleanup();
+        return 0;
+    }
+
+    // Creates a target that print()s the given number of lines in a
+    // tight loop once a client connects, with the output batched for up
+    // to batchInterval ms, or sent line by line if batchInterval is 0.
+    // Returns the port it listens on, or 0.
+    Q_INVOKABLE int prepareOutput(int prints, int batchInterval)
+    {
+        int port = prepare(0, 0, /*stop=*/false);
+        if (port == 0)
+            return 0;
+        if (batchInterval > 0)
+            m_debugger->setOutputBatching(batchInterval, QScriptDebuggerEngine::DefaultMaxOutputBatchSize);
+        else
+            m_debugger->setOutputBatching(0, 1);
+        // room for every line, so that none is dropped and both runs
+        // deliver the same output
+        m_debugger->setOutboundLimits(qMax(int(QScriptDebuggerEngine::DefaultMaxOutboundBytes), prints * 256),
+                                      qMax(int(QScriptDebuggerEngine::DefaultMaxOutboundFrames), prints));
+        m_prints = prints;
+        QObject::connect(m_debugger, SIGNAL(connected()), this, SLOT(print()),
+                         Qt::QueuedConnection);
+        return port;
+    }
+
+    // Gets rid of the current target; it must not be evaluating.
+    Q_INVOKABLE void release()
+    {
+        Q_ASSERT(!m_running);
+        cleanup();
+    }
+
+    // Returns true while the current target is evaluating.
+    Q_INVOKABLE bool isRunning() const
+    { return m_running; }
+
+    // Returns the time, in ns, of the best of runs evaluations of the
+    // benchmark loop, on the current target or on a new engine.
+    Q_INVOKABLE qint64 measure(int iterations, int runs, bool onTarget)
+    {
+        QScriptEngine plain;
+        QScriptEngine *engine = (onTarget && m_engine) ? m_engine : &plain;
+        engine->evaluate(program(iterations / 10));
+        QString code = program(iterations);
+        qint64 best = -1;
+        for (int i = 0; i < runs; ++i) {
+            qint64 start = nanoTime();
+            engine->evaluate(code);
+            qint64 elapsed = nanoTime() - start;
+            if ((best == -1) || (elapsed < best))
+                best = elapsed;
+        }
+        return best;
+    }
+
+private slots:
+    void run()
+    {
+        m_running = true;
+        m_engine->evaluate(QString::fromLatin1(
+            "function g(a, b) {\n"
+            "    var o = { x: 1, y: 'two', z: [1, 2, 3] };\n"
+            "    return a + b + o.x;\n"
+            "}\n"
+            "g(1, 2);\n"), QString::fromLatin1("stop.js"));
+        m_running = false;
+    }
+
+    void print()
+    {
+        m_running = true;
+        m_engine->evaluate(QString::fromLatin1(
+            "for (var i = 0; i < %0; ++i)\n"
+            "    print('line ' + i);\n").arg(m_prints), QString::fromLatin1("print.js"));
+        m_running = false;
+    }
+
+private:
+    void cleanup()
+    {
+        delete m_debugger;
+        m_debugger = 0;
+        delete m_engine;
+        m_engine = 0;
+    }
+
+    QScriptEngine *m_engine;
+    QScriptDebuggerEngine *m_debugger;
+    quint16 m_nextPort;
+    bool m_running;
+    int m_prints;
+};
+
+// How the client reaches the host: directly, or through the stdin and
+// stdout of a child process.
+class HostProxy
+{
+public:
+    virtual ~HostProxy() {}
+    virtual int prepare(int scripts, int lines, bool stop) = 0;
+    virtual int prepareOutput(int prints, int batchInterval) = 0;
+    virtual void release() = 0;
+    virtual bool isRunning() = 0;
+    virtual qint64 measure(int iterations, int runs, bool onTarget) = 0;
+};
+
+class LocalHostProxy : public HostProxy
+{
+public:
+    LocalHostProxy(Host *host) : m_host(host) {}
+
+    int prepare(int scripts, int lines, bool stop)
+    {
+        int port = 0;
+        QMetaObject::invokeMethod(m_host, "prepare", Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(int, port), Q_ARG(int, scripts),
+                                  Q_ARG(int, lines), Q_ARG(bool, stop));
+        return port;
+    }
+    int prepareOutput(int prints, int batchInterval)
+    {
+        int port = 0;
+        QMetaObject::invokeMethod(m_host, "prepareOutput", Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(int, port), Q_ARG(int, prints),
+                                  Q_ARG(int, batchInterval));
+        return port;
+    }
+    void release()
+    {
+        QMetaObject::invokeMethod(m_host, "release", Qt::BlockingQueuedConnection);
+    }
+    bool isRunning()
+    {
+        bool running = false;
+        QMetaObject::invokeMethod(m_host, "isRunning", Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(bool, running));
+        return running;
+    }
+    qint64 measure(int iterations, int runs, bool onTarget)
+    {
+        qint64 ns = 0;
+        QMetaObject::invokeMethod(m_host, "measure", Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(qint64, ns), Q_ARG(int, iterations),
+                                  Q_ARG(int, runs), Q_ARG(bool, onTarget));
+        return ns;
+    }
+
+private:
+    Host *m_host;
+};
+
+class RemoteHostProxy : public HostProxy
+{
+public:
+    RemoteHostProxy(QProcess *process) : m_process(process) {}
+
+    int prepare(int scripts, int lines, bool stop)
+    { return call(QString::fromLatin1("prepare %0 %1 %2").arg(scripts).arg(lines).arg(int(stop))).toInt(); }
+    int prepareOutput(int prints, int batchInterval)
+    { return call(QString::fromLatin1("output %0 %1").arg(prints).arg(batchInterval)).toInt(); }
+    void release()
+    { call(QString::fromLatin1("release")); }
+    bool isRunning()
+    { return call(QString::fromLatin1("running")).toInt() != 0; }
+    qint64 measure(int iterations, int runs, bool onTarget)
+    { return call(QString::fromLatin1("measure %0 %1 %2").arg(iterations).arg(runs).arg(int(onTarget))).toLongLong(); }
+
+private:
+    QByteArray call(const QString &line)
+    {
+        m_process->write(line.toLatin1() + '\n');
+        m_process->waitForBytesWritten(-1);
+        while (!m_process->canReadLine()) {
+            if (!m_process->waitForReadyRead(60000))
+                return QByteArray();
+        }
+        return m_process->readLine().trimmed();
+    }
+
+    QProcess *m_process;
+};
+
+// Serves the requests of a parent started with --remote; the answers are
+// written to stdout, one line each.
+class HostServer : public QThread
+{
+public:
+    HostServer(Host *host) : m_host(host) {}
+
+protected:
+    void run()
+    {
+        LocalHostProxy proxy(m_host);
+        char buffer[256];
+        while (fgets(buffer, sizeof(buffer), stdin)) {
+            QStringList words = QString::fromLatin1(buffer).simplified().split(QLatin1Char(' '));
+            QString answer;
+            if ((words.at(0) == QLatin1String("prepare")) && (words.size() == 4)) {
+                answer = QString::number(proxy.prepare(words.at(1).toInt(), words.at(2).toInt(),
+                                                       words.at(3).toInt() != 0));
+            } else if ((words.at(0) == QLatin1String("output")) && (words.size() == 3)) {
+                answer = QString::number(proxy.prepareOutput(words.at(1).toInt(), words.at(2).toInt()));
+            } else if (words.at(0) == QLatin1String("release")) {
+                proxy.release();
+                answer = QLatin1String("ok");
+            } else if (words.at(0) == QLatin1String("running")) {
+                answer = QString::number(int(proxy.isRunning()));
+            } else if ((words.at(0) == QLatin1String("measure")) && (words.size() == 4)) {
+                answer = QString::number(proxy.measure(words.at(1).toInt(), words.at(2).toInt(),
+                                                       words.at(3).toInt() != 0));
+            } else {
+                answer = QLatin1String("?");
+            }
+            fprintf(stdout, "%s\n", qPrintable(answer));
+            fflush(stdout);
+        }
+        QMetaObject::invokeMethod(QCoreApplication::instance(), "quit", Qt::QueuedConnection);
+    }
+
+private:
+    Host *m_host;
+};
+
+struct Options
+{
+    QString suites;
+    int samples;
+    int rounds;
+    int iterations;
+    int runs;
+    bool remote;
+    quint16 port;
+};
+
+class Client : public QThread
+{
+public:
+    Client(Host *host, const Options &options)
+        : m_host(host), m_options(options), m_socket(0), m_nextId(0) {}
+
+    bool ok() const { return m_ok; }
+
+protected:
+    void run();
+
+private:
+    bool connectTo(int port);
+    void disconnect();
+    void waitForTarget();
+    void finish();
+    bool readFrame(quint8 *type, quint32 *channel, QByteArray *payload);
+    void writeFrame(quint8 type, quint32 channel, const QByteArray &payload);
+    bool waitFor(quint8 type, QByteArray *payload = 0);
+    bool roundTrip(const QScriptDebuggerCommand &command, QScriptDebuggerResponse *response = 0);
+    bool roundTrip(const QList<QScriptDebuggerCommand> &commands, QList<QScriptDebuggerResponse> *responses = 0);
+
+    bool runLatency();
+    bool runThroughput();
+    bool runAttach();
+    bool runOverhead();
+    bool runOutput();
+    void report(const QString &benchmark, const QList<QPair<QString, QString> > &fields);
+
+    Host *m_host;
+    HostProxy *m_proxy;
+    Options m_options;
+    QTcpSocket *m_socket;
+    qint32 m_nextId;
+    bool m_ok;
+
+    qint64 m_framesWritten;
+    qint64 m_framesRead;
+    qint64 m_bytesWritten;
+    qint64 m_bytesRead;
+};
+
+typedef QPair<QString, QString> Field;
+
+static Field field(const char *name, const QString &value)
+{ return Field(QString::fromLatin1(name), QString::fromLatin1("\"%0\"").arg(value)); }
+static Field field(const char *name, qint64 value)
+{ return Field(QString::fromLatin1(name), QString::number(value)); }
+static Field field(const char *name, double value)
+{ return Field(QString::fromLatin1(name), QString::number(value, 'f', 1)); }
+
+void Client::report(const QString &benchmark, const QList<Field> &fields)
+{
+    QString line = QString::fromLatin1("{\"benchmark\": \"%0\", \"mode\": \"%1\"")
+                   .arg(benchmark).arg(QLatin1String(m_options.remote ? "remote" : "local"));
+    for (int i = 0; i < fields.size(); ++i)
+        line += QString::fromLatin1(", \"%0\": %1").arg(fields.at(i).first).arg(fields.at(i).second);
+    line += QLatin1Char('}');
+    fprintf(stdout, "%s\n", qPrintable(line));
+    fflush(stdout);
+}
+
+bool Client::connectTo(int port)
+{
+    if (port == 0) {
+        fprintf(stderr, "the host couldn't create a target\n");
+        return false;
+    }
+    m_socket = new QTcpSocket();
+    m_socket->connectToHost(QHostAddress::LocalHost, port);
+    if (!m_socket->waitForConnected(5000)) {
+        fprintf(stderr, "failed to connect: %s\n", qPrintable(m_socket->errorString()));
+        return false;
+    }
+    m_socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+    // no optional capabilities, so that the payloads can be decoded with
+    // the plain stream operators
+    QByteArray handshake = QScriptDebuggerProtocol::handshakeData();
+    uchar field[sizeof(quint16) + sizeof(quint32)];
+    qToBigEndian<quint16>(QScriptDebuggerProtocol::ProtocolVersion, field);
+    qToBigEndian<quint32>(0, field + sizeof(quint16));
+    m_socket->write(handshake);
+    m_socket->write(reinterpret_cast<const char*>(field), sizeof(field));
+    while (m_socket->bytesAvailable() < QScriptDebuggerProtocol::HandshakeSize) {
+        if (!m_socket->waitForReadyRead(5000))
+            return false;
+    }
+    if (m_socket->read(handshake.size()) != handshake) {
+        fprintf(stderr, "handshake failed\n");
+        return false;
+    }
+    m_socket->read(sizeof(quint16) + sizeof(quint32));
+    return waitFor(QScriptDebuggerProtocol::ChannelOpenedFrame);
+}
+
+void Client::disconnect()
+{
+    if (!m_socket)
+        return;
+    if (m_socket->state() == QAbstractSocket::ConnectedState) {
+        QByteArray payload;
+        QDataStream out(&payload, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_4_5);
+        out << m_nextId++ << QScriptDebuggerCommand::resumeCommand();
+        writeFrame(QScriptDebuggerProtocol::CommandFrame, 0, payload);
+        m_socket->disconnectFromHost();
+        if (m_socket->state() != QAbstractSocket::UnconnectedState)
+            m_socket->waitForDisconnected(5000);
+    }
+    delete m_socket;
+    m_socket = 0;
+}
+
+// waits until the target has left the evaluation it was stopped in
+void Client::waitForTarget()
+{
+    while (m_proxy->isRunning())
+        msleep(1);
+}
+
+void Client::finish()
+{
+    disconnect();
+    waitForTarget();
+    m_proxy->release();
+}
+
+bool Client::readFrame(quint8 *type, quint32 *channel, QByteArray *payload)
+{
+    while (m_socket->bytesAvailable() < (int)sizeof(quint32)) {
+        if (!m_socket->waitForReadyRead(10000))
+            return false;
+    }
+    QDataStream in(m_socket);
+    in.setVersion(QDataStream::Qt_4_5);
+    quint32 size;
+    in >> size;
+    while (m_socket->bytesAvailable() < size) {
+        if (!m_socket->waitForReadyRead(10000))
+            return false;
+    }
+    in >> *type >> *channel;
+    *payload = m_socket->read(size - QScriptDebuggerProtocol::FrameHeaderSize);
+    ++m_framesRead;
+    m_bytesRead += sizeof(quint32) + size;
+    return true;
+}
+
+void Client::writeFrame(quint8 type, quint32 channel, const QByteArray &payload)
+{
+    QByteArray block;
+    QDataStream out(&block, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_5);
+    out << (quint32)(QScriptDebuggerProtocol::FrameHeaderSize + payload.size());
+    out << type << channel;
+    block.append(payload);
+    m_socket->write(block);
+    m_socket->flush();
+    ++m_framesWritten;
+    m_bytesWritten += block.size();
+}
+
+// skips frames until one of the given type arrives
+bool Client::waitFor(quint8 type, QByteArray *payload)
+{
+    for (;;) {
+        quint8 frameType;
+        quint32 channel;
+        QByteArray frame;
+        if (!readFrame(&frameType, &channel, &frame))
+            return false;
+        if (frameType == type) {
+            if (payload)
+                *payload = frame;
+            return true;
+        }
+    }
+}
+
+bool Client::roundTrip(const QScriptDebuggerCommand &command, QScriptDebuggerResponse *response)
+{
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_5);
+    out << m_nextId++ << command;
+    writeFrame(QScriptDebuggerProtocol::CommandFrame, 0, payload);
+    if (!waitFor(QScriptDebuggerProtocol::ResponseFrame, &payload))
+        return false;
+    if (response) {
+        QDataStream in(payload);
+        in.setVersion(QDataStream::Qt_4_5);
+        qint32 id;
+        in >> id >> *response;
+    }
+    return true;
+}
+
+bool Client::roundTrip(const QList<QScriptDebuggerCommand> &commands,
+                       QList<QScriptDebuggerResponse> *responses)
+{
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_5);
+    out << (quint32)commands.size();
+    for (int i = 0; i < commands.size(); ++i)
+        out << m_nextId++ << commands.at(i);
+    writeFrame(QScriptDebuggerProtocol::CommandBatchFrame, 0, payload);
+    int pending = commands.size();
+    while (pending > 0) {
+        quint8 type;
+        quint32 channel;
+        if (!readFrame(&type, &channel, &payload))
+            return false;
+        if (type != QScriptDebuggerProtocol::ResponseBatchFrame)
+            continue;
+        QDataStream in(payload);
+        in.setVersion(QDataStream::Qt_4_5);
+        quint32 count;
+        in >> count;
+        for (quint32 i = 0; i < count; ++i) {
+            qint32 id;
+            QScriptDebuggerResponse response;
+            in >> id >> response;
+            if (responses)
+                responses->append(response);
+        }
+        pending -= count;
+    }
+    return true;
+}
+
+bool Client::runLatency()
+{
+    if (!connectTo(m_proxy->prepare(1, 10, /*stop=*/true))
+        || !waitFor(QScriptDebuggerProtocol::EventFrame)) {
+        return false;
+    }
+    QList<QPair<const char*, QScriptDebuggerCommand> > commands;
+    commands << qMakePair("GetContextCount", QScriptDebuggerCommand::getContextCountCommand())
+             << qMakePair("GetContextInfo", QScriptDebuggerCommand::getContextInfoCommand(0))
+             << qMakePair("GetContextState", QScriptDebuggerCommand::getContextStateCommand(0))
+             << qMakePair("GetContextID", QScriptDebuggerCommand::getContextIdCommand(0))
+             << qMakePair("GetBacktrace", QScriptDebuggerCommand::getBacktraceCommand())
+             << qMakePair("GetScopeChain", QScriptDebuggerCommand::getScopeChainCommand(0))
+             << qMakePair("GetThisObject", QScriptDebuggerCommand::getThisObjectCommand(0))
+             << qMakePair("GetActivationObject", QScriptDebuggerCommand::getActivationObjectCommand(0))
+             << qMakePair("GetScripts", QScriptDebuggerCommand::getScriptsCommand())
+             << qMakePair("GetBreakpoints", QScriptDebuggerCommand::getBreakpointsCommand())
+             << qMakePair("GetScriptsDelta", QScriptDebuggerCommand::getScriptsDelta());
+    for (int i = 0; i < commands.size(); ++i) {
+        const QScriptDebuggerCommand &command = commands.at(i).second;
+        for (int j = 0; j < 10; ++j)
+            roundTrip(command);
+        QVector<qint64> times(m_options.samples);
+        for (int j = 0; j < m_options.samples; ++j) {
+            qint64 start = nanoTime();
+            if (!roundTrip(command))
+                return false;
+            times[j] = nanoTime() - start;
+        }
+        qSort(times);
+        qint64 total = 0;
+        for (int j = 0; j < times.size(); ++j)
+            total += times.at(j);
+        QList<Field> fields;
+        fields << field("command", QString::fromLatin1(commands.at(i).first))
+               << field("samples", qint64(times.size()))
+               << field("mean_ns", total / times.size())
+               << field("p50_ns", times.at(times.size() / 2))
+               << field("p99_ns", times.at(times.size() * 99 / 100))
+               << field("max_ns", times.last());
+        report(QString::fromLatin1("latency"), fields);
+    }
+    finish();
+    return true;
+}
+
+bool Client::runThroughput()
+{
+    if (!connectTo(m_proxy->prepare(1, 10, /*stop=*/true))
+        || !waitFor(QScriptDebuggerProtocol::EventFrame)) {
+        return false;
+    }
+    // the burst the debugger sends when it stops and fills its views
+    QList<QScriptDebuggerCommand> commands;
+    for (int i = 0; i < 4; ++i) {
+        commands << QScriptDebuggerCommand::getContextInfoCommand(0)
+                 << QScriptDebuggerCommand::getContextStateCommand(0)
+                 << QScriptDebuggerCommand::getScopeChainCommand(0)
+                 << QScriptDebuggerCommand::getThisObjectCommand(0)
+                 << QScriptDebuggerCommand::getActivationObjectCommand(0)
+                 << QScriptDebuggerCommand::getBacktraceCommand();
+    }
+    for (int burst = 0; burst < 2; ++burst) {
+        for (int i = 0; i < 10; ++i)
+            roundTrip(commands);
+        m_framesWritten = m_framesRead = m_bytesWritten = m_bytesRead = 0;
+        qint64 start = nanoTime();
+        for (int i = 0; i < m_options.rounds; ++i) {
+            if (burst) {
+                if (!roundTrip(commands))
+                    return false;
+            } else {
+                for (int j = 0; j < commands.size(); ++j) {
+                    if (!roundTrip(commands.at(j)))
+                        return false;
+                }
+            }
+        }
+        double seconds = double(nanoTime() - start) / 1000000000.0;
+        qint64 frames = m_framesWritten + m_framesRead;
+        qint64 bytes = m_bytesWritten + m_bytesRead;
+        QList<Field> fields;
+        fields << field("framing", QString::fromLatin1(burst ? "batched" : "per-frame"))
+               << field("commands", qint64(commands.size()) * m_options.rounds)
+               << field("frames", frames)
+               << field("bytes", bytes)
+               << field("frames_per_s", frames / seconds)
+               << field("bytes_per_s", bytes / seconds)
+               << field("commands_per_s", commands.size() * m_options.rounds / seconds);
+        report(QString::fromLatin1("throughput"), fields);
+    }
+    finish();
+    return true;
+}
+
+bool Client::runAttach()
+{
+    static const int scriptCounts[] = { 1, 10, 100, 1000 };
+    static const int lineCounts[] = { 10, 1000 };
+    for (int c = 0; c < int(sizeof(scriptCounts) / sizeof(int)); ++c) {
+        for (int l = 0; l < int(sizeof(lineCounts) / sizeof(int)); ++l) {
+            int scripts = scriptCounts[c];
+            int lines = lineCounts[l];
+            int port = m_proxy->prepare(scripts, lines, /*stop=*/false);
+            m_framesWritten = m_framesRead = m_bytesWritten = m_bytesRead = 0;
+            // what the debugger does on attach without a script cache:
+            // find out which scripts there are and fetch each of them
+            qint64 start = nanoTime();
+            if (!connectTo(port))
+                return false;
+            QScriptDebuggerResponse response;
+            if (!roundTrip(QScriptDebuggerCommand::scriptsCheckpoint(), &response))
+                return false;
+            QScriptScriptsDelta delta = qvariant_cast<QScriptScriptsDelta>(response.result());
+            QList<QScriptDebuggerCommand> fetch;
+            for (int i = 0; i < delta.first.size(); ++i)
+                fetch.append(QScriptDebuggerCommand::getScriptDataCommand(delta.first.at(i)));
+            if (!fetch.isEmpty() && !roundTrip(fetch))
+                return false;
+            qint64 elapsed = nanoTime() - start;
+            QList<Field> fields;
+            fields << field("scripts", qint64(scripts))
+                   << field("lines_per_script", qint64(lines))
+                   << field("scripts_fetched", qint64(delta.first.size()))
+                   << field("attach_ns", elapsed)
+                   << field("bytes", m_bytesWritten + m_bytesRead);
+            report(QString::fromLatin1("attach"), fields);
+            finish();
+        }
+    }
+    return true;
+}
+
+bool Client::runOverhead()
+{
+    qint64 statements = qint64(m_options.iterations) * 3;
+    QList<QPair<const char*, qint64> > results;
+    results << qMakePair("none", m_proxy->measure(m_options.iterations, m_options.runs, false));
+    int port = m_proxy->prepare(0, 0, /*stop=*/true);
+    results << qMakePair("attached", m_proxy->measure(m_options.iterations, m_options.runs, true));
+    // the target breaks when the debugger connects; let it go before
+    // measuring, so that the loop runs with the debugger just listening
+    if (!connectTo(port) || !waitFor(QScriptDebuggerProtocol::EventFrame))
+        return false;
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_5);
+    out << m_nextId++ << QScriptDebuggerCommand::resumeCommand();
+    writeFrame(QScriptDebuggerProtocol::CommandFrame, 0, payload);
+    waitForTarget();
+    results << qMakePair("connected", m_proxy->measure(m_options.iterations, m_options.runs, true));
+    finish();
+
+    qint64 baseline = qMax(Q_INT64_C(1), results.first().second);
+    for (int i = 0; i < results.size(); ++i) {
+        qint64 ns = results.at(i).second;
+        QList<Field> fields;
+        fields << field("agent", QString::fromLatin1(results.at(i).first))
+               << field("statements", statements)
+               << field("total_ns", ns)
+               << field("ns_per_statement", double(ns) / statements)
+               << field("relative", double(ns) / baseline);
+        report(QString::fromLatin1("overhead"), fields);
+    }
+    return true;
+}
+
+bool Client::runOutput()
+{
+    static const int batchIntervals[] = { 0, QScriptDebuggerEngine::DefaultOutputBatchInterval };
+    int prints = m_options.rounds * 10;
+    for (int b = 0; b < int(sizeof(batchIntervals) / sizeof(int)); ++b) {
+        int batchInterval = batchIntervals[b];
+        if (!connectTo(m_proxy->prepareOutput(prints, batchInterval)))
+            return false;
+        // the target starts printing once it has seen the client
+        m_framesWritten = m_framesRead = m_bytesWritten = m_bytesRead = 0;
+        qint64 start = nanoTime();
+        qint64 lines = 0;
+        qint64 frames = 0;
+        while (lines < prints) {
+            QByteArray payload;
+            if (!waitFor(QScriptDebuggerProtocol::OutputFrame, &payload))
+                return false;
+            QDataStream in(payload);
+            in.setVersion(QDataStream::Qt_4_5);
+            QList<QScriptDebuggerOutputEntry> output;
+            in >> output;
+            lines += output.size();
+            ++frames;
+        }
+        double seconds = double(nanoTime() - start) / 1000000000.0;
+        QList<Field> fields;
+        fields << field("batching", QString::fromLatin1(batchInterval ? "on" : "off"))
+               << field("batch_interval_ms", qint64(batchInterval))
+               << field("prints", qint64(prints))
+               << field("frames", frames)
+               << field("bytes", m_bytesRead)
+               << field("prints_per_s", prints / seconds)
+               << field("frames_per_s", frames / seconds);
+        report(QString::fromLatin1("output"), fields);
+        finish();
+    }
+    return true;
+}
+
+void Client::run()
+{
+    m_ok = false;
+    QProcess *process = 0;
+    if (m_options.remote) {
+        process = new QProcess();
+        process->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+        process->start(QCoreApplication::applicationFilePath(),
+                       QStringList() << QString::fromLatin1("--host")
+                                     << QString::fromLatin1("--port=%0").arg(m_options.port));
+        if (!process->waitForStarted()) {
+            fprintf(stderr, "failed to start the host process\n");
+            delete process;
+            QMetaObject::invokeMethod(QCoreApplication::instance(), "quit", Qt::QueuedConnection);
+            return;
+        }
+        m_proxy = new RemoteHostProxy(process);
+    } else {
+        m_proxy = new LocalHostProxy(m_host);
+    }
+
+    QStringList suites = m_options.suites.split(QLatin1Char(','));
+    bool ok = true;
+    if (ok && suites.contains(QLatin1String("latency")))
+        ok = runLatency();
+    if (ok && suites.contains(QLatin1String("throughput")))
+        ok = runThroughput();
+    if (ok && suites.contains(QLatin1String("attach")))
+        ok = runAttach();
+    if (ok && suites.contains(QLatin1String("overhead")))
+        ok = runOverhead();
+    if (ok && suites.contains(QLatin1String("output")))
+        ok = runOutput();
+    if (!ok)
+        fprintf(stderr, "timed out waiting for the target\n");
+    disconnect();
+    m_ok = ok;
+
+    delete m_proxy;
+    if (process) {
+        process->closeWriteChannel();
+        if (!process->waitForFinished(10000))
+            process->kill();
+        delete process;
+    }
+    QMetaObject::invokeMethod(QCoreApplication::instance(), "quit", Qt::QueuedConnection);
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    Options options;
+    options.suites = QString::fromLatin1("latency,throughput,attach,overhead,output");
+    options.samples = 1000;
+    options.rounds = 1000;
+    options.iterations = 1000000;
+    options.runs = 3;
+    options.remote = false;
+    options.port = 2100;
+    bool host = false;
+    QStringList args = app.arguments();
+    for (int i = 1; i < args.size(); ++i) {
+        QString arg = args.at(i);
+        if (arg.startsWith(QLatin1String("--suites=")))
+            options.suites = arg.mid(9);
+        else if (arg.startsWith(QLatin1String("--samples=")))
+            options.samples = qMax(1, arg.mid(10).toInt());
+        else if (arg.startsWith(QLatin1String("--rounds=")))
+            options.rounds = qMax(1, arg.mid(9).toInt());
+        else if (arg.startsWith(QLatin1String("--iterations=")))
+            options.iterations = qMax(10, arg.mid(13).toInt());
+        else if (arg.startsWith(QLatin1String("--runs=")))
+            options.runs = qMax(1, arg.mid(7).toInt());
+        else if (arg.startsWith(QLatin1String("--port=")))
+            options.port = arg.mid(7).toUShort();
+        else if (arg == QLatin1String("--remote"))
+            options.remote = true;
+        else if (arg == QLatin1String("--host"))
+            host = true;
+        else {
+            fprintf(stdout, "Usage: protocolsuite [--suites=latency,throughput,attach,overhead,output]\n"
+                            "                     [--samples=N] [--rounds=N] [--iterations=N] [--runs=N]\n"
+                            "                     [--port=NUM] [--remote]\n");
+            return 0;
+        }
+    }
+
+    qScriptDebugRegisterMetaTypes();
+    Host targets(options.port);
+    if (host) {
+        HostServer server(&targets);
+        server.start();
+        int ret = app.exec();
+        server.wait();
+        return ret;
+    }
+    Client client(&targets, options);
+    client.start();
+    app.exec();
+    client.wait();
+    return client.ok() ? 0 : 1;
+}
+
+#include "main.moc"
@@ -0,0 +1,235 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+// Compares the round-trip latency of the debugger transports on the same
+// host: the time it takes a message of a given size (by default, about
+// the size of a step command or a small locals response) to reach a
+// child process and be echoed back.
+//
+// The child is this program started with --echo; it is connected to over
+// each transport in turn, so both ends pay the same costs that a debugger
+// and a debuggee would.
+
+#include <QtCore>
+#include <qscriptdebuggertransport_p.h>
+
+#include <stdio.h>
+
+static const char *transportNames[] = { "tcp", "local", "pipe", "shm" };
+
+static int transportType(const QString &name)
+{
+    for (int i = 0; i < 4; ++i) {
+        if (name == QLatin1String(transportNames[i]))
+            return i;
+    }
+    return -1;
+}
+
+class Echo : public QObject
+{
+    Q_OBJECT
+public:
+    Echo(QScriptDebuggerTransport *transport)
+        : m_transport(transport)
+    {
+        QObject::connect(transport, SIGNAL(readyRead()), this, SLOT(echo()));
+        QObject::connect(transport, SIGNAL(disconnected()), QCoreApplication::instance(), SLOT(quit()));
+    }
+
+private Q_SLOTS:
+    void echo()
+    {
+        QIODevice *device = m_transport->device();
+        device->write(device->readAll());
+    }
+
+private:
+    QScriptDebuggerTransport *m_transport;
+};
+
+class Pinger : public QObject
+{
+    Q_OBJECT
+public:
+    Pinger(QScriptDebuggerTransport *transport)
+        : m_transport(transport), m_connected(false), m_expected(0), m_received(0)
+    {
+        QObject::connect(transport, SIGNAL(connected()), this, SLOT(onConnected()));
+        QObject::connect(transport, SIGNAL(disconnected()), &m_loop, SLOT(quit()));
+        QObject::connect(transport, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+    }
+
+    bool waitForConnected(int msecs)
+    {
+        QTimer::singleShot(msecs, &m_loop, SLOT(quit()));
+        if (!m_connected)
+            m_loop.exec();
+        return m_connected;
+    }
+
+    bool roundTrip(const QByteArray &message)
+    {
+        m_expected = message.size();
+        m_received = 0;
+        m_transport->device()->write(message);
+        while (m_received < m_expected) {
+            if (!m_transport->device())
+                return false;
+            m_loop.exec();
+        }
+        return true;
+    }
+
+private Q_SLOTS:
+    void onConnected()
+    {
+        m_connected = true;
+        m_loop.quit();
+    }
+
+    void onReadyRead()
+    {
+        m_received += m_transport->device()->readAll().size();
+        if (m_received >= m_expected)
+            m_loop.quit();
+    }
+
+private:
+    QScriptDebuggerTransport *m_transport;
+    QEventLoop m_loop;
+    bool m_connected;
+    int m_expected;
+    int m_received;
+};
+
+static int runEcho(int type, const QString &address)
+{
+    QScriptDebuggerTransport *transport = QScriptDebuggerTransport::create(
+        QScriptDebuggerTransport::Type(type));
+    Echo echo(transport);
+    if (type == QScriptDebuggerTransport::PipeTransport)
+        transport->listen(QString());
+    else
+        transport->connectToPeer(address);
+    int ret = QCoreApplication::exec();
+    delete transport;
+    return ret;
+}
+
+static void measure(int type, int roundTrips, int size)
+{
+    QString program = QCoreApplication::applicationFilePath();
+    QString echoArg = QString::fromLatin1("--echo=%0").arg(QLatin1String(transportNames[type]));
+    QString address;
+    switch (type) {
+    case QScriptDebuggerTransport::TcpTransport:
+        address = QString::fromLatin1("127.0.0.1:2050");
+        break;
+    case QScriptDebuggerTransport::LocalSocketTransport:
+    case QScriptDebuggerTransport::SharedMemoryTransport:
+        address = QString::fromLatin1("qscriptdebugger-latency-%0")
+                  .arg(QCoreApplication::applicationPid());
+        break;
+    case QScriptDebuggerTransport::PipeTransport:
+        address = QString::fromLatin1("\"%0\" %1").arg(program).arg(echoArg);
+        break;
+    }
+
+    QScriptDebuggerTransport *transport = QScriptDebuggerTransport::create(
+        QScriptDebuggerTransport::Type(type));
+    Pinger pinger(transport);
+    QProcess child;
+    if (type == QScriptDebuggerTransport::PipeTransport) {
+        transport->connectToPeer(address);
+    } else {
+        if (!transport->listen(address)) {
+            fprintf(stderr, "%s: failed to listen: %s\n", transportNames[type],
+                    qPrintable(transport->errorString()));
+            delete transport;
+            return;
+        }
+        child.setProcessChannelMode(QProcess::ForwardedChannels);
+        child.start(program, QStringList() << echoArg
+                    << QString::fromLatin1("--address=%0").arg(address));
+    }
+    if (!pinger.waitForConnected(5000)) {
+        fprintf(stderr, "%s: the echo process didn't connect\n", transportNames[type]);
+        delete transport;
+        return;
+    }
+
+    QByteArray message(size, 'x');
+    for (int i = 0; i < 100; ++i)
+        pinger.roundTrip(message);
+    QTime timer;
+    timer.start();
+    int done = 0;
+    while ((done < roundTrips) && pinger.roundTrip(message))
+        ++done;
+    int elapsed = timer.elapsed();
+    fprintf(stdout, "%-8s %10d %10d %14.1f\n", transportNames[type], size, done,
+            done ? double(elapsed) * 1000.0 / done : 0.0);
+
+    transport->disconnectFromPeer();
+    child.waitForFinished(5000);
+    delete transport;
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    int roundTrips = 10000;
+    int size = 64;
+    QList<int> types;
+    int echoType = -1;
+    QString address;
+    QStringList args = app.arguments();
+    for (int i = 1; i < args.size(); ++i) {
+        QString arg = args.at(i);
+        if (arg.startsWith(QLatin1String("--echo=")))
+            echoType = transportType(arg.mid(7));
+        else if (arg.startsWith(QLatin1String("--address=")))
+            address = arg.mid(10);
+        else if (arg.startsWith(QLatin1String("--transport=")) && (transportType(arg.mid(12)) != -1))
+            types.append(transportType(arg.mid(12)));
+        else if (arg.startsWith(QLatin1String("--round-trips=")))
+            roundTrips = qMax(1, arg.mid(14).toInt());
+        else if (arg.startsWith(QLatin1String("--size=")))
+            size = qMax(1, arg.mid(7).toInt());
+        else {
+            fprintf(stdout, "Usage: transportlatency [--transport=tcp|local|pipe|shm]... "
+                    "[--round-trips=N] [--size=BYTES]\n");
+            return 0;
+        }
+    }
+    if (echoType != -1)
+        return runEcho(echoType, address);
+
+    if (types.isEmpty())
+        types << 0 << 1 << 2 << 3;
+    fprintf(stdout, "%-8s %10s %10s %14s\n", "transport", "bytes", "round-trips", "us/round-trip");
+    for (int i = 0; i < types.size(); ++i)
+        measure(types.at(i), roundTrips, size);
+    return 0;
+}
+
+#include "main.moc"
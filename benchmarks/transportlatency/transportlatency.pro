@@ -0,0 +1,11 @@
+TEMPLATE = app
+TARGET = 
+DEPENDPATH += .
+INCLUDEPATH += .
+QT += network
+CONFIG += release
+win32: CONFIG += console
+mac:CONFIG -= app_bundle
+INCLUDEPATH += ../../src
+SOURCES += main.cpp ../../src/qscriptdebuggertransport.cpp
+HEADERS += ../../src/qscriptdebuggertransport_p.h
@@ -1,3 +1,4 @@
 TEMPLATE = subdirs
 SUBDIRS = debugger \
-	  debuggee 
+	  debuggee \
+	  headless
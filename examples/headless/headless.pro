@@ -0,0 +1,9 @@
+TEMPLATE = app
+TARGET = 
+DEPENDPATH += .
+INCLUDEPATH += .
+QT += script scripttools network
+win32: CONFIG += console
+mac:CONFIG -= app_bundle
+include(../../src/headlessdebugger.pri)
+SOURCES += main.cpp
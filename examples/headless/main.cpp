@@ -0,0 +1,195 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+// Attaches to a debuggee without a user interface, sets the breakpoints
+// given on the command line, and prints the stack and the local variables
+// whenever the script stops on one of them or throws an exception that it
+// doesn't handle.
+
+#include <QtCore>
+#include <QtNetwork>
+#include "qscriptheadlessdebugger.h"
+
+#include <stdio.h>
+
+void qScriptDebugRegisterMetaTypes();
+
+class Runner : public QObject
+{
+    Q_OBJECT
+public:
+    Runner(const QHostAddress &addr, quint16 port, bool listen,
+           const QStringList &breakpoints, QObject *parent = 0);
+private slots:
+    void onDetached();
+    void onError(QScriptHeadlessDebugger::Error error);
+    void onChannelOpened(int channel, const QString &name);
+    void onEvaluationSuspended(int channel, QScriptHeadlessDebugger::SuspendReason reason,
+                               const QString &fileName, int lineNumber, const QString &message);
+    void onDebugOutput(int channel, const QString &message);
+private:
+    void setBreakpoints(int channel);
+    void printStack(int channel);
+    QScriptHeadlessDebugger *m_debugger;
+    QStringList m_breakpoints;
+    QSet<int> m_started;
+};
+
+Runner::Runner(const QHostAddress &addr, quint16 port, bool listen,
+               const QStringList &breakpoints, QObject *parent)
+    : QObject(parent), m_breakpoints(breakpoints)
+{
+    m_debugger = new QScriptHeadlessDebugger(this);
+    QObject::connect(m_debugger, SIGNAL(detached()), this, SLOT(onDetached()));
+    QObject::connect(m_debugger, SIGNAL(error(QScriptHeadlessDebugger::Error)),
+                     this, SLOT(onError(QScriptHeadlessDebugger::Error)));
+    QObject::connect(m_debugger, SIGNAL(channelOpened(int,QString)),
+                     this, SLOT(onChannelOpened(int,QString)));
+    QObject::connect(m_debugger, SIGNAL(evaluationSuspended(int,QScriptHeadlessDebugger::SuspendReason,QString,int,QString)),
+                     this, SLOT(onEvaluationSuspended(int,QScriptHeadlessDebugger::SuspendReason,QString,int,QString)));
+    QObject::connect(m_debugger, SIGNAL(debugOutput(int,QString)),
+                     this, SLOT(onDebugOutput(int,QString)));
+    if (listen) {
+        if (m_debugger->listen(addr, port))
+            qDebug("listening for debuggee connection at %s:%d", qPrintable(addr.toString()), port);
+        else {
+            qWarning("Failed to listen!");
+            QCoreApplication::quit();
+        }
+    } else {
+        qDebug("attaching to %s:%d", qPrintable(addr.toString()), port);
+        m_debugger->attachTo(addr, port);
+    }
+}
+
+void Runner::onDetached()
+{
+    QCoreApplication::quit();
+}
+
+void Runner::onError(QScriptHeadlessDebugger::Error /*error*/)
+{
+    QCoreApplication::quit();
+}
+
+void Runner::onChannelOpened(int channel, const QString &name)
+{
+    fprintf(stdout, "[%d] engine \"%s\"\n", channel, qPrintable(name));
+}
+
+void Runner::onEvaluationSuspended(int channel, QScriptHeadlessDebugger::SuspendReason reason,
+                                   const QString &fileName, int lineNumber, const QString &message)
+{
+    if (!m_started.contains(channel)) {
+        // the target stops when the debugger attaches
+        m_started.insert(channel);
+        setBreakpoints(channel);
+    } else if (reason == QScriptHeadlessDebugger::ExceptionThrown) {
+        fprintf(stdout, "[%d] uncaught exception at %s:%d: %s\n", channel,
+                qPrintable(fileName), lineNumber, qPrintable(message));
+        printStack(channel);
+    } else if (reason == QScriptHeadlessDebugger::BreakpointReached) {
+        fprintf(stdout, "[%d] breakpoint at %s:%d\n", channel, qPrintable(fileName), lineNumber);
+        printStack(channel);
+    }
+    m_debugger->continueEvaluation(channel)->deleteLater();
+}
+
+void Runner::onDebugOutput(int channel, const QString &message)
+{
+    fprintf(stdout, "[%d] %s\n", channel, qPrintable(message));
+}
+
+void Runner::setBreakpoints(int channel)
+{
+    for (int i = 0; i < m_breakpoints.size(); ++i) {
+        QString location = m_breakpoints.at(i);
+        int split = location.lastIndexOf(QLatin1Char(':'));
+        QScriptHeadlessDebuggerReply *reply = m_debugger->setBreakpoint(
+            channel, location.left(split), location.mid(split + 1).toInt());
+        if (!reply->waitForFinished() || reply->hasError())
+            qWarning("can't set a breakpoint at %s", qPrintable(location));
+        delete reply;
+    }
+}
+
+void Runner::printStack(int channel)
+{
+    QScriptHeadlessDebuggerReply *backtrace = m_debugger->backtrace(channel);
+    QScriptHeadlessDebuggerReply *locals = m_debugger->locals(channel);
+    // both commands are sent together
+    if (backtrace->waitForFinished() && !backtrace->hasError()) {
+        QStringList frames = backtrace->result().toStringList();
+        for (int i = 0; i < frames.size(); ++i)
+            fprintf(stdout, "    #%d %s\n", i, qPrintable(frames.at(i)));
+    }
+    if (locals->waitForFinished() && !locals->hasError()) {
+        QVariantMap variables = locals->result().toMap();
+        QVariantMap::const_iterator it;
+        for (it = variables.constBegin(); it != variables.constEnd(); ++it)
+            fprintf(stdout, "    %s = %s\n", qPrintable(it.key()), qPrintable(it.value().toString()));
+    }
+    delete backtrace;
+    delete locals;
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+
+    QHostAddress addr(QHostAddress::LocalHost);
+    quint16 port = 2000;
+    bool listen = false;
+    QStringList breakpoints;
+    for (int i = 1; i < argc; ++i) {
+        QString arg(argv[i]);
+        arg = arg.trimmed();
+        if(arg.startsWith("--")) {
+            QString opt;
+            QString val;
+            int split = arg.indexOf("=");
+            if(split > 0) {
+                opt = arg.mid(2).left(split-2);
+                val = arg.mid(split + 1).trimmed();
+            } else {
+                opt = arg.mid(2);
+            }
+            if (opt == QLatin1String("address"))
+                addr.setAddress(val);
+            else if (opt == QLatin1String("port"))
+                port = val.toUShort();
+            else if (opt == QLatin1String("listen"))
+                listen = true;
+            else if (opt == QLatin1String("break"))
+                breakpoints.append(val);
+            else if (opt == QLatin1String("help")) {
+                fprintf(stdout, "Usage: headless --address=ADDR --port=NUM [--listen] [--break=FILE:LINE]...\n");
+                return(-1);
+            }
+        }
+    }
+
+    qScriptDebugRegisterMetaTypes();
+    Runner runner(addr, port, listen, breakpoints);
+    return app.exec();
+}
+
+#include "main.moc"
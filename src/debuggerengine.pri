@@ -1,5 +1,18 @@
 INCLUDEPATH += $$PWD
 DEPENDPATH += $$PWD
-SOURCES += $$PWD/qscriptdebuggerengine.cpp $$PWD/qscriptdebuggermetatypes.cpp
-HEADERS += $$PWD/qscriptdebuggerengine.h
+SOURCES += $$PWD/qscriptdebuggerengine.cpp $$PWD/qscriptdebuggermetatypes.cpp \
+           $$PWD/qscriptdebuggerframecodec.cpp $$PWD/qscriptdebuggercompactencoding.cpp \
+           $$PWD/qscriptdebuggertransport.cpp $$PWD/qscriptdebuggerprofiler.cpp \
+           $$PWD/qscriptdebuggercoveragerecorder.cpp $$PWD/qscriptdebuggerhookagent.cpp \
+           $$PWD/qscriptdebuggerheapwalker.cpp $$PWD/qscriptdebuggerpager.cpp \
+           $$PWD/qscriptdebuggertrace.cpp \
+           $$PWD/qscriptdebuggersessionlog.cpp $$PWD/qscriptdebuggermetrics.cpp
+HEADERS += $$PWD/qscriptdebuggerengine.h $$PWD/qscriptdebuggerprotocol_p.h \
+           $$PWD/qscriptdebuggerspscqueue_p.h $$PWD/qscriptdebuggerframecodec_p.h \
+           $$PWD/qscriptdebuggermetatypes_p.h $$PWD/qscriptdebuggercompactencoding_p.h \
+           $$PWD/qscriptdebuggertransport_p.h $$PWD/qscriptdebuggerprofiler_p.h \
+           $$PWD/qscriptdebuggercoveragerecorder_p.h $$PWD/qscriptdebuggerhookagent_p.h \
+           $$PWD/qscriptdebuggerheapwalker_p.h $$PWD/qscriptdebuggerpager_p.h \
+           $$PWD/qscriptdebuggertrace_p.h \
+           $$PWD/qscriptdebuggersessionlog_p.h $$PWD/qscriptdebuggermetrics_p.h
 DEFINES += QT_BUILD_INTERNAL
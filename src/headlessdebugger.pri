@@ -0,0 +1,18 @@
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+SOURCES += $$PWD/qscriptheadlessdebugger.cpp $$PWD/qscriptremotetargetdebuggerconnection.cpp \
+           $$PWD/qscriptdebuggermetatypes.cpp \
+           $$PWD/qscriptdebuggerframecodec.cpp $$PWD/qscriptdebuggercompactencoding.cpp \
+           $$PWD/qscriptdebuggerscriptcache.cpp $$PWD/qscriptdebuggertransport.cpp \
+           $$PWD/qscriptdebuggerprofile.cpp $$PWD/qscriptdebuggercoverage.cpp \
+           $$PWD/qscriptdebuggerheapsnapshot.cpp $$PWD/qscriptdebuggertrace.cpp \
+           $$PWD/qscriptdebuggersessionlog.cpp $$PWD/qscriptdebuggermetrics.cpp
+HEADERS += $$PWD/qscriptheadlessdebugger.h $$PWD/qscriptremotetargetdebuggerconnection_p.h \
+           $$PWD/qscriptdebuggerprotocol_p.h \
+           $$PWD/qscriptdebuggerframecodec_p.h \
+           $$PWD/qscriptdebuggermetatypes_p.h $$PWD/qscriptdebuggercompactencoding_p.h \
+           $$PWD/qscriptdebuggerscriptcache_p.h $$PWD/qscriptdebuggertransport_p.h \
+           $$PWD/qscriptdebuggerprofile_p.h $$PWD/qscriptdebuggercoverage_p.h \
+           $$PWD/qscriptdebuggerheapsnapshot_p.h $$PWD/qscriptdebuggertrace_p.h \
+           $$PWD/qscriptdebuggersessionlog_p.h $$PWD/qscriptdebuggermetrics_p.h
+DEFINES += QT_BUILD_INTERNAL
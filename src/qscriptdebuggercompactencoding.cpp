@@ -0,0 +1,619 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "qscriptdebuggercompactencoding_p.h"
+#include "qscriptdebuggermetatypes_p.h"
+
+#include <QtCore/qbytearray.h>
+#include <QtCore/qdatetime.h>
+#include <QtCore/qiodevice.h>
+#include <QtCore/qstringlist.h>
+#include <QtCore/qvariant.h>
+
+namespace QScriptDebuggerCompactEncoding
+{
+
+// The tag written in front of every QVariant.
+enum VariantTag {
+    InvalidTag,
+    BoolTag,
+    IntTag,
+    UIntTag,
+    LongLongTag,
+    DoubleTag,
+    StringTag,
+    StringListTag,
+    DebuggerValueTag,
+    DebuggerValueListTag,
+    ValuePropertyTag,
+    ValuePropertyListTag,
+    ScriptDataTag,
+    ScriptMapTag,
+    ScriptsDeltaTag,
+    ObjectSnapshotDeltaTag,
+    IntListTag,
+    LongLongListTag,
+    VariantListTag,
+    VariantMapTag,
+    DataStreamTag = 0xff
+};
+
+static inline void writeVarUInt(QDataStream &out, quint64 value)
+{
+    char buf[10];
+    int n = 0;
+    while (value >= 0x80) {
+        buf[n++] = char((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    buf[n++] = char(value);
+    out.writeRawData(buf, n);
+}
+
+static inline void writeVarInt(QDataStream &out, qint64 value)
+{
+    writeVarUInt(out, (quint64(value) << 1) ^ quint64(value >> 63));
+}
+
+static quint64 readVarUInt(QDataStream &in)
+{
+    quint64 value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        quint8 byte;
+        in >> byte;
+        if (in.status() != QDataStream::Ok)
+            return 0;
+        value |= quint64(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return value;
+    }
+    in.setStatus(QDataStream::ReadCorruptData);
+    return 0;
+}
+
+static inline qint64 readVarInt(QDataStream &in)
+{
+    quint64 value = readVarUInt(in);
+    return qint64(value >> 1) ^ -qint64(value & 1);
+}
+
+// Reads a count or length and makes sure the remaining payload can
+// possibly hold that many bytes, so that a corrupt frame can't make us
+// allocate an arbitrary amount of memory.
+static int readLength(QDataStream &in)
+{
+    quint64 length = readVarUInt(in);
+    if (in.status() != QDataStream::Ok)
+        return 0;
+    if (length > quint64(in.device()->bytesAvailable())) {
+        in.setStatus(QDataStream::ReadCorruptData);
+        return 0;
+    }
+    return int(length);
+}
+
+static inline void writeBool(QDataStream &out, bool value)
+{
+    out << quint8(value ? 1 : 0);
+}
+
+static inline bool readBool(QDataStream &in)
+{
+    quint8 value;
+    in >> value;
+    return (value != 0);
+}
+
+// A null string is written as 0, any other string as its UTF-8 length
+// plus one followed by the UTF-8 data.
+static void writeString(QDataStream &out, const QString &value)
+{
+    if (value.isNull()) {
+        writeVarUInt(out, 0);
+        return;
+    }
+    QByteArray utf8 = value.toUtf8();
+    writeVarUInt(out, quint64(utf8.size()) + 1);
+    out.writeRawData(utf8.constData(), utf8.size());
+}
+
+static QString readString(QDataStream &in)
+{
+    quint64 length = readVarUInt(in);
+    if ((in.status() != QDataStream::Ok) || (length == 0))
+        return QString();
+    --length;
+    if (length > quint64(in.device()->bytesAvailable())) {
+        in.setStatus(QDataStream::ReadCorruptData);
+        return QString();
+    }
+    if (length == 0)
+        return QString::fromLatin1("");
+    QByteArray utf8;
+    utf8.resize(int(length));
+    if (in.readRawData(utf8.data(), int(length)) != int(length)) {
+        in.setStatus(QDataStream::ReadPastEnd);
+        return QString();
+    }
+    return QString::fromUtf8(utf8.constData(), utf8.size());
+}
+
+static void writeStringList(QDataStream &out, const QStringList &list)
+{
+    writeVarUInt(out, list.size());
+    for (int i = 0; i < list.size(); ++i)
+        writeString(out, list.at(i));
+}
+
+static QStringList readStringList(QDataStream &in)
+{
+    QStringList list;
+    int count = readLength(in);
+    for (int i = 0; (i < count) && (in.status() == QDataStream::Ok); ++i)
+        list.append(readString(in));
+    return list;
+}
+
+static void writeDebuggerValue(QDataStream &out, const QScriptDebuggerValue &value)
+{
+    writeVarUInt(out, value.type());
+    switch (value.type()) {
+    case QScriptDebuggerValue::NoValue:
+    case QScriptDebuggerValue::UndefinedValue:
+    case QScriptDebuggerValue::NullValue:
+        break;
+    case QScriptDebuggerValue::BooleanValue:
+        writeBool(out, value.booleanValue());
+        break;
+    case QScriptDebuggerValue::StringValue:
+        writeString(out, value.stringValue());
+        break;
+    case QScriptDebuggerValue::NumberValue:
+        out << value.numberValue();
+        break;
+    case QScriptDebuggerValue::ObjectValue:
+        writeVarInt(out, value.objectId());
+        break;
+    }
+}
+
+static QScriptDebuggerValue readDebuggerValue(QDataStream &in)
+{
+    QScriptDebuggerValue::ValueType type = QScriptDebuggerValue::ValueType(readVarUInt(in));
+    switch (type) {
+    case QScriptDebuggerValue::NoValue:
+    case QScriptDebuggerValue::UndefinedValue:
+    case QScriptDebuggerValue::NullValue:
+        return QScriptDebuggerValue(type);
+    case QScriptDebuggerValue::BooleanValue:
+        return QScriptDebuggerValue(readBool(in));
+    case QScriptDebuggerValue::StringValue:
+        return QScriptDebuggerValue(readString(in));
+    case QScriptDebuggerValue::NumberValue: {
+        double number;
+        in >> number;
+        return QScriptDebuggerValue(number);
+    }
+    case QScriptDebuggerValue::ObjectValue: {
+        // there is no public way to construct an object value, so let
+        // the QDataStream operator do it
+        qint64 id = readVarInt(in);
+        QByteArray bytes;
+        {
+            QDataStream tmp(&bytes, QIODevice::WriteOnly);
+            tmp.setVersion(QDataStream::Qt_4_5);
+            tmp << quint32(QScriptDebuggerValue::ObjectValue) << id;
+        }
+        QDataStream tmp(bytes);
+        tmp.setVersion(QDataStream::Qt_4_5);
+        QScriptDebuggerValue value;
+        tmp >> value;
+        return value;
+    }
+    }
+    in.setStatus(QDataStream::ReadCorruptData);
+    return QScriptDebuggerValue();
+}
+
+static void writeValueProperty(QDataStream &out, const QScriptDebuggerValueProperty &property)
+{
+    writeString(out, property.name());
+    writeDebuggerValue(out, property.value());
+    writeString(out, property.valueAsString());
+    writeVarUInt(out, quint32(property.flags()));
+}
+
+static QScriptDebuggerValueProperty readValueProperty(QDataStream &in)
+{
+    QString name = readString(in);
+    QScriptDebuggerValue value = readDebuggerValue(in);
+    QString valueAsString = readString(in);
+    QScriptValue::PropertyFlags flags = QScriptValue::PropertyFlags(int(readVarUInt(in)));
+    return QScriptDebuggerValueProperty(name, value, valueAsString, flags);
+}
+
+static void writeValuePropertyList(QDataStream &out, const QScriptDebuggerValuePropertyList &list)
+{
+    writeVarUInt(out, list.size());
+    for (int i = 0; i < list.size(); ++i)
+        writeValueProperty(out, list.at(i));
+}
+
+static QScriptDebuggerValuePropertyList readValuePropertyList(QDataStream &in)
+{
+    QScriptDebuggerValuePropertyList list;
+    int count = readLength(in);
+    for (int i = 0; (i < count) && (in.status() == QDataStream::Ok); ++i)
+        list.append(readValueProperty(in));
+    return list;
+}
+
+static void writeScriptData(QDataStream &out, const QScriptScriptData &data)
+{
+    writeString(out, data.contents());
+    writeString(out, data.fileName());
+    writeVarInt(out, data.baseLineNumber());
+    out << data.timeStamp();
+}
+
+static QScriptScriptData readScriptData(QDataStream &in)
+{
+    QString contents = readString(in);
+    QString fileName = readString(in);
+    int baseLineNumber = int(readVarInt(in));
+    QDateTime timeStamp;
+    in >> timeStamp;
+    return QScriptScriptData(contents, fileName, baseLineNumber, timeStamp);
+}
+
+static void writeIdList(QDataStream &out, const QList<qint64> &list)
+{
+    writeVarUInt(out, list.size());
+    for (int i = 0; i < list.size(); ++i)
+        writeVarInt(out, list.at(i));
+}
+
+static QList<qint64> readIdList(QDataStream &in)
+{
+    QList<qint64> list;
+    int count = readLength(in);
+    for (int i = 0; (i < count) && (in.status() == QDataStream::Ok); ++i)
+        list.append(readVarInt(in));
+    return list;
+}
+
+static void writeVariant(QDataStream &out, const QVariant &value);
+static QVariant readVariant(QDataStream &in, int depth = 0);
+
+static void writeVariant(QDataStream &out, const QVariant &value)
+{
+    int type = value.userType();
+    switch (type) {
+    case QVariant::Invalid:
+        out << quint8(InvalidTag);
+        return;
+    case QVariant::Bool:
+        out << quint8(BoolTag);
+        writeBool(out, value.toBool());
+        return;
+    case QVariant::Int:
+        out << quint8(IntTag);
+        writeVarInt(out, value.toInt());
+        return;
+    case QVariant::UInt:
+        out << quint8(UIntTag);
+        writeVarUInt(out, value.toUInt());
+        return;
+    case QVariant::LongLong:
+        out << quint8(LongLongTag);
+        writeVarInt(out, value.toLongLong());
+        return;
+    case QVariant::Double:
+        out << quint8(DoubleTag) << value.toDouble();
+        return;
+    case QVariant::String:
+        out << quint8(StringTag);
+        writeString(out, value.toString());
+        return;
+    case QVariant::StringList:
+        out << quint8(StringListTag);
+        writeStringList(out, value.toStringList());
+        return;
+    case QVariant::List: {
+        QVariantList list = value.toList();
+        out << quint8(VariantListTag);
+        writeVarUInt(out, list.size());
+        for (int i = 0; i < list.size(); ++i)
+            writeVariant(out, list.at(i));
+    }   return;
+    case QVariant::Map: {
+        QVariantMap map = value.toMap();
+        out << quint8(VariantMapTag);
+        writeVarUInt(out, map.size());
+        QVariantMap::const_iterator it;
+        for (it = map.constBegin(); it != map.constEnd(); ++it) {
+            writeString(out, it.key());
+            writeVariant(out, it.value());
+        }
+    }   return;
+    default:
+        break;
+    }
+
+    if (type == qMetaTypeId<QScriptDebuggerValue>()) {
+        out << quint8(DebuggerValueTag);
+        writeDebuggerValue(out, qvariant_cast<QScriptDebuggerValue>(value));
+    } else if (type == qMetaTypeId<QScriptDebuggerValueList>()) {
+        QScriptDebuggerValueList list = qvariant_cast<QScriptDebuggerValueList>(value);
+        out << quint8(DebuggerValueListTag);
+        writeVarUInt(out, list.size());
+        for (int i = 0; i < list.size(); ++i)
+            writeDebuggerValue(out, list.at(i));
+    } else if (type == qMetaTypeId<QScriptDebuggerValueProperty>()) {
+        out << quint8(ValuePropertyTag);
+        writeValueProperty(out, qvariant_cast<QScriptDebuggerValueProperty>(value));
+    } else if (type == qMetaTypeId<QScriptDebuggerValuePropertyList>()) {
+        out << quint8(ValuePropertyListTag);
+        writeValuePropertyList(out, qvariant_cast<QScriptDebuggerValuePropertyList>(value));
+    } else if (type == qMetaTypeId<QScriptScriptData>()) {
+        out << quint8(ScriptDataTag);
+        writeScriptData(out, qvariant_cast<QScriptScriptData>(value));
+    } else if (type == qMetaTypeId<QScriptScriptMap>()) {
+        QScriptScriptMap map = qvariant_cast<QScriptScriptMap>(value);
+        out << quint8(ScriptMapTag);
+        writeVarUInt(out, map.size());
+        QScriptScriptMap::const_iterator it;
+        for (it = map.constBegin(); it != map.constEnd(); ++it) {
+            writeVarInt(out, it.key());
+            writeScriptData(out, it.value());
+        }
+    } else if (type == qMetaTypeId<QScriptScriptsDelta>()) {
+        QScriptScriptsDelta delta = qvariant_cast<QScriptScriptsDelta>(value);
+        out << quint8(ScriptsDeltaTag);
+        writeIdList(out, delta.first);
+        writeIdList(out, delta.second);
+    } else if (type == qMetaTypeId<QScriptDebuggerObjectSnapshotDelta>()) {
+        QScriptDebuggerObjectSnapshotDelta delta = qvariant_cast<QScriptDebuggerObjectSnapshotDelta>(value);
+        out << quint8(ObjectSnapshotDeltaTag);
+        writeStringList(out, delta.removedProperties);
+        writeValuePropertyList(out, delta.changedProperties);
+        writeValuePropertyList(out, delta.addedProperties);
+    } else if (type == qMetaTypeId<QList<int> >()) {
+        QList<int> list = qvariant_cast<QList<int> >(value);
+        out << quint8(IntListTag);
+        writeVarUInt(out, list.size());
+        for (int i = 0; i < list.size(); ++i)
+            writeVarInt(out, list.at(i));
+    } else if (type == qMetaTypeId<QList<qint64> >()) {
+        out << quint8(LongLongListTag);
+        writeIdList(out, qvariant_cast<QList<qint64> >(value));
+    } else {
+        // anything else (context infos, breakpoints, ...) is rare enough
+        // that it isn't worth a dedicated encoding
+        QByteArray bytes;
+        {
+            QDataStream tmp(&bytes, QIODevice::WriteOnly);
+            tmp.setVersion(QDataStream::Qt_4_5);
+            tmp << value;
+        }
+        out << quint8(DataStreamTag);
+        writeVarUInt(out, bytes.size());
+        out.writeRawData(bytes.constData(), bytes.size());
+    }
+}
+
+// Reads a variant that is nested in \a depth variant lists or maps.
+static QVariant readVariant(QDataStream &in, int depth)
+{
+    quint8 tag;
+    in >> tag;
+    if (in.status() != QDataStream::Ok)
+        return QVariant();
+    switch (tag) {
+    case InvalidTag:
+        return QVariant();
+    case BoolTag:
+        return QVariant(readBool(in));
+    case IntTag:
+        return QVariant(int(readVarInt(in)));
+    case UIntTag:
+        return QVariant(uint(readVarUInt(in)));
+    case LongLongTag:
+        return QVariant(readVarInt(in));
+    case DoubleTag: {
+        double number;
+        in >> number;
+        return QVariant(number);
+    }
+    case StringTag:
+        return QVariant(readString(in));
+    case StringListTag:
+        return QVariant(readStringList(in));
+    case DebuggerValueTag:
+        return qVariantFromValue(readDebuggerValue(in));
+    case DebuggerValueListTag: {
+        QScriptDebuggerValueList list;
+        int count = readLength(in);
+        for (int i = 0; (i < count) && (in.status() == QDataStream::Ok); ++i)
+            list.append(readDebuggerValue(in));
+        return qVariantFromValue(list);
+    }
+    case ValuePropertyTag:
+        return qVariantFromValue(readValueProperty(in));
+    case ValuePropertyListTag:
+        return qVariantFromValue(readValuePropertyList(in));
+    case ScriptDataTag:
+        return qVariantFromValue(readScriptData(in));
+    case ScriptMapTag: {
+        QScriptScriptMap map;
+        int count = readLength(in);
+        for (int i = 0; (i < count) && (in.status() == QDataStream::Ok); ++i) {
+            qint64 id = readVarInt(in);
+            map.insert(id, readScriptData(in));
+        }
+        return qVariantFromValue(map);
+    }
+    case ScriptsDeltaTag: {
+        QScriptScriptsDelta delta;
+        delta.first = readIdList(in);
+        delta.second = readIdList(in);
+        return qVariantFromValue(delta);
+    }
+    case ObjectSnapshotDeltaTag: {
+        QScriptDebuggerObjectSnapshotDelta delta;
+        delta.removedProperties = readStringList(in);
+        delta.changedProperties = readValuePropertyList(in);
+        delta.addedProperties = readValuePropertyList(in);
+        return qVariantFromValue(delta);
+    }
+    case IntListTag: {
+        QList<int> list;
+        int count = readLength(in);
+        for (int i = 0; (i < count) && (in.status() == QDataStream::Ok); ++i)
+            list.append(int(readVarInt(in)));
+        return qVariantFromValue(list);
+    }
+    case LongLongListTag:
+        return qVariantFromValue(readIdList(in));
+    case VariantListTag: {
+        // a frame that nests deeper would take us that deep into the stack
+        if (depth >= MaxNestingDepth)
+            break;
+        QVariantList list;
+        int count = readLength(in);
+        for (int i = 0; (i < count) && (in.status() == QDataStream::Ok); ++i)
+            list.append(readVariant(in, depth + 1));
+        return list;
+    }
+    case VariantMapTag: {
+        if (depth >= MaxNestingDepth)
+            break;
+        QVariantMap map;
+        int count = readLength(in);
+        for (int i = 0; (i < count) && (in.status() == QDataStream::Ok); ++i) {
+            QString key = readString(in);
+            map.insert(key, readVariant(in, depth + 1));
+        }
+        return map;
+    }
+    case DataStreamTag: {
+        int length = readLength(in);
+        if (in.status() != QDataStream::Ok)
+            return QVariant();
+        QByteArray bytes;
+        bytes.resize(length);
+        if (in.readRawData(bytes.data(), length) != length) {
+            in.setStatus(QDataStream::ReadPastEnd);
+            return QVariant();
+        }
+        QDataStream tmp(bytes);
+        tmp.setVersion(QDataStream::Qt_4_5);
+        QVariant value;
+        tmp >> value;
+        if (tmp.status() != QDataStream::Ok)
+            in.setStatus(QDataStream::ReadCorruptData);
+        return value;
+    }
+    default:
+        break;
+    }
+    in.setStatus(QDataStream::ReadCorruptData);
+    return QVariant();
+}
+
+template <class Attributes>
+static void writeAttributes(QDataStream &out, const Attributes &attributes)
+{
+    writeVarUInt(out, attributes.size());
+    typename Attributes::const_iterator it;
+    for (it = attributes.constBegin(); it != attributes.constEnd(); ++it) {
+        writeVarUInt(out, quint32(it.key()));
+        writeVariant(out, it.value());
+    }
+}
+
+/*!
+  Writes \a command to \a out in the compact encoding.
+*/
+void writeCommand(QDataStream &out, const QScriptDebuggerCommand &command)
+{
+    writeVarUInt(out, quint32(command.type()));
+    writeAttributes(out, command.attributes());
+}
+
+/*!
+  Reads a command in the compact encoding from \a in into \a command.
+  The status of \a in is set if the data is corrupt.
+*/
+void readCommand(QDataStream &in, QScriptDebuggerCommand &command)
+{
+    command = QScriptDebuggerCommand(QScriptDebuggerCommand::Type(readVarUInt(in)));
+    int count = readLength(in);
+    for (int i = 0; (i < count) && (in.status() == QDataStream::Ok); ++i) {
+        QScriptDebuggerCommand::Attribute attribute = QScriptDebuggerCommand::Attribute(readVarUInt(in));
+        command.setAttribute(attribute, readVariant(in));
+    }
+}
+
+/*!
+  Writes \a response to \a out in the compact encoding.
+*/
+void writeResponse(QDataStream &out, const QScriptDebuggerResponse &response)
+{
+    writeVarUInt(out, quint32(response.error()));
+    writeVariant(out, response.result());
+    writeBool(out, response.async());
+}
+
+/*!
+  Reads a response in the compact encoding from \a in into \a response.
+*/
+void readResponse(QDataStream &in, QScriptDebuggerResponse &response)
+{
+    response = QScriptDebuggerResponse();
+    response.setError(QScriptDebuggerResponse::Error(readVarUInt(in)));
+    response.setResult(readVariant(in));
+    response.setAsync(readBool(in));
+}
+
+/*!
+  Writes \a event to \a out in the compact encoding.
+*/
+void writeEvent(QDataStream &out, const QScriptDebuggerEvent &event)
+{
+    writeVarUInt(out, quint32(event.type()));
+    writeAttributes(out, event.attributes());
+}
+
+/*!
+  Reads an event in the compact encoding from \a in into \a event.
+*/
+void readEvent(QDataStream &in, QScriptDebuggerEvent &event)
+{
+    event = QScriptDebuggerEvent(QScriptDebuggerEvent::Type(readVarUInt(in)));
+    int count = readLength(in);
+    for (int i = 0; (i < count) && (in.status() == QDataStream::Ok); ++i) {
+        QScriptDebuggerEvent::Attribute attribute = QScriptDebuggerEvent::Attribute(readVarUInt(in));
+        event.setAttribute(attribute, readVariant(in));
+    }
+}
+
+} // namespace QScriptDebuggerCompactEncoding
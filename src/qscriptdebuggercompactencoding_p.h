@@ -0,0 +1,68 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef QSCRIPTDEBUGGERCOMPACTENCODING_P_H
+#define QSCRIPTDEBUGGERCOMPACTENCODING_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/qdatastream.h>
+
+class QScriptDebuggerCommand;
+class QScriptDebuggerResponse;
+class QScriptDebuggerEvent;
+
+// A denser alternative to the QDataStream operators of the debugger's
+// command, response and event types, used when both ends have agreed to
+// it in the handshake (see QScriptDebuggerProtocol::CompactEncodingCapability).
+//
+// Integers and lengths are written as base-128 varints (signed ones
+// zigzag-encoded first) and strings as UTF-8. Values of the types that
+// make up most of the traffic (debugger values, properties, script data
+// and the like) are encoded field by field; any other QVariant is
+// embedded in its QDataStream Qt_4_5 form. Variant lists and maps nested
+// more than MaxNestingDepth deep are read as corrupt data.
+namespace QScriptDebuggerCompactEncoding
+{
+    enum {
+        MaxNestingDepth = 32
+    };
+
+    void writeCommand(QDataStream &out, const QScriptDebuggerCommand &command);
+    void readCommand(QDataStream &in, QScriptDebuggerCommand &command);
+
+    void writeResponse(QDataStream &out, const QScriptDebuggerResponse &response);
+    void readResponse(QDataStream &in, QScriptDebuggerResponse &response);
+
+    void writeEvent(QDataStream &out, const QScriptDebuggerEvent &event);
+    void readEvent(QDataStream &in, QScriptDebuggerEvent &event);
+}
+
+#endif
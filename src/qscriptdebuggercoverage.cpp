@@ -0,0 +1,115 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "qscriptdebuggercoverage_p.h"
+
+QScriptDebuggerCoverage::QScriptDebuggerCoverage()
+    : m_session(0)
+{
+}
+
+QScriptDebuggerCoverage::~QScriptDebuggerCoverage()
+{
+}
+
+/*!
+  Forgets everything and expects chunks of the given \a session from now
+  on.
+*/
+void QScriptDebuggerCoverage::reset(quint32 session)
+{
+    m_session = session;
+    m_scripts.clear();
+}
+
+quint32 QScriptDebuggerCoverage::session() const
+{
+    return m_session;
+}
+
+/*!
+  Adds the hits in \a chunk to the counts. Returns false if the chunk
+  belongs to another session, in which case it's ignored.
+*/
+bool QScriptDebuggerCoverage::append(const QScriptDebuggerCoverageChunk &chunk)
+{
+    if (chunk.session != m_session)
+        return false;
+    for (int i = 0; i < chunk.scripts.size(); ++i) {
+        const QScriptDebuggerCoverageScript &delta = chunk.scripts.at(i);
+        Script &script = m_scripts[delta.scriptId];
+        script.fileName = delta.fileName;
+        script.baseLineNumber = delta.baseLineNumber;
+        QMap<qint32, quint32>::const_iterator it;
+        for (it = delta.hits.constBegin(); it != delta.hits.constEnd(); ++it) {
+            quint32 &count = script.hits[it.key()];
+            count += it.value();
+            script.maxHits = qMax(script.maxHits, count);
+        }
+    }
+    return true;
+}
+
+QList<qint64> QScriptDebuggerCoverage::scriptIds() const
+{
+    return m_scripts.keys();
+}
+
+bool QScriptDebuggerCoverage::hasScript(qint64 scriptId) const
+{
+    return m_scripts.contains(scriptId);
+}
+
+QString QScriptDebuggerCoverage::fileName(qint64 scriptId) const
+{
+    return m_scripts.value(scriptId).fileName;
+}
+
+int QScriptDebuggerCoverage::baseLineNumber(qint64 scriptId) const
+{
+    return m_scripts.value(scriptId).baseLineNumber;
+}
+
+/*!
+  Returns how often the given \a lineNumber of the script with the given
+  \a scriptId has been executed.
+*/
+quint32 QScriptDebuggerCoverage::hitCount(qint64 scriptId, int lineNumber) const
+{
+    QHash<qint64, Script>::const_iterator it = m_scripts.constFind(scriptId);
+    if (it == m_scripts.constEnd())
+        return 0;
+    return it.value().hits.value(lineNumber);
+}
+
+/*!
+  Returns the count of the most executed line of the script with the
+  given \a scriptId.
+*/
+quint32 QScriptDebuggerCoverage::maxHitCount(qint64 scriptId) const
+{
+    return m_scripts.value(scriptId).maxHits;
+}
+
+QMap<qint32, quint32> QScriptDebuggerCoverage::hitCounts(qint64 scriptId) const
+{
+    return m_scripts.value(scriptId).hits;
+}
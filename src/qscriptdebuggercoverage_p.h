@@ -0,0 +1,80 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef QSCRIPTDEBUGGERCOVERAGE_P_H
+#define QSCRIPTDEBUGGERCOVERAGE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/qhash.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qmap.h>
+#include <QtCore/qstring.h>
+
+#include "qscriptdebuggerprotocol_p.h"
+
+// The line coverage of a target, summed up from the deltas streamed by
+// its coverage recorder (see QScriptDebuggerCoverageChunk). Scripts are
+// identified by the ids assigned by the target.
+class QScriptDebuggerCoverage
+{
+public:
+    QScriptDebuggerCoverage();
+    ~QScriptDebuggerCoverage();
+
+    void reset(quint32 session);
+    quint32 session() const;
+
+    bool append(const QScriptDebuggerCoverageChunk &chunk);
+
+    QList<qint64> scriptIds() const;
+    bool hasScript(qint64 scriptId) const;
+    QString fileName(qint64 scriptId) const;
+    int baseLineNumber(qint64 scriptId) const;
+    quint32 hitCount(qint64 scriptId, int lineNumber) const;
+    quint32 maxHitCount(qint64 scriptId) const;
+    QMap<qint32, quint32> hitCounts(qint64 scriptId) const;
+
+private:
+    struct Script
+    {
+        Script() : baseLineNumber(1), maxHits(0) {}
+
+        QString fileName;
+        int baseLineNumber;
+        quint32 maxHits;
+        QMap<qint32, quint32> hits;
+    };
+
+    quint32 m_session;
+    QHash<qint64, Script> m_scripts;
+};
+
+#endif
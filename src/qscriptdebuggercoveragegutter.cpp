@@ -0,0 +1,142 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "qscriptdebuggercoveragegutter_p.h"
+#include "qscriptdebuggercoverage_p.h"
+
+#include <QtGui/qboxlayout.h>
+#include <QtGui/qpainter.h>
+#include <QtGui/qplaintextedit.h>
+#include <QtGui/qtextobject.h>
+
+QScriptDebuggerCoverageGutter::QScriptDebuggerCoverageGutter(QPlainTextEdit *editor,
+                                                             QWidget *parent)
+    : QWidget(parent), m_editor(editor), m_coverage(0), m_scriptId(-1)
+{
+    setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Preferred);
+    QObject::connect(m_editor, SIGNAL(updateRequest(QRect,int)),
+                     this, SLOT(onUpdateRequest(QRect,int)));
+    hide();
+}
+
+QScriptDebuggerCoverageGutter::~QScriptDebuggerCoverageGutter()
+{
+}
+
+/*!
+  Returns the gutter of the given \a codeView, putting one beside its
+  editor first if needed. Returns 0 if the view's layout isn't one the
+  gutter can be added to.
+*/
+QScriptDebuggerCoverageGutter *QScriptDebuggerCoverageGutter::install(QWidget *codeView)
+{
+    if (!codeView)
+        return 0;
+    if (QScriptDebuggerCoverageGutter *gutter = codeView->findChild<QScriptDebuggerCoverageGutter*>())
+        return gutter;
+    QPlainTextEdit *editor = codeView->findChild<QPlainTextEdit*>();
+    if (!editor || !editor->parentWidget())
+        return 0;
+    QBoxLayout *layout = qobject_cast<QBoxLayout*>(editor->parentWidget()->layout());
+    if (!layout)
+        return 0;
+    int index = layout->indexOf(editor);
+    if (index == -1)
+        return 0;
+    QWidget *container = new QWidget();
+    QHBoxLayout *hbox = new QHBoxLayout(container);
+    hbox->setMargin(0);
+    hbox->setSpacing(0);
+    QScriptDebuggerCoverageGutter *gutter = new QScriptDebuggerCoverageGutter(editor, container);
+    layout->removeWidget(editor);
+    hbox->addWidget(gutter);
+    hbox->addWidget(editor);
+    layout->insertWidget(index, container);
+    return gutter;
+}
+
+/*!
+  Shows the hit counts of the script with the given \a scriptId in \a
+  coverage, or hides the gutter if \a coverage is 0 or has no counts for
+  the script.
+*/
+void QScriptDebuggerCoverageGutter::setCoverage(const QScriptDebuggerCoverage *coverage,
+                                                qint64 scriptId)
+{
+    m_coverage = coverage;
+    m_scriptId = scriptId;
+    setVisible(m_coverage && m_coverage->hasScript(m_scriptId));
+    updateGeometry();
+    update();
+}
+
+/*!
+  \reimp
+*/
+QSize QScriptDebuggerCoverageGutter::sizeHint() const
+{
+    quint32 max = m_coverage ? m_coverage->maxHitCount(m_scriptId) : 0;
+    QString widest = QString::number(qMax(max, quint32(9)));
+    return QSize(fontMetrics().width(widest) + 8, 0);
+}
+
+/*!
+  \reimp
+*/
+void QScriptDebuggerCoverageGutter::paintEvent(QPaintEvent *)
+{
+    if (!m_coverage)
+        return;
+    QPainter painter(this);
+    painter.fillRect(rect(), palette().color(QPalette::Window));
+    quint32 max = m_coverage->maxHitCount(m_scriptId);
+    if (!max)
+        return;
+    int base = m_coverage->baseLineNumber(m_scriptId);
+    // the gutter and the editor share the top of their container
+    int offset = m_editor->viewport()->y();
+    QTextBlock block = m_editor->cursorForPosition(QPoint(0, 0)).block();
+    for ( ; block.isValid() && block.isVisible(); block = block.next()) {
+        QRect line = m_editor->cursorRect(QTextCursor(block));
+        int top = line.top() + offset;
+        if (top > height())
+            break;
+        quint32 count = m_coverage->hitCount(m_scriptId, base + block.blockNumber());
+        if (!count)
+            continue;
+        QRect cell(0, top, width(), line.height());
+        // the more often a line ran, the stronger its tint
+        QColor tint(Qt::green);
+        tint.setAlpha(40 + int(160 * qreal(count) / max));
+        painter.fillRect(cell, tint);
+        painter.setPen(palette().color(QPalette::WindowText));
+        painter.drawText(cell.adjusted(0, 0, -4, 0), Qt::AlignRight | Qt::AlignVCenter,
+                         QString::number(count));
+    }
+}
+
+void QScriptDebuggerCoverageGutter::onUpdateRequest(const QRect &rect, int dy)
+{
+    if (dy)
+        scroll(0, dy);
+    else
+        update(0, rect.y(), width(), rect.height());
+}
@@ -0,0 +1,71 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef QSCRIPTDEBUGGERCOVERAGEGUTTER_P_H
+#define QSCRIPTDEBUGGERCOVERAGEGUTTER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtGui/qwidget.h>
+
+class QScriptDebuggerCoverage;
+class QPlainTextEdit;
+
+// A strip beside the editor of a code view that shows how often each
+// line of the script has been executed. The code view has no way to
+// annotate its lines, so install() puts the strip next to the view's
+// editor and follows its scrolling.
+class QScriptDebuggerCoverageGutter : public QWidget
+{
+    Q_OBJECT
+public:
+    ~QScriptDebuggerCoverageGutter();
+
+    static QScriptDebuggerCoverageGutter *install(QWidget *codeView);
+
+    void setCoverage(const QScriptDebuggerCoverage *coverage, qint64 scriptId);
+
+    QSize sizeHint() const;
+
+protected:
+    void paintEvent(QPaintEvent *event);
+
+private Q_SLOTS:
+    void onUpdateRequest(const QRect &rect, int dy);
+
+private:
+    QScriptDebuggerCoverageGutter(QPlainTextEdit *editor, QWidget *parent);
+
+    QPlainTextEdit *m_editor;
+    const QScriptDebuggerCoverage *m_coverage;
+    qint64 m_scriptId;
+};
+
+#endif
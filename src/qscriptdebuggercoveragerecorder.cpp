@@ -0,0 +1,256 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "qscriptdebuggercoveragerecorder_p.h"
+
+#include <QtCore/qdatastream.h>
+#include <QtCore/qtimer.h>
+#include <private/qscriptdebuggerbackend_p.h>
+#include <private/qscriptscriptdata_p.h>
+
+QScriptDebuggerCoverageRecorder::QScriptDebuggerCoverageRecorder(QScriptDebuggerBackend *backend,
+                                                                 QObject *parent)
+    : QObject(parent), m_backend(backend), m_active(false), m_countdown(CheckInterval),
+      m_interval(0), m_session(0)
+{
+    for (int i = 0; i < CacheSize; ++i)
+        m_cache[i] = 0;
+    m_flushTimer = new QTimer(this);
+    QObject::connect(m_flushTimer, SIGNAL(timeout()), this, SLOT(flush()));
+}
+
+QScriptDebuggerCoverageRecorder::~QScriptDebuggerCoverageRecorder()
+{
+    clear();
+}
+
+/*!
+  Starts recording, from zero.
+*/
+void QScriptDebuggerCoverageRecorder::start()
+{
+    clear();
+    m_countdown = CheckInterval;
+    m_active = true;
+}
+
+/*!
+  Stops recording and streaming. The counts are kept until the next
+  start(), so that they can still be written.
+*/
+void QScriptDebuggerCoverageRecorder::stop()
+{
+    if (!m_active)
+        return;
+    setStreaming(0, m_session);
+    m_active = false;
+}
+
+bool QScriptDebuggerCoverageRecorder::isActive() const
+{
+    return m_active;
+}
+
+/*!
+  Reports the counters that have changed every \a interval ms, in chunks
+  tagged with \a session. The first chunk has all the counts collected
+  so far. An \a interval of 0 reports what's left and stops streaming.
+*/
+void QScriptDebuggerCoverageRecorder::setStreaming(int interval, quint32 session)
+{
+    if (interval <= 0) {
+        if (m_interval > 0)
+            flush();
+        m_interval = 0;
+        m_flushTimer->stop();
+        return;
+    }
+    m_interval = interval;
+    m_session = session;
+    QList<Script*> scripts = m_scripts.values() + m_unloaded;
+    for (int i = 0; i < scripts.size(); ++i) {
+        Script *script = scripts.at(i);
+        qMemSet(script->reported, 0, script->lineCount * sizeof(quint32));
+        script->dirty = true;
+    }
+    m_age.start();
+    m_flushTimer->start(interval);
+}
+
+bool QScriptDebuggerCoverageRecorder::isStreaming() const
+{
+    return (m_interval > 0);
+}
+
+/*!
+  Returns the hits since the previous delta.
+*/
+QScriptDebuggerCoverageChunk QScriptDebuggerCoverageRecorder::takeDelta()
+{
+    QScriptDebuggerCoverageChunk chunk;
+    chunk.session = m_session;
+    QList<Script*> scripts = m_scripts.values() + m_unloaded;
+    for (int i = 0; i < scripts.size(); ++i) {
+        Script *script = scripts.at(i);
+        if (!script->dirty)
+            continue;
+        script->dirty = false;
+        QScriptDebuggerCoverageScript delta;
+        for (int j = 0; j < script->lineCount; ++j) {
+            if (script->hits[j] == script->reported[j])
+                continue;
+            delta.hits.insert(script->baseLineNumber + j, script->hits[j] - script->reported[j]);
+            script->reported[j] = script->hits[j];
+        }
+        if (delta.hits.isEmpty())
+            continue;
+        delta.scriptId = script->id;
+        delta.fileName = script->fileName;
+        delta.baseLineNumber = script->baseLineNumber;
+        chunk.scripts.append(delta);
+    }
+    return chunk;
+}
+
+/*!
+  Writes a record for every script that has been hit to \a out, in the
+  format described by QScriptDebuggerProtocol::CoverageFileMagic. The
+  counters of a script are written from its first hit line to its last.
+*/
+void QScriptDebuggerCoverageRecorder::write(QDataStream &out) const
+{
+    QList<Script*> scripts = m_scripts.values() + m_unloaded;
+    for (int i = 0; i < scripts.size(); ++i) {
+        const Script *script = scripts.at(i);
+        int first = 0;
+        while ((first < script->lineCount) && !script->hits[first])
+            ++first;
+        if (first == script->lineCount)
+            continue;
+        int last = script->lineCount - 1;
+        while (!script->hits[last])
+            --last;
+        out << (quint8)1 << script->fileName << (qint32)script->baseLineNumber
+            << (qint32)(script->baseLineNumber + first) << (quint32)(last - first + 1);
+        for (int j = first; j <= last; ++j)
+            out << script->hits[j];
+    }
+}
+
+void QScriptDebuggerCoverageRecorder::scriptLoad(qint64 id, const QString &program,
+                                                 const QString &fileName, int baseLineNumber)
+{
+    // an id can be reused once its script has been unloaded
+    scriptUnload(id);
+    Script *script = createScript(id, program.count(QLatin1Char('\n')) + 1,
+                                  fileName, baseLineNumber);
+    m_cache[cacheIndex(id)] = script;
+}
+
+void QScriptDebuggerCoverageRecorder::scriptUnload(qint64 id)
+{
+    Script *script = m_scripts.take(id);
+    if (!script)
+        return;
+    if (m_cache[cacheIndex(id)] == script)
+        m_cache[cacheIndex(id)] = 0;
+    bool hit = false;
+    for (int i = 0; (i < script->lineCount) && !hit; ++i)
+        hit = (script->hits[i] != 0);
+    if (hit) {
+        m_unloaded.append(script);
+    } else {
+        delete[] script->hits;
+        delete script;
+    }
+}
+
+/*!
+  Finds the counters of the script with the given \a scriptId when the
+  cache misses, creating them if the script was loaded before recording
+  started. Ids that don't belong to a known script get an empty array.
+*/
+QScriptDebuggerCoverageRecorder::Script *QScriptDebuggerCoverageRecorder::lookup(qint64 scriptId)
+{
+    Script *script = m_scripts.value(scriptId);
+    if (!script) {
+        QScriptScriptData data = m_backend->scriptData(scriptId);
+        if (data.isValid()) {
+            script = createScript(scriptId, data.contents().count(QLatin1Char('\n')) + 1,
+                                  data.fileName(), data.baseLineNumber());
+        } else {
+            script = createScript(scriptId, 0, QString(), 0);
+        }
+    }
+    m_cache[cacheIndex(scriptId)] = script;
+    return script;
+}
+
+QScriptDebuggerCoverageRecorder::Script *QScriptDebuggerCoverageRecorder::createScript(
+    qint64 id, int lineCount, const QString &fileName, int baseLineNumber)
+{
+    Script *script = new Script;
+    script->id = id;
+    script->fileName = fileName;
+    script->baseLineNumber = baseLineNumber;
+    script->lineCount = lineCount;
+    // one block for both arrays
+    script->hits = new quint32[2 * lineCount + 1];
+    script->reported = script->hits + lineCount;
+    qMemSet(script->hits, 0, 2 * lineCount * sizeof(quint32));
+    script->dirty = false;
+    m_scripts.insert(id, script);
+    return script;
+}
+
+void QScriptDebuggerCoverageRecorder::checkFlush()
+{
+    m_countdown = CheckInterval;
+    if ((m_interval > 0) && (m_age.elapsed() >= m_interval))
+        flush();
+}
+
+void QScriptDebuggerCoverageRecorder::flush()
+{
+    m_age.start();
+    if (m_interval <= 0)
+        return;
+    QList<Script*> scripts = m_scripts.values() + m_unloaded;
+    for (int i = 0; i < scripts.size(); ++i) {
+        if (scripts.at(i)->dirty) {
+            emit deltaReady();
+            return;
+        }
+    }
+}
+
+void QScriptDebuggerCoverageRecorder::clear()
+{
+    QList<Script*> scripts = m_scripts.values() + m_unloaded;
+    for (int i = 0; i < scripts.size(); ++i) {
+        delete[] scripts.at(i)->hits;
+        delete scripts.at(i);
+    }
+    m_scripts.clear();
+    m_unloaded.clear();
+    for (int i = 0; i < CacheSize; ++i)
+        m_cache[i] = 0;
+}
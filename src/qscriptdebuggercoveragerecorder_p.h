@@ -0,0 +1,143 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef QSCRIPTDEBUGGERCOVERAGERECORDER_P_H
+#define QSCRIPTDEBUGGERCOVERAGERECORDER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/qobject.h>
+#include <QtCore/qdatetime.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qvector.h>
+
+#include "qscriptdebuggerprotocol_p.h"
+
+class QDataStream;
+class QTimer;
+class QScriptDebuggerBackend;
+
+// Counts how often every line of every script run by one engine is
+// executed. Each script has a flat array of counters, indexed by line
+// relative to the script's base line; the hook agent bumps a counter on
+// every position change. A small direct-mapped cache, indexed by bits of
+// the script id, finds the array, so the common case involves neither
+// hashing nor allocation. Arrays are allocated when a script is loaded,
+// or when a script that was loaded before recording started is first
+// hit.
+//
+// While streaming, the counters that have changed are reported through
+// deltaReady() every interval ms.
+class QScriptDebuggerCoverageRecorder : public QObject
+{
+    Q_OBJECT
+public:
+    QScriptDebuggerCoverageRecorder(QScriptDebuggerBackend *backend, QObject *parent = 0);
+    ~QScriptDebuggerCoverageRecorder();
+
+    void start();
+    void stop();
+    bool isActive() const;
+
+    void setStreaming(int interval, quint32 session);
+    bool isStreaming() const;
+    QScriptDebuggerCoverageChunk takeDelta();
+
+    void write(QDataStream &out) const;
+
+    // called by the hook agent
+    void scriptLoad(qint64 id, const QString &program,
+                    const QString &fileName, int baseLineNumber);
+    void scriptUnload(qint64 id);
+    inline void hit(qint64 scriptId, int lineNumber)
+    {
+        Script *script = m_cache[cacheIndex(scriptId)];
+        if (!script || (script->id != scriptId))
+            script = lookup(scriptId);
+        uint index = uint(lineNumber - script->baseLineNumber);
+        if (index < uint(script->lineCount)) {
+            ++script->hits[index];
+            script->dirty = true;
+        }
+        // the flush timer can't fire while the engine is busy, so check
+        // the time every now and then
+        if (--m_countdown == 0)
+            checkFlush();
+    }
+
+Q_SIGNALS:
+    void deltaReady();
+
+private Q_SLOTS:
+    void flush();
+
+private:
+    enum {
+        CacheSize = 64,
+        CheckInterval = 4096 // hits between looking at the clock
+    };
+
+    struct Script
+    {
+        qint64 id;
+        QString fileName;
+        int baseLineNumber;
+        int lineCount;
+        quint32 *hits;      // lineCount counters
+        quint32 *reported;  // the counters as of the last delta
+        bool dirty;
+    };
+
+    static inline int cacheIndex(qint64 scriptId)
+    { return int((quint64(scriptId) >> 4) & (CacheSize - 1)); }
+
+    Script *lookup(qint64 scriptId);
+    Script *createScript(qint64 id, int lineCount,
+                         const QString &fileName, int baseLineNumber);
+    void checkFlush();
+    void clear();
+
+    QScriptDebuggerBackend *m_backend;
+    bool m_active;
+    Script *m_cache[CacheSize];
+    QHash<qint64, Script*> m_scripts;
+    QList<Script*> m_unloaded; // kept for their counts
+    int m_countdown;
+
+    int m_interval;
+    quint32 m_session;
+    QTime m_age;
+    QTimer *m_flushTimer;
+
+    Q_DISABLE_COPY(QScriptDebuggerCoverageRecorder)
+};
+
+#endif
@@ -20,10 +20,40 @@
 ****************************************************************************/
 
 #include "qscriptdebuggerengine.h"
+#include "qscriptdebuggerprotocol_p.h"
+#include "qscriptdebuggerframecodec_p.h"
+#include "qscriptdebuggercompactencoding_p.h"
+#include "qscriptdebuggermetatypes_p.h"
+#include "qscriptdebuggerspscqueue_p.h"
+#include "qscriptdebuggertransport_p.h"
+#include "qscriptdebuggerprofiler_p.h"
+#include "qscriptdebuggercoveragerecorder_p.h"
+#include "qscriptdebuggerhookagent_p.h"
+#include "qscriptdebuggerheapwalker_p.h"
+#include "qscriptdebuggerpager_p.h"
+#include "qscriptdebuggertrace_p.h"
+#include "qscriptdebuggersessionlog_p.h"
+#include "qscriptdebuggermetrics_p.h"
+#include <QtCore/qcoreapplication.h>
+#include <QtCore/qcryptographichash.h>
 #include <QtCore/qeventloop.h>
-#include <QtNetwork/qtcpserver.h>
-#include <QtNetwork/qtcpsocket.h>
+#include <QtCore/qfile.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qmap.h>
+#include <QtCore/qmutex.h>
+#include <QtCore/qpair.h>
+#include <QtCore/qpointer.h>
+#include <QtCore/qqueue.h>
+#include <QtCore/qset.h>
+#include <QtCore/qstringlist.h>
+#include <QtCore/qthread.h>
+#include <QtCore/qdatetime.h>
+#include <QtCore/qendian.h>
+#include <QtCore/qtimer.h>
+#include <QtCore/qvariant.h>
+#include <QtCore/qwaitcondition.h>
 #include <QtScript/qscriptengine.h>
+#include <QtScript/qscriptcontext.h>
 #include <private/qscriptdebuggerbackend_p.h>
 #include <private/qscriptdebuggercommand_p.h>
 #include <private/qscriptdebuggerevent_p.h>
@@ -34,377 +64,4235 @@
 
 // #define DEBUGGERENGINE_DEBUG
 
+class QScriptDebuggerEngineConnection;
+
+// A decoded command, handed from the network thread to the engine thread.
+// A CommandBatchFrame is handed over as a single message, so that its
+// responses can be sent back in a single ResponseBatchFrame.
+struct QScriptDebuggerInboundMessage
+{
+    QScriptDebuggerInboundMessage() : id(0), peer(0) {}
+
+    qint32 id;
+    // the debugger that sent it; 0 is the controlling one
+    quint32 peer;
+    QScriptDebuggerCommand command;
+    QList<qint32> batchIds;
+    QList<QScriptDebuggerCommand> batchCommands;
+};
+
+// An event or response, handed from the engine thread to the network
+// thread for serialization.
+struct QScriptDebuggerOutboundMessage
+{
+    QScriptDebuggerOutboundMessage() : type(0), id(0), peer(0) {}
+
+    quint8 type;
+    qint32 id;
+    // the debugger a response or heap snapshot is for
+    quint32 peer;
+    QScriptDebuggerEvent event;
+    QScriptDebuggerResponse response;
+    QList<QScriptDebuggerOutputEntry> output;
+    QList<QScriptDebuggerScriptHash> scripts;
+    QScriptDebuggerProfileChunk profile;
+    QScriptDebuggerCoverageChunk coverage;
+    QScriptDebuggerHeapSnapshotChunk heapSnapshot;
+    QList<qint32> batchIds;
+    QList<QScriptDebuggerResponse> batchResponses;
+};
+
+// A debugger that is connected besides the controlling one, and may only
+// look at the targets (see QScriptDebuggerEngine::setMaxObservers()).
+struct QScriptDebuggerEngineObserver
+{
+    QScriptDebuggerEngineObserver(quint32 id, QIODevice *device)
+        : id(id), device(device), connected(false) {}
+
+    quint32 id;
+    // 0 once the observer has been dropped
+    QIODevice *device;
+    // set once its handshake has been answered
+    bool connected;
+    // decodes its commands and encodes the responses to them
+    QScriptDebuggerFrameCodec codec;
+};
+
 class QScriptRemoteTargetDebuggerBackend : public QObject,
                                            public QScriptDebuggerBackend
 {
     Q_OBJECT
 public:
-    QScriptRemoteTargetDebuggerBackend();
+    QScriptRemoteTargetDebuggerBackend(QScriptDebuggerEngineConnection *connection,
+                                       quint32 channel, const QString &name);
     ~QScriptRemoteTargetDebuggerBackend();
 
-    void connectToDebugger(const QHostAddress &address, quint16 port);
-    void disconnectFromDebugger();
+    quint32 channel() const;
+    QString name() const;
+
+    QScriptEngine *target() const;
+    void setTarget(QScriptEngine *engine);
+    bool isLazyAttachEnabled() const;
+    Q_INVOKABLE void setLazyAttachEnabled(bool enabled);
+    Q_INVOKABLE void setSuspensionTimeout(int msecs, int action);
+    Q_INVOKABLE void setOutputBatching(int msecs, int maxEntries);
+    void setWorkerThread(QThread *thread);
+    bool isWorkerThread() const;
+    bool isSuspended() const;
 
-    bool listen(const QHostAddress &address, quint16 port);
+    void executeCommand(qint32 id, const QScriptDebuggerCommand &command, quint32 peer);
+    void executeCommands(const QList<qint32> &ids, const QList<QScriptDebuggerCommand> &commands,
+                         quint32 peer);
+
+    // called from the network thread
+    bool isInboundFull();
+    void enqueueCommand(qint32 id, const QScriptDebuggerCommand &command, quint32 peer);
+    void enqueueCommands(const QList<qint32> &ids, const QList<QScriptDebuggerCommand> &commands,
+                         quint32 peer);
+    bool dequeueOutbound(QScriptDebuggerOutboundMessage *message);
+    void wake();
 
     void resume();
+    void detach();
+
+    Q_INVOKABLE void setProfilingInterval(int interval, uint session);
+    Q_INVOKABLE void setCoverageInterval(int interval, uint session);
+    Q_INVOKABLE void takeHeapSnapshot(uint snapshot, uint peer);
+    Q_INVOKABLE void continueHeapSnapshot(bool proceed);
+    Q_INVOKABLE void releasePeer(uint peer);
+
+    Q_INVOKABLE void setCoverageEnabled(bool enabled);
+    void writeCoverage(QDataStream &out) const;
 
 Q_SIGNALS:
-    void connected();
-    void disconnected();
-    void error(QScriptDebuggerEngine::Error error);
+    void suspensionTimedOut(QScriptEngine *target, int msecs);
 
 protected:
     void event(const QScriptDebuggerEvent &event);
 
 private Q_SLOTS:
-    void onSocketStateChanged(QAbstractSocket::SocketState);
-    void onSocketError(QAbstractSocket::SocketError);
+    void checkSuspension();
+    void processInbound();
+    void pollInbound();
+    void onConnected();
+    void onDisconnected();
+    void flushOutput();
+    void flushProfile();
+    void flushCoverage();
+
+private:
+    QScriptDebuggerResponse execute(const QScriptDebuggerCommand &command, quint32 peer);
+    bool isOwnedBy(const QScriptDebuggerCommand &command, quint32 peer) const;
+    bool handleTracepoint(const QScriptDebuggerEvent &event);
+    void collectAddedScripts(const QScriptDebuggerCommand &command,
+                             const QScriptDebuggerResponse &response,
+                             QList<qint64> *added);
+    void announceScripts(const QList<qint64> &ids);
+    void appendOutput(const QScriptDebuggerOutputEntry &entry);
+
+    void sendEvent(const QScriptDebuggerEvent &event);
+    void sendResponse(qint32 id, const QScriptDebuggerResponse &response, quint32 peer);
+    void sendResponses(const QList<qint32> &ids, const QList<QScriptDebuggerResponse> &responses,
+                       quint32 peer);
+    void sendHeapSnapshot(const QScriptDebuggerHeapSnapshotChunk &chunk, quint32 peer);
+    void startHeapSnapshot();
+    void enqueueOutbound(const QScriptDebuggerOutboundMessage &message);
+    void attachDebuggerAgent();
+    void detachDebuggerAgent();
+    void updateHookAgent();
+    void releaseRetiredHookAgent();
+    void forceResume();
+    void waitForResume();
+
+private:
+    QScriptDebuggerEngineConnection *m_connection;
+    quint32 m_channel;
+    QString m_name;
+    // the engine to debug; the debugger's agent is only on it while
+    // attached, which in lazy mode is only while a debugger is connected
+    QPointer<QScriptEngine> m_target;
+    bool m_lazyAttach;
+    QList<QEventLoop*> m_eventLoopPool;
+    QList<QEventLoop*> m_eventLoopStack;
+
+    QScriptDebuggerSpscQueue<QScriptDebuggerInboundMessage> m_inbound;
+    QScriptDebuggerSpscQueue<QScriptDebuggerOutboundMessage> m_outbound;
+    // set while the engine thread waits for room in m_outbound
+    QAtomicInt m_outboundWaiting;
+    QMutex m_outboundMutex;
+    QWaitCondition m_outboundCondition;
+    QAtomicInt m_inboundPending;
+    QAtomicInt m_inboundStalled;
+    bool m_executingCommands;
+
+    // a target on another thread than the debugger engine's (e.g. a
+    // QThreadPool worker) has no event loop to suspend in; it waits on
+    // m_suspendCondition instead, and runs the commands itself
+    bool m_workerThread;
+    QMutex m_suspendMutex;
+    QWaitCondition m_suspendCondition;
+    int m_suspendDepth;
+    int m_resumeCount;
+
+    bool m_inTracepoint;
+    // output, including what the target print()s, is sent in batches of
+    // up to m_maxOutputBatchSize entries or m_outputBatchInterval ms
+    QList<QScriptDebuggerOutputEntry> m_pendingOutput;
+    QTime m_pendingOutputAge;
+    QTimer *m_outputTimer;
+    int m_outputBatchInterval;
+    int m_maxOutputBatchSize;
+
+    QHash<qint64, QByteArray> m_scriptHashes;
+
+    QScriptDebuggerPager m_pager;
+    // the debugger (peer) that created each object snapshot and script
+    // value iterator; their ids are the backend's, not the debugger's,
+    // so another debugger must not use them
+    QHash<int, quint32> m_snapshotOwners;
+    QHash<int, quint32> m_iteratorOwners;
+
+    QScriptDebuggerProfiler *m_profiler;
+    QScriptDebuggerProfileChunk m_pendingProfile;
+
+    QScriptDebuggerCoverageRecorder *m_coverage;
+    QScriptDebuggerCoverageChunk m_pendingCoverage;
+    bool m_localCoverage;
+
+    // the heap snapshot being sent, one chunk at a time as the debugger
+    // that asked for it keeps up, and the requests (snapshot, peer)
+    // waiting for it to end
+    QScriptDebuggerHeapWalker *m_heapWalker;
+    quint32 m_heapSnapshot;
+    quint32 m_heapSnapshotPeer;
+    QPointer<QScriptEngine> m_heapSnapshotEngine;
+    QQueue<QPair<quint32, quint32> > m_heapSnapshotRequests;
+
+    // in front of the debugger's agent while profiling or recording
+    // coverage; a retired agent may still be on the engine's stack, so
+    // it is only deleted when the next one is installed
+    QScriptDebuggerHookAgent *m_hookAgent;
+    QScriptDebuggerHookAgent *m_retiredHookAgent;
+    QPointer<QScriptEngine> m_hookEngine;
+
+    // how long the target may stay suspended without word from the
+    // debugger, and what is done then (a
+    // QScriptDebuggerEngine::SuspensionTimeoutAction)
+    int m_suspensionTimeout;
+    int m_suspensionTimeoutAction;
+    QTimer *m_watchdogTimer;
+    QTime m_suspendedTime;
+    int m_lastActivity;
+    QTime m_lastActivityTime;
+
+private:
+    Q_DISABLE_COPY(QScriptRemoteTargetDebuggerBackend)
+};
+
+class QScriptDebuggerEngineConnection : public QObject
+{
+    Q_OBJECT
+public:
+    QScriptDebuggerEngineConnection(QObject *parent = 0);
+    ~QScriptDebuggerEngineConnection();
+
+    Q_INVOKABLE void connectToDebugger(int transport, const QString &address);
+    Q_INVOKABLE void disconnectFromDebugger();
+    Q_INVOKABLE bool listen(int transport, const QString &address);
+    Q_INVOKABLE void close();
+
+    Q_INVOKABLE void setCompressionEnabled(bool enable);
+    Q_INVOKABLE qreal compressionRatio() const;
+    Q_INVOKABLE int compressionTime() const;
+
+    Q_INVOKABLE bool startRecording(const QString &fileName);
+    Q_INVOKABLE void stopRecording();
+
+    Q_INVOKABLE bool startMetricsDump(const QString &fileName, int interval);
+    Q_INVOKABLE void stopMetricsDump();
+    QScriptDebuggerMetrics *metrics();
+
+    Q_INVOKABLE void setMaxObservers(int count);
+    Q_INVOKABLE void setSessionResumeGracePeriod(int msecs);
+    Q_INVOKABLE void setHeartbeatInterval(int msecs);
+    Q_INVOKABLE void setOutboundLimits(int maxBytes, int maxFrames);
+    Q_INVOKABLE int droppedOutputCount() const;
+    Q_INVOKABLE int coalescedFrameCount() const;
+
+    bool isConnected() const;
+    int activity() const;
+    bool isActive() const;
+    quint32 agreedCapabilities() const;
+
+    bool isThreaded() const;
+    void setThreaded(bool threaded);
+
+    void addBackend(QScriptRemoteTargetDebuggerBackend *backend);
+    void removeBackend(QScriptRemoteTargetDebuggerBackend *backend);
+    QScriptRemoteTargetDebuggerBackend *backend(quint32 channel) const;
+    QList<QScriptRemoteTargetDebuggerBackend*> backends() const;
+    QList<QScriptRemoteTargetDebuggerBackend*> backends(QThread *thread) const;
+    QList<QScriptEngine*> targets() const;
+    QMap<quint32, QString> channelNames() const;
+    void invokeOnBackends(const char *member, QGenericArgument val0 = QGenericArgument(0),
+                          QGenericArgument val1 = QGenericArgument(0));
+    Q_INVOKABLE void wakeBackendLater(uint channel, int msecs);
+
+    void notifyOutbound();
+
+    // the debugger that responses go to when no other one is given
+    enum { ControllerPeer = 0 };
+
+    void writeEvent(quint32 channel, const QScriptDebuggerEvent &event);
+    void writeResponse(quint32 channel, qint32 id, const QScriptDebuggerResponse &response,
+                       quint32 peer = ControllerPeer);
+    void writeOutput(quint32 channel, const QList<QScriptDebuggerOutputEntry> &output);
+    void writeScriptHashes(quint32 channel, const QList<QScriptDebuggerScriptHash> &scripts);
+    void writeProfile(quint32 channel, const QScriptDebuggerProfileChunk &chunk);
+    void writeCoverage(quint32 channel, const QScriptDebuggerCoverageChunk &chunk);
+    void writeHeapSnapshot(quint32 channel, const QScriptDebuggerHeapSnapshotChunk &chunk,
+                           quint32 peer = ControllerPeer);
+    void writeResponses(quint32 channel, const QList<qint32> &ids,
+                        const QList<QScriptDebuggerResponse> &responses,
+                        quint32 peer = ControllerPeer);
+
+Q_SIGNALS:
+    void connected();
+    void disconnected();
+    void error(QScriptDebuggerEngine::Error error);
+
+private Q_SLOTS:
+    void onTransportConnected();
+    void onTransportDisconnected();
+    void onTransportError(QScriptDebuggerTransport::TransportError);
     void onReadyRead();
-    void onNewConnection();
+    void onLegacyHandshakeTimeout();
+    void onObserverConnected(QIODevice *device);
+    void onObserverDisconnected(QIODevice *device);
+    void onObserverReadyRead();
+    void resumeReading();
+    void releaseRetiredObservers();
+    void onSessionGraceTimeout();
+    void sendHeartbeat();
+    void releaseHeldFrames();
+    void dumpMetrics();
+    void flushOutbound();
+    void announceChannel(uint channel);
+    void retireChannel(uint channel);
+    void wakeBackends();
+    void continueHeapSnapshots();
 
 private:
+    QIODevice *device() const;
+    bool createTransport(int type);
+    void completeHandshake(const QByteArray &reply, quint32 capabilities);
+    void beginSession();
+    void startHeartbeat();
+    void resumeSession(const QByteArray &token, quint32 received);
+    void endSession();
+    void forgetSession();
+    bool isWritable() const;
+    bool readFrame(QScriptDebuggerEngineObserver *observer = 0);
+    void protocolError(QScriptDebuggerEngineObserver *observer = 0);
+    bool dispatchCommand(quint32 channel, qint32 id, const QScriptDebuggerCommand &command, quint32 peer);
+    bool dispatchCommands(quint32 channel, const QList<qint32> &ids,
+                          const QList<QScriptDebuggerCommand> &commands, quint32 peer);
+    bool invokeOnBackend(quint32 channel, const char *member, QGenericArgument val0,
+                         QGenericArgument val1 = QGenericArgument(0));
+    void decodeCommand(QDataStream &in, QScriptDebuggerCommand &command);
+    void encodeResponse(QDataStream &out, const QScriptDebuggerResponse &response);
+    void writeChannelOpened(quint32 channel, const QString &name);
+    void writeChannelClosed(quint32 channel);
+    void writeAck();
+    QScriptDebuggerFrameCodec *codecFor(quint32 peer);
+    void endFrame(quint32 peer = ControllerPeer);
+    void endBroadcastFrame(int start);
+    void flushWrites();
+    void frameQueued();
+    bool isBackedUp();
+    void holdBack();
+    void countCoalescedFrame();
+    void updateQueueGauges(qint64 bytes);
+
+    void readObserver(QScriptDebuggerEngineObserver *observer);
+    bool answerObserverHandshake(QScriptDebuggerEngineObserver *observer);
+    QScriptDebuggerEngineObserver *findObserver(QIODevice *device) const;
+    void writeToObserver(QScriptDebuggerEngineObserver *observer, const char *data, int size);
+    void dropObserver(QScriptDebuggerEngineObserver *observer);
+
     enum State {
         UnconnectedState,
         HandshakingState,
+        // waiting for the debugger to say which session it wants
+        ResumingState,
         ConnectedState
     };
 
+    enum {
+        // what an observer may have left to read before it is dropped
+        MaxObserverBacklog = 4 * 1024 * 1024,
+        // what an observer may have left to read when it is sent the
+        // next chunk of a heap snapshot
+        HeapSnapshotBacklog = 256 * 1024,
+        // how often held back frames are offered again
+        HeldFrameInterval = 50 // ms
+    };
+
 private:
     State m_state;
-    QTcpSocket *m_socket;
-    int m_blockSize;
-    QTcpServer *m_server;
-    QList<QEventLoop*> m_eventLoopPool;
-    QList<QEventLoop*> m_eventLoopStack;
+    QScriptDebuggerTransport *m_transport;
+    int m_transportType;
+    QScriptDebuggerFrameCodec m_codec;
+    QScriptDebuggerTraceWriter m_traceWriter;
+    // what we're willing to use; what is used is agreed on in the handshake
+    quint32 m_capabilities;
+    // what was agreed on; read by the engine thread
+    QAtomicInt m_agreedCapabilities;
+    bool m_compact;
+    QTimer *m_legacyHandshakeTimer;
+    bool m_threaded;
+    QAtomicInt m_connected;
+    QAtomicInt m_outboundPending;
+    // frames written while this is non-zero are collected in the codec's
+    // send buffer and handed to the socket in one write by flushWrites()
+    int m_coalesceWrites;
+    // the backends are added and removed by the engine thread, but looked
+    // up by the network thread when it is enabled
+    mutable QMutex m_backendsMutex;
+    QMap<quint32, QScriptRemoteTargetDebuggerBackend*> m_backends;
+    int m_maxObservers;
+    quint32 m_nextObserverId;
+    QMap<quint32, QScriptDebuggerEngineObserver*> m_observers;
+    int m_readingObservers;
+    // dropped observers may still be in use further up the stack, so
+    // they are only deleted once control is back in the event loop
+    QList<QScriptDebuggerEngineObserver*> m_retiredObservers;
+    // the resumable session, if any; it outlives the connection to the
+    // debugger by the grace period, and frames written in the meantime
+    // are only logged
+    QByteArray m_sessionToken;
+    quint32 m_sessionCapabilities;
+    QScriptDebuggerSessionLog m_sessionLog;
+    QTimer *m_sessionGraceTimer;
+    QTimer *m_heartbeatTimer;
+    // when the controlling debugger was last heard from, and the number
+    // of frames received from it; the latter is read by the engine
+    // thread (see QScriptRemoteTargetDebuggerBackend::checkSuspension())
+    QTime m_lastReceived;
+    QAtomicInt m_activity;
+    // the bound on what may be waiting to be sent to the controlling
+    // debugger; see isBackedUp()
+    int m_maxOutboundBytes;
+    int m_maxOutboundFrames;
+    // the number of bytes handed to the device so far, and the running
+    // totals at which the frames that it may not have sent yet end
+    qint64 m_bytesHanded;
+    QQueue<qint64> m_frameEnds;
+    // what is held back per channel while the debugger isn't keeping up:
+    // telemetry and script announcements are merged into one frame each,
+    // output is dropped and only counted
+    QMap<quint32, QScriptDebuggerProfileChunk> m_heldProfile;
+    QMap<quint32, QScriptDebuggerCoverageChunk> m_heldCoverage;
+    QMap<quint32, QList<QScriptDebuggerScriptHash> > m_heldScripts;
+    QMap<quint32, int> m_heldOutputDrops;
+    QTimer *m_heldFrameTimer;
+    // the channels of targets on worker threads that have output waiting
+    // for its batch interval, and that are woken when it is over
+    QSet<quint32> m_wakeChannels;
+    QTimer *m_wakeTimer;
+    // the heap snapshots being sent, by channel and peer, whose backend
+    // hasn't been asked for the next chunk yet
+    QList<QPair<quint32, quint32> > m_heapSnapshotStreams;
+    QTimer *m_heapSnapshotTimer;
+    int m_droppedOutputCount;
+    int m_coalescedFrameCount;
+    // counted by the codecs, the network thread and the engine thread
+    QScriptDebuggerMetrics m_metrics;
+    QString m_metricsFileName;
+    QTimer *m_metricsTimer;
 
 private:
-    Q_DISABLE_COPY(QScriptRemoteTargetDebuggerBackend)
+    Q_DISABLE_COPY(QScriptDebuggerEngineConnection)
 };
 
-QScriptRemoteTargetDebuggerBackend::QScriptRemoteTargetDebuggerBackend()
-    : m_state(UnconnectedState), m_socket(0), m_blockSize(0), m_server(0)
+static QScriptDebuggerResponse observerCommandError()
+{
+    QScriptDebuggerResponse response;
+    response.setError(QScriptDebuggerResponse::Error(QScriptDebuggerProtocol::ObserverCommandError));
+    return response;
+}
+
+QScriptRemoteTargetDebuggerBackend::QScriptRemoteTargetDebuggerBackend(
+    QScriptDebuggerEngineConnection *connection, quint32 channel, const QString &name)
+    : m_connection(connection), m_channel(channel), m_name(name), m_lazyAttach(false),
+      m_outboundWaiting(0), m_inboundPending(0), m_inboundStalled(0), m_executingCommands(false),
+      m_workerThread(false), m_suspendDepth(0), m_resumeCount(0), m_inTracepoint(false),
+      m_outputBatchInterval(QScriptDebuggerEngine::DefaultOutputBatchInterval),
+      m_maxOutputBatchSize(QScriptDebuggerEngine::DefaultMaxOutputBatchSize),
+      m_localCoverage(false), m_heapWalker(0), m_heapSnapshot(0), m_heapSnapshotPeer(0),
+      m_hookAgent(0), m_retiredHookAgent(0),
+      m_suspensionTimeout(0), m_suspensionTimeoutAction(QScriptDebuggerEngine::ResumeTarget),
+      m_lastActivity(0)
 {
+    m_outputTimer = new QTimer(this);
+    m_outputTimer->setSingleShot(true);
+    m_outputTimer->setInterval(m_outputBatchInterval);
+    QObject::connect(m_outputTimer, SIGNAL(timeout()), this, SLOT(flushOutput()));
+    m_profiler = new QScriptDebuggerProfiler(this);
+    QObject::connect(m_profiler, SIGNAL(chunkReady()), this, SLOT(flushProfile()));
+    m_coverage = new QScriptDebuggerCoverageRecorder(this, this);
+    QObject::connect(m_coverage, SIGNAL(deltaReady()), this, SLOT(flushCoverage()));
+    m_watchdogTimer = new QTimer(this);
+    QObject::connect(m_watchdogTimer, SIGNAL(timeout()), this, SLOT(checkSuspension()));
 }
 
 QScriptRemoteTargetDebuggerBackend::~QScriptRemoteTargetDebuggerBackend()
 {
+    m_profiler->stop();
+    m_coverage->stop();
+    updateHookAgent();
+    releaseRetiredHookAgent();
+    qDeleteAll(m_eventLoopPool);
+    delete m_heapWalker;
 }
 
-void QScriptRemoteTargetDebuggerBackend::connectToDebugger(const QHostAddress &address, quint16 port)
+quint32 QScriptRemoteTargetDebuggerBackend::channel() const
 {
-    Q_ASSERT(m_state == UnconnectedState);
-    if (!m_socket) {
-        m_socket = new QTcpSocket(this);
-        QObject::connect(m_socket, SIGNAL(stateChanged(QAbstractSocket::SocketState)),
-                         this, SLOT(onSocketStateChanged(QAbstractSocket::SocketState)));
-        QObject::connect(m_socket, SIGNAL(error(QAbstractSocket::SocketError)),
-                         this, SLOT(onSocketError(QAbstractSocket::SocketError)));
-        QObject::connect(m_socket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
-    }
-    m_socket->connectToHost(address, port);
+    return m_channel;
 }
 
-void QScriptRemoteTargetDebuggerBackend::disconnectFromDebugger()
+QString QScriptRemoteTargetDebuggerBackend::name() const
 {
-    if (!m_socket)
-        return;
-    m_socket->disconnectFromHost();
+    return m_name;
 }
 
-bool QScriptRemoteTargetDebuggerBackend::listen(const QHostAddress &address, quint16 port)
+QScriptEngine *QScriptRemoteTargetDebuggerBackend::target() const
 {
-    if (m_socket)
-        return false;
-    if (!m_server) {
-        m_server = new QTcpServer(this);
-        QObject::connect(m_server, SIGNAL(newConnection()),
-                         this, SLOT(onNewConnection()));
-    }
-    return m_server->listen(address, port);
+    return m_target;
 }
 
-void QScriptRemoteTargetDebuggerBackend::onSocketStateChanged(QAbstractSocket::SocketState s)
+/*!
+  Makes \a engine the target of this backend, detaching from the
+  previous one. The backend attaches to \a engine right away, unless
+  lazy attach is enabled and no debugger is connected.
+*/
+void QScriptRemoteTargetDebuggerBackend::setTarget(QScriptEngine *engine)
 {
-    if (s == QAbstractSocket::ConnectedState) {
-        m_state = HandshakingState;
-    } else if (s == QAbstractSocket::UnconnectedState) {
-        engine()->setAgent(0);
-        m_state = UnconnectedState;
-        emit disconnected();
-    }
+    detach();
+    m_target = engine;
+    if (m_target && (!m_lazyAttach || m_connection->isConnected()))
+        attachDebuggerAgent();
+    updateHookAgent();
 }
 
-void QScriptRemoteTargetDebuggerBackend::onSocketError(QAbstractSocket::SocketError err)
+bool QScriptRemoteTargetDebuggerBackend::isLazyAttachEnabled() const
 {
-    if (err != QAbstractSocket::RemoteHostClosedError) {
-        qDebug("%s", qPrintable(m_socket->errorString()));
-        emit error(QScriptDebuggerEngine::SocketError);
-    }
+    return m_lazyAttach;
 }
 
-void QScriptRemoteTargetDebuggerBackend::onNewConnection()
+/*!
+  Sets whether the debugger's agent is only put on the target while a
+  debugger is connected to \a enabled.
+*/
+void QScriptRemoteTargetDebuggerBackend::setLazyAttachEnabled(bool enabled)
 {
-    m_socket = m_server->nextPendingConnection();
-    m_server->close();
-    QObject::connect(m_socket, SIGNAL(stateChanged(QAbstractSocket::SocketState)),
-                     this, SLOT(onSocketStateChanged(QAbstractSocket::SocketState)));
-    QObject::connect(m_socket, SIGNAL(error(QAbstractSocket::SocketError)),
-                     this, SLOT(onSocketError(QAbstractSocket::SocketError)));
-    QObject::connect(m_socket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
-    // the handshake is initiated by the debugger side, so wait for it
-    m_state = HandshakingState;
+    m_lazyAttach = enabled;
+    if (!m_target || m_connection->isConnected())
+        return;
+    if (enabled && engine())
+        detachDebuggerAgent();
+    else if (!enabled && !engine())
+        attachDebuggerAgent();
 }
 
-void QScriptRemoteTargetDebuggerBackend::onReadyRead()
+/*!
+  Sets how long the target may stay suspended without a frame from the
+  controlling debugger to \a msecs (0 means forever), and what is done
+  then to \a action.
+*/
+void QScriptRemoteTargetDebuggerBackend::setSuspensionTimeout(int msecs, int action)
 {
-    switch (m_state) {
-    case UnconnectedState:
-        Q_ASSERT(0);
-        break;
+    m_suspensionTimeout = msecs;
+    m_suspensionTimeoutAction = action;
+    if (msecs <= 0)
+        m_watchdogTimer->stop();
+}
 
-    case HandshakingState: {
-        QByteArray handshakeData("QtScriptDebug-Handshake");
-        if (m_socket->bytesAvailable() == handshakeData.size()) {
-            QByteArray ba = m_socket->read(handshakeData.size());
-            if (ba == handshakeData) {
-#ifdef DEBUGGERENGINE_DEBUG
-                qDebug() << "sending handshake reply (" << handshakeData.size() << "bytes )";
-#endif
-                m_socket->write(handshakeData);
-                // handshaking complete
-                // ### a way to specify if a break should be triggered immediately,
-                // or only if an uncaught exception is triggered
-                interruptEvaluation();
-                m_state = ConnectedState;
-                emit connected();
-            } else {
-//                d->error = QScriptDebuggerEngine::HandshakeError;
-//                d->errorString = QString::fromLatin1("Incorrect handshake data received");
-                m_state = UnconnectedState;
-                emit error(QScriptDebuggerEngine::HandshakeError);
-                m_socket->close();
-            }
-        }
-    }   break;
+/*!
+  Sends output once \a maxEntries entries have been collected, or once
+  the oldest is \a msecs old, whichever comes first.
+*/
+void QScriptRemoteTargetDebuggerBackend::setOutputBatching(int msecs, int maxEntries)
+{
+    m_outputBatchInterval = msecs;
+    m_maxOutputBatchSize = maxEntries;
+    m_outputTimer->setInterval(msecs);
+    if (!m_pendingOutput.isEmpty() && (m_pendingOutput.size() >= maxEntries))
+        flushOutput();
+}
 
-    case ConnectedState: {
-#ifdef DEBUGGERENGINE_DEBUG
-        qDebug() << "received data. bytesAvailable:" << m_socket->bytesAvailable();
-#endif
-        QDataStream in(m_socket);
-        in.setVersion(QDataStream::Qt_4_5);
-        if (m_blockSize == 0) {
-            if (m_socket->bytesAvailable() < (int)sizeof(quint32))
-                return;
-            in >> m_blockSize;
-#ifdef DEBUGGERENGINE_DEBUG
-            qDebug() << "  blockSize:" << m_blockSize;
-#endif
-        }
-        if (m_socket->bytesAvailable() < m_blockSize)
-            return;
+/*!
+  Moves the backend to \a thread, the thread of a target engine that
+  doesn't live in the debugger engine's thread. The backend must not
+  have been added to the connection yet.
 
-#ifdef DEBUGGERENGINE_DEBUG
-        qDebug() << "deserializing command";
-#endif
-        int wasAvailable = m_socket->bytesAvailable();
-        qint32 id;
-        in >> id;
-        QScriptDebuggerCommand command(QScriptDebuggerCommand::None);
-        in >> command;
-        Q_ASSERT(m_socket->bytesAvailable() == wasAvailable - m_blockSize);
+  Such a target is suspended with waitForResume() rather than a nested
+  event loop, and the commands that arrive while it runs are executed
+  between two statements, by the hook agent calling pollInbound().
+  Timers don't fire on a thread that doesn't run an event loop, so
+  profile and coverage chunks that are only due by time wait until the
+  thread runs one. Output is woken for by the connection instead (see
+  appendOutput()), but still waits while the thread runs no script.
 
-#ifdef DEBUGGERENGINE_DEBUG
-        qDebug("executing command (id=%d, type=%d)", id, command.type());
-#endif
-        QScriptDebuggerResponse response = commandExecutor()->execute(this, command);
+  The setters are then called through the connection, see
+  QScriptDebuggerEngineConnection::invokeOnBackends().
+*/
+void QScriptRemoteTargetDebuggerBackend::setWorkerThread(QThread *thread)
+{
+    m_workerThread = true;
+    moveToThread(thread);
+}
 
-#ifdef DEBUGGERENGINE_DEBUG
-        qDebug() << "serializing response";
-#endif
-        QByteArray block;
-        QDataStream out(&block, QIODevice::WriteOnly);
-        out.setVersion(QDataStream::Qt_4_5);
-        out << (quint32)0; // reserve 4 bytes for block size
-        out << (quint8)1;  // type = command response
-        out << id;
-        out << response;
-        out.device()->seek(0);
-        out << (quint32)(block.size() - sizeof(quint32));
-#ifdef DEBUGGERENGINE_DEBUG
-        qDebug() << "writing response (" << block.size() << "bytes )" << block.toHex();
-#endif
-        m_socket->write(block);
-        m_blockSize = 0;
+bool QScriptRemoteTargetDebuggerBackend::isWorkerThread() const
+{
+    return m_workerThread;
+}
 
-#ifdef DEBUGGERENGINE_DEBUG
-        qDebug() << "bytes available is now" << m_socket->bytesAvailable();
-#endif
-        if (m_socket->bytesAvailable() != 0)
-            QMetaObject::invokeMethod(this, "onReadyRead", Qt::QueuedConnection);
-    }   break;
+/*!
+  Returns true if the target is suspended in event().
 
-    }
+  This function must be called from the target's thread.
+*/
+bool QScriptRemoteTargetDebuggerBackend::isSuspended() const
+{
+    return (m_suspendDepth > 0) || !m_eventLoopStack.isEmpty();
 }
 
 /*!
-  \reimp
+  Executes the given \a command and sends the response, tagged with
+  \a id, on this backend's channel to the debugger \a peer.
 */
-void QScriptRemoteTargetDebuggerBackend::event(const QScriptDebuggerEvent &event)
+void QScriptRemoteTargetDebuggerBackend::executeCommand(qint32 id, const QScriptDebuggerCommand &command,
+                                                        quint32 peer)
 {
-    if (m_state != ConnectedState)
-        return;
-    if (m_eventLoopPool.isEmpty())
-        m_eventLoopPool.append(new QEventLoop());
-    QEventLoop *eventLoop = m_eventLoopPool.takeFirst();
-    Q_ASSERT(!eventLoop->isRunning());
-    m_eventLoopStack.prepend(eventLoop);
-
 #ifdef DEBUGGERENGINE_DEBUG
-    qDebug() << "serializing event of type" << event.type();
-#endif
-    QByteArray block;
-    QDataStream out(&block, QIODevice::WriteOnly);
-    out.setVersion(QDataStream::Qt_4_5);
-    out << (quint32)0; // reserve 4 bytes for block size
-    out << (quint8)0;  // type = event
-    out << event;
-    out.device()->seek(0);
-    out << (quint32)(block.size() - sizeof(quint32));
-
-#ifdef DEBUGGERENGINE_DEBUG
-    qDebug() << "writing event (" << block.size() << " bytes )";
+    qDebug("executing command (channel=%u, id=%d, type=%d)", m_channel, id, command.type());
 #endif
-    m_socket->write(block);
+    QScriptDebuggerResponse response = execute(command, peer);
+    QList<qint64> added;
+    collectAddedScripts(command, response, &added);
+    if (!added.isEmpty())
+        announceScripts(added);
+    sendResponse(id, response, peer);
+}
 
-    // run an event loop until the debugger triggers a resume
-#ifdef DEBUGGERENGINE_DEBUG
-    qDebug("entering event loop");
-#endif
-    eventLoop->exec();
+/*!
+  Executes the given \a commands in order and sends all the responses,
+  tagged with the corresponding \a ids, in a single frame.
+*/
+void QScriptRemoteTargetDebuggerBackend::executeCommands(const QList<qint32> &ids,
+                                                         const QList<QScriptDebuggerCommand> &commands,
+                                                         quint32 peer)
+{
+    Q_ASSERT(ids.size() == commands.size());
 #ifdef DEBUGGERENGINE_DEBUG
-    qDebug("returned from event loop");
+    qDebug("executing batch of %d commands (channel=%u)", commands.size(), m_channel);
 #endif
+    QList<QScriptDebuggerResponse> responses;
+    QList<qint64> added;
+    for (int i = 0; i < commands.size(); ++i) {
+        responses.append(execute(commands.at(i), peer));
+        collectAddedScripts(commands.at(i), responses.last(), &added);
+    }
+    if (!added.isEmpty())
+        announceScripts(added);
+    sendResponses(ids, responses, peer);
+}
 
-    if (!m_eventLoopStack.isEmpty()) {
-        // the event loop was quit directly (i.e. not via resume())
-        m_eventLoopStack.takeFirst();
+/*!
+  Executes \a command for the debugger \a peer. A command that refers to
+  an object snapshot or script value iterator that another debugger
+  created is answered with ObserverCommandError instead.
+*/
+QScriptDebuggerResponse QScriptRemoteTargetDebuggerBackend::execute(const QScriptDebuggerCommand &command,
+                                                                    quint32 peer)
+{
+    if (!isOwnedBy(command, peer))
+        return observerCommandError();
+    QScriptDebuggerResponse response = m_pager.execute(this, command);
+    if (response.error() != QScriptDebuggerResponse::NoError)
+        return response;
+    switch (command.type()) {
+    case QScriptDebuggerCommand::NewScriptObjectSnapshot:
+        m_snapshotOwners.insert(response.resultAsInt(), peer);
+        break;
+    case QScriptDebuggerCommand::DeleteScriptObjectSnapshot:
+        m_snapshotOwners.remove(command.snapshotId());
+        break;
+    case QScriptDebuggerCommand::NewScriptValueIterator:
+        m_iteratorOwners.insert(response.resultAsInt(), peer);
+        break;
+    case QScriptDebuggerCommand::DeleteScriptValueIterator:
+        m_iteratorOwners.remove(command.iteratorId());
+        break;
+    default:
+        break;
     }
-    m_eventLoopPool.append(eventLoop);
-    doPendingEvaluate(/*postEvent=*/false);
+    return response;
 }
 
 /*!
-  \reimp
+  Returns true if \a command doesn't refer to an object snapshot or
+  script value iterator that another debugger than \a peer created.
 */
-void QScriptRemoteTargetDebuggerBackend::resume()
+bool QScriptRemoteTargetDebuggerBackend::isOwnedBy(const QScriptDebuggerCommand &command,
+                                                   quint32 peer) const
 {
-    // quitting the event loops will cause event() to return (see above)
-    while (!m_eventLoopStack.isEmpty()) {
-        QEventLoop *eventLoop = m_eventLoopStack.takeFirst();
-        if (eventLoop->isRunning())
-            eventLoop->quit();
+    switch (command.type()) {
+    case QScriptDebuggerCommand::ScriptObjectSnapshotCapture:
+    case QScriptDebuggerCommand::DeleteScriptObjectSnapshot:
+        return m_snapshotOwners.value(command.snapshotId(), peer) == peer;
+    case QScriptDebuggerCommand::GetPropertiesByIterator:
+    case QScriptDebuggerCommand::DeleteScriptValueIterator:
+        return m_iteratorOwners.value(command.iteratorId(), peer) == peer;
+    default:
+        break;
     }
+    return true;
 }
 
 /*!
-  Constructs a new QScriptDebuggerEngine object with the given \a
-  parent.
+  Deletes the object snapshots and script value iterators that the
+  debugger \a peer created; it is gone.
 */
-QScriptDebuggerEngine::QScriptDebuggerEngine(QObject *parent)
-    : QObject(parent), m_backend(0)
+void QScriptRemoteTargetDebuggerBackend::releasePeer(uint peer)
 {
+    QHash<int, quint32>::iterator it;
+    for (it = m_snapshotOwners.begin(); it != m_snapshotOwners.end(); ) {
+        if (it.value() == peer) {
+            deleteScriptObjectSnapshot(it.key());
+            it = m_snapshotOwners.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (it = m_iteratorOwners.begin(); it != m_iteratorOwners.end(); ) {
+        if (it.value() == peer) {
+            deleteScriptValueIterator(it.key());
+            it = m_iteratorOwners.erase(it);
+        } else {
+            ++it;
+        }
+    }
 }
 
 /*!
-  Destroys this QScriptDebuggerEngine.
+  Returns true if the inbound queue has no room for another command.
+  The network thread must then stop reading; processInbound() tells it
+  to resume once the queue has been drained.
+
+  This function is called by the network thread.
 */
-QScriptDebuggerEngine::~QScriptDebuggerEngine()
+bool QScriptRemoteTargetDebuggerBackend::isInboundFull()
 {
-    delete m_backend;
+    // raise the flag before checking, so that a concurrent drain can't
+    // miss it
+    m_inboundStalled.fetchAndStoreOrdered(1);
+    if (m_inbound.isFull())
+        return true;
+    m_inboundStalled.fetchAndStoreOrdered(0);
+    return false;
 }
 
 /*!
-  Sets the \a target engine that this debugger engine will manage.
+  Queues the given \a command for execution on the engine thread. The
+  caller must have checked that the queue isn't full.
+
+  This function is called by the network thread.
 */
-void QScriptDebuggerEngine::setTarget(QScriptEngine *target)
+void QScriptRemoteTargetDebuggerBackend::enqueueCommand(qint32 id, const QScriptDebuggerCommand &command,
+                                                        quint32 peer)
 {
-    if (m_backend) {
-        m_backend->detach();
-    } else {
-        m_backend = new QScriptRemoteTargetDebuggerBackend();
-        QObject::connect(m_backend, SIGNAL(connected()),
-                         this, SIGNAL(connected()));
-        QObject::connect(m_backend, SIGNAL(disconnected()),
-                         this, SIGNAL(disconnected()));
-        QObject::connect(m_backend, SIGNAL(error(QScriptDebuggerEngine::Error)),
-                         this, SIGNAL(error(QScriptDebuggerEngine::Error)));
-    }
-    m_backend->attachTo(target);
+    QScriptDebuggerInboundMessage message;
+    message.id = id;
+    message.peer = peer;
+    message.command = command;
+    bool ok = m_inbound.enqueue(message);
+    Q_ASSERT(ok);
+    Q_UNUSED(ok);
+    // only post one notification for any number of queued commands
+    if (m_workerThread)
+        wake();
+    else if (m_inboundPending.testAndSetOrdered(0, 1))
+        QMetaObject::invokeMethod(this, "processInbound", Qt::QueuedConnection);
 }
 
 /*!
-  Returns the script engine that this debugger engine manages a connection to,
-  or 0 if no engine has been set.
+  Queues the given batch of \a commands as a single message. The caller
+  must have checked that the queue isn't full.
+
+  This function is called by the network thread.
 */
-QScriptEngine *QScriptDebuggerEngine::target() const
+void QScriptRemoteTargetDebuggerBackend::enqueueCommands(const QList<qint32> &ids,
+                                                         const QList<QScriptDebuggerCommand> &commands,
+                                                         quint32 peer)
 {
-    if (!m_backend)
-        return 0;
-    return m_backend->engine();
+    QScriptDebuggerInboundMessage message;
+    message.peer = peer;
+    message.batchIds = ids;
+    message.batchCommands = commands;
+    bool ok = m_inbound.enqueue(message);
+    Q_ASSERT(ok);
+    Q_UNUSED(ok);
+    if (m_workerThread)
+        wake();
+    else if (m_inboundPending.testAndSetOrdered(0, 1))
+        QMetaObject::invokeMethod(this, "processInbound", Qt::QueuedConnection);
 }
 
 /*!
-  Attempts to make a connection to the given \a address on the given
-  \a port.
+  Takes the next event or response off the outbound queue.
 
-  The connected() signal is emitted when the connection has been
-  established.
+  This function is called by the network thread.
+*/
+bool QScriptRemoteTargetDebuggerBackend::dequeueOutbound(QScriptDebuggerOutboundMessage *message)
+{
+    if (!m_outbound.dequeue(message))
+        return false;
+    if (m_outboundWaiting.testAndSetOrdered(1, 0)) {
+        QMutexLocker locker(&m_outboundMutex);
+        m_outboundCondition.wakeAll();
+    }
+    return true;
+}
 
-  \sa disconnectFromDebugger(), listen()
+/*!
+  Gets a target on a worker thread to look at its inbound queue and the
+  calls posted to the backend: right away if it is suspended, otherwise
+  before its next statement. Does nothing for other targets, whose
+  event loop delivers both.
+
+  This function is called by the network thread.
 */
-void QScriptDebuggerEngine::connectToDebugger(const QHostAddress &address, quint16 port)
+void QScriptRemoteTargetDebuggerBackend::wake()
 {
-    if (!m_backend) {
-        qWarning("QScriptDebuggerEngine::connectToDebugger(): no engine has been set (call setTarget() first)");
+    if (!m_workerThread)
         return;
+    m_inboundPending.fetchAndStoreOrdered(1);
+    QMutexLocker locker(&m_suspendMutex);
+    m_suspendCondition.wakeAll();
+}
+
+void QScriptRemoteTargetDebuggerBackend::processInbound()
+{
+    m_inboundPending.fetchAndStoreOrdered(0);
+    bool executing = m_executingCommands;
+    m_executingCommands = true;
+    if (m_workerThread) {
+        // calls from the network thread (profiler control, connects and
+        // disconnects) that no event loop on this thread will deliver
+        QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+    }
+    QScriptDebuggerInboundMessage message;
+    while (m_inbound.dequeue(&message)) {
+        if (!message.batchCommands.isEmpty())
+            executeCommands(message.batchIds, message.batchCommands, message.peer);
+        else
+            executeCommand(message.id, message.command, message.peer);
+    }
+    m_executingCommands = executing;
+    if (m_inboundStalled.testAndSetOrdered(1, 0)) {
+        // there's room again; let the network thread pick up where it left
+        QMetaObject::invokeMethod(m_connection, "resumeReading", Qt::QueuedConnection);
     }
-    m_backend->connectToDebugger(address, port);
 }
 
 /*!
-  Attempts to close the connection.
+  Called by the hook agent before each statement of a target on a
+  worker thread once wake() has been called.
+*/
+void QScriptRemoteTargetDebuggerBackend::pollInbound()
+{
+    // the output timer can't fire on this thread
+    if (!m_pendingOutput.isEmpty() && (m_pendingOutputAge.elapsed() >= m_outputBatchInterval))
+        flushOutput();
+    // not while a command (e.g. an evaluation) is executing; what came
+    // in meanwhile is executed once it is done
+    if (!m_executingCommands)
+        processInbound();
+}
 
-  The disconnected() signal is emitted when the connection has been
-  closed.
+void QScriptRemoteTargetDebuggerBackend::onConnected()
+{
+    if (m_target && !engine())
+        attachDebuggerAgent();
+    // ### a way to specify if a break should be triggered immediately,
+    // or only if an uncaught exception is triggered
+    interruptEvaluation();
+}
 
-  \sa connectToDebugger()
-*/
-void QScriptDebuggerEngine::disconnectFromDebugger()
+void QScriptRemoteTargetDebuggerBackend::onDisconnected()
 {
-    if (m_backend)
-        m_backend->disconnectFromDebugger();
+    m_profiler->stop();
+    m_pendingProfile = QScriptDebuggerProfileChunk();
+    m_coverage->setStreaming(0, 0);
+    if (!m_localCoverage)
+        m_coverage->stop();
+    m_pendingCoverage = QScriptDebuggerCoverageChunk();
+    updateHookAgent();
+    if (!engine())
+        return;
+    if (m_lazyAttach) {
+        // nobody is left to resume the target
+        resume();
+        detachDebuggerAgent();
+        return;
+    }
+    // coverage that is recorded locally outlives the connection
+    if (m_hookAgent)
+        m_hookAgent->setNext(0);
+    else
+        engine()->setAgent(0);
 }
 
 /*!
-  Listens for an incoming connection on the given \a address and \a
-  port.
+  If the breakpoint that triggered \a event is a logpoint or tracepoint,
+  evaluates it, queues the result for the frontend and returns true;
+  otherwise returns false.
+*/
+bool QScriptRemoteTargetDebuggerBackend::handleTracepoint(const QScriptDebuggerEvent &event)
+{
+    QScriptBreakpointData data = breakpointData(event.breakpointId());
+    QVariantMap spec = data.data().toMap();
+    QString kind = spec.value(QScriptDebuggerProtocol::breakpointKindKey()).toString();
+    bool isLog = (kind == QScriptDebuggerProtocol::logpointKind());
+    if (!isLog && (kind != QScriptDebuggerProtocol::tracepointKind()))
+        return false;
 
-  Returns true on success; otherwise returns false.
+    QScriptDebuggerOutputEntry entry;
+    entry.type = QtDebugMsg;
+    entry.fileName = event.fileName();
+    entry.lineNumber = event.lineNumber();
+    // evaluating the expression can itself trigger debugger events;
+    // those are dropped (see event())
+    m_inTracepoint = true;
+    if (isLog) {
+        QString expression = spec.value(QScriptDebuggerProtocol::expressionKey()).toString();
+        QScriptValue ret = engine()->evaluate(expression, QString::fromLatin1("logpoint"));
+        if (engine()->hasUncaughtException()) {
+            entry.type = QtWarningMsg;
+            engine()->clearExceptions();
+        }
+        entry.message = ret.toString();
+    } else {
+        int maxFrames = spec.value(QScriptDebuggerProtocol::maxFramesKey(), 5).toInt();
+        QStringList backtrace = engine()->currentContext()->backtrace();
+        entry.message = QStringList(backtrace.mid(0, maxFrames)).join(QLatin1String("\n"));
+    }
+    m_inTracepoint = false;
+    appendOutput(entry);
+    return true;
+}
 
-  The connected() signal is emitted when a connection has been
-  established.
+/*!
+  If \a command reports which scripts have been loaded since the last
+  checkpoint, appends the ids of the added ones from \a response to
+  \a added, and forgets the hashes of the removed ones.
+*/
+void QScriptRemoteTargetDebuggerBackend::collectAddedScripts(const QScriptDebuggerCommand &command,
+                                                             const QScriptDebuggerResponse &response,
+                                                             QList<qint64> *added)
+{
+    if ((command.type() != QScriptDebuggerCommand::ScriptsCheckpoint)
+        && (command.type() != QScriptDebuggerCommand::GetScriptsDelta)) {
+        return;
+    }
+    if (!(m_connection->agreedCapabilities() & QScriptDebuggerProtocol::ScriptCacheCapability)
+        || (response.error() != QScriptDebuggerResponse::NoError)) {
+        return;
+    }
+    QScriptScriptsDelta delta = qvariant_cast<QScriptScriptsDelta>(response.result());
+    for (int i = 0; i < delta.second.size(); ++i)
+        m_scriptHashes.remove(delta.second.at(i));
+    *added += delta.first;
+}
 
-  \sa connectToDebugger()
+/*!
+  Tells the frontend the hashes of the scripts with the given \a ids, so
+  that it only asks for the contents of the ones it hasn't cached.
 */
-bool QScriptDebuggerEngine::listen(const QHostAddress &address, quint16 port)
+void QScriptRemoteTargetDebuggerBackend::announceScripts(const QList<qint64> &ids)
 {
-    if (!m_backend) {
-        qWarning("QScriptDebuggerEngine::listen(): no script engine has been set (call setTarget() first)");
-        return false;
+    QList<QScriptDebuggerScriptHash> scripts;
+    for (int i = 0; i < ids.size(); ++i) {
+        QScriptScriptData data = scriptData(ids.at(i));
+        if (!data.isValid())
+            continue;
+        QScriptDebuggerScriptHash script;
+        script.scriptId = ids.at(i);
+        script.hash = m_scriptHashes.value(script.scriptId);
+        if (script.hash.isEmpty()) {
+            script.hash = QCryptographicHash::hash(data.contents().toUtf8(), QCryptographicHash::Sha1);
+            m_scriptHashes.insert(script.scriptId, script.hash);
+        }
+        script.fileName = data.fileName();
+        script.baseLineNumber = data.baseLineNumber();
+        script.timeStamp = data.timeStamp();
+        scripts.append(script);
+    }
+    if (scripts.isEmpty())
+        return;
+    if (!m_connection->isThreaded()) {
+        m_connection->writeScriptHashes(m_channel, scripts);
+    } else {
+        QScriptDebuggerOutboundMessage message;
+        message.type = QScriptDebuggerProtocol::ScriptHashesFrame;
+        message.scripts = scripts;
+        enqueueOutbound(message);
+    }
+}
+
+void QScriptRemoteTargetDebuggerBackend::appendOutput(const QScriptDebuggerOutputEntry &entry)
+{
+    if (m_pendingOutput.isEmpty()) {
+        m_pendingOutputAge.start();
+        m_outputTimer->start();
+        // a worker thread is unlikely to run an event loop; have the
+        // connection wake it once the batch is due, for pollInbound()
+        if (m_workerThread) {
+            QMetaObject::invokeMethod(m_connection, "wakeBackendLater", Qt::QueuedConnection,
+                                      Q_ARG(uint, m_channel), Q_ARG(int, m_outputBatchInterval));
+        }
+    }
+    m_pendingOutput.append(entry);
+    // the timer can't fire while the engine is busy, so also check the
+    // age of the batch here
+    if ((m_pendingOutput.size() >= m_maxOutputBatchSize)
+        || (m_pendingOutputAge.elapsed() >= m_outputBatchInterval)) {
+        flushOutput();
+    }
+}
+
+void QScriptRemoteTargetDebuggerBackend::flushOutput()
+{
+    m_outputTimer->stop();
+    if (m_pendingOutput.isEmpty())
+        return;
+    if (!m_connection->isConnected()) {
+        m_pendingOutput.clear();
+        return;
+    }
+    if (!m_connection->isThreaded()) {
+        m_connection->writeOutput(m_channel, m_pendingOutput);
+    } else {
+        QScriptDebuggerOutboundMessage message;
+        message.type = QScriptDebuggerProtocol::OutputFrame;
+        message.output = m_pendingOutput;
+        enqueueOutbound(message);
+    }
+    m_pendingOutput.clear();
+}
+
+/*!
+  Sends what the profiler has sampled since the last chunk. A chunk that
+  doesn't fit in the outbound queue is kept and sent with the next one,
+  rather than waiting for the network thread; the target isn't
+  suspended while it's being profiled.
+*/
+void QScriptRemoteTargetDebuggerBackend::flushProfile()
+{
+    m_pendingProfile.append(m_profiler->takeChunk());
+    if (!m_connection->isConnected()) {
+        m_pendingProfile = QScriptDebuggerProfileChunk();
+        return;
+    }
+    if (!m_connection->isThreaded()) {
+        m_connection->writeProfile(m_channel, m_pendingProfile);
+    } else {
+        QScriptDebuggerOutboundMessage message;
+        message.type = QScriptDebuggerProtocol::ProfileFrame;
+        message.profile = m_pendingProfile;
+        if (!m_outbound.enqueue(message))
+            return;
+        m_connection->notifyOutbound();
+    }
+    m_pendingProfile = QScriptDebuggerProfileChunk();
+}
+
+/*!
+  Sends the coverage counters that have changed since the last chunk,
+  the same way flushProfile() sends profile chunks.
+*/
+void QScriptRemoteTargetDebuggerBackend::flushCoverage()
+{
+    m_pendingCoverage.append(m_coverage->takeDelta());
+    if (!m_connection->isConnected()) {
+        m_pendingCoverage = QScriptDebuggerCoverageChunk();
+        return;
+    }
+    if (m_pendingCoverage.isEmpty())
+        return;
+    if (!m_connection->isThreaded()) {
+        m_connection->writeCoverage(m_channel, m_pendingCoverage);
+    } else {
+        QScriptDebuggerOutboundMessage message;
+        message.type = QScriptDebuggerProtocol::CoverageFrame;
+        message.coverage = m_pendingCoverage;
+        if (!m_outbound.enqueue(message))
+            return;
+        m_connection->notifyOutbound();
+    }
+    m_pendingCoverage = QScriptDebuggerCoverageChunk();
+}
+
+void QScriptRemoteTargetDebuggerBackend::sendHeapSnapshot(const QScriptDebuggerHeapSnapshotChunk &chunk,
+                                                          quint32 peer)
+{
+    if (!m_connection->isThreaded()) {
+        m_connection->writeHeapSnapshot(m_channel, chunk, peer);
+        return;
+    }
+    QScriptDebuggerOutboundMessage message;
+    message.type = QScriptDebuggerProtocol::HeapSnapshotFrame;
+    message.peer = peer;
+    message.heapSnapshot = chunk;
+    enqueueOutbound(message);
+}
+
+void QScriptRemoteTargetDebuggerBackend::sendEvent(const QScriptDebuggerEvent &event)
+{
+    if (!m_connection->isThreaded()) {
+        m_connection->writeEvent(m_channel, event);
+        return;
+    }
+    QScriptDebuggerOutboundMessage message;
+    message.type = QScriptDebuggerProtocol::EventFrame;
+    message.event = event;
+    enqueueOutbound(message);
+}
+
+void QScriptRemoteTargetDebuggerBackend::sendResponse(qint32 id, const QScriptDebuggerResponse &response,
+                                                      quint32 peer)
+{
+    if (!m_connection->isThreaded()) {
+        m_connection->writeResponse(m_channel, id, response, peer);
+        return;
+    }
+    QScriptDebuggerOutboundMessage message;
+    message.type = QScriptDebuggerProtocol::ResponseFrame;
+    message.id = id;
+    message.peer = peer;
+    message.response = response;
+    enqueueOutbound(message);
+}
+
+void QScriptRemoteTargetDebuggerBackend::sendResponses(const QList<qint32> &ids,
+                                                       const QList<QScriptDebuggerResponse> &responses,
+                                                       quint32 peer)
+{
+    if (!m_connection->isThreaded()) {
+        m_connection->writeResponses(m_channel, ids, responses, peer);
+        return;
+    }
+    QScriptDebuggerOutboundMessage message;
+    message.type = QScriptDebuggerProtocol::ResponseBatchFrame;
+    message.peer = peer;
+    message.batchIds = ids;
+    message.batchResponses = responses;
+    enqueueOutbound(message);
+}
+
+/*!
+  Queues \a message for the network thread. If the queue is full, waits
+  until dequeueOutbound() has made room; the network thread drains the
+  queue regardless of the socket state, so a full queue only means that
+  it hasn't caught up yet.
+*/
+void QScriptRemoteTargetDebuggerBackend::enqueueOutbound(const QScriptDebuggerOutboundMessage &message)
+{
+    if (!m_outbound.enqueue(message)) {
+        QMutexLocker locker(&m_outboundMutex);
+        m_outboundWaiting.fetchAndStoreOrdered(1);
+        while (!m_outbound.enqueue(message)) {
+            m_connection->notifyOutbound();
+            // dequeueOutbound() can't wake us before we wait, as it
+            // needs the mutex to do so
+            m_outboundCondition.wait(&m_outboundMutex);
+            m_outboundWaiting.fetchAndStoreOrdered(1);
+        }
+        m_outboundWaiting.fetchAndStoreOrdered(0);
+    }
+    m_connection->notifyOutbound();
+}
+
+/*!
+  \reimp
+*/
+void QScriptRemoteTargetDebuggerBackend::event(const QScriptDebuggerEvent &event)
+{
+    if (!m_connection->isConnected() || m_inTracepoint)
+        return;
+    if ((event.type() == QScriptDebuggerEvent::Breakpoint) && handleTracepoint(event))
+        return;
+    if (event.type() == QScriptDebuggerEvent::Trace) {
+        // what the target print()s; there's no need to stop it and wait
+        // for the debugger to say so, as the debugger would only show it
+        // and resume it
+        QScriptDebuggerOutputEntry entry;
+        entry.type = QtDebugMsg;
+        entry.message = event.message();
+        appendOutput(entry);
+        return;
+    }
+    // output produced before the target stopped must arrive first
+    flushOutput();
+    bool outermost = m_workerThread ? (m_suspendDepth == 0) : !m_watchdogTimer->isActive();
+    QEventLoop *eventLoop = 0;
+    if (!m_workerThread) {
+        if (m_eventLoopPool.isEmpty())
+            m_eventLoopPool.append(new QEventLoop());
+        eventLoop = m_eventLoopPool.takeFirst();
+        Q_ASSERT(!eventLoop->isRunning());
+        m_eventLoopStack.prepend(eventLoop);
+    }
+
+    sendEvent(event);
+
+    // the watchdog covers the outermost suspension; nested ones (while
+    // evaluating in a suspended context) count towards it
+    if ((m_suspensionTimeout > 0) && outermost) {
+        m_suspendedTime.start();
+        m_lastActivity = m_connection->activity();
+        m_lastActivityTime.start();
+        if (!m_workerThread)
+            m_watchdogTimer->start(qBound(10, m_suspensionTimeout / 10, 1000));
+    }
+
+    // run an event loop until the debugger triggers a resume
+#ifdef DEBUGGERENGINE_DEBUG
+    qDebug("entering event loop (channel=%u)", m_channel);
+#endif
+    qint64 suspended = QScriptDebuggerMetrics::now();
+    if (m_workerThread)
+        waitForResume();
+    else
+        eventLoop->exec();
+#ifdef DEBUGGERENGINE_DEBUG
+    qDebug("returned from event loop (channel=%u)", m_channel);
+#endif
+    m_connection->metrics()->addTime(QString::fromLatin1("suspended_seconds"),
+                                     QString::fromLatin1("event=\"%0\"").arg(int(event.type())),
+                                     QScriptDebuggerMetrics::now() - suspended);
+
+    if (eventLoop) {
+        if (!m_eventLoopStack.isEmpty()) {
+            // the event loop was quit directly (i.e. not via resume())
+            m_eventLoopStack.takeFirst();
+        }
+        if (m_eventLoopStack.isEmpty())
+            m_watchdogTimer->stop();
+        m_eventLoopPool.append(eventLoop);
+    }
+    // however the target was resumed (by the debugger, the watchdog or
+    // the engine), the objects may change once it runs; release the
+    // range objects, and the objects they refer to, when it leaves the
+    // outermost suspension
+    if (m_workerThread ? (m_suspendDepth == 0) : m_eventLoopStack.isEmpty())
+        m_pager.clear();
+    doPendingEvaluate(/*postEvent=*/false);
+}
+
+/*!
+  Suspends a target on a worker thread until resume() is called. The
+  thread sleeps on a condition that wake() raises when a command comes
+  in, and executes the commands itself, so nothing is handed to it
+  through an event loop; the watchdog is checked whenever the wait
+  times out.
+*/
+void QScriptRemoteTargetDebuggerBackend::waitForResume()
+{
+    QMutexLocker locker(&m_suspendMutex);
+    int resumeCount = m_resumeCount;
+    ++m_suspendDepth;
+    while (m_resumeCount == resumeCount) {
+        if (m_inboundPending == 0) {
+            if (m_suspensionTimeout > 0)
+                m_suspendCondition.wait(&m_suspendMutex, qBound(10, m_suspensionTimeout / 10, 1000));
+            else
+                m_suspendCondition.wait(&m_suspendMutex);
+        }
+        locker.unlock();
+        // this may resume the target, or suspend it again (nested)
+        processInbound();
+        if ((m_suspensionTimeout > 0) && (m_suspendDepth == 1))
+            checkSuspension();
+        locker.relock();
+    }
+    --m_suspendDepth;
+}
+
+/*!
+  Called periodically while the target is suspended; takes the action
+  set with setSuspensionTimeout() once the controlling debugger hasn't
+  been heard from for too long. Heartbeats count, so a debugger that is
+  merely waiting for its user doesn't trigger it.
+*/
+void QScriptRemoteTargetDebuggerBackend::checkSuspension()
+{
+    int activity = m_connection->activity();
+    if (activity != m_lastActivity) {
+        m_lastActivity = activity;
+        m_lastActivityTime.start();
+        return;
+    }
+    if ((m_suspensionTimeout > 0) && (m_lastActivityTime.elapsed() >= m_suspensionTimeout))
+        forceResume();
+}
+
+/*!
+  Resumes the target without being told to by the debugger, after
+  disabling its breakpoints or disconnecting the debugger if that is
+  the action set. The debugger finds out through a warning in the
+  target's output, and the engine through suspensionTimedOut().
+*/
+void QScriptRemoteTargetDebuggerBackend::forceResume()
+{
+    m_watchdogTimer->stop();
+    int msecs = m_suspendedTime.elapsed();
+    QString what;
+    if (m_suspensionTimeoutAction == QScriptDebuggerEngine::DisableBreakpoints) {
+        QScriptBreakpointMap breakpoints = this->breakpoints();
+        QScriptBreakpointMap::const_iterator it;
+        for (it = breakpoints.constBegin(); it != breakpoints.constEnd(); ++it) {
+            QScriptBreakpointData data = it.value();
+            if (!data.isEnabled())
+                continue;
+            data.setEnabled(false);
+            setBreakpointData(it.key(), data);
+        }
+        what = QString::fromLatin1("; breakpoints disabled");
+    } else if (m_suspensionTimeoutAction == QScriptDebuggerEngine::DisconnectDebugger) {
+        QMetaObject::invokeMethod(m_connection, "disconnectFromDebugger", Qt::QueuedConnection);
+        what = QString::fromLatin1("; disconnecting the debugger");
+    }
+    QScriptDebuggerOutputEntry entry;
+    entry.type = QtWarningMsg;
+    entry.message = QString::fromLatin1("Resumed after %0 ms without word from the debugger%1")
+                    .arg(msecs).arg(what);
+    qWarning("QScriptDebuggerEngine: %s (channel=%u)", qPrintable(entry.message), m_channel);
+    appendOutput(entry);
+    flushOutput();
+    continueEvalution();
+    emit suspensionTimedOut(m_target, msecs);
+}
+
+/*!
+  Starts sampling the target every \a interval ms, tagging the chunks
+  with \a session; an \a interval of 0 stops sampling.
+*/
+void QScriptRemoteTargetDebuggerBackend::setProfilingInterval(int interval, uint session)
+{
+#ifdef DEBUGGERENGINE_DEBUG
+    qDebug("profiling interval %d ms (channel=%u, session=%u)", interval, m_channel, session);
+#endif
+    if ((interval <= 0) || !engine()) {
+        m_profiler->stop();
+    } else {
+        // anything still pending belongs to the previous session
+        m_pendingProfile = QScriptDebuggerProfileChunk();
+        m_profiler->start(engine(), interval, session);
+    }
+    updateHookAgent();
+}
+
+/*!
+  Starts recording the target's line coverage and sending what has
+  changed every \a interval ms, in chunks tagged with \a session; an
+  \a interval of 0 stops sending. Recording goes on while coverage is
+  also recorded locally (see setCoverageEnabled()).
+*/
+void QScriptRemoteTargetDebuggerBackend::setCoverageInterval(int interval, uint session)
+{
+#ifdef DEBUGGERENGINE_DEBUG
+    qDebug("coverage interval %d ms (channel=%u, session=%u)", interval, m_channel, session);
+#endif
+    if ((interval <= 0) || !engine()) {
+        m_coverage->setStreaming(0, session);
+        if (!m_localCoverage)
+            m_coverage->stop();
+    } else {
+        m_pendingCoverage = QScriptDebuggerCoverageChunk();
+        if (!m_coverage->isActive())
+            m_coverage->start();
+        m_coverage->setStreaming(interval, session);
+    }
+    updateHookAgent();
+}
+
+/*!
+  Walks the objects reachable in the target and sends them in chunks
+  tagged with \a snapshot to the debugger \a peer. Only the first chunk
+  is sent right away; the connection asks for each of the others with
+  continueHeapSnapshot() once the peer has read most of what was sent
+  before, so neither the snapshot as a whole nor a backlog of chunks is
+  ever held in memory. A request that arrives while another snapshot
+  is being sent waits for it.
+
+  The target may run between two chunks; the objects that it creates
+  in the meantime are only included if they are reached later on.
+*/
+void QScriptRemoteTargetDebuggerBackend::takeHeapSnapshot(uint snapshot, uint peer)
+{
+    m_heapSnapshotRequests.enqueue(qMakePair(quint32(snapshot), quint32(peer)));
+    if (!m_heapWalker)
+        startHeapSnapshot();
+}
+
+void QScriptRemoteTargetDebuggerBackend::startHeapSnapshot()
+{
+    while (!m_heapWalker && !m_heapSnapshotRequests.isEmpty()) {
+        QPair<quint32, quint32> request = m_heapSnapshotRequests.dequeue();
+        if (!engine()) {
+            // still answer, so that the frontend isn't left waiting
+            QScriptDebuggerHeapSnapshotChunk chunk;
+            chunk.snapshot = request.first;
+            chunk.last = true;
+            sendHeapSnapshot(chunk, request.second);
+            continue;
+        }
+        m_heapWalker = new QScriptDebuggerHeapWalker(engine(), request.first);
+        m_heapSnapshot = request.first;
+        m_heapSnapshotPeer = request.second;
+        m_heapSnapshotEngine = engine();
+        continueHeapSnapshot(true);
+    }
+}
+
+/*!
+  Sends the next chunk of the heap snapshot being taken. Unless \a
+  proceed is true, or if the target has changed since the snapshot was
+  started, the snapshot is ended with a truncated chunk instead; the
+  connection says not to proceed once the debugger that asked for it is
+  gone.
+*/
+void QScriptRemoteTargetDebuggerBackend::continueHeapSnapshot(bool proceed)
+{
+    if (!m_heapWalker)
+        return;
+    QScriptDebuggerHeapSnapshotChunk chunk;
+    if (proceed && m_heapSnapshotEngine && (m_heapSnapshotEngine == engine())) {
+        chunk = m_heapWalker->next();
+    } else {
+        // a controlling debugger may only be away for the moment, and
+        // get this when it resumes its session
+        chunk.snapshot = m_heapSnapshot;
+        chunk.last = true;
+        chunk.truncated = true;
+    }
+    sendHeapSnapshot(chunk, m_heapSnapshotPeer);
+    if (!chunk.last)
+        return;
+#ifdef DEBUGGERENGINE_DEBUG
+    qDebug("heap snapshot %u has %d objects%s (channel=%u)", m_heapSnapshot,
+           m_heapWalker->nodeCount(), chunk.truncated ? ", truncated" : "", m_channel);
+#endif
+    delete m_heapWalker;
+    m_heapWalker = 0;
+    startHeapSnapshot();
+}
+
+/*!
+  Sets whether the target's line coverage is recorded locally, to be
+  written by writeCoverage(), to \a enabled. Enabling it discards what
+  has been recorded before.
+*/
+void QScriptRemoteTargetDebuggerBackend::setCoverageEnabled(bool enabled)
+{
+    if (enabled == m_localCoverage)
+        return;
+    m_localCoverage = enabled;
+    if (enabled && !m_coverage->isStreaming())
+        m_coverage->start();
+    else if (!enabled && !m_coverage->isStreaming())
+        m_coverage->stop();
+    updateHookAgent();
+}
+
+/*!
+  Writes the coverage records of this backend's target to \a out.
+
+  This function must be called from the target's thread.
+*/
+void QScriptRemoteTargetDebuggerBackend::writeCoverage(QDataStream &out) const
+{
+    m_coverage->write(out);
+}
+
+/*!
+  Puts the hook agent in front of the engine's agent if the target is
+  being profiled or its coverage recorded, and takes it out again when
+  neither is the case.
+*/
+void QScriptRemoteTargetDebuggerBackend::updateHookAgent()
+{
+    QScriptEngine *eng = m_target;
+    // a target on a worker thread needs it to poll for commands
+    bool needed = eng && (m_profiler->isActive() || m_coverage->isActive() || m_workerThread);
+    if (m_hookAgent && (!needed || (m_hookEngine != eng))) {
+        if (m_hookEngine && (m_hookEngine->agent() == m_hookAgent))
+            m_hookEngine->setAgent(m_hookAgent->next());
+        m_hookAgent->setProfiler(0);
+        m_hookAgent->setCoverageRecorder(0);
+        releaseRetiredHookAgent();
+        m_retiredHookAgent = m_hookAgent;
+        m_hookAgent = 0;
+    }
+    if (!needed)
+        return;
+    if (!m_hookAgent) {
+        releaseRetiredHookAgent();
+        m_hookAgent = new QScriptDebuggerHookAgent(eng, eng->agent());
+        m_hookEngine = eng;
+        eng->setAgent(m_hookAgent);
+    }
+    m_hookAgent->setProfiler(m_profiler->isActive() ? m_profiler : 0);
+    m_hookAgent->setCoverageRecorder(m_coverage->isActive() ? m_coverage : 0);
+    m_hookAgent->setPoll(m_workerThread ? &m_inboundPending : 0, this, "pollInbound");
+}
+
+void QScriptRemoteTargetDebuggerBackend::releaseRetiredHookAgent()
+{
+    // agents are owned by their engine; if it's gone, so is the agent
+    if (m_retiredHookAgent && m_hookEngine)
+        delete m_retiredHookAgent;
+    m_retiredHookAgent = 0;
+}
+
+/*!
+  Puts the debugger's agent on the target, behind the hook agent if
+  that is installed.
+*/
+void QScriptRemoteTargetDebuggerBackend::attachDebuggerAgent()
+{
+    attachTo(m_target);
+    if (m_hookAgent && (m_hookEngine == m_target)) {
+        m_hookAgent->setNext(m_target->agent());
+        m_target->setAgent(m_hookAgent);
+    }
+}
+
+/*!
+  Takes the debugger's agent off the target, leaving the hook agent in
+  place.
+*/
+void QScriptRemoteTargetDebuggerBackend::detachDebuggerAgent()
+{
+    QScriptEngine *eng = engine();
+    if (m_hookAgent && eng && (eng->agent() == m_hookAgent)) {
+        // the base class only detaches if its agent is the engine's
+        eng->setAgent(m_hookAgent->next());
+        QScriptDebuggerBackend::detach();
+        m_hookAgent->setNext(0);
+        eng->setAgent(m_hookAgent);
+    } else {
+        QScriptDebuggerBackend::detach();
+    }
+    m_pager.clear();
+}
+
+/*!
+  Detaches from the target engine and forgets it. Hides
+  QScriptDebuggerBackend::detach(), so that the hook agent is out of the
+  way first.
+*/
+void QScriptRemoteTargetDebuggerBackend::detach()
+{
+    m_profiler->stop();
+    m_coverage->stop();
+    m_localCoverage = false;
+    m_target = 0;
+    updateHookAgent();
+    m_pager.clear();
+    QScriptDebuggerBackend::detach();
+}
+
+/*!
+  \reimp
+*/
+void QScriptRemoteTargetDebuggerBackend::resume()
+{
+    if (m_workerThread) {
+        // resumes every nested waitForResume(); may be called from any
+        // thread (e.g. by removeTarget())
+        QMutexLocker locker(&m_suspendMutex);
+        ++m_resumeCount;
+        m_suspendCondition.wakeAll();
+        return;
+    }
+    // quitting the event loops will cause event() to return (see above)
+    while (!m_eventLoopStack.isEmpty()) {
+        QEventLoop *eventLoop = m_eventLoopStack.takeFirst();
+        if (eventLoop->isRunning())
+            eventLoop->quit();
+    }
+}
+
+QScriptDebuggerEngineConnection::QScriptDebuggerEngineConnection(QObject *parent)
+    : QObject(parent), m_state(UnconnectedState), m_transport(0), m_transportType(0),
+      m_traceWriter(QScriptDebuggerTraceWriter::BackendSide),
+      m_capabilities(QScriptDebuggerProtocol::CompressionCapability
+                     | QScriptDebuggerProtocol::CompactEncodingCapability
+                     | QScriptDebuggerProtocol::ScriptCacheCapability
+                     | QScriptDebuggerProtocol::ProfilerCapability
+                     | QScriptDebuggerProtocol::CoverageCapability
+                     | QScriptDebuggerProtocol::HeapSnapshotCapability),
+      m_agreedCapabilities(0), m_compact(false), m_threaded(false), m_connected(0),
+      m_outboundPending(0), m_coalesceWrites(0), m_maxObservers(0), m_nextObserverId(1),
+      m_readingObservers(0), m_sessionCapabilities(0), m_activity(0),
+      m_maxOutboundBytes(QScriptDebuggerEngine::DefaultMaxOutboundBytes),
+      m_maxOutboundFrames(QScriptDebuggerEngine::DefaultMaxOutboundFrames),
+      m_bytesHanded(0), m_droppedOutputCount(0), m_coalescedFrameCount(0)
+{
+    m_legacyHandshakeTimer = new QTimer(this);
+    m_legacyHandshakeTimer->setSingleShot(true);
+    m_legacyHandshakeTimer->setInterval(QScriptDebuggerProtocol::LegacyHandshakeTimeout);
+    QObject::connect(m_legacyHandshakeTimer, SIGNAL(timeout()),
+                     this, SLOT(onLegacyHandshakeTimeout()));
+    m_sessionGraceTimer = new QTimer(this);
+    m_sessionGraceTimer->setSingleShot(true);
+    QObject::connect(m_sessionGraceTimer, SIGNAL(timeout()),
+                     this, SLOT(onSessionGraceTimeout()));
+    m_heartbeatTimer = new QTimer(this);
+    QObject::connect(m_heartbeatTimer, SIGNAL(timeout()), this, SLOT(sendHeartbeat()));
+    m_heldFrameTimer = new QTimer(this);
+    m_heldFrameTimer->setSingleShot(true);
+    m_heldFrameTimer->setInterval(HeldFrameInterval);
+    QObject::connect(m_heldFrameTimer, SIGNAL(timeout()), this, SLOT(releaseHeldFrames()));
+    m_wakeTimer = new QTimer(this);
+    m_wakeTimer->setSingleShot(true);
+    QObject::connect(m_wakeTimer, SIGNAL(timeout()), this, SLOT(wakeBackends()));
+    m_heapSnapshotTimer = new QTimer(this);
+    m_heapSnapshotTimer->setSingleShot(true);
+    m_heapSnapshotTimer->setInterval(HeldFrameInterval);
+    QObject::connect(m_heapSnapshotTimer, SIGNAL(timeout()), this, SLOT(continueHeapSnapshots()));
+    m_metricsTimer = new QTimer(this);
+    QObject::connect(m_metricsTimer, SIGNAL(timeout()), this, SLOT(dumpMetrics()));
+    m_codec.setMetrics(&m_metrics);
+}
+
+QScriptDebuggerEngineConnection::~QScriptDebuggerEngineConnection()
+{
+    qDeleteAll(m_observers);
+    qDeleteAll(m_retiredObservers);
+}
+
+/*!
+  Makes sure that the transport is one of the given \a type, replacing
+  the current one if needed. Returns false if the current one is busy.
+*/
+bool QScriptDebuggerEngineConnection::createTransport(int type)
+{
+    if (m_transport) {
+        if (m_transportType == type)
+            return true;
+        if (m_state != UnconnectedState)
+            return false;
+        delete m_transport;
+    }
+    m_transport = QScriptDebuggerTransport::create(QScriptDebuggerTransport::Type(type), this);
+    m_transportType = type;
+    QObject::connect(m_transport, SIGNAL(connected()), this, SLOT(onTransportConnected()));
+    QObject::connect(m_transport, SIGNAL(disconnected()), this, SLOT(onTransportDisconnected()));
+    QObject::connect(m_transport, SIGNAL(error(QScriptDebuggerTransport::TransportError)),
+                     this, SLOT(onTransportError(QScriptDebuggerTransport::TransportError)));
+    QObject::connect(m_transport, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+    QObject::connect(m_transport, SIGNAL(observerConnected(QIODevice*)),
+                     this, SLOT(onObserverConnected(QIODevice*)));
+    QObject::connect(m_transport, SIGNAL(observerDisconnected(QIODevice*)),
+                     this, SLOT(onObserverDisconnected(QIODevice*)));
+    m_transport->setMaxObservers(m_maxObservers);
+    return true;
+}
+
+QIODevice *QScriptDebuggerEngineConnection::device() const
+{
+    return m_transport ? m_transport->device() : 0;
+}
+
+void QScriptDebuggerEngineConnection::connectToDebugger(int transport, const QString &address)
+{
+    Q_ASSERT(m_state == UnconnectedState);
+    if (!createTransport(transport))
+        return;
+    m_transport->connectToPeer(address);
+}
+
+void QScriptDebuggerEngineConnection::disconnectFromDebugger()
+{
+    if (!m_transport)
+        return;
+    forgetSession();
+    m_transport->disconnectFromPeer();
+}
+
+bool QScriptDebuggerEngineConnection::listen(int transport, const QString &address)
+{
+    if (device() || !createTransport(transport))
+        return false;
+    if (!m_transport->listen(address)) {
+        qWarning("QScriptDebuggerEngine: %s", qPrintable(m_transport->errorString()));
+        return false;
+    }
+    return true;
+}
+
+/*!
+  Closes the connection and stops listening, if listening. The
+  transport's notifiers belong to the thread the connection lives in, so
+  this must be called in that thread.
+*/
+void QScriptDebuggerEngineConnection::close()
+{
+    if (m_transport) {
+        forgetSession();
+        m_transport->abort();
+        delete m_transport;
+        m_transport = 0;
+    }
+}
+
+bool QScriptDebuggerEngineConnection::isConnected() const
+{
+    return (m_connected != 0);
+}
+
+/*!
+  Returns a number that changes whenever a frame arrives from the
+  controlling debugger. This function can be called from any thread.
+*/
+int QScriptDebuggerEngineConnection::activity() const
+{
+    return int(m_activity);
+}
+
+/*!
+  Returns true if the connection is connecting, connected or listening.
+*/
+bool QScriptDebuggerEngineConnection::isActive() const
+{
+    return (m_transport != 0);
+}
+
+/*!
+  Returns the capabilities agreed on in the handshake. This function can
+  be called from any thread.
+*/
+quint32 QScriptDebuggerEngineConnection::agreedCapabilities() const
+{
+    return quint32(int(m_agreedCapabilities));
+}
+
+/*!
+  Returns true if this connection lives in a separate network thread,
+  in which case the backends talk to it through their queues.
+*/
+bool QScriptDebuggerEngineConnection::isThreaded() const
+{
+    return m_threaded;
+}
+
+void QScriptDebuggerEngineConnection::setThreaded(bool threaded)
+{
+    m_threaded = threaded;
+}
+
+/*!
+  Sets whether compression is offered to the debugger in the handshake
+  to \a enable. Takes effect on the next connection.
+*/
+void QScriptDebuggerEngineConnection::setCompressionEnabled(bool enable)
+{
+    if (enable)
+        m_capabilities |= QScriptDebuggerProtocol::CompressionCapability;
+    else
+        m_capabilities &= ~QScriptDebuggerProtocol::CompressionCapability;
+}
+
+qreal QScriptDebuggerEngineConnection::compressionRatio() const
+{
+    if (m_codec.bytesBeforeCompression() == 0)
+        return 1;
+    return qreal(m_codec.bytesAfterCompression()) / m_codec.bytesBeforeCompression();
+}
+
+int QScriptDebuggerEngineConnection::compressionTime() const
+{
+    return m_codec.compressionTime();
+}
+
+/*!
+  Starts recording every frame to the trace file \a fileName, replacing
+  any recording in progress. Returns false if the file can't be written.
+*/
+bool QScriptDebuggerEngineConnection::startRecording(const QString &fileName)
+{
+    stopRecording();
+    if (!m_traceWriter.open(fileName)) {
+        qWarning("QScriptDebuggerEngine: can't record to %s (%s)",
+                 qPrintable(fileName), qPrintable(m_traceWriter.errorString()));
+        return false;
+    }
+    if (m_state == ConnectedState)
+        m_traceWriter.writeHandshake(agreedCapabilities());
+    m_codec.setTraceWriter(&m_traceWriter);
+    return true;
+}
+
+void QScriptDebuggerEngineConnection::stopRecording()
+{
+    m_codec.setTraceWriter(0);
+    m_traceWriter.close();
+}
+
+/*!
+  Starts writing the metrics to \a fileName every \a interval ms,
+  replacing any dump in progress. Returns false if the file can't be
+  written.
+*/
+bool QScriptDebuggerEngineConnection::startMetricsDump(const QString &fileName, int interval)
+{
+    stopMetricsDump();
+    if (!m_metrics.dump(fileName, QString::fromLatin1("qscriptdebuggerengine"))) {
+        qWarning("QScriptDebuggerEngine: can't write metrics to %s", qPrintable(fileName));
+        return false;
+    }
+    m_metricsFileName = fileName;
+    m_metricsTimer->start(qMax(1, interval));
+    return true;
+}
+
+/*!
+  Stops writing the metrics; the file is written one last time.
+*/
+void QScriptDebuggerEngineConnection::stopMetricsDump()
+{
+    if (m_metricsFileName.isEmpty())
+        return;
+    m_metricsTimer->stop();
+    dumpMetrics();
+    m_metricsFileName = QString();
+}
+
+void QScriptDebuggerEngineConnection::dumpMetrics()
+{
+    if (!m_metricsFileName.isEmpty())
+        m_metrics.dump(m_metricsFileName, QString::fromLatin1("qscriptdebuggerengine"));
+}
+
+/*!
+  Returns the metrics of this connection and its targets. This function
+  can be called from any thread.
+*/
+QScriptDebuggerMetrics *QScriptDebuggerEngineConnection::metrics()
+{
+    return &m_metrics;
+}
+
+/*!
+  Sets the number of debuggers that are accepted besides the controlling
+  one to \a count. Only the frames of the controlling debugger are
+  recorded.
+*/
+void QScriptDebuggerEngineConnection::setMaxObservers(int count)
+{
+    m_maxObservers = count;
+    if (m_transport)
+        m_transport->setMaxObservers(count);
+}
+
+/*!
+  Sets how long a session is kept after the connection to the debugger
+  has dropped to \a msecs, and offers the session resume capability in
+  the handshake if it is greater than 0. Takes effect on the next
+  connection.
+*/
+void QScriptDebuggerEngineConnection::setSessionResumeGracePeriod(int msecs)
+{
+    m_sessionGraceTimer->setInterval(qMax(0, msecs));
+    if (msecs > 0)
+        m_capabilities |= QScriptDebuggerProtocol::SessionResumeCapability;
+    else
+        m_capabilities &= ~QScriptDebuggerProtocol::SessionResumeCapability;
+}
+
+/*!
+  Sets the interval at which heartbeats are sent to the debugger to \a
+  msecs, and offers the heartbeat capability in the handshake if it is
+  greater than 0. Takes effect on the next connection.
+*/
+void QScriptDebuggerEngineConnection::setHeartbeatInterval(int msecs)
+{
+    m_heartbeatTimer->setInterval(qMax(0, msecs));
+    if (msecs > 0)
+        m_capabilities |= QScriptDebuggerProtocol::HeartbeatCapability;
+    else
+        m_capabilities &= ~QScriptDebuggerProtocol::HeartbeatCapability;
+}
+
+/*!
+  Bounds what may be waiting to be sent to the controlling debugger to
+  \a maxBytes and \a maxFrames; see isBackedUp().
+*/
+void QScriptDebuggerEngineConnection::setOutboundLimits(int maxBytes, int maxFrames)
+{
+    m_maxOutboundBytes = maxBytes;
+    m_maxOutboundFrames = maxFrames;
+}
+
+/*!
+  Returns the number of output entries that have been dropped because
+  the debugger wasn't keeping up.
+*/
+int QScriptDebuggerEngineConnection::droppedOutputCount() const
+{
+    return m_droppedOutputCount;
+}
+
+/*!
+  Returns the number of profile, coverage and script announcement frames
+  that have been merged into later ones because the debugger wasn't
+  keeping up.
+*/
+int QScriptDebuggerEngineConnection::coalescedFrameCount() const
+{
+    return m_coalescedFrameCount;
+}
+
+/*!
+  Adds the given \a backend to this connection. If the debugger is
+  already connected, it is told about the new channel right away.
+*/
+void QScriptDebuggerEngineConnection::addBackend(QScriptRemoteTargetDebuggerBackend *backend)
+{
+    {
+        QMutexLocker locker(&m_backendsMutex);
+        Q_ASSERT(!m_backends.contains(backend->channel()));
+        m_backends.insert(backend->channel(), backend);
+    }
+    QMetaObject::invokeMethod(this, "announceChannel", Qt::AutoConnection,
+                              Q_ARG(uint, backend->channel()));
+}
+
+void QScriptDebuggerEngineConnection::removeBackend(QScriptRemoteTargetDebuggerBackend *backend)
+{
+    {
+        QMutexLocker locker(&m_backendsMutex);
+        if (m_backends.value(backend->channel()) != backend)
+            return;
+        m_backends.remove(backend->channel());
+    }
+    QMetaObject::invokeMethod(this, "retireChannel", Qt::AutoConnection,
+                              Q_ARG(uint, backend->channel()));
+}
+
+QScriptRemoteTargetDebuggerBackend *QScriptDebuggerEngineConnection::backend(quint32 channel) const
+{
+    QMutexLocker locker(&m_backendsMutex);
+    return m_backends.value(channel);
+}
+
+QList<QScriptRemoteTargetDebuggerBackend*> QScriptDebuggerEngineConnection::backends() const
+{
+    QMutexLocker locker(&m_backendsMutex);
+    return m_backends.values();
+}
+
+/*!
+  Returns the backends that live in the given \a thread. Unlike the
+  ones returned by backends(), they can't be deleted while the calling
+  thread uses them, if it is \a thread.
+*/
+QList<QScriptRemoteTargetDebuggerBackend*> QScriptDebuggerEngineConnection::backends(QThread *thread) const
+{
+    QMutexLocker locker(&m_backendsMutex);
+    QList<QScriptRemoteTargetDebuggerBackend*> result;
+    QMap<quint32, QScriptRemoteTargetDebuggerBackend*>::const_iterator it;
+    for (it = m_backends.constBegin(); it != m_backends.constEnd(); ++it) {
+        if (it.value()->thread() == thread)
+            result.append(it.value());
+    }
+    return result;
+}
+
+/*!
+  Returns the target engines of the backends, ordered by channel.
+*/
+QList<QScriptEngine*> QScriptDebuggerEngineConnection::targets() const
+{
+    QMutexLocker locker(&m_backendsMutex);
+    QList<QScriptEngine*> result;
+    QMap<quint32, QScriptRemoteTargetDebuggerBackend*>::const_iterator it;
+    for (it = m_backends.constBegin(); it != m_backends.constEnd(); ++it) {
+        if (QScriptEngine *engine = it.value()->target())
+            result.append(engine);
+    }
+    return result;
+}
+
+/*!
+  Returns the names of the backends' channels.
+*/
+QMap<quint32, QString> QScriptDebuggerEngineConnection::channelNames() const
+{
+    QMutexLocker locker(&m_backendsMutex);
+    QMap<quint32, QString> result;
+    QMap<quint32, QScriptRemoteTargetDebuggerBackend*>::const_iterator it;
+    for (it = m_backends.constBegin(); it != m_backends.constEnd(); ++it)
+        result.insert(it.key(), it.value()->name());
+    return result;
+}
+
+/*!
+  Calls the given \a member of every backend with the arguments \a val0
+  and \a val1 (which may be left out), in the backend's thread.
+
+  Backends in another thread than the calling one get a queued call and
+  are woken (see QScriptRemoteTargetDebuggerBackend::wake()) while the
+  lock is held, as a target on a worker thread may remove, and delete,
+  its backend at any time. The others are called directly.
+
+  This function can be called from any thread.
+*/
+void QScriptDebuggerEngineConnection::invokeOnBackends(const char *member, QGenericArgument val0,
+                                                       QGenericArgument val1)
+{
+    QList<QScriptRemoteTargetDebuggerBackend*> local;
+    {
+        QMutexLocker locker(&m_backendsMutex);
+        QMap<quint32, QScriptRemoteTargetDebuggerBackend*>::const_iterator it;
+        for (it = m_backends.constBegin(); it != m_backends.constEnd(); ++it) {
+            QScriptRemoteTargetDebuggerBackend *backend = it.value();
+            if (backend->thread() == QThread::currentThread()) {
+                local.append(backend);
+                continue;
+            }
+            QMetaObject::invokeMethod(backend, member, Qt::QueuedConnection, val0, val1);
+            backend->wake();
+        }
+    }
+    // not under the lock; the call may write frames, and writing may
+    // close the connection
+    for (int i = 0; i < local.size(); ++i)
+        QMetaObject::invokeMethod(local.at(i), member, Qt::DirectConnection, val0, val1);
+}
+
+/*!
+  Wakes the backend on the given \a channel in \a msecs milliseconds, or
+  together with the others that asked for it before, so that a target
+  on a worker thread sends its output once the batch interval is over.
+*/
+void QScriptDebuggerEngineConnection::wakeBackendLater(uint channel, int msecs)
+{
+    m_wakeChannels.insert(channel);
+    if (!m_wakeTimer->isActive())
+        m_wakeTimer->start(msecs);
+}
+
+void QScriptDebuggerEngineConnection::wakeBackends()
+{
+    QMutexLocker locker(&m_backendsMutex);
+    QSet<quint32>::const_iterator it;
+    for (it = m_wakeChannels.constBegin(); it != m_wakeChannels.constEnd(); ++it) {
+        if (QScriptRemoteTargetDebuggerBackend *backend = m_backends.value(*it))
+            backend->wake();
+    }
+    m_wakeChannels.clear();
+}
+
+/*!
+  Tells the connection that a backend has queued outbound messages.
+  This function can be called from any thread.
+*/
+void QScriptDebuggerEngineConnection::notifyOutbound()
+{
+    if (m_outboundPending.testAndSetOrdered(0, 1))
+        QMetaObject::invokeMethod(this, "flushOutbound", Qt::QueuedConnection);
+}
+
+void QScriptDebuggerEngineConnection::flushOutbound()
+{
+    m_outboundPending.fetchAndStoreOrdered(0);
+    QMutexLocker locker(&m_backendsMutex);
+    ++m_coalesceWrites;
+    QMap<quint32, QScriptRemoteTargetDebuggerBackend*>::const_iterator it;
+    for (it = m_backends.constBegin(); it != m_backends.constEnd(); ++it) {
+        QScriptDebuggerOutboundMessage message;
+        while (it.value()->dequeueOutbound(&message)) {
+            // a heap snapshot chunk that can't be sent still ends the walk
+            // (see writeHeapSnapshot())
+            if (!isWritable() && (message.type != QScriptDebuggerProtocol::HeapSnapshotFrame))
+                continue;
+            if (message.type == QScriptDebuggerProtocol::EventFrame)
+                writeEvent(it.key(), message.event);
+            else if (message.type == QScriptDebuggerProtocol::OutputFrame)
+                writeOutput(it.key(), message.output);
+            else if (message.type == QScriptDebuggerProtocol::ScriptHashesFrame)
+                writeScriptHashes(it.key(), message.scripts);
+            else if (message.type == QScriptDebuggerProtocol::ProfileFrame)
+                writeProfile(it.key(), message.profile);
+            else if (message.type == QScriptDebuggerProtocol::CoverageFrame)
+                writeCoverage(it.key(), message.coverage);
+            else if (message.type == QScriptDebuggerProtocol::HeapSnapshotFrame)
+                writeHeapSnapshot(it.key(), message.heapSnapshot, message.peer);
+            else if (message.type == QScriptDebuggerProtocol::ResponseBatchFrame)
+                writeResponses(it.key(), message.batchIds, message.batchResponses, message.peer);
+            else
+                writeResponse(it.key(), message.id, message.response, message.peer);
+        }
+    }
+    --m_coalesceWrites;
+    flushWrites();
+}
+
+void QScriptDebuggerEngineConnection::announceChannel(uint channel)
+{
+    if (!isWritable())
+        return;
+    QMap<quint32, QString> names = channelNames();
+    if (names.contains(channel))
+        writeChannelOpened(channel, names.value(channel));
+}
+
+void QScriptDebuggerEngineConnection::retireChannel(uint channel)
+{
+    if (!isWritable())
+        return;
+    writeChannelClosed(channel);
+}
+
+void QScriptDebuggerEngineConnection::onTransportConnected()
+{
+    // the handshake is initiated by the debugger side, so wait for it
+    m_state = HandshakingState;
+}
+
+void QScriptDebuggerEngineConnection::onTransportDisconnected()
+{
+    m_state = UnconnectedState;
+    m_legacyHandshakeTimer->stop();
+    m_heartbeatTimer->stop();
+    m_compact = false;
+    m_agreedCapabilities.fetchAndStoreOrdered(0);
+    m_codec.reset();
+    m_bytesHanded = 0;
+    m_frameEnds.clear();
+    // the transport drops the observers along with the controlling
+    // debugger; make sure none is left behind
+    QList<QScriptDebuggerEngineObserver*> observers = m_observers.values();
+    for (int i = 0; i < observers.size(); ++i)
+        dropObserver(observers.at(i));
+    if (!m_sessionToken.isEmpty() && m_transport->relisten()) {
+        // the targets carry on as if the debugger were still connected,
+        // so that it finds them as it left them if it comes back in time
+#ifdef DEBUGGERENGINE_DEBUG
+        qDebug() << "connection dropped; keeping the session for" << m_sessionGraceTimer->interval() << "ms";
+#endif
+        if (!m_sessionGraceTimer->isActive())
+            m_sessionGraceTimer->start();
+        return;
+    }
+    endSession();
+}
+
+/*!
+  Called when the debugger hasn't come back within the grace period.
+  Unless another debugger is connecting, the transport stops listening,
+  as it does when a session ends right away.
+*/
+void QScriptDebuggerEngineConnection::onSessionGraceTimeout()
+{
+    endSession();
+    if (m_state == UnconnectedState)
+        m_transport->abort();
+}
+
+/*!
+  Sends a heartbeat to the debugger, or closes the connection if nothing
+  has arrived from it for too long; if the session is kept, the debugger
+  can still resume it.
+*/
+void QScriptDebuggerEngineConnection::sendHeartbeat()
+{
+    int interval = m_heartbeatTimer->interval();
+    if ((m_state != ConnectedState) || (interval == 0)) {
+        m_heartbeatTimer->stop();
+        return;
+    }
+    if (m_lastReceived.elapsed() >= QScriptDebuggerProtocol::MaxMissedHeartbeats * interval) {
+        qWarning("QScriptDebuggerEngine: no word from the debugger for %d ms; closing the connection",
+                 m_lastReceived.elapsed());
+        m_transport->abort();
+        return;
+    }
+    m_codec.beginFrame(QScriptDebuggerProtocol::HeartbeatFrame, 0) << qint32(interval);
+    endFrame();
+}
+
+void QScriptDebuggerEngineConnection::onTransportError(QScriptDebuggerTransport::TransportError err)
+{
+    qDebug("%s", qPrintable(m_transport->errorString()));
+    if (err == QScriptDebuggerTransport::HostNotFoundError)
+        emit error(QScriptDebuggerEngine::HostNotFoundError);
+    else if (err == QScriptDebuggerTransport::ConnectionRefusedError)
+        emit error(QScriptDebuggerEngine::ConnectionRefusedError);
+    else
+        emit error(QScriptDebuggerEngine::SocketError);
+}
+
+void QScriptDebuggerEngineConnection::onReadyRead()
+{
+    switch (m_state) {
+    case UnconnectedState:
+        // may happen when a backend asks us to resume reading after
+        // the connection was closed
+        break;
+
+    case HandshakingState: {
+        QByteArray handshakeData = QScriptDebuggerProtocol::handshakeData();
+        qint64 available = device()->bytesAvailable();
+        if (available < QScriptDebuggerProtocol::LegacyHandshakeSize)
+            break;
+        if (device()->peek(handshakeData.size()) != handshakeData) {
+            m_state = UnconnectedState;
+            emit error(QScriptDebuggerEngine::HandshakeError);
+            m_transport->disconnectFromPeer();
+            break;
+        }
+        if (available < QScriptDebuggerProtocol::HandshakeSize) {
+            // either the rest is on its way, or this is a version 1
+            // debugger that is waiting for our reply
+            if (!m_legacyHandshakeTimer->isActive())
+                m_legacyHandshakeTimer->start();
+            break;
+        }
+        m_legacyHandshakeTimer->stop();
+        device()->read(handshakeData.size());
+        uchar field[sizeof(quint16) + sizeof(quint32)];
+        device()->read(reinterpret_cast<char*>(field), sizeof(field));
+        quint16 version = qFromBigEndian<quint16>(field);
+        quint32 capabilities = qFromBigEndian<quint32>(field + sizeof(quint16)) & m_capabilities;
+#ifdef DEBUGGERENGINE_DEBUG
+        qDebug() << "debugger speaks protocol version" << version;
+#endif
+        // we answer with our own version; a newer debugger is expected
+        // to fall back to it
+        Q_UNUSED(version);
+        qToBigEndian<quint16>(QScriptDebuggerProtocol::ProtocolVersion, field);
+        qToBigEndian<quint32>(capabilities, field + sizeof(quint16));
+        QByteArray reply = handshakeData;
+        reply.append(reinterpret_cast<const char*>(field), sizeof(field));
+        completeHandshake(reply, capabilities);
+    }   break;
+
+    case ResumingState:
+    case ConnectedState: {
+#ifdef DEBUGGERENGINE_DEBUG
+        qDebug() << "received data. bytesAvailable:" << device()->bytesAvailable();
+#endif
+        // handle every complete frame in one pass, and send the responses
+        // (in direct mode) in one write when done
+        ++m_coalesceWrites;
+        while (device() && ((m_state == ConnectedState) || (m_state == ResumingState)) && readFrame())
+            ;
+        --m_coalesceWrites;
+        flushWrites();
+    }   break;
+
+    }
+}
+
+/*!
+  Called when a debugger has sent nothing but the handshake data for a
+  while; it speaks version 1 of the protocol, whose frames have neither
+  a channel nor a type byte. It is turned away rather than answered, as
+  it couldn't read what is sent.
+*/
+void QScriptDebuggerEngineConnection::onLegacyHandshakeTimeout()
+{
+    if ((m_state != HandshakingState)
+        || !device() || (device()->bytesAvailable() != QScriptDebuggerProtocol::LegacyHandshakeSize)) {
+        return;
+    }
+    qWarning("QScriptDebuggerEngine: the debugger speaks protocol version %d; version %d is needed",
+             int(QScriptDebuggerProtocol::LegacyProtocolVersion),
+             int(QScriptDebuggerProtocol::ProtocolVersion));
+    m_state = UnconnectedState;
+    emit error(QScriptDebuggerEngine::HandshakeError);
+    m_transport->disconnectFromPeer();
+}
+
+/*!
+  Picks up reading where a full inbound queue made it stop, for the
+  controlling debugger and the observers alike.
+*/
+void QScriptDebuggerEngineConnection::resumeReading()
+{
+    onReadyRead();
+    QList<QScriptDebuggerEngineObserver*> observers = m_observers.values();
+    for (int i = 0; i < observers.size(); ++i)
+        readObserver(observers.at(i));
+}
+
+void QScriptDebuggerEngineConnection::onObserverConnected(QIODevice *device)
+{
+    QScriptDebuggerEngineObserver *observer = new QScriptDebuggerEngineObserver(m_nextObserverId++, device);
+    observer->codec.setMetrics(&m_metrics);
+    m_observers.insert(observer->id, observer);
+    QObject::connect(device, SIGNAL(readyRead()), this, SLOT(onObserverReadyRead()));
+    QObject::connect(device, SIGNAL(bytesWritten(qint64)), this, SLOT(continueHeapSnapshots()));
+#ifdef DEBUGGERENGINE_DEBUG
+    qDebug("observer %u connected", observer->id);
+#endif
+    readObserver(observer);
+}
+
+void QScriptDebuggerEngineConnection::onObserverDisconnected(QIODevice *device)
+{
+    QScriptDebuggerEngineObserver *observer = findObserver(device);
+    if (observer)
+        dropObserver(observer);
+}
+
+void QScriptDebuggerEngineConnection::onObserverReadyRead()
+{
+    QScriptDebuggerEngineObserver *observer = findObserver(qobject_cast<QIODevice*>(sender()));
+    if (observer)
+        readObserver(observer);
+}
+
+QScriptDebuggerEngineObserver *QScriptDebuggerEngineConnection::findObserver(QIODevice *device) const
+{
+    QMap<quint32, QScriptDebuggerEngineObserver*>::const_iterator it;
+    for (it = m_observers.constBegin(); it != m_observers.constEnd(); ++it) {
+        if (it.value()->device == device)
+            return it.value();
+    }
+    return 0;
+}
+
+/*!
+  Answers the handshake of \a observer, once the controlling debugger's
+  is complete, and handles every complete frame it has sent.
+*/
+void QScriptDebuggerEngineConnection::readObserver(QScriptDebuggerEngineObserver *observer)
+{
+    if (!observer->device || (m_state != ConnectedState))
+        return;
+    if (!observer->connected && !answerObserverHandshake(observer))
+        return;
+    ++m_readingObservers;
+    ++m_coalesceWrites;
+    while (observer->device && (m_state == ConnectedState) && readFrame(observer))
+        ;
+    --m_coalesceWrites;
+    --m_readingObservers;
+    flushWrites();
+    if ((m_readingObservers == 0) && !m_retiredObservers.isEmpty())
+        QMetaObject::invokeMethod(this, "releaseRetiredObservers", Qt::QueuedConnection);
+}
+
+/*!
+  Answers the handshake of \a observer with the capabilities agreed on
+  with the controlling debugger. Returns false if the handshake hasn't
+  been received in full yet, or if the observer has been dropped because
+  it can't use those capabilities.
+*/
+bool QScriptDebuggerEngineConnection::answerObserverHandshake(QScriptDebuggerEngineObserver *observer)
+{
+    QIODevice *dev = observer->device;
+    if (dev->bytesAvailable() < QScriptDebuggerProtocol::HandshakeSize)
+        return false;
+    QByteArray handshakeData = QScriptDebuggerProtocol::handshakeData();
+    QByteArray request = dev->read(QScriptDebuggerProtocol::HandshakeSize);
+    const uchar *field = reinterpret_cast<const uchar*>(request.constData()) + handshakeData.size();
+    quint16 version = qFromBigEndian<quint16>(field);
+    quint32 capabilities = qFromBigEndian<quint32>(field + sizeof(quint16));
+    // sessions and heartbeats are the controlling debugger's
+    quint32 agreed = agreedCapabilities() & ~(QScriptDebuggerProtocol::SessionResumeCapability
+                                              | QScriptDebuggerProtocol::HeartbeatCapability);
+    if (!request.startsWith(handshakeData)
+        || (version < QScriptDebuggerProtocol::ProtocolVersion)
+        || ((capabilities & agreed) != agreed)) {
+        qWarning("QScriptDebuggerEngine: observer %u can't use the capabilities of the "
+                 "controlling debugger; dropping it", observer->id);
+        dropObserver(observer);
+        return false;
+    }
+    uchar reply[sizeof(quint16) + sizeof(quint32)];
+    qToBigEndian<quint16>(QScriptDebuggerProtocol::ProtocolVersion, reply);
+    qToBigEndian<quint32>(agreed, reply + sizeof(quint16));
+    dev->write(handshakeData);
+    dev->write(reinterpret_cast<const char*>(reply), sizeof(reply));
+    observer->codec.setCompressionEnabled(agreed & QScriptDebuggerProtocol::CompressionCapability);
+    observer->connected = true;
+    // tell it about the channels, as the controlling debugger was told
+    QMap<quint32, QString> names = channelNames();
+    QMap<quint32, QString>::const_iterator it;
+    for (it = names.constBegin(); it != names.constEnd(); ++it) {
+        QDataStream &out = observer->codec.beginFrame(QScriptDebuggerProtocol::ChannelOpenedFrame,
+                                                      it.key());
+        out << it.value();
+        observer->codec.endFrame();
+    }
+    observer->codec.writeTo(dev);
+    return true;
+}
+
+/*!
+  Writes \a size bytes of \a data to \a observer, and drops it if it has
+  fallen too far behind; a slow observer must stall neither the targets
+  nor the controlling debugger.
+*/
+void QScriptDebuggerEngineConnection::writeToObserver(QScriptDebuggerEngineObserver *observer,
+                                                      const char *data, int size)
+{
+    if (!observer->device || !observer->connected || (size == 0))
+        return;
+    observer->device->write(data, size);
+    if (observer->device->bytesToWrite() > MaxObserverBacklog) {
+        qWarning("QScriptDebuggerEngine: observer %u is %lld bytes behind; dropping it",
+                 observer->id, observer->device->bytesToWrite());
+        dropObserver(observer);
+    }
+}
+
+void QScriptDebuggerEngineConnection::dropObserver(QScriptDebuggerEngineObserver *observer)
+{
+    QIODevice *dev = observer->device;
+    if (!dev)
+        return;
+#ifdef DEBUGGERENGINE_DEBUG
+    qDebug("observer %u dropped", observer->id);
+#endif
+    observer->device = 0;
+    m_observers.remove(observer->id);
+    m_retiredObservers.append(observer);
+    QMetaObject::invokeMethod(this, "releaseRetiredObservers", Qt::QueuedConnection);
+    dev->disconnect(this);
+    if (m_transport)
+        m_transport->abortObserver(dev);
+}
+
+void QScriptDebuggerEngineConnection::releaseRetiredObservers()
+{
+    // readObserver() queues another call when it's done
+    if (m_readingObservers > 0)
+        return;
+    // what they created in the targets is of no use to anyone else
+    for (int i = 0; i < m_retiredObservers.size(); ++i)
+        invokeOnBackends("releasePeer", Q_ARG(uint, m_retiredObservers.at(i)->id));
+    qDeleteAll(m_retiredObservers);
+    m_retiredObservers.clear();
+}
+
+/*!
+  Sends the handshake \a reply and switches to the agreed \a capabilities.
+*/
+void QScriptDebuggerEngineConnection::completeHandshake(const QByteArray &reply, quint32 capabilities)
+{
+#ifdef DEBUGGERENGINE_DEBUG
+    qDebug() << "sending handshake reply (" << reply.size() << "bytes ), capabilities" << capabilities;
+#endif
+    device()->write(reply);
+    m_codec.setCompressionEnabled(capabilities & QScriptDebuggerProtocol::CompressionCapability);
+    m_compact = (capabilities & QScriptDebuggerProtocol::CompactEncodingCapability) != 0;
+    m_agreedCapabilities.fetchAndStoreOrdered(int(capabilities));
+    if (m_traceWriter.isOpen())
+        m_traceWriter.writeHandshake(capabilities);
+    if (capabilities & QScriptDebuggerProtocol::SessionResumeCapability) {
+        // the debugger says which session it wants first
+        m_state = ResumingState;
+        if (device()->bytesAvailable() > 0)
+            QMetaObject::invokeMethod(this, "onReadyRead", Qt::QueuedConnection);
+        return;
+    }
+    endSession();
+    beginSession();
+}
+
+/*!
+  Tells the debugger which engines (channels) it can talk to, and the
+  backends that a debugger is connected.
+*/
+void QScriptDebuggerEngineConnection::beginSession()
+{
+    m_state = ConnectedState;
+    m_connected.fetchAndStoreOrdered(1);
+    startHeartbeat();
+    QMap<quint32, QString> names = channelNames();
+    QMap<quint32, QString>::const_iterator it;
+    for (it = names.constBegin(); it != names.constEnd(); ++it)
+        writeChannelOpened(it.key(), it.value());
+    invokeOnBackends("onConnected");
+    emit connected();
+    // observers that connected in the meantime have been waiting for this
+    QList<QScriptDebuggerEngineObserver*> observers = m_observers.values();
+    for (int i = 0; i < observers.size(); ++i)
+        readObserver(observers.at(i));
+    // the debugger may not have waited for our reply
+    if (device()->bytesAvailable() > 0)
+        QMetaObject::invokeMethod(this, "onReadyRead", Qt::QueuedConnection);
+}
+
+static QByteArray createSessionToken(const void *salt)
+{
+    // only tells sessions apart; it isn't meant to be a secret
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QDateTime::currentDateTime().toString(Qt::ISODate).toLatin1());
+    hash.addData(QByteArray::number(QTime::currentTime().msec()));
+    hash.addData(QByteArray::number(quintptr(salt)));
+    hash.addData(QByteArray::number(qrand()));
+    return hash.result().left(16);
+}
+
+/*!
+  Answers the debugger's ResumeRequestFrame. The session with the given
+  \a token is resumed if it is still kept, was set up with the same
+  capabilities, and still has the frames after the \a received ones that
+  the debugger got; those are sent again. Otherwise the kept session, if
+  any, ends and a new one begins.
+*/
+void QScriptDebuggerEngineConnection::resumeSession(const QByteArray &token, quint32 received)
+{
+    bool resumed = !token.isEmpty() && (token == m_sessionToken)
+                   && (agreedCapabilities() == m_sessionCapabilities)
+                   && m_sessionLog.canReplay(received);
+    if (!resumed) {
+        endSession();
+        m_sessionToken = createSessionToken(this);
+        m_sessionCapabilities = agreedCapabilities();
+    }
+    m_sessionGraceTimer->stop();
+    m_state = ConnectedState;
+#ifdef DEBUGGERENGINE_DEBUG
+    qDebug() << (resumed ? "resuming session after frame" : "new session") << received;
+#endif
+    m_codec.beginFrame(QScriptDebuggerProtocol::SessionFrame, 0)
+        << m_sessionToken << m_sessionLog.receivedCount() << resumed
+        << qint32(m_sessionGraceTimer->interval());
+    endFrame();
+    if (!resumed) {
+        beginSession();
+        return;
+    }
+    // the SessionFrame must go out before the frames sent again
+    flushWrites();
+    m_sessionLog.replay(received, device());
+    startHeartbeat();
+    QList<QScriptDebuggerEngineObserver*> observers = m_observers.values();
+    for (int i = 0; i < observers.size(); ++i)
+        readObserver(observers.at(i));
+    if (device()->bytesAvailable() > 0)
+        QMetaObject::invokeMethod(this, "onReadyRead", Qt::QueuedConnection);
+}
+
+void QScriptDebuggerEngineConnection::startHeartbeat()
+{
+    m_lastReceived.start();
+    if (agreedCapabilities() & QScriptDebuggerProtocol::HeartbeatCapability)
+        m_heartbeatTimer->start();
+}
+
+/*!
+  Ends the current session, if any: the backends are told that the
+  debugger has gone, and the frames kept for it are dropped.
+*/
+void QScriptDebuggerEngineConnection::endSession()
+{
+    forgetSession();
+    m_heldFrameTimer->stop();
+    m_heldProfile.clear();
+    m_heldCoverage.clear();
+    m_heldScripts.clear();
+    m_heldOutputDrops.clear();
+    if (!m_connected.testAndSetOrdered(1, 0))
+        return;
+    invokeOnBackends("onDisconnected");
+    emit disconnected();
+}
+
+/*!
+  Drops the session token and the frames kept for the debugger, so that
+  the session ends when the connection closes rather than being kept
+  for the grace period.
+*/
+void QScriptDebuggerEngineConnection::forgetSession()
+{
+    m_sessionGraceTimer->stop();
+    m_sessionToken.clear();
+    m_sessionCapabilities = 0;
+    m_sessionLog.reset();
+}
+
+/*!
+  Returns true if frames for the controlling debugger are to be encoded:
+  while it is connected, and while a session is kept for it.
+*/
+bool QScriptDebuggerEngineConnection::isWritable() const
+{
+    return (m_state == ConnectedState) || !m_sessionToken.isEmpty();
+}
+
+/*!
+  Returns true if an observer may send \a command, i.e. if it changes
+  neither the state of the target nor that of the controlling debugger's
+  session (the checkpoints).
+*/
+static bool isObserverCommand(const QScriptDebuggerCommand &command)
+{
+    switch (command.type()) {
+    case QScriptDebuggerCommand::GetBreakpoints:
+    case QScriptDebuggerCommand::GetBreakpointData:
+    case QScriptDebuggerCommand::GetScripts:
+    case QScriptDebuggerCommand::GetScriptData:
+    case QScriptDebuggerCommand::ResolveScript:
+    case QScriptDebuggerCommand::GetBacktrace:
+    case QScriptDebuggerCommand::GetContextCount:
+    case QScriptDebuggerCommand::GetContextInfo:
+    case QScriptDebuggerCommand::GetContextState:
+    case QScriptDebuggerCommand::GetContextID:
+    case QScriptDebuggerCommand::GetThisObject:
+    case QScriptDebuggerCommand::GetActivationObject:
+    case QScriptDebuggerCommand::GetScopeChain:
+    case QScriptDebuggerCommand::GetPropertyExpressionValue:
+    case QScriptDebuggerCommand::GetCompletions:
+    case QScriptDebuggerCommand::NewScriptObjectSnapshot:
+    case QScriptDebuggerCommand::ScriptObjectSnapshotCapture:
+    case QScriptDebuggerCommand::DeleteScriptObjectSnapshot:
+    case QScriptDebuggerCommand::NewScriptValueIterator:
+    case QScriptDebuggerCommand::GetPropertiesByIterator:
+    case QScriptDebuggerCommand::DeleteScriptValueIterator:
+    case QScriptDebuggerCommand::ScriptValueToString:
+        return true;
+    default:
+        break;
+    }
+    return false;
+}
+
+/*!
+  Reads and dispatches one frame sent by \a observer, or by the
+  controlling debugger if \a observer is 0. Returns false if no complete
+  frame is available, or if the frame is for a backend that can't take
+  it yet.
+*/
+bool QScriptDebuggerEngineConnection::readFrame(QScriptDebuggerEngineObserver *observer)
+{
+    QScriptDebuggerFrameCodec &codec = observer ? observer->codec : m_codec;
+    QIODevice *dev = observer ? observer->device : device();
+    quint32 peer = observer ? observer->id : quint32(ControllerPeer);
+    quint8 type;
+    quint32 channel;
+    QScriptDebuggerFrameCodec::Status status = codec.peekFrame(&type, &channel);
+    while (status == QScriptDebuggerFrameCodec::NeedMoreData) {
+        if (codec.readFrom(dev) == 0)
+            return false;
+        status = codec.peekFrame(&type, &channel);
+    }
+    if (status == QScriptDebuggerFrameCodec::FrameError) {
+        protocolError(observer);
+        return false;
+    }
+
+    if (((type == QScriptDebuggerProtocol::CommandFrame)
+         || (type == QScriptDebuggerProtocol::CommandBatchFrame)) && m_threaded) {
+        QMutexLocker locker(&m_backendsMutex);
+        QScriptRemoteTargetDebuggerBackend *target = m_backends.value(channel);
+        if (target && target->isInboundFull()) {
+            // leave the frame in the buffer; the backend calls resumeReading()
+            // once it has caught up
+            return false;
+        }
+    }
+
+    if (!observer) {
+        m_lastReceived.start();
+        m_activity.ref();
+        if ((m_state == ResumingState) != (type == QScriptDebuggerProtocol::ResumeRequestFrame)) {
+            qWarning("QScriptDebuggerEngine: frame type %d while %s a session; closing the connection",
+                     type, (m_state == ResumingState) ? "waiting for" : "in");
+            emit error(QScriptDebuggerEngine::ProtocolError);
+            forgetSession();
+            m_transport->abort();
+            return false;
+        }
+        if (!QScriptDebuggerProtocol::isControlFrame(type))
+            m_sessionLog.recordReceived();
+    }
+
+    if (!observer && (type == QScriptDebuggerProtocol::ResumeRequestFrame)) {
+        QByteArray token;
+        quint32 received;
+        m_codec.beginRead() >> token >> received;
+        if (!m_codec.endRead()) {
+            protocolError();
+            return false;
+        }
+        resumeSession(token, received);
+        return true;
+    } else if (!observer && (type == QScriptDebuggerProtocol::AckFrame)) {
+        quint32 received;
+        m_codec.beginRead() >> received;
+        if (!m_codec.endRead()) {
+            protocolError();
+            return false;
+        }
+        m_sessionLog.acknowledge(received);
+        return true;
+    } else if (!observer && (type == QScriptDebuggerProtocol::HeartbeatFrame)) {
+        // the debugger's answer to ours; that it arrived is all that counts
+        m_codec.skipFrame();
+        return true;
+    } else if (!observer && (type == QScriptDebuggerProtocol::DetachFrame)) {
+        m_codec.skipFrame();
+        // the debugger is leaving for good
+        forgetSession();
+        return true;
+    } else if (type == QScriptDebuggerProtocol::CommandFrame) {
+#ifdef DEBUGGERENGINE_DEBUG
+        qDebug() << "deserializing command";
+#endif
+        qint64 started = QScriptDebuggerMetrics::now();
+        QDataStream &in = codec.beginRead();
+        qint32 id;
+        in >> id;
+        QScriptDebuggerCommand command(QScriptDebuggerCommand::None);
+        decodeCommand(in, command);
+        m_metrics.addTime(QString::fromLatin1("decode_seconds"),
+                          QString::fromLatin1("message=\"command\",type=\"%0\"").arg(int(command.type())),
+                          QScriptDebuggerMetrics::now() - started);
+        if (!codec.endRead()) {
+            protocolError(observer);
+            return false;
+        }
+
+        if (observer && !isObserverCommand(command)) {
+            if (backend(channel))
+                writeResponse(channel, id, observerCommandError(), peer);
+        } else if (!dispatchCommand(channel, id, command, peer)) {
+            // the engine went away; the frontend has been (or will be)
+            // told through a ChannelClosedFrame
+            qWarning("QScriptDebuggerEngine: command for unknown channel %u", channel);
+        }
+    } else if (type == QScriptDebuggerProtocol::CommandBatchFrame) {
+        QDataStream &in = codec.beginRead();
+        quint32 count;
+        in >> count;
+#ifdef DEBUGGERENGINE_DEBUG
+        qDebug() << "deserializing batch of" << count << "commands";
+#endif
+        QList<qint32> ids;
+        QList<QScriptDebuggerCommand> commands;
+        bool allowed = true;
+        for (quint32 i = 0; (i < count) && (in.status() == QDataStream::Ok); ++i) {
+            qint64 started = QScriptDebuggerMetrics::now();
+            qint32 id;
+            in >> id;
+            QScriptDebuggerCommand command(QScriptDebuggerCommand::None);
+            decodeCommand(in, command);
+            m_metrics.addTime(QString::fromLatin1("decode_seconds"),
+                              QString::fromLatin1("message=\"command\",type=\"%0\"").arg(int(command.type())),
+                              QScriptDebuggerMetrics::now() - started);
+            ids.append(id);
+            commands.append(command);
+            if (observer && !isObserverCommand(command))
+                allowed = false;
+        }
+        if (!codec.endRead()) {
+            protocolError(observer);
+            return false;
+        }
+
+        if (!allowed) {
+            if (backend(channel)) {
+                QList<QScriptDebuggerResponse> errors;
+                for (int i = 0; i < ids.size(); ++i)
+                    errors.append(observerCommandError());
+                writeResponses(channel, ids, errors, peer);
+            }
+        } else if (!dispatchCommands(channel, ids, commands, peer)) {
+            qWarning("QScriptDebuggerEngine: commands for unknown channel %u", channel);
+        }
+    } else if (type == QScriptDebuggerProtocol::ProfilerControlFrame) {
+        qint32 interval;
+        quint32 session;
+        codec.beginRead() >> interval >> session;
+        if (!codec.endRead()) {
+            protocolError(observer);
+            return false;
+        }
+        if (observer) {
+            // only the controlling debugger decides what is streamed
+            qWarning("QScriptDebuggerEngine: profiler control from observer %u ignored", peer);
+        } else if (!invokeOnBackend(channel, "setProfilingInterval", Q_ARG(int, interval),
+                                    Q_ARG(uint, session))) {
+            qWarning("QScriptDebuggerEngine: profiler control for unknown channel %u", channel);
+        }
+    } else if (type == QScriptDebuggerProtocol::CoverageControlFrame) {
+        qint32 interval;
+        quint32 session;
+        codec.beginRead() >> interval >> session;
+        if (!codec.endRead()) {
+            protocolError(observer);
+            return false;
+        }
+        if (observer) {
+            qWarning("QScriptDebuggerEngine: coverage control from observer %u ignored", peer);
+        } else if (!invokeOnBackend(channel, "setCoverageInterval", Q_ARG(int, interval),
+                                    Q_ARG(uint, session))) {
+            qWarning("QScriptDebuggerEngine: coverage control for unknown channel %u", channel);
+        }
+    } else if (type == QScriptDebuggerProtocol::HeapSnapshotRequestFrame) {
+        quint32 snapshot;
+        codec.beginRead() >> snapshot;
+        if (!codec.endRead()) {
+            protocolError(observer);
+            return false;
+        }
+        // the objects can only be walked from the engine's thread
+        if (!invokeOnBackend(channel, "takeHeapSnapshot", Q_ARG(uint, snapshot), Q_ARG(uint, peer)))
+            qWarning("QScriptDebuggerEngine: heap snapshot request for unknown channel %u", channel);
+    } else {
+        qWarning("QScriptDebuggerEngine: unexpected frame type %d", type);
+        codec.skipFrame();
+    }
+
+    if (!observer && !m_sessionToken.isEmpty() && m_sessionLog.needsAcknowledgement())
+        writeAck();
+#ifdef DEBUGGERENGINE_DEBUG
+    qDebug() << "bytes buffered is now" << codec.bytesBuffered();
+#endif
+    return true;
+}
+
+/*!
+  Drops the connection after receiving data that isn't a valid frame;
+  there's no telling where the next frame would start. Only \a observer
+  is dropped if the data came from one.
+*/
+void QScriptDebuggerEngineConnection::protocolError(QScriptDebuggerEngineObserver *observer)
+{
+    if (observer) {
+        qWarning("QScriptDebuggerEngine: %s; dropping observer %u",
+                 qPrintable(observer->codec.errorString()), observer->id);
+        dropObserver(observer);
+        return;
+    }
+    qWarning("QScriptDebuggerEngine: %s; closing the connection",
+             qPrintable(m_codec.errorString()));
+    emit error(QScriptDebuggerEngine::ProtocolError);
+    forgetSession();
+    m_transport->abort();
+}
+
+/*!
+  Passes the command \a id from \a peer to the backend on \a channel:
+  queues it if the backend lives in another thread, otherwise executes
+  it. Returns false if there's no such backend.
+
+  The lock is only held to queue the command, which keeps a backend on
+  a worker thread from being deleted meanwhile. A command that is
+  executed right away may write frames, and writing may close the
+  connection.
+*/
+bool QScriptDebuggerEngineConnection::dispatchCommand(quint32 channel, qint32 id,
+                                                      const QScriptDebuggerCommand &command, quint32 peer)
+{
+    if (m_threaded) {
+        QMutexLocker locker(&m_backendsMutex);
+        QScriptRemoteTargetDebuggerBackend *target = m_backends.value(channel);
+        if (!target)
+            return false;
+        target->enqueueCommand(id, command, peer);
+        return true;
+    }
+    // without a network thread, the backends live in this one
+    QScriptRemoteTargetDebuggerBackend *target = backend(channel);
+    if (!target)
+        return false;
+    target->executeCommand(id, command, peer);
+    return true;
+}
+
+/*!
+  Passes a batch of \a commands like dispatchCommand() does a single one.
+*/
+bool QScriptDebuggerEngineConnection::dispatchCommands(quint32 channel, const QList<qint32> &ids,
+                                                       const QList<QScriptDebuggerCommand> &commands,
+                                                       quint32 peer)
+{
+    if (m_threaded) {
+        QMutexLocker locker(&m_backendsMutex);
+        QScriptRemoteTargetDebuggerBackend *target = m_backends.value(channel);
+        if (!target)
+            return false;
+        target->enqueueCommands(ids, commands, peer);
+        return true;
+    }
+    QScriptRemoteTargetDebuggerBackend *target = backend(channel);
+    if (!target)
+        return false;
+    target->executeCommands(ids, commands, peer);
+    return true;
+}
+
+/*!
+  Calls the given \a member of the backend on \a channel with the
+  arguments \a val0 and \a val1 in the backend's thread, like
+  invokeOnBackends() does for all of them. Returns false if there's no
+  such backend.
+*/
+bool QScriptDebuggerEngineConnection::invokeOnBackend(quint32 channel, const char *member,
+                                                      QGenericArgument val0, QGenericArgument val1)
+{
+    QScriptRemoteTargetDebuggerBackend *local = 0;
+    {
+        QMutexLocker locker(&m_backendsMutex);
+        QScriptRemoteTargetDebuggerBackend *target = m_backends.value(channel);
+        if (!target)
+            return false;
+        if (target->thread() == QThread::currentThread()) {
+            local = target;
+        } else {
+            QMetaObject::invokeMethod(target, member, Qt::QueuedConnection, val0, val1);
+            target->wake();
+        }
+    }
+    if (local)
+        QMetaObject::invokeMethod(local, member, Qt::DirectConnection, val0, val1);
+    return true;
+}
+
+void QScriptDebuggerEngineConnection::decodeCommand(QDataStream &in, QScriptDebuggerCommand &command)
+{
+    if (m_compact)
+        QScriptDebuggerCompactEncoding::readCommand(in, command);
+    else
+        in >> command;
+}
+
+void QScriptDebuggerEngineConnection::encodeResponse(QDataStream &out, const QScriptDebuggerResponse &response)
+{
+    if (m_compact)
+        QScriptDebuggerCompactEncoding::writeResponse(out, response);
+    else
+        out << response;
+}
+
+/*!
+  Returns the codec to encode a frame for the debugger \a peer with, or
+  0 if that debugger has gone away.
+*/
+QScriptDebuggerFrameCodec *QScriptDebuggerEngineConnection::codecFor(quint32 peer)
+{
+    if (peer == ControllerPeer)
+        return &m_codec;
+    QScriptDebuggerEngineObserver *observer = m_observers.value(peer);
+    return observer ? &observer->codec : 0;
+}
+
+/*!
+  Finishes the frame started with codecFor(\a peer)->beginFrame(). A
+  frame for the controlling debugger is written unless writes are being
+  coalesced; one for an observer is written right away.
+*/
+void QScriptDebuggerEngineConnection::endFrame(quint32 peer)
+{
+    if (peer != ControllerPeer) {
+        QScriptDebuggerEngineObserver *observer = m_observers.value(peer);
+        if (!observer->codec.endFrame())
+            qWarning("QScriptDebuggerEngine: %s; frame dropped", qPrintable(observer->codec.errorString()));
+        writeToObserver(observer, observer->codec.pendingData(), observer->codec.pendingSize());
+        observer->codec.discardPending();
+        return;
+    }
+    if (!m_codec.endFrame())
+        qWarning("QScriptDebuggerEngine: %s; frame dropped", qPrintable(m_codec.errorString()));
+    else
+        frameQueued();
+    if (m_coalesceWrites == 0)
+        flushWrites();
+}
+
+/*!
+  Finishes a frame for every debugger, that was started with
+  m_codec.beginFrame() when \a start bytes were pending. The frame is
+  encoded once, and copied as it is to the observers, which use the same
+  capabilities as the controlling debugger.
+*/
+void QScriptDebuggerEngineConnection::endBroadcastFrame(int start)
+{
+    if (!m_codec.endFrame()) {
+        qWarning("QScriptDebuggerEngine: %s; frame dropped", qPrintable(m_codec.errorString()));
+    } else {
+        frameQueued();
+        const char *frame = m_codec.pendingData() + start;
+        int size = m_codec.pendingSize() - start;
+        QList<QScriptDebuggerEngineObserver*> observers = m_observers.values();
+        for (int i = 0; i < observers.size(); ++i)
+            writeToObserver(observers.at(i), frame, size);
+    }
+    if (m_coalesceWrites == 0)
+        flushWrites();
+}
+
+void QScriptDebuggerEngineConnection::flushWrites()
+{
+    if (!m_sessionToken.isEmpty() && (m_codec.pendingSize() > 0))
+        m_sessionLog.recordSent(m_codec.pendingData(), m_codec.pendingSize());
+    if (device() && (m_state == ConnectedState)) {
+        m_bytesHanded += m_codec.pendingSize();
+        m_codec.writeTo(device());
+        updateQueueGauges(device()->bytesToWrite());
+    } else {
+        m_codec.discardPending();
+        while (!m_frameEnds.isEmpty() && (m_frameEnds.last() > m_bytesHanded))
+            m_frameEnds.removeLast();
+    }
+}
+
+/*!
+  Notes that a frame for the controlling debugger has been encoded.
+*/
+void QScriptDebuggerEngineConnection::frameQueued()
+{
+    m_frameEnds.enqueue(m_bytesHanded + m_codec.pendingSize());
+}
+
+/*!
+  Returns true if more than the set number of bytes or frames is waiting
+  to be sent to the controlling debugger, either in the codec or in the
+  device's write buffer; the debugger isn't reading as fast as we write.
+
+  Frames that the debugger needs to stay in step with the target (events,
+  responses, heap snapshot chunks and those that manage the session) are
+  written regardless. Output, script announcements and telemetry are held
+  back instead; see holdBack().
+*/
+bool QScriptDebuggerEngineConnection::isBackedUp()
+{
+    qint64 queued = m_codec.pendingSize();
+    if (device() && (m_state == ConnectedState)) {
+        qint64 unwritten = device()->bytesToWrite();
+        queued += unwritten;
+        while (!m_frameEnds.isEmpty() && (m_frameEnds.head() <= m_bytesHanded - unwritten))
+            m_frameEnds.dequeue();
+    }
+    updateQueueGauges(queued);
+    return (queued > m_maxOutboundBytes) || (m_frameEnds.size() > m_maxOutboundFrames);
+}
+
+void QScriptDebuggerEngineConnection::countCoalescedFrame()
+{
+    ++m_coalescedFrameCount;
+    m_metrics.increment(QString::fromLatin1("frames_coalesced_total"));
+}
+
+/*!
+  Records that \a bytes, in the frames that m_frameEnds still holds,
+  are waiting to be sent to the controlling debugger.
+*/
+void QScriptDebuggerEngineConnection::updateQueueGauges(qint64 bytes)
+{
+    m_metrics.setGauge(QString::fromLatin1("outbound_queue_bytes"), QString(), bytes);
+    m_metrics.setGauge(QString::fromLatin1("outbound_queue_frames"), QString(), m_frameEnds.size());
+}
+
+/*!
+  Called when a frame has been held back; what is held is offered again
+  once the debugger has caught up.
+*/
+void QScriptDebuggerEngineConnection::holdBack()
+{
+    if (!m_heldFrameTimer->isActive()) {
+        if (m_heldProfile.isEmpty() && m_heldCoverage.isEmpty()
+            && m_heldScripts.isEmpty() && m_heldOutputDrops.isEmpty()) {
+            qWarning("QScriptDebuggerEngine: the debugger isn't keeping up; holding back output and telemetry");
+        }
+        m_heldFrameTimer->start();
+    }
+}
+
+/*!
+  Sends what has been held back, unless the debugger is still behind.
+*/
+void QScriptDebuggerEngineConnection::releaseHeldFrames()
+{
+    if (!isWritable())
+        return;
+    if (isBackedUp()) {
+        m_heldFrameTimer->start();
+        return;
+    }
+    ++m_coalesceWrites;
+    // the write functions hold back again whatever doesn't fit; start
+    // from a clean slate so that it isn't sent twice
+    QMap<quint32, QList<QScriptDebuggerScriptHash> > scripts = m_heldScripts;
+    QMap<quint32, QScriptDebuggerProfileChunk> profile = m_heldProfile;
+    QMap<quint32, QScriptDebuggerCoverageChunk> coverage = m_heldCoverage;
+    QList<quint32> outputChannels = m_heldOutputDrops.keys();
+    m_heldScripts.clear();
+    m_heldProfile.clear();
+    m_heldCoverage.clear();
+    QMap<quint32, QList<QScriptDebuggerScriptHash> >::const_iterator sit;
+    for (sit = scripts.constBegin(); sit != scripts.constEnd(); ++sit)
+        writeScriptHashes(sit.key(), sit.value());
+    QMap<quint32, QScriptDebuggerProfileChunk>::const_iterator pit;
+    for (pit = profile.constBegin(); pit != profile.constEnd(); ++pit)
+        writeProfile(pit.key(), pit.value());
+    QMap<quint32, QScriptDebuggerCoverageChunk>::const_iterator cit;
+    for (cit = coverage.constBegin(); cit != coverage.constEnd(); ++cit)
+        writeCoverage(cit.key(), cit.value());
+    for (int i = 0; i < outputChannels.size(); ++i)
+        writeOutput(outputChannels.at(i), QList<QScriptDebuggerOutputEntry>());
+    --m_coalesceWrites;
+    flushWrites();
+}
+
+void QScriptDebuggerEngineConnection::writeEvent(quint32 channel, const QScriptDebuggerEvent &event)
+{
+#ifdef DEBUGGERENGINE_DEBUG
+    qDebug() << "serializing event of type" << event.type();
+#endif
+    // the debugger may need to know about the scripts that the event
+    // refers to
+    if (m_heldScripts.contains(channel)) {
+        QList<QScriptDebuggerScriptHash> scripts = m_heldScripts.take(channel);
+        int start = m_codec.pendingSize();
+        m_codec.beginFrame(QScriptDebuggerProtocol::ScriptHashesFrame, channel) << scripts;
+        endBroadcastFrame(start);
+    }
+    qint64 started = QScriptDebuggerMetrics::now();
+    int start = m_codec.pendingSize();
+    QDataStream &out = m_codec.beginFrame(QScriptDebuggerProtocol::EventFrame, channel);
+    if (m_compact)
+        QScriptDebuggerCompactEncoding::writeEvent(out, event);
+    else
+        out << event;
+    m_metrics.addTime(QString::fromLatin1("encode_seconds"),
+                      QString::fromLatin1("message=\"event\",type=\"%0\"").arg(int(event.type())),
+                      QScriptDebuggerMetrics::now() - started);
+    endBroadcastFrame(start);
+    // in direct mode the engine is about to block in event(), so
+    // whatever has been collected must go out now
+    if (!m_threaded)
+        flushWrites();
+}
+
+void QScriptDebuggerEngineConnection::writeResponse(quint32 channel, qint32 id,
+                                                    const QScriptDebuggerResponse &response,
+                                                    quint32 peer)
+{
+#ifdef DEBUGGERENGINE_DEBUG
+    qDebug() << "serializing response";
+#endif
+    QScriptDebuggerFrameCodec *codec = codecFor(peer);
+    if (!codec)
+        return; // the observer has gone away
+    qint64 started = QScriptDebuggerMetrics::now();
+    QDataStream &out = codec->beginFrame(QScriptDebuggerProtocol::ResponseFrame, channel);
+    out << id;
+    encodeResponse(out, response);
+    m_metrics.addTime(QString::fromLatin1("encode_seconds"), QString::fromLatin1("message=\"response\""),
+                      QScriptDebuggerMetrics::now() - started);
+    endFrame(peer);
+}
+
+void QScriptDebuggerEngineConnection::writeResponses(quint32 channel, const QList<qint32> &ids,
+                                                     const QList<QScriptDebuggerResponse> &responses,
+                                                     quint32 peer)
+{
+    Q_ASSERT(ids.size() == responses.size());
+#ifdef DEBUGGERENGINE_DEBUG
+    qDebug() << "serializing" << responses.size() << "responses";
+#endif
+    QScriptDebuggerFrameCodec *codec = codecFor(peer);
+    if (!codec)
+        return;
+    QDataStream &out = codec->beginFrame(QScriptDebuggerProtocol::ResponseBatchFrame, channel);
+    out << (quint32)responses.size();
+    for (int i = 0; i < responses.size(); ++i) {
+        qint64 started = QScriptDebuggerMetrics::now();
+        out << ids.at(i);
+        encodeResponse(out, responses.at(i));
+        m_metrics.addTime(QString::fromLatin1("encode_seconds"), QString::fromLatin1("message=\"response\""),
+                          QScriptDebuggerMetrics::now() - started);
+    }
+    endFrame(peer);
+}
+
+void QScriptDebuggerEngineConnection::writeOutput(quint32 channel,
+                                                  const QList<QScriptDebuggerOutputEntry> &output)
+{
+#ifdef DEBUGGERENGINE_DEBUG
+    qDebug() << "serializing" << output.size() << "output entries";
+#endif
+    if (isBackedUp()) {
+        if (output.isEmpty())
+            return;
+        m_heldOutputDrops[channel] += output.size();
+        m_droppedOutputCount += output.size();
+        m_metrics.increment(QString::fromLatin1("output_dropped_total"), QString(), output.size());
+        holdBack();
+        return;
+    }
+    int dropped = m_heldOutputDrops.take(channel);
+    if (dropped == 0) {
+        if (output.isEmpty())
+            return;
+        int start = m_codec.pendingSize();
+        m_codec.beginFrame(QScriptDebuggerProtocol::OutputFrame, channel) << output;
+        endBroadcastFrame(start);
+        return;
+    }
+    // let the user know that something is missing
+    QScriptDebuggerOutputEntry note;
+    note.type = QtWarningMsg;
+    note.message = QString::fromLatin1("%0 messages dropped while the debugger wasn't keeping up")
+                   .arg(dropped);
+    int start = m_codec.pendingSize();
+    m_codec.beginFrame(QScriptDebuggerProtocol::OutputFrame, channel)
+        << (QList<QScriptDebuggerOutputEntry>() << note << output);
+    endBroadcastFrame(start);
+}
+
+void QScriptDebuggerEngineConnection::writeScriptHashes(quint32 channel,
+                                                        const QList<QScriptDebuggerScriptHash> &scripts)
+{
+#ifdef DEBUGGERENGINE_DEBUG
+    qDebug() << "announcing" << scripts.size() << "scripts";
+#endif
+    if (isBackedUp()) {
+        if (m_heldScripts.contains(channel))
+            countCoalescedFrame();
+        m_heldScripts[channel] += scripts;
+        holdBack();
+        return;
+    }
+    QList<QScriptDebuggerScriptHash> held = m_heldScripts.take(channel);
+    if (!held.isEmpty())
+        countCoalescedFrame();
+    int start = m_codec.pendingSize();
+    QDataStream &out = m_codec.beginFrame(QScriptDebuggerProtocol::ScriptHashesFrame, channel);
+    out << (held + scripts);
+    endBroadcastFrame(start);
+}
+
+void QScriptDebuggerEngineConnection::writeProfile(quint32 channel,
+                                                   const QScriptDebuggerProfileChunk &chunk)
+{
+#ifdef DEBUGGERENGINE_DEBUG
+    qDebug() << "serializing profile chunk with" << chunk.hits.size() << "hit nodes";
+#endif
+    if (isBackedUp()) {
+        if (m_heldProfile.contains(channel))
+            countCoalescedFrame();
+        m_heldProfile[channel].append(chunk);
+        holdBack();
+        return;
+    }
+    QScriptDebuggerProfileChunk merged = chunk;
+    if (m_heldProfile.contains(channel)) {
+        merged = m_heldProfile.take(channel);
+        merged.append(chunk);
+        countCoalescedFrame();
+    }
+    int start = m_codec.pendingSize();
+    QDataStream &out = m_codec.beginFrame(QScriptDebuggerProtocol::ProfileFrame, channel);
+    out << merged;
+    endBroadcastFrame(start);
+}
+
+void QScriptDebuggerEngineConnection::writeCoverage(quint32 channel,
+                                                    const QScriptDebuggerCoverageChunk &chunk)
+{
+#ifdef DEBUGGERENGINE_DEBUG
+    qDebug() << "serializing coverage chunk with" << chunk.scripts.size() << "scripts";
+#endif
+    if (isBackedUp()) {
+        if (m_heldCoverage.contains(channel))
+            countCoalescedFrame();
+        m_heldCoverage[channel].append(chunk);
+        holdBack();
+        return;
+    }
+    QScriptDebuggerCoverageChunk merged = chunk;
+    if (m_heldCoverage.contains(channel)) {
+        merged = m_heldCoverage.take(channel);
+        merged.append(chunk);
+        countCoalescedFrame();
+    }
+    int start = m_codec.pendingSize();
+    QDataStream &out = m_codec.beginFrame(QScriptDebuggerProtocol::CoverageFrame, channel);
+    out << merged;
+    endBroadcastFrame(start);
+}
+
+void QScriptDebuggerEngineConnection::writeHeapSnapshot(quint32 channel,
+                                                        const QScriptDebuggerHeapSnapshotChunk &chunk,
+                                                        quint32 peer)
+{
+#ifdef DEBUGGERENGINE_DEBUG
+    qDebug() << "serializing heap snapshot chunk with" << chunk.nodes.size() << "nodes";
+#endif
+    QScriptDebuggerFrameCodec *codec = codecFor(peer);
+    if (codec && ((peer != ControllerPeer) || isWritable())) {
+        QDataStream &out = codec->beginFrame(QScriptDebuggerProtocol::HeapSnapshotFrame, channel);
+        out << chunk;
+        endFrame(peer);
+    }
+    if (!chunk.last) {
+        // the backend waits to be asked for the next chunk; not from
+        // here, as this may be called with the backends lock held
+        m_heapSnapshotStreams.append(qMakePair(channel, peer));
+        QMetaObject::invokeMethod(this, "continueHeapSnapshots", Qt::QueuedConnection);
+    }
+}
+
+/*!
+  Asks the backends for the next chunk of the heap snapshots being sent
+  to debuggers that have read most of the previous ones; the others are
+  looked at again once their device has written something, or after
+  HeldFrameInterval. A snapshot whose debugger is gone is ended with a
+  truncated chunk.
+*/
+void QScriptDebuggerEngineConnection::continueHeapSnapshots()
+{
+    if (m_heapSnapshotStreams.isEmpty())
+        return;
+    QMutexLocker locker(&m_backendsMutex);
+    for (int i = 0; i < m_heapSnapshotStreams.size(); ) {
+        quint32 channel = m_heapSnapshotStreams.at(i).first;
+        quint32 peer = m_heapSnapshotStreams.at(i).second;
+        bool gone;
+        bool backedUp;
+        if (peer == ControllerPeer) {
+            gone = !isWritable();
+            backedUp = !gone && isBackedUp();
+        } else {
+            QScriptDebuggerEngineObserver *observer = m_observers.value(peer);
+            gone = !observer || !observer->device;
+            backedUp = !gone && (observer->device->bytesToWrite() > HeapSnapshotBacklog);
+        }
+        if (backedUp) {
+            ++i;
+            continue;
+        }
+        m_heapSnapshotStreams.removeAt(i);
+        // posted while the lock keeps the backend alive, and never called
+        // directly, so that a snapshot doesn't recurse chunk by chunk
+        QScriptRemoteTargetDebuggerBackend *target = m_backends.value(channel);
+        if (target) {
+            QMetaObject::invokeMethod(target, "continueHeapSnapshot", Qt::QueuedConnection,
+                                      Q_ARG(bool, !gone));
+            target->wake();
+        }
+    }
+    if (!m_heapSnapshotStreams.isEmpty())
+        m_heapSnapshotTimer->start();
+}
+
+void QScriptDebuggerEngineConnection::writeChannelOpened(quint32 channel, const QString &name)
+{
+    int start = m_codec.pendingSize();
+    QDataStream &out = m_codec.beginFrame(QScriptDebuggerProtocol::ChannelOpenedFrame, channel);
+    out << name;
+    endBroadcastFrame(start);
+}
+
+void QScriptDebuggerEngineConnection::writeChannelClosed(quint32 channel)
+{
+    int start = m_codec.pendingSize();
+    m_codec.beginFrame(QScriptDebuggerProtocol::ChannelClosedFrame, channel);
+    endBroadcastFrame(start);
+}
+
+/*!
+  Tells the debugger how many of its frames have been received, so that
+  it can forget them.
+*/
+void QScriptDebuggerEngineConnection::writeAck()
+{
+    m_codec.beginFrame(QScriptDebuggerProtocol::AckFrame, 0) << m_sessionLog.receivedCount();
+    m_sessionLog.setAcknowledged();
+    endFrame();
+}
+
+/*!
+  Constructs a new QScriptDebuggerEngine object with the given \a
+  parent.
+*/
+QScriptDebuggerEngine::QScriptDebuggerEngine(QObject *parent)
+    : QObject(parent), m_connection(0), m_nextChannel(1), m_networkThread(0),
+      m_compression(true), m_coverage(false), m_lazyAttach(false), m_maxObservers(0),
+      m_sessionResumeGracePeriod(0), m_heartbeatInterval(0), m_suspensionTimeout(0),
+      m_suspensionTimeoutAction(ResumeTarget), m_maxOutboundBytes(DefaultMaxOutboundBytes),
+      m_maxOutboundFrames(DefaultMaxOutboundFrames),
+      m_outputBatchInterval(DefaultOutputBatchInterval),
+      m_maxOutputBatchSize(DefaultMaxOutputBatchSize)
+{
+    // the connection has no parent so that it can be moved to the
+    // network thread
+    m_connection = new QScriptDebuggerEngineConnection();
+    QObject::connect(m_connection, SIGNAL(connected()),
+                     this, SIGNAL(connected()));
+    QObject::connect(m_connection, SIGNAL(disconnected()),
+                     this, SIGNAL(disconnected()));
+    QObject::connect(m_connection, SIGNAL(error(QScriptDebuggerEngine::Error)),
+                     this, SIGNAL(error(QScriptDebuggerEngine::Error)));
+}
+
+/*!
+  Destroys this QScriptDebuggerEngine.
+*/
+QScriptDebuggerEngine::~QScriptDebuggerEngine()
+{
+    QList<QScriptRemoteTargetDebuggerBackend*> backends = m_connection->backends();
+    for (int i = 0; i < backends.size(); ++i) {
+        m_connection->removeBackend(backends.at(i));
+        backends.at(i)->detach();
+        delete backends.at(i);
+    }
+    if (m_networkThread) {
+        QMetaObject::invokeMethod(m_connection, "close", Qt::BlockingQueuedConnection);
+        m_networkThread->quit();
+        m_networkThread->wait();
+        delete m_networkThread;
+    }
+    delete m_connection;
+}
+
+/*!
+  Sets whether socket I/O should happen in a dedicated network thread
+  to \a enabled. This must be called before connectToDebugger() or
+  listen(); once enabled, the network thread can't be disabled again.
+
+  By default, reading, decoding, encoding and writing of debugger
+  traffic happen in the thread of the target engine. When a network
+  thread is used, only the execution of debugger commands happens in
+  the engine's thread; traffic is handed between the two threads through
+  lock-free queues, so a busy engine thread doesn't stall the connection
+  and a slow debugger doesn't stall the engine thread on socket I/O.
+
+  \sa isNetworkThreadEnabled()
+*/
+void QScriptDebuggerEngine::setNetworkThreadEnabled(bool enabled)
+{
+    if (enabled == (m_networkThread != 0))
+        return;
+    if (!enabled) {
+        qWarning("QScriptDebuggerEngine::setNetworkThreadEnabled(): the network thread can't be disabled");
+        return;
+    }
+    if (m_connection->isActive()) {
+        qWarning("QScriptDebuggerEngine::setNetworkThreadEnabled(): already connected or listening");
+        return;
+    }
+    qRegisterMetaType<QScriptDebuggerEngine::Error>("QScriptDebuggerEngine::Error");
+    m_networkThread = new QThread();
+    m_connection->setThreaded(true);
+    m_connection->moveToThread(m_networkThread);
+    m_networkThread->start();
+}
+
+/*!
+  Returns true if socket I/O happens in a dedicated network thread;
+  otherwise returns false.
+
+  \sa setNetworkThreadEnabled()
+*/
+bool QScriptDebuggerEngine::isNetworkThreadEnabled() const
+{
+    return (m_networkThread != 0);
+}
+
+/*!
+  Sets whether the targets are only debugged while a debugger is
+  connected to \a enabled. Lazy attach is disabled by default.
+
+  Debugging a target means putting an agent on its engine, which is
+  notified of every statement that is executed. When lazy attach is
+  enabled, the agent is only put on the engine once a debugger has
+  connected, and taken off again when it disconnects, so that a target
+  that is merely listen()ing for a debugger runs without it. The debugger then
+  only learns about the scripts evaluated while it is connected, so
+  breakpoints can't be set in functions of scripts that were evaluated
+  before.
+
+  \sa isLazyAttachEnabled(), listen()
+*/
+void QScriptDebuggerEngine::setLazyAttachEnabled(bool enabled)
+{
+    m_lazyAttach = enabled;
+    m_connection->invokeOnBackends("setLazyAttachEnabled", Q_ARG(bool, enabled));
+}
+
+/*!
+  Returns true if the targets are only debugged while a debugger is
+  connected; otherwise returns false.
+
+  \sa setLazyAttachEnabled()
+*/
+bool QScriptDebuggerEngine::isLazyAttachEnabled() const
+{
+    return m_lazyAttach;
+}
+
+/*!
+  Sets the number of debuggers that may observe the targets, besides the
+  one that controls them, to \a count. This must be called before
+  listen(); the default is 0.
+
+  While listening, the first debugger to connect controls the targets.
+  Up to \a count more can connect while it is connected. They see the
+  same events and output, and can inspect a suspended target, but can't
+  resume it, change breakpoints or evaluate code. Every event is encoded
+  once and sent to all debuggers; an observer that falls more than a few
+  megabytes behind is disconnected, so that it stalls neither the
+  targets nor the controlling debugger. The observers are disconnected
+  when the controlling debugger disconnects.
+
+  Only the TCP and local socket transports accept observers.
+
+  \sa maxObservers(), listen()
+*/
+void QScriptDebuggerEngine::setMaxObservers(int count)
+{
+    m_maxObservers = qMax(0, count);
+    QMetaObject::invokeMethod(m_connection, "setMaxObservers", Qt::AutoConnection,
+                              Q_ARG(int, m_maxObservers));
+}
+
+/*!
+  Returns the number of debuggers that may observe the targets besides
+  the controlling one.
+
+  \sa setMaxObservers()
+*/
+int QScriptDebuggerEngine::maxObservers() const
+{
+    return m_maxObservers;
+}
+
+/*!
+  Sets how long a debugger session is kept after the connection to the
+  debugger has dropped to \a msecs. This must be called before listen();
+  the default is 0, which ends a session as soon as its connection does.
+
+  While a session is kept, the engine listens again at the same address,
+  and the targets carry on as if the debugger were still connected: they
+  stop at breakpoints, and their events are kept for the debugger. A
+  debugger that reconnects within \a msecs with the session's token
+  resumes it; it keeps its breakpoints and scripts, and only the frames
+  that got lost on either side are sent again. The disconnected() signal
+  is only emitted once the session ends. A debugger that detaches ends
+  its session right away.
+
+  Only the TCP and local socket transports can listen again, so a
+  session over another transport, or one made with connectToDebugger(),
+  ends with its connection.
+
+  \sa sessionResumeGracePeriod(), listen()
+*/
+void QScriptDebuggerEngine::setSessionResumeGracePeriod(int msecs)
+{
+    m_sessionResumeGracePeriod = qMax(0, msecs);
+    QMetaObject::invokeMethod(m_connection, "setSessionResumeGracePeriod", Qt::AutoConnection,
+                              Q_ARG(int, m_sessionResumeGracePeriod));
+}
+
+/*!
+  Returns how long a session is kept after its connection has dropped,
+  in milliseconds.
+
+  \sa setSessionResumeGracePeriod()
+*/
+int QScriptDebuggerEngine::sessionResumeGracePeriod() const
+{
+    return m_sessionResumeGracePeriod;
+}
+
+/*!
+  Sets the interval at which heartbeats are exchanged with the debugger
+  to \a msecs. This must be called before connectToDebugger() or
+  listen(); the default is 0, which sends none.
+
+  The engine sends a heartbeat every \a msecs, and the debugger answers
+  each one. Either side closes the connection once nothing has arrived
+  from the other for three intervals, so that a debugger that hangs or a
+  network that partitions is noticed even while the target is
+  suspended. If a session is kept (see setSessionResumeGracePeriod()),
+  the debugger can still resume it.
+
+  \sa heartbeatInterval(), setSuspensionTimeout()
+*/
+void QScriptDebuggerEngine::setHeartbeatInterval(int msecs)
+{
+    m_heartbeatInterval = qMax(0, msecs);
+    QMetaObject::invokeMethod(m_connection, "setHeartbeatInterval", Qt::AutoConnection,
+                              Q_ARG(int, m_heartbeatInterval));
+}
+
+/*!
+  Returns the interval at which heartbeats are exchanged with the
+  debugger, in milliseconds.
+
+  \sa setHeartbeatInterval()
+*/
+int QScriptDebuggerEngine::heartbeatInterval() const
+{
+    return m_heartbeatInterval;
+}
+
+/*!
+  Bounds how long a target stays suspended without word from the
+  debugger to \a msecs, after which the given \a action is taken; 0,
+  the default, lets a target wait forever.
+
+  Every frame from the controlling debugger counts as word from it,
+  including the answers to heartbeats; enable those with
+  setHeartbeatInterval(), or a debugger whose user takes longer than
+  \a msecs to decide is treated like one that hangs. The time runs
+  while the connection is down too.
+
+  \table
+  \header \o Action \o What happens
+  \row \o ResumeTarget \o the target continues, as if the debugger
+       had told it to; it can be suspended again
+  \row \o DisableBreakpoints \o the target's breakpoints are disabled,
+       and it continues
+  \row \o DisconnectDebugger \o the debugger is disconnected, ending
+       its session, and the target continues
+  \endtable
+
+  Every forced resume is reported with suspensionTimedOut(), and as a
+  warning in the target's output.
+
+  \sa suspensionTimeout(), suspensionTimeoutAction()
+*/
+void QScriptDebuggerEngine::setSuspensionTimeout(int msecs, SuspensionTimeoutAction action)
+{
+    m_suspensionTimeout = qMax(0, msecs);
+    m_suspensionTimeoutAction = action;
+    m_connection->invokeOnBackends("setSuspensionTimeout", Q_ARG(int, m_suspensionTimeout),
+                                   Q_ARG(int, action));
+}
+
+/*!
+  Returns how long a target may stay suspended without word from the
+  debugger, in milliseconds; 0 means forever.
+
+  \sa setSuspensionTimeout()
+*/
+int QScriptDebuggerEngine::suspensionTimeout() const
+{
+    return m_suspensionTimeout;
+}
+
+/*!
+  Returns what is done when a target has been suspended for too long.
+
+  \sa setSuspensionTimeout()
+*/
+QScriptDebuggerEngine::SuspensionTimeoutAction QScriptDebuggerEngine::suspensionTimeoutAction() const
+{
+    return m_suspensionTimeoutAction;
+}
+
+/*!
+  Sets how output is collected before it is sent to the debugger: once
+  \a maxEntries messages have been collected, or once the oldest is
+  \a msecs old, they are sent in one frame. The defaults are
+  DefaultOutputBatchInterval and DefaultMaxOutputBatchSize; a
+  \a maxEntries of 1 sends every message on its own.
+
+  This covers what the targets print(), as well as the output of
+  logpoints and tracepoints. Printing doesn't suspend a target, and
+  output that is waiting is always sent before the target stops.
+
+  \sa outputBatchInterval(), maxOutputBatchSize()
+*/
+void QScriptDebuggerEngine::setOutputBatching(int msecs, int maxEntries)
+{
+    m_outputBatchInterval = qMax(0, msecs);
+    m_maxOutputBatchSize = qMax(1, maxEntries);
+    m_connection->invokeOnBackends("setOutputBatching", Q_ARG(int, m_outputBatchInterval),
+                                   Q_ARG(int, m_maxOutputBatchSize));
+}
+
+/*!
+  Returns how long output is collected before it is sent, in
+  milliseconds.
+
+  \sa setOutputBatching()
+*/
+int QScriptDebuggerEngine::outputBatchInterval() const
+{
+    return m_outputBatchInterval;
+}
+
+/*!
+  Returns how many output messages are sent in one frame at most.
+
+  \sa setOutputBatching()
+*/
+int QScriptDebuggerEngine::maxOutputBatchSize() const
+{
+    return m_maxOutputBatchSize;
+}
+
+/*!
+  Bounds what may be waiting to be sent to the debugger to \a maxBytes
+  and \a maxFrames; the defaults are DefaultMaxOutboundBytes and
+  DefaultMaxOutboundFrames.
+
+  A debugger that stops reading would otherwise let the socket's write
+  buffer grow without limit. Past the bound, events, responses and heap
+  snapshot chunks are still sent, since the debugger can't follow the
+  target without them. Script announcements, profile and coverage chunks
+  are held back and merged into one frame per target, which is sent when
+  the debugger has caught up; output is dropped, and a note saying how
+  many messages are missing is sent in its place.
+
+  \sa droppedOutputCount(), coalescedFrameCount()
+*/
+void QScriptDebuggerEngine::setOutboundLimits(int maxBytes, int maxFrames)
+{
+    m_maxOutboundBytes = qMax(0, maxBytes);
+    m_maxOutboundFrames = qMax(0, maxFrames);
+    QMetaObject::invokeMethod(m_connection, "setOutboundLimits", Qt::AutoConnection,
+                              Q_ARG(int, m_maxOutboundBytes), Q_ARG(int, m_maxOutboundFrames));
+}
+
+/*!
+  Returns the number of bytes that may be waiting to be sent to the
+  debugger before output and telemetry are held back.
+
+  \sa setOutboundLimits()
+*/
+int QScriptDebuggerEngine::maxOutboundBytes() const
+{
+    return m_maxOutboundBytes;
+}
+
+/*!
+  Returns the number of frames that may be waiting to be sent to the
+  debugger before output and telemetry are held back.
+
+  \sa setOutboundLimits()
+*/
+int QScriptDebuggerEngine::maxOutboundFrames() const
+{
+    return m_maxOutboundFrames;
+}
+
+/*!
+  Returns the number of output messages that have been dropped because
+  the debugger wasn't keeping up.
+
+  \sa setOutboundLimits()
+*/
+int QScriptDebuggerEngine::droppedOutputCount() const
+{
+    int count = 0;
+    QMetaObject::invokeMethod(m_connection, "droppedOutputCount",
+                              m_networkThread ? Qt::BlockingQueuedConnection : Qt::DirectConnection,
+                              Q_RETURN_ARG(int, count));
+    return count;
+}
+
+/*!
+  Returns the number of script announcements, profile and coverage
+  chunks that have been merged into later ones because the debugger
+  wasn't keeping up.
+
+  \sa setOutboundLimits()
+*/
+int QScriptDebuggerEngine::coalescedFrameCount() const
+{
+    int count = 0;
+    QMetaObject::invokeMethod(m_connection, "coalescedFrameCount",
+                              m_networkThread ? Qt::BlockingQueuedConnection : Qt::DirectConnection,
+                              Q_RETURN_ARG(int, count));
+    return count;
+}
+
+/*!
+  Sets the \a target engine that this debugger engine will manage.
+
+  The target is debugged on channel 0; use addTarget() to debug
+  additional engines over the same connection.
+
+  The target may live in another thread than this debugger engine, as
+  described for addTarget(). Once channel 0 has had a target, the next
+  one must live in the same thread.
+*/
+void QScriptDebuggerEngine::setTarget(QScriptEngine *target)
+{
+    QScriptRemoteTargetDebuggerBackend *backend = m_connection->backend(0);
+    if (backend && target && (target->thread() != backend->thread())) {
+        qWarning("QScriptDebuggerEngine::setTarget(): the target lives in another thread than "
+                 "the previous one; use addTarget() instead");
+        return;
+    }
+    if (!backend) {
+        if (!prepareTargetThread(target))
+            return;
+        backend = new QScriptRemoteTargetDebuggerBackend(m_connection, 0, QString());
+        if (target && (target->thread() != thread()))
+            backend->setWorkerThread(target->thread());
+        backend->setLazyAttachEnabled(m_lazyAttach);
+        backend->setSuspensionTimeout(m_suspensionTimeout, m_suspensionTimeoutAction);
+        backend->setOutputBatching(m_outputBatchInterval, m_maxOutputBatchSize);
+        QObject::connect(backend, SIGNAL(suspensionTimedOut(QScriptEngine*,int)),
+                         this, SIGNAL(suspensionTimedOut(QScriptEngine*,int)));
+        m_connection->addBackend(backend);
+    }
+    backend->setTarget(target);
+    backend->setCoverageEnabled(m_coverage);
+}
+
+/*!
+  Returns the script engine that this debugger engine manages a connection to,
+  or 0 if no engine has been set.
+*/
+QScriptEngine *QScriptDebuggerEngine::target() const
+{
+    QScriptRemoteTargetDebuggerBackend *backend = m_connection->backend(0);
+    if (!backend)
+        return 0;
+    return backend->target();
+}
+
+/*!
+  Adds the given \a target engine to the set of engines managed by this
+  debugger engine, and returns the channel that the engine is debugged
+  on. The optional \a name is shown by the debugger to identify the
+  engine.
+
+  All targets share the connection established by connectToDebugger()
+  or listen(); the debugger routes traffic to a per-engine session
+  based on the channel.
+
+  The \a target may live in another thread than this debugger engine,
+  e.g. when scripts are run from a QThreadPool. The sockets then stay
+  in the network thread, which is enabled for that; if this debugger
+  engine is already connected or listening without it, the target is
+  rejected and -1 is returned. Such a target isn't suspended in a
+  nested event loop: its thread sleeps until the debugger sends a
+  command, executes it and sleeps again, until it is resumed. Commands
+  that arrive while it runs are executed before its next statement.
+  The target must not be evaluating while it is added, and must be
+  removed from its own thread, before it or this debugger engine is
+  destroyed.
+
+  \sa removeTarget(), setTarget(), setNetworkThreadEnabled()
+*/
+int QScriptDebuggerEngine::addTarget(QScriptEngine *target, const QString &name)
+{
+    if (!prepareTargetThread(target))
+        return -1;
+    quint32 channel = m_nextChannel++;
+    QScriptRemoteTargetDebuggerBackend *backend;
+    backend = new QScriptRemoteTargetDebuggerBackend(m_connection, channel, name);
+    if (target && (target->thread() != thread()))
+        backend->setWorkerThread(target->thread());
+    backend->setLazyAttachEnabled(m_lazyAttach);
+    backend->setSuspensionTimeout(m_suspensionTimeout, m_suspensionTimeoutAction);
+    backend->setOutputBatching(m_outputBatchInterval, m_maxOutputBatchSize);
+    QObject::connect(backend, SIGNAL(suspensionTimedOut(QScriptEngine*,int)),
+                     this, SIGNAL(suspensionTimedOut(QScriptEngine*,int)));
+    backend->setTarget(target);
+    backend->setCoverageEnabled(m_coverage);
+    m_connection->addBackend(backend);
+    return channel;
+}
+
+/*!
+  Removes the given \a target engine from this debugger engine. If the
+  engine is currently suspended, it is resumed.
+
+  A target that lives in another thread than this debugger engine must
+  be removed from that thread.
+
+  \sa addTarget()
+*/
+void QScriptDebuggerEngine::removeTarget(QScriptEngine *target)
+{
+    if (target && (target->thread() != QThread::currentThread())) {
+        qWarning("QScriptDebuggerEngine::removeTarget(): the target must be removed from its own thread");
+        return;
+    }
+    // only this thread deletes these
+    QList<QScriptRemoteTargetDebuggerBackend*> backends = m_connection->backends(QThread::currentThread());
+    for (int i = 0; i < backends.size(); ++i) {
+        QScriptRemoteTargetDebuggerBackend *backend = backends.at(i);
+        if (backend->target() != target)
+            continue;
+        m_connection->removeBackend(backend);
+        backend->resume();
+        backend->detach();
+        // the backend may still be on the stack (suspended in event());
+        // a worker thread may never run an event loop to delete it
+        if (backend->isWorkerThread() && !backend->isSuspended())
+            delete backend;
+        else
+            backend->deleteLater();
+    }
+}
+
+/*!
+  \internal
+
+  Makes sure that the sockets can stay in one thread if \a target lives
+  in another one than this debugger engine, by enabling the network
+  thread. Returns false if that is too late.
+*/
+bool QScriptDebuggerEngine::prepareTargetThread(QScriptEngine *target)
+{
+    if (!target || (target->thread() == thread()) || m_networkThread)
+        return true;
+    if (m_connection->isActive()) {
+        qWarning("QScriptDebuggerEngine: a target in another thread needs the network thread, "
+                 "which can't be enabled while connected or listening");
+        return false;
+    }
+    // suspensionTimedOut() is emitted from the target's thread
+    qRegisterMetaType<QScriptEngine*>("QScriptEngine*");
+    setNetworkThreadEnabled(true);
+    return true;
+}
+
+/*!
+  Returns the script engines managed by this debugger engine, ordered
+  by channel.
+*/
+QList<QScriptEngine*> QScriptDebuggerEngine::targets() const
+{
+    return m_connection->targets();
+}
+
+/*!
+  Attempts to make a TCP connection to the given \a address on the given
+  \a port.
+
+  The connected() signal is emitted when the connection has been
+  established.
+
+  \sa disconnectFromDebugger(), listen()
+*/
+void QScriptDebuggerEngine::connectToDebugger(const QHostAddress &address, quint16 port)
+{
+    connectToDebugger(TcpTransport, QString::fromLatin1("%0:%1").arg(address.toString()).arg(port));
+}
+
+/*!
+  Attempts to make a connection to the debugger at the given \a address
+  over the given \a transport. The address is interpreted as follows:
+
+  \table
+  \header \o Transport \o Address
+  \row \o TcpTransport \o "host:port"
+  \row \o LocalSocketTransport \o the name the debugger listens on
+       (see QLocalServer)
+  \row \o PipeTransport \o ignored; the debugger is the parent process
+       and talks to this process over its stdin and stdout, which must
+       not be used for anything else
+  \row \o SharedMemoryTransport \o the key the debugger listens on
+  \endtable
+
+  The local socket, pipe and shared memory transports can only be used
+  when the debugger runs on the same host;
+  benchmarks/transportlatency compares their round trips with TCP.
+
+  \sa listen()
+*/
+void QScriptDebuggerEngine::connectToDebugger(Transport transport, const QString &address)
+{
+    if (m_connection->backends().isEmpty()) {
+        qWarning("QScriptDebuggerEngine::connectToDebugger(): no engine has been set (call setTarget() first)");
+        return;
+    }
+    QMetaObject::invokeMethod(m_connection, "connectToDebugger", Qt::AutoConnection,
+                              Q_ARG(int, transport), Q_ARG(QString, address));
+}
+
+/*!
+  Attempts to close the connection.
+
+  The disconnected() signal is emitted when the connection has been
+  closed.
+
+  \sa connectToDebugger()
+*/
+void QScriptDebuggerEngine::disconnectFromDebugger()
+{
+    QMetaObject::invokeMethod(m_connection, "disconnectFromDebugger", Qt::AutoConnection);
+}
+
+/*!
+  Listens for an incoming TCP connection on the given \a address and \a
+  port.
+
+  Returns true on success; otherwise returns false.
+
+  The connected() signal is emitted when a connection has been
+  established.
+
+  \sa connectToDebugger()
+*/
+bool QScriptDebuggerEngine::listen(const QHostAddress &address, quint16 port)
+{
+    return listen(TcpTransport, QString::fromLatin1("%0:%1").arg(address.toString()).arg(port));
+}
+
+/*!
+  Listens for an incoming connection over the given \a transport, on
+  the given \a address (see connectToDebugger() for its format). With
+  PipeTransport, the connection is established right away over stdin
+  and stdout.
+
+  Returns true on success; otherwise returns false.
+*/
+bool QScriptDebuggerEngine::listen(Transport transport, const QString &address)
+{
+    if (m_connection->backends().isEmpty()) {
+        qWarning("QScriptDebuggerEngine::listen(): no script engine has been set (call setTarget() first)");
+        return false;
+    }
+    bool ok = false;
+    QMetaObject::invokeMethod(m_connection, "listen",
+                              m_networkThread ? Qt::BlockingQueuedConnection : Qt::DirectConnection,
+                              Q_RETURN_ARG(bool, ok),
+                              Q_ARG(int, transport), Q_ARG(QString, address));
+    return ok;
+}
+
+/*!
+  Sets whether frames are compressed to \a enabled, if the debugger
+  supports it; this is negotiated when the connection is established.
+  Compression is enabled by default.
+
+  Only frames whose payload is larger than a threshold (1 KB) are
+  compressed, and only if that makes them smaller.
+
+  \sa compressionRatio(), compressionTime()
+*/
+void QScriptDebuggerEngine::setCompressionEnabled(bool enabled)
+{
+    m_compression = enabled;
+    QMetaObject::invokeMethod(m_connection, "setCompressionEnabled", Qt::AutoConnection,
+                              Q_ARG(bool, enabled));
+}
+
+/*!
+  Returns true if compression will be offered to the debugger;
+  otherwise returns false.
+*/
+bool QScriptDebuggerEngine::isCompressionEnabled() const
+{
+    return m_compression;
+}
+
+/*!
+  Returns the combined size of the compressed frames, as sent or
+  received, divided by their size before compression. Returns 1 if no
+  frame has been compressed.
+*/
+qreal QScriptDebuggerEngine::compressionRatio() const
+{
+    qreal ratio = 1;
+    QMetaObject::invokeMethod(m_connection, "compressionRatio",
+                              m_networkThread ? Qt::BlockingQueuedConnection : Qt::DirectConnection,
+                              Q_RETURN_ARG(qreal, ratio));
+    return ratio;
+}
+
+/*!
+  Returns the time spent compressing and decompressing frames, in
+  milliseconds.
+*/
+int QScriptDebuggerEngine::compressionTime() const
+{
+    int time = 0;
+    QMetaObject::invokeMethod(m_connection, "compressionTime",
+                              m_networkThread ? Qt::BlockingQueuedConnection : Qt::DirectConnection,
+                              Q_RETURN_ARG(int, time));
+    return time;
+}
+
+/*!
+  Starts recording every frame exchanged with the debugger, with its
+  direction and the time, to the trace file \a fileName. The file is
+  replaced. Recording continues across connections until stopRecording()
+  is called. Returns false if the file can't be written.
+
+  A trace can be played back with QScriptRemoteTargetDebugger::replay()
+  or tools/tracereplay.
+
+  \sa stopRecording()
+*/
+bool QScriptDebuggerEngine::startRecording(const QString &fileName)
+{
+    bool ok = false;
+    QMetaObject::invokeMethod(m_connection, "startRecording",
+                              m_networkThread ? Qt::BlockingQueuedConnection : Qt::DirectConnection,
+                              Q_RETURN_ARG(bool, ok), Q_ARG(QString, fileName));
+    return ok;
+}
+
+/*!
+  Stops recording and closes the trace file.
+
+  \sa startRecording()
+*/
+void QScriptDebuggerEngine::stopRecording()
+{
+    QMetaObject::invokeMethod(m_connection, "stopRecording",
+                              m_networkThread ? Qt::BlockingQueuedConnection : Qt::DirectConnection);
+}
+
+/*!
+  Returns what the engine has counted and timed since it was created or
+  resetMetrics() was called, keyed by metric name and labels in the
+  Prometheus notation, e.g. frames_total{direction="sent",type="event"}.
+
+  \table
+  \header \o Metric \o What it counts
+  \row \o frames_total, bytes_total \o frames and bytes, by direction
+       and frame type
+  \row \o encode_seconds, decode_seconds \o the time spent encoding
+       events (by event type) and responses, and decoding commands (by
+       command type)
+  \row \o suspended_seconds \o the time the targets spent suspended,
+       by the type of the event that suspended them
+  \row \o outbound_queue_bytes, outbound_queue_frames \o what is
+       waiting to be sent to the debugger (see setOutboundLimits())
+  \row \o output_dropped_total, frames_coalesced_total \o what was held
+       back because the debugger wasn't keeping up
+  \endtable
+
+  Times are histograms; this function returns their _count, and their
+  _sum in seconds. startMetricsDump() writes the buckets as well.
+
+  \sa startMetricsDump()
+*/
+QVariantMap QScriptDebuggerEngine::metrics() const
+{
+    return m_connection->metrics()->values();
+}
+
+/*!
+  Sets every metric back to 0.
+
+  \sa metrics()
+*/
+void QScriptDebuggerEngine::resetMetrics()
+{
+    m_connection->metrics()->reset();
+}
+
+/*!
+  Starts writing the metrics to \a fileName in the Prometheus text
+  format every \a interval ms, with names prefixed by
+  qscriptdebuggerengine_. The file is replaced as a whole each time, so
+  that it can be read by the node exporter's textfile collector. Returns
+  false if the file can't be written.
+
+  \sa stopMetricsDump(), metrics()
+*/
+bool QScriptDebuggerEngine::startMetricsDump(const QString &fileName, int interval)
+{
+    bool ok = false;
+    QMetaObject::invokeMethod(m_connection, "startMetricsDump",
+                              m_networkThread ? Qt::BlockingQueuedConnection : Qt::DirectConnection,
+                              Q_RETURN_ARG(bool, ok), Q_ARG(QString, fileName), Q_ARG(int, interval));
+    return ok;
+}
+
+/*!
+  Stops writing the metrics, after writing them one last time.
+
+  \sa startMetricsDump()
+*/
+void QScriptDebuggerEngine::stopMetricsDump()
+{
+    QMetaObject::invokeMethod(m_connection, "stopMetricsDump",
+                              m_networkThread ? Qt::BlockingQueuedConnection : Qt::DirectConnection);
+}
+
+/*!
+  Sets whether the line coverage of the targets is recorded to \a
+  enabled, whether or not a debugger is connected. Coverage recording
+  is disabled by default.
+
+  Every executed line bumps a counter, so recording slows the targets
+  down slightly. Enabling it discards what has been recorded before.
+
+  \sa writeCoverage()
+*/
+void QScriptDebuggerEngine::setCoverageEnabled(bool enabled)
+{
+    m_coverage = enabled;
+    m_connection->invokeOnBackends("setCoverageEnabled", Q_ARG(bool, enabled));
+}
+
+/*!
+  Returns true if the line coverage of the targets is recorded;
+  otherwise returns false.
+*/
+bool QScriptDebuggerEngine::isCoverageEnabled() const
+{
+    return m_coverage;
+}
+
+/*!
+  Writes the line coverage recorded for all targets to the file with
+  the given \a fileName. Returns false if the file couldn't be written.
+
+  The file starts with a header (the magic number 0x51534356 and a
+  format version, currently 1), followed by one record per script that
+  was run, and ends with a zero byte. Each record is a 1 byte, then the
+  script's file name, base line number, first line and line count,
+  followed by a hit count per line. All data is written with
+  QDataStream (version Qt_4_5).
+
+  Only the targets that live in the calling thread are written; call
+  this function from the thread of a target on a worker thread to
+  write its coverage.
+
+  \sa setCoverageEnabled()
+*/
+bool QScriptDebuggerEngine::writeCoverage(const QString &fileName) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_4_5);
+    out << (quint32)QScriptDebuggerProtocol::CoverageFileMagic
+        << (quint32)QScriptDebuggerProtocol::CoverageFileVersion;
+    // the records of a target on a worker thread can only be read there
+    QList<QScriptRemoteTargetDebuggerBackend*> backends = m_connection->backends(QThread::currentThread());
+    int skipped = m_connection->backends().size() - backends.size();
+    if (skipped > 0) {
+        qWarning("QScriptDebuggerEngine::writeCoverage(): skipping %d target(s) in other threads",
+                 skipped);
     }
-    return m_backend->listen(address, port);
+    for (int i = 0; i < backends.size(); ++i)
+        backends.at(i)->writeCoverage(out);
+    out << (quint8)0;
+    return (out.status() == QDataStream::Ok);
 }
 
 #include "qscriptdebuggerengine.moc"
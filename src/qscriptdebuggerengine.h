@@ -23,12 +23,16 @@
 #define QSCRIPTDEBUGGERENGINE_H
 
 #include <QtCore/qobject.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qstring.h>
+#include <QtCore/qvariant.h>
 
 #include <QtNetwork/qhostaddress.h>
 //#include <QtNetwork/qabstractsocket.h>
 
 class QScriptEngine;
-class QScriptRemoteTargetDebuggerBackend;
+class QThread;
+class QScriptDebuggerEngineConnection;
 
 class QScriptDebuggerEngine : public QObject
 {
@@ -39,7 +43,28 @@ public:
         HostNotFoundError,
         ConnectionRefusedError,
         HandshakeError,
-        SocketError
+        SocketError,
+        ProtocolError
+    };
+
+    enum Transport {
+        TcpTransport,
+        LocalSocketTransport,
+        PipeTransport,
+        SharedMemoryTransport
+    };
+
+    enum SuspensionTimeoutAction {
+        ResumeTarget,
+        DisableBreakpoints,
+        DisconnectDebugger
+    };
+
+    enum {
+        DefaultMaxOutboundBytes = 4 * 1024 * 1024,
+        DefaultMaxOutboundFrames = 1024,
+        DefaultOutputBatchInterval = 50, // ms
+        DefaultMaxOutputBatchSize = 256
     };
 
     QScriptDebuggerEngine(QObject *parent = 0);
@@ -48,18 +73,87 @@ public:
     void setTarget(QScriptEngine *engine);
     QScriptEngine *target() const;
 
+    int addTarget(QScriptEngine *engine, const QString &name = QString());
+    void removeTarget(QScriptEngine *engine);
+    QList<QScriptEngine*> targets() const;
+
     void connectToDebugger(const QHostAddress &address, quint16 port);
+    void connectToDebugger(Transport transport, const QString &address);
     void disconnectFromDebugger();
 
     bool listen(const QHostAddress &address = QHostAddress::Any, quint16 port = 0);
+    bool listen(Transport transport, const QString &address);
+
+    void setNetworkThreadEnabled(bool enabled);
+    bool isNetworkThreadEnabled() const;
+
+    void setLazyAttachEnabled(bool enabled);
+    bool isLazyAttachEnabled() const;
+
+    void setMaxObservers(int count);
+    int maxObservers() const;
+
+    void setSessionResumeGracePeriod(int msecs);
+    int sessionResumeGracePeriod() const;
+
+    void setHeartbeatInterval(int msecs);
+    int heartbeatInterval() const;
+
+    void setSuspensionTimeout(int msecs, SuspensionTimeoutAction action = ResumeTarget);
+    int suspensionTimeout() const;
+    SuspensionTimeoutAction suspensionTimeoutAction() const;
+
+    void setOutputBatching(int msecs, int maxEntries);
+    int outputBatchInterval() const;
+    int maxOutputBatchSize() const;
+
+    void setOutboundLimits(int maxBytes, int maxFrames);
+    int maxOutboundBytes() const;
+    int maxOutboundFrames() const;
+    int droppedOutputCount() const;
+    int coalescedFrameCount() const;
+
+    void setCompressionEnabled(bool enabled);
+    bool isCompressionEnabled() const;
+    qreal compressionRatio() const;
+    int compressionTime() const;
+
+    bool startRecording(const QString &fileName);
+    void stopRecording();
+
+    QVariantMap metrics() const;
+    void resetMetrics();
+    bool startMetricsDump(const QString &fileName, int interval = 10000);
+    void stopMetricsDump();
+
+    void setCoverageEnabled(bool enabled);
+    bool isCoverageEnabled() const;
+    bool writeCoverage(const QString &fileName) const;
 
 signals:
     void connected();
     void disconnected();
     void error(QScriptDebuggerEngine::Error error);
+    void suspensionTimedOut(QScriptEngine *target, int msecs);
 
 private:
-    QScriptRemoteTargetDebuggerBackend *m_backend;
+    bool prepareTargetThread(QScriptEngine *target);
+
+    QScriptDebuggerEngineConnection *m_connection;
+    int m_nextChannel;
+    QThread *m_networkThread;
+    bool m_compression;
+    bool m_coverage;
+    bool m_lazyAttach;
+    int m_maxObservers;
+    int m_sessionResumeGracePeriod;
+    int m_heartbeatInterval;
+    int m_suspensionTimeout;
+    SuspensionTimeoutAction m_suspensionTimeoutAction;
+    int m_maxOutboundBytes;
+    int m_maxOutboundFrames;
+    int m_outputBatchInterval;
+    int m_maxOutputBatchSize;
 
     Q_DISABLE_COPY(QScriptDebuggerEngine)
 };
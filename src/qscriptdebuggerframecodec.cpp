@@ -0,0 +1,598 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "qscriptdebuggerframecodec_p.h"
+#include "qscriptdebuggerprotocol_p.h"
+#include "qscriptdebuggertrace_p.h"
+#include "qscriptdebuggermetrics_p.h"
+#include <QtCore/qdatetime.h>
+#include <QtCore/qendian.h>
+#include <QtCore/qiodevice.h>
+
+#include <string.h>
+
+enum {
+    InitialRingCapacity = 4096,
+    InitialSendCapacity = 4096,
+    // the send buffer is trimmed back after flushing a frame larger than this
+    SendBufferTrimThreshold = 1024 * 1024
+};
+
+// Hands the payload of the current frame to a QDataStream, straight out
+// of the ring buffer. Reading stops at the end of the frame, so a
+// malformed payload can't make the stream read into the next frame.
+class QScriptDebuggerFrameReader : public QIODevice
+{
+public:
+    QScriptDebuggerFrameReader(QScriptDebuggerFrameCodec *codec)
+        : m_codec(codec)
+    { open(QIODevice::ReadOnly | QIODevice::Unbuffered); }
+
+    bool isSequential() const
+    { return true; }
+    qint64 bytesAvailable() const
+    { return m_codec->m_frameRemaining + QIODevice::bytesAvailable(); }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize)
+    { return m_codec->takeBytes(data, int(qMin<qint64>(maxSize, m_codec->m_frameRemaining))); }
+    qint64 writeData(const char *, qint64)
+    { return -1; }
+
+private:
+    QScriptDebuggerFrameCodec *m_codec;
+};
+
+// Lets a QDataStream append to the codec's send buffer without resetting
+// it, so that the buffer keeps its capacity from one frame to the next.
+class QScriptDebuggerFrameWriter : public QIODevice
+{
+public:
+    QScriptDebuggerFrameWriter(QScriptDebuggerFrameCodec *codec)
+        : m_codec(codec), m_pos(0)
+    { open(QIODevice::WriteOnly | QIODevice::Unbuffered); }
+
+    bool isSequential() const
+    { return true; }
+
+    int position() const
+    { return m_pos; }
+    void setPosition(int pos)
+    { m_pos = pos; }
+
+protected:
+    qint64 readData(char *, qint64)
+    { return -1; }
+    qint64 writeData(const char *data, qint64 size)
+    {
+        QByteArray &buffer = m_codec->m_sendBuffer;
+        int needed = m_pos + int(size);
+        if (buffer.size() < needed)
+            buffer.resize(qMax(needed, buffer.size() * 2));
+        memcpy(buffer.data() + m_pos, data, size);
+        m_pos = needed;
+        return size;
+    }
+
+private:
+    QScriptDebuggerFrameCodec *m_codec;
+    int m_pos;
+};
+
+QScriptDebuggerFrameCodec::QScriptDebuggerFrameCodec(quint32 maxFrameSize)
+    : m_ringHead(0), m_ringSize(0), m_frameSize(0), m_frameType(0), m_frameRemaining(0),
+      m_frameOpen(false), m_frameCompressed(false), m_inflatedPos(0),
+      m_pendingSize(0), m_frameStart(0), m_maxFrameSize(maxFrameSize),
+      m_compression(false), m_compressionThreshold(DefaultCompressionThreshold),
+      m_bytesBeforeCompression(0), m_bytesAfterCompression(0), m_compressionTime(0),
+      m_traceWriter(0), m_metrics(0)
+{
+    m_ring = new char[InitialRingCapacity];
+    m_ringMask = InitialRingCapacity - 1;
+    m_reader = new QScriptDebuggerFrameReader(this);
+    m_in.setDevice(m_reader);
+    m_in.setVersion(QDataStream::Qt_4_5);
+
+    m_sendBuffer.resize(InitialSendCapacity);
+    m_writer = new QScriptDebuggerFrameWriter(this);
+    m_out.setDevice(m_writer);
+    m_out.setVersion(QDataStream::Qt_4_5);
+}
+
+QScriptDebuggerFrameCodec::~QScriptDebuggerFrameCodec()
+{
+    m_in.setDevice(0);
+    m_out.setDevice(0);
+    delete m_reader;
+    delete m_writer;
+    delete[] m_ring;
+}
+
+/*!
+  Returns the largest frame, not counting the size field, that the codec
+  accepts or produces.
+*/
+quint32 QScriptDebuggerFrameCodec::maxFrameSize() const
+{
+    return m_maxFrameSize;
+}
+
+void QScriptDebuggerFrameCodec::setMaxFrameSize(quint32 size)
+{
+    m_maxFrameSize = size;
+}
+
+/*!
+  Returns a description of the last error, i.e. of the last time
+  peekFrame() returned FrameError or endRead() or endFrame() returned
+  false.
+*/
+QString QScriptDebuggerFrameCodec::errorString() const
+{
+    return m_errorString;
+}
+
+/*!
+  Discards all received and pending data, and turns compression off.
+  The buffers keep their capacity, and the statistics are kept.
+*/
+void QScriptDebuggerFrameCodec::reset()
+{
+    m_ringHead = 0;
+    m_ringSize = 0;
+    m_frameSize = 0;
+    m_frameRemaining = 0;
+    m_frameOpen = false;
+    m_frameCompressed = false;
+    m_inflated = QByteArray();
+    m_in.resetStatus();
+    discardPending();
+    m_errorString = QString();
+    m_compression = false;
+}
+
+bool QScriptDebuggerFrameCodec::isCompressionEnabled() const
+{
+    return m_compression;
+}
+
+/*!
+  Sets whether frames with a payload of at least compressionThreshold()
+  bytes are compressed to \a enable. This should only be enabled once the
+  peer has agreed to it; compressed frames are always accepted.
+*/
+void QScriptDebuggerFrameCodec::setCompressionEnabled(bool enable)
+{
+    m_compression = enable;
+}
+
+int QScriptDebuggerFrameCodec::compressionThreshold() const
+{
+    return m_compressionThreshold;
+}
+
+void QScriptDebuggerFrameCodec::setCompressionThreshold(int size)
+{
+    m_compressionThreshold = size;
+}
+
+/*!
+  Returns the total payload size of the frames that were compressed or
+  decompressed, before compression.
+*/
+qint64 QScriptDebuggerFrameCodec::bytesBeforeCompression() const
+{
+    return m_bytesBeforeCompression;
+}
+
+/*!
+  Returns the total payload size of the same frames as
+  bytesBeforeCompression(), as sent over the wire.
+*/
+qint64 QScriptDebuggerFrameCodec::bytesAfterCompression() const
+{
+    return m_bytesAfterCompression;
+}
+
+/*!
+  Returns the time spent compressing and decompressing frames, in
+  milliseconds.
+*/
+int QScriptDebuggerFrameCodec::compressionTime() const
+{
+    return m_compressionTime;
+}
+
+QScriptDebuggerTraceWriter *QScriptDebuggerFrameCodec::traceWriter() const
+{
+    return m_traceWriter;
+}
+
+/*!
+  Sets the \a writer that every frame is recorded with, as it is sent or
+  read; 0 records nothing. The codec doesn't take ownership.
+*/
+void QScriptDebuggerFrameCodec::setTraceWriter(QScriptDebuggerTraceWriter *writer)
+{
+    m_traceWriter = writer;
+}
+
+QScriptDebuggerMetrics *QScriptDebuggerFrameCodec::metrics() const
+{
+    return m_metrics;
+}
+
+/*!
+  Sets the \a metrics that every frame is counted in, as it is sent or
+  read; 0 counts nothing. The codec doesn't take ownership.
+*/
+void QScriptDebuggerFrameCodec::setMetrics(QScriptDebuggerMetrics *metrics)
+{
+    m_metrics = metrics;
+}
+
+/*!
+  Moves as many bytes as are available from \a device into the receive
+  buffer, without growing it. Returns the number of bytes read.
+*/
+qint64 QScriptDebuggerFrameCodec::readFrom(QIODevice *device)
+{
+    qint64 total = 0;
+    for (;;) {
+        int capacity = m_ringMask + 1;
+        if (m_ringSize == capacity)
+            break;
+        qint64 available = device->bytesAvailable();
+        if (available <= 0)
+            break;
+        int tail = (m_ringHead + m_ringSize) & m_ringMask;
+        int chunk = qMin(capacity - m_ringSize, capacity - tail);
+        qint64 n = device->read(m_ring + tail, qMin<qint64>(chunk, available));
+        if (n <= 0)
+            break;
+        m_ringSize += int(n);
+        total += n;
+    }
+    return total;
+}
+
+/*!
+  Appends \a size bytes of \a data to the receive buffer, growing it if
+  needed.
+*/
+void QScriptDebuggerFrameCodec::append(const char *data, int size)
+{
+    reserve(m_ringSize + size);
+    int capacity = m_ringMask + 1;
+    int tail = (m_ringHead + m_ringSize) & m_ringMask;
+    int first = qMin(size, capacity - tail);
+    memcpy(m_ring + tail, data, first);
+    memcpy(m_ring, data + first, size - first);
+    m_ringSize += size;
+}
+
+int QScriptDebuggerFrameCodec::bytesBuffered() const
+{
+    return m_ringSize;
+}
+
+/*!
+  Checks whether a complete frame has been received. If so, stores its
+  type and channel in \a type and \a channel and returns FrameAvailable;
+  the frame stays in the buffer until it is read with beginRead() and
+  endRead(), or skipped.
+
+  Returns FrameError if the length prefix can't belong to a valid frame;
+  the stream can't be recovered then, and the connection should be
+  closed.
+*/
+QScriptDebuggerFrameCodec::Status QScriptDebuggerFrameCodec::peekFrame(quint8 *type, quint32 *channel)
+{
+    Q_ASSERT(!m_frameOpen);
+    if (m_ringSize < int(sizeof(quint32)))
+        return NeedMoreData;
+    uchar sizeField[sizeof(quint32)];
+    copyOut(0, reinterpret_cast<char*>(sizeField), sizeof(quint32));
+    quint32 size = qFromBigEndian<quint32>(sizeField);
+    if ((size < quint32(QScriptDebuggerProtocol::FrameHeaderSize)) || (size > m_maxFrameSize)) {
+        setError(QString::fromLatin1("invalid frame size %0").arg(size));
+        return FrameError;
+    }
+    m_frameSize = size;
+    int total = int(sizeof(quint32) + size);
+    if (total > m_ringMask + 1)
+        reserve(total);
+    if (m_ringSize < total)
+        return NeedMoreData;
+
+    uchar header[QScriptDebuggerProtocol::FrameHeaderSize];
+    copyOut(sizeof(quint32), reinterpret_cast<char*>(header), sizeof(header));
+    *type = header[0] & ~QScriptDebuggerProtocol::CompressedFrameFlag;
+    m_frameType = *type;
+    *channel = qFromBigEndian<quint32>(header + 1);
+    m_frameCompressed = (header[0] & QScriptDebuggerProtocol::CompressedFrameFlag) != 0;
+    return FrameAvailable;
+}
+
+/*!
+  Starts reading the payload of the frame found by peekFrame(). The
+  returned stream stops at the end of the frame.
+*/
+QDataStream &QScriptDebuggerFrameCodec::beginRead()
+{
+    Q_ASSERT(!m_frameOpen);
+    int header = int(sizeof(quint32)) + QScriptDebuggerProtocol::FrameHeaderSize;
+    Q_ASSERT(m_ringSize >= header);
+    if (m_traceWriter)
+        traceReceivedFrame();
+    if (m_metrics)
+        countReceivedFrame();
+    m_ringHead = (m_ringHead + header) & m_ringMask;
+    m_ringSize -= header;
+    m_frameRemaining = int(m_frameSize) - QScriptDebuggerProtocol::FrameHeaderSize;
+    m_frameOpen = true;
+    m_in.resetStatus();
+    if (m_frameCompressed)
+        inflate();
+    return m_in;
+}
+
+/*!
+  Replaces the compressed payload of the current frame by its inflated
+  form, which the reader then takes the payload from.
+*/
+void QScriptDebuggerFrameCodec::inflate()
+{
+    QByteArray packed;
+    packed.resize(m_frameRemaining);
+    takeBytes(packed.data(), packed.size());
+    m_inflatedPos = 0;
+    // qCompress() puts the inflated size in front; don't let a bogus one
+    // make us allocate more than a frame may hold
+    quint32 size = 0;
+    if (packed.size() >= int(sizeof(quint32)))
+        size = qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(packed.constData()));
+    if ((size == 0) || (size > m_maxFrameSize)) {
+        m_in.setStatus(QDataStream::ReadCorruptData);
+        return;
+    }
+    QTime timer;
+    timer.start();
+    m_inflated = qUncompress(packed);
+    m_compressionTime += timer.elapsed();
+    if (m_inflated.isEmpty()) {
+        m_in.setStatus(QDataStream::ReadCorruptData);
+        return;
+    }
+    m_bytesBeforeCompression += m_inflated.size();
+    m_bytesAfterCompression += packed.size();
+    m_frameRemaining = m_inflated.size();
+}
+
+/*!
+  Finishes reading the current frame. Any payload that wasn't read is
+  skipped. Returns false if the payload was shorter than its contents
+  claimed, or was otherwise malformed.
+*/
+bool QScriptDebuggerFrameCodec::endRead()
+{
+    Q_ASSERT(m_frameOpen);
+    bool ok = (m_in.status() == QDataStream::Ok);
+    skipFrame();
+    if (!ok)
+        setError(QString::fromLatin1("malformed payload in frame of %0 bytes").arg(m_frameSize));
+    return ok;
+}
+
+/*!
+  Discards the current frame, or the rest of it if it is being read.
+*/
+void QScriptDebuggerFrameCodec::skipFrame()
+{
+    int size = m_frameRemaining;
+    if (!m_frameOpen) {
+        size = int(sizeof(quint32) + m_frameSize);
+        if (m_traceWriter)
+            traceReceivedFrame();
+        if (m_metrics)
+            countReceivedFrame();
+    } else if (m_frameCompressed) {
+        size = 0; // the payload has already been taken out of the ring
+    }
+    Q_ASSERT(size <= m_ringSize);
+    m_ringHead = (m_ringHead + size) & m_ringMask;
+    m_ringSize -= size;
+    m_frameRemaining = 0;
+    m_frameOpen = false;
+    m_frameCompressed = false;
+    m_inflated = QByteArray();
+}
+
+/*!
+  Starts a new frame of the given \a type on the given \a channel, after
+  any frames that are pending. The payload is written to the returned
+  stream; the frame becomes pending when endFrame() is called.
+*/
+QDataStream &QScriptDebuggerFrameCodec::beginFrame(quint8 type, quint32 channel)
+{
+    m_frameStart = m_pendingSize;
+    m_writer->setPosition(m_frameStart);
+    m_out.resetStatus();
+    m_out << quint32(0); // patched by endFrame()
+    m_out << type;
+    m_out << channel;
+    return m_out;
+}
+
+/*!
+  Finishes the current frame. Returns false, and drops the frame, if it
+  is larger than maxFrameSize().
+*/
+bool QScriptDebuggerFrameCodec::endFrame()
+{
+    int end = m_writer->position();
+    int payloadStart = m_frameStart + int(sizeof(quint32)) + QScriptDebuggerProtocol::FrameHeaderSize;
+    int payloadSize = end - payloadStart;
+    if (m_compression && (payloadSize >= m_compressionThreshold)) {
+        char *payload = m_sendBuffer.data() + payloadStart;
+        QTime timer;
+        timer.start();
+        QByteArray packed = qCompress(reinterpret_cast<const uchar*>(payload), payloadSize);
+        m_compressionTime += timer.elapsed();
+        m_bytesBeforeCompression += payloadSize;
+        if (packed.size() < payloadSize) {
+            memcpy(payload, packed.constData(), packed.size());
+            end = payloadStart + packed.size();
+            m_writer->setPosition(end);
+            m_sendBuffer.data()[m_frameStart + sizeof(quint32)] |= char(QScriptDebuggerProtocol::CompressedFrameFlag);
+            m_bytesAfterCompression += packed.size();
+        } else {
+            m_bytesAfterCompression += payloadSize;
+        }
+    }
+    quint32 size = quint32(end - m_frameStart) - sizeof(quint32);
+    if (size > m_maxFrameSize) {
+        setError(QString::fromLatin1("frame of %0 bytes exceeds the maximum frame size").arg(size));
+        cancelFrame();
+        return false;
+    }
+    qToBigEndian<quint32>(size, reinterpret_cast<uchar*>(m_sendBuffer.data() + m_frameStart));
+    m_pendingSize = end;
+    if (m_traceWriter)
+        m_traceWriter->writeSentFrame(m_sendBuffer.constData() + m_frameStart, end - m_frameStart);
+    if (m_metrics) {
+        quint8 type = quint8(m_sendBuffer.at(m_frameStart + sizeof(quint32)))
+                      & ~QScriptDebuggerProtocol::CompressedFrameFlag;
+        m_metrics->addFrame(QScriptDebuggerMetrics::Sent, type, end - m_frameStart);
+    }
+    return true;
+}
+
+void QScriptDebuggerFrameCodec::cancelFrame()
+{
+    m_writer->setPosition(m_pendingSize);
+}
+
+/*!
+  Returns the number of bytes of finished frames that haven't been
+  written yet.
+*/
+int QScriptDebuggerFrameCodec::pendingSize() const
+{
+    return m_pendingSize;
+}
+
+const char *QScriptDebuggerFrameCodec::pendingData() const
+{
+    return m_sendBuffer.constData();
+}
+
+/*!
+  Writes all pending frames to \a device in one write, and returns the
+  number of bytes written.
+*/
+qint64 QScriptDebuggerFrameCodec::writeTo(QIODevice *device)
+{
+    if (m_pendingSize == 0)
+        return 0;
+    qint64 written = device->write(m_sendBuffer.constData(), m_pendingSize);
+    discardPending();
+    return written;
+}
+
+void QScriptDebuggerFrameCodec::discardPending()
+{
+    m_pendingSize = 0;
+    m_writer->setPosition(0);
+    // don't hold on to the memory of an exceptionally large frame
+    if (m_sendBuffer.size() > SendBufferTrimThreshold) {
+        m_sendBuffer.resize(InitialSendCapacity);
+        m_sendBuffer.squeeze();
+    }
+}
+
+int QScriptDebuggerFrameCodec::takeBytes(char *data, int maxSize)
+{
+    if (!m_inflated.isEmpty()) {
+        int size = qMin(maxSize, m_inflated.size() - m_inflatedPos);
+        memcpy(data, m_inflated.constData() + m_inflatedPos, size);
+        m_inflatedPos += size;
+        m_frameRemaining -= size;
+        return size;
+    }
+    int size = qMin(maxSize, m_ringSize);
+    copyOut(0, data, size);
+    m_ringHead = (m_ringHead + size) & m_ringMask;
+    m_ringSize -= size;
+    m_frameRemaining -= size;
+    return size;
+}
+
+void QScriptDebuggerFrameCodec::copyOut(int offset, char *data, int size) const
+{
+    int capacity = m_ringMask + 1;
+    int start = (m_ringHead + offset) & m_ringMask;
+    int first = qMin(size, capacity - start);
+    memcpy(data, m_ring + start, first);
+    memcpy(data + first, m_ring, size - first);
+}
+
+/*!
+  Makes room for at least \a size bytes in the receive buffer.
+*/
+void QScriptDebuggerFrameCodec::reserve(int size)
+{
+    int capacity = m_ringMask + 1;
+    if (size <= capacity)
+        return;
+    while (capacity < size)
+        capacity <<= 1;
+    char *ring = new char[capacity];
+    copyOut(0, ring, m_ringSize);
+    delete[] m_ring;
+    m_ring = ring;
+    m_ringMask = capacity - 1;
+    m_ringHead = 0;
+}
+
+void QScriptDebuggerFrameCodec::setError(const QString &message)
+{
+    m_errorString = message;
+}
+
+/*!
+  Records the frame found by peekFrame(), which is still in the ring
+  buffer as a whole.
+*/
+void QScriptDebuggerFrameCodec::traceReceivedFrame()
+{
+    int size = int(sizeof(quint32) + m_frameSize);
+    if (m_traceBuffer.size() < size)
+        m_traceBuffer.resize(size);
+    copyOut(0, m_traceBuffer.data(), size);
+    m_traceWriter->writeReceivedFrame(m_traceBuffer.constData(), size);
+}
+
+void QScriptDebuggerFrameCodec::countReceivedFrame()
+{
+    m_metrics->addFrame(QScriptDebuggerMetrics::Received, m_frameType,
+                        int(sizeof(quint32) + m_frameSize));
+}
@@ -0,0 +1,164 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef QSCRIPTDEBUGGERFRAMECODEC_P_H
+#define QSCRIPTDEBUGGERFRAMECODEC_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/qbytearray.h>
+#include <QtCore/qdatastream.h>
+#include <QtCore/qstring.h>
+
+class QIODevice;
+class QScriptDebuggerFrameReader;
+class QScriptDebuggerFrameWriter;
+class QScriptDebuggerMetrics;
+class QScriptDebuggerTraceWriter;
+
+// Encodes and decodes the frames described in qscriptdebuggerprotocol_p.h.
+//
+// Received bytes are kept in a ring buffer that only grows when a single
+// frame doesn't fit; frames are encoded back to back into a send buffer
+// that keeps its capacity between flushes, so that neither buffer is
+// allocated per frame.
+class QScriptDebuggerFrameCodec
+{
+public:
+    enum Status {
+        NeedMoreData,
+        FrameAvailable,
+        FrameError
+    };
+
+    enum {
+        DefaultMaxFrameSize = 64 * 1024 * 1024,
+        DefaultCompressionThreshold = 1024
+    };
+
+    QScriptDebuggerFrameCodec(quint32 maxFrameSize = DefaultMaxFrameSize);
+    ~QScriptDebuggerFrameCodec();
+
+    quint32 maxFrameSize() const;
+    void setMaxFrameSize(quint32 size);
+
+    QString errorString() const;
+    void reset();
+
+    bool isCompressionEnabled() const;
+    void setCompressionEnabled(bool enable);
+    int compressionThreshold() const;
+    void setCompressionThreshold(int size);
+
+    qint64 bytesBeforeCompression() const;
+    qint64 bytesAfterCompression() const;
+    int compressionTime() const;
+
+    QScriptDebuggerTraceWriter *traceWriter() const;
+    void setTraceWriter(QScriptDebuggerTraceWriter *writer);
+
+    QScriptDebuggerMetrics *metrics() const;
+    void setMetrics(QScriptDebuggerMetrics *metrics);
+
+    // receiving
+    qint64 readFrom(QIODevice *device);
+    void append(const char *data, int size);
+    int bytesBuffered() const;
+
+    Status peekFrame(quint8 *type, quint32 *channel);
+    QDataStream &beginRead();
+    bool endRead();
+    void skipFrame();
+
+    // sending
+    QDataStream &beginFrame(quint8 type, quint32 channel);
+    bool endFrame();
+    void cancelFrame();
+
+    int pendingSize() const;
+    const char *pendingData() const;
+    qint64 writeTo(QIODevice *device);
+    void discardPending();
+
+private:
+    int takeBytes(char *data, int maxSize);
+    void inflate();
+    void copyOut(int offset, char *data, int size) const;
+    void reserve(int size);
+    void setError(const QString &message);
+    void traceReceivedFrame();
+    void countReceivedFrame();
+
+    // receive ring buffer
+    char *m_ring;
+    int m_ringMask;
+    int m_ringHead;
+    int m_ringSize;
+
+    // the frame being looked at; m_frameSize doesn't include the size field
+    quint32 m_frameSize;
+    quint8 m_frameType;
+    int m_frameRemaining;
+    bool m_frameOpen;
+    bool m_frameCompressed;
+    QByteArray m_inflated;
+    int m_inflatedPos;
+    QScriptDebuggerFrameReader *m_reader;
+    QDataStream m_in;
+
+    // send buffer
+    QByteArray m_sendBuffer;
+    int m_pendingSize;
+    int m_frameStart;
+    QScriptDebuggerFrameWriter *m_writer;
+    QDataStream m_out;
+
+    quint32 m_maxFrameSize;
+    QString m_errorString;
+
+    bool m_compression;
+    int m_compressionThreshold;
+    // payload sizes of the frames that were large enough to compress, and
+    // the time (in ms) spent compressing and decompressing
+    qint64 m_bytesBeforeCompression;
+    qint64 m_bytesAfterCompression;
+    int m_compressionTime;
+
+    QScriptDebuggerTraceWriter *m_traceWriter;
+    QByteArray m_traceBuffer;
+    QScriptDebuggerMetrics *m_metrics;
+
+    friend class QScriptDebuggerFrameReader;
+    friend class QScriptDebuggerFrameWriter;
+
+    Q_DISABLE_COPY(QScriptDebuggerFrameCodec)
+};
+
+#endif
@@ -0,0 +1,325 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "qscriptdebuggerheapsnapshot_p.h"
+
+#include <QtCore/qalgorithms.h>
+#include <QtCore/qiodevice.h>
+#include <QtCore/qmap.h>
+#include <QtCore/qtextstream.h>
+
+namespace {
+
+struct RetainedSizeGreaterThan
+{
+    RetainedSizeGreaterThan(const QVector<quint64> &sizes) : m_sizes(sizes) {}
+    bool operator()(int a, int b) const
+    { return m_sizes.at(a) > m_sizes.at(b); }
+    const QVector<quint64> &m_sizes;
+};
+
+} // namespace
+
+QScriptDebuggerHeapSnapshot::QScriptDebuggerHeapSnapshot()
+    : m_snapshot(0), m_complete(false), m_truncated(false)
+{
+}
+
+QScriptDebuggerHeapSnapshot::~QScriptDebuggerHeapSnapshot()
+{
+}
+
+/*!
+  Forgets everything and expects the chunks of the given \a snapshot
+  from now on.
+*/
+void QScriptDebuggerHeapSnapshot::reset(quint32 snapshot)
+{
+    m_snapshot = snapshot;
+    m_complete = false;
+    m_truncated = false;
+    m_strings.clear();
+    m_nodes.clear();
+    m_index.clear();
+    m_edges.clear();
+}
+
+quint32 QScriptDebuggerHeapSnapshot::snapshot() const
+{
+    return m_snapshot;
+}
+
+/*!
+  Adds \a chunk to the graph; the last chunk completes it. Returns false
+  if the chunk belongs to another snapshot, in which case it's ignored.
+*/
+bool QScriptDebuggerHeapSnapshot::append(const QScriptDebuggerHeapSnapshotChunk &chunk)
+{
+    if ((chunk.snapshot != m_snapshot) || m_complete)
+        return false;
+    m_strings += chunk.strings;
+    for (int i = 0; i < chunk.nodes.size(); ++i) {
+        const QScriptDebuggerHeapNode &in = chunk.nodes.at(i);
+        if (m_index.contains(in.id))
+            continue;
+        Node node;
+        node.id = in.id;
+        node.type = in.type;
+        node.nameIndex = in.nameIndex;
+        node.selfSize = in.selfSize;
+        m_index.insert(in.id, m_nodes.size());
+        m_nodes.append(node);
+    }
+    m_edges += chunk.edges;
+    if (chunk.last) {
+        m_complete = true;
+        m_truncated = chunk.truncated;
+        computeDominators();
+        m_edges.clear();
+    }
+    return true;
+}
+
+bool QScriptDebuggerHeapSnapshot::isComplete() const
+{
+    return m_complete;
+}
+
+/*!
+  Returns true if the target stopped sending the snapshot before it had
+  walked all objects; the graph then only holds the objects that it had
+  sent.
+*/
+bool QScriptDebuggerHeapSnapshot::isTruncated() const
+{
+    return m_truncated;
+}
+
+int QScriptDebuggerHeapSnapshot::nodeCount() const
+{
+    return m_nodes.size();
+}
+
+qint64 QScriptDebuggerHeapSnapshot::objectId(int node) const
+{
+    return m_nodes.at(node).id;
+}
+
+int QScriptDebuggerHeapSnapshot::type(int node) const
+{
+    return m_nodes.at(node).type;
+}
+
+/*!
+  Returns the class or function name of the given \a node.
+*/
+QString QScriptDebuggerHeapSnapshot::name(int node) const
+{
+    return string(m_nodes.at(node).nameIndex);
+}
+
+/*!
+  Returns the name of the property through which the given \a node was
+  first reached.
+*/
+QString QScriptDebuggerHeapSnapshot::retainerName(int node) const
+{
+    return string(m_nodes.at(node).retainerIndex);
+}
+
+quint32 QScriptDebuggerHeapSnapshot::selfSize(int node) const
+{
+    return m_nodes.at(node).selfSize;
+}
+
+quint64 QScriptDebuggerHeapSnapshot::retainedSize(int node) const
+{
+    return m_nodes.at(node).retainedSize;
+}
+
+/*!
+  Returns the nodes whose immediate dominator is \a node, largest
+  retained size first.
+*/
+QList<int> QScriptDebuggerHeapSnapshot::dominatedNodes(int node) const
+{
+    return m_nodes.at(node).dominated;
+}
+
+/*!
+  Writes the snapshot to \a device as text meant to be compared with
+  another snapshot's using a line based diff: a summary line, the number
+  and size of the objects per class, and one line per object (id, class,
+  self size, retained size and retaining property), ordered by id.
+  Returns false if the snapshot isn't complete.
+*/
+bool QScriptDebuggerHeapSnapshot::write(QIODevice *device) const
+{
+    if (!m_complete || m_nodes.isEmpty())
+        return false;
+    QTextStream out(device);
+    out << "# objects " << (m_nodes.size() - 1)
+        << " retained " << m_nodes.at(0).retainedSize << "\n";
+    if (m_truncated)
+        out << "# truncated\n";
+
+    QMap<QString, QPair<int, quint64> > classes;
+    for (int i = 1; i < m_nodes.size(); ++i) {
+        QPair<int, quint64> &entry = classes[name(i)];
+        ++entry.first;
+        entry.second += m_nodes.at(i).selfSize;
+    }
+    out << "# class\tcount\tself\n";
+    QMap<QString, QPair<int, quint64> >::const_iterator it;
+    for (it = classes.constBegin(); it != classes.constEnd(); ++it)
+        out << it.key() << "\t" << it.value().first << "\t" << it.value().second << "\n";
+
+    QMap<qint64, int> byId;
+    for (int i = 1; i < m_nodes.size(); ++i)
+        byId.insert(m_nodes.at(i).id, i);
+    out << "# object\tclass\tself\tretained\tretainer\n";
+    QMap<qint64, int>::const_iterator it2;
+    for (it2 = byId.constBegin(); it2 != byId.constEnd(); ++it2) {
+        const Node &node = m_nodes.at(it2.value());
+        out << node.id << "\t" << name(it2.value()) << "\t" << node.selfSize << "\t"
+            << node.retainedSize << "\t" << retainerName(it2.value()) << "\n";
+    }
+    out.flush();
+    return (out.status() == QTextStream::Ok);
+}
+
+QString QScriptDebuggerHeapSnapshot::string(qint32 index) const
+{
+    if ((index < 0) || (index >= m_strings.size()))
+        return QString();
+    return m_strings.at(index);
+}
+
+/*!
+  Computes the immediate dominator of every node, using the iterative
+  algorithm of Cooper, Harvey and Kennedy, and from that the retained
+  sizes.
+*/
+void QScriptDebuggerHeapSnapshot::computeDominators()
+{
+    int count = m_nodes.size();
+    if (count == 0)
+        return;
+    QVector<QVector<int> > successors(count);
+    QVector<QVector<int> > predecessors(count);
+    for (int i = 0; i < m_edges.size(); ++i) {
+        const QScriptDebuggerHeapEdge &edge = m_edges.at(i);
+        int from = m_index.value(edge.from, -1);
+        int to = m_index.value(edge.to, -1);
+        if ((from == -1) || (to == -1))
+            continue;
+        successors[from].append(to);
+        predecessors[to].append(from);
+        if (m_nodes.at(to).retainerIndex == -1)
+            m_nodes[to].retainerIndex = edge.nameIndex;
+    }
+
+    // depth-first postorder from the root
+    QVector<int> postIndex(count, -1);
+    QVector<int> order;
+    order.reserve(count);
+    QVector<int> nextSuccessor(count, 0);
+    QVector<bool> visited(count, false);
+    QVector<int> stack;
+    stack.append(0);
+    visited[0] = true;
+    while (!stack.isEmpty()) {
+        int node = stack.last();
+        if (nextSuccessor.at(node) < successors.at(node).size()) {
+            int next = successors.at(node).at(nextSuccessor[node]++);
+            if (!visited.at(next)) {
+                visited[next] = true;
+                stack.append(next);
+            }
+        } else {
+            postIndex[node] = order.size();
+            order.append(node);
+            stack.pop_back();
+        }
+    }
+
+    QVector<int> dominator(count, -1);
+    dominator[0] = 0;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        // reverse postorder, skipping the root
+        for (int i = order.size() - 2; i >= 0; --i) {
+            int node = order.at(i);
+            int candidate = -1;
+            const QVector<int> &preds = predecessors.at(node);
+            for (int j = 0; j < preds.size(); ++j) {
+                int pred = preds.at(j);
+                if (dominator.at(pred) == -1)
+                    continue;
+                if (candidate == -1) {
+                    candidate = pred;
+                    continue;
+                }
+                int a = pred;
+                int b = candidate;
+                while (a != b) {
+                    while (postIndex.at(a) < postIndex.at(b))
+                        a = dominator.at(a);
+                    while (postIndex.at(b) < postIndex.at(a))
+                        b = dominator.at(b);
+                }
+                candidate = a;
+            }
+            if ((candidate != -1) && (dominator.at(node) != candidate)) {
+                dominator[node] = candidate;
+                changed = true;
+            }
+        }
+    }
+
+    // a dominator comes after the nodes it dominates in postorder, so
+    // one pass in postorder accumulates the retained sizes
+    QVector<quint64> retained(count);
+    for (int i = 0; i < count; ++i)
+        retained[i] = m_nodes.at(i).selfSize;
+    for (int i = 0; i < order.size() - 1; ++i) {
+        int node = order.at(i);
+        retained[dominator.at(node)] += retained.at(node);
+    }
+    // objects the walk reached through edges that weren't sent
+    for (int i = 1; i < count; ++i) {
+        if (dominator.at(i) == -1) {
+            dominator[i] = 0;
+            retained[0] += retained.at(i);
+        }
+    }
+
+    for (int i = 0; i < count; ++i) {
+        m_nodes[i].retainedSize = retained.at(i);
+        m_nodes[i].dominator = dominator.at(i);
+        if (i != 0)
+            m_nodes[dominator.at(i)].dominated.append(i);
+    }
+    RetainedSizeGreaterThan greaterThan(retained);
+    for (int i = 0; i < count; ++i)
+        qSort(m_nodes[i].dominated.begin(), m_nodes[i].dominated.end(), greaterThan);
+}
@@ -0,0 +1,104 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef QSCRIPTDEBUGGERHEAPSNAPSHOT_P_H
+#define QSCRIPTDEBUGGERHEAPSNAPSHOT_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/qhash.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qstringlist.h>
+#include <QtCore/qvector.h>
+
+#include "qscriptdebuggerprotocol_p.h"
+
+class QIODevice;
+
+// The object graph of a target, assembled from the chunks of a heap
+// snapshot (see QScriptDebuggerHeapSnapshotChunk). Once the last chunk
+// has arrived, the dominator tree of the graph is computed: an object's
+// retained size is its own size plus that of every object that is only
+// reachable through it.
+//
+// Nodes are referred to by their index; index 0 is the root.
+class QScriptDebuggerHeapSnapshot
+{
+public:
+    QScriptDebuggerHeapSnapshot();
+    ~QScriptDebuggerHeapSnapshot();
+
+    void reset(quint32 snapshot);
+    quint32 snapshot() const;
+
+    bool append(const QScriptDebuggerHeapSnapshotChunk &chunk);
+    bool isComplete() const;
+    bool isTruncated() const;
+
+    int nodeCount() const;
+    qint64 objectId(int node) const;
+    int type(int node) const;
+    QString name(int node) const;
+    QString retainerName(int node) const;
+    quint32 selfSize(int node) const;
+    quint64 retainedSize(int node) const;
+    QList<int> dominatedNodes(int node) const;
+
+    bool write(QIODevice *device) const;
+
+private:
+    struct Node
+    {
+        Node() : id(-1), type(0), nameIndex(-1), retainerIndex(-1), selfSize(0),
+                 retainedSize(0), dominator(-1) {}
+
+        qint64 id;
+        int type;
+        qint32 nameIndex;
+        qint32 retainerIndex; // name of the first edge that reached it
+        quint32 selfSize;
+        quint64 retainedSize;
+        int dominator;
+        QList<int> dominated; // by retained size, largest first
+    };
+
+    QString string(qint32 index) const;
+    void computeDominators();
+
+    quint32 m_snapshot;
+    bool m_complete;
+    bool m_truncated;
+    QStringList m_strings;
+    QVector<Node> m_nodes;
+    QHash<qint64, int> m_index;
+    QList<QScriptDebuggerHeapEdge> m_edges; // until the snapshot is complete
+};
+
+#endif
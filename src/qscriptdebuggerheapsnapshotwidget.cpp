@@ -0,0 +1,188 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "qscriptdebuggerheapsnapshotwidget_p.h"
+#include "qscriptdebuggerheapsnapshot_p.h"
+
+#include <QtCore/qfile.h>
+#include <QtGui/qboxlayout.h>
+#include <QtGui/qfiledialog.h>
+#include <QtGui/qheaderview.h>
+#include <QtGui/qlabel.h>
+#include <QtGui/qmessagebox.h>
+#include <QtGui/qtoolbutton.h>
+#include <QtGui/qtreewidget.h>
+
+namespace {
+
+enum Column {
+    ObjectColumn,
+    SelfColumn,
+    RetainedColumn,
+    ColumnCount
+};
+
+enum {
+    NodeRole = Qt::UserRole + 1,
+    PopulatedRole
+};
+
+} // namespace
+
+QScriptDebuggerHeapSnapshotWidget::QScriptDebuggerHeapSnapshotWidget(QWidget *parent)
+    : QWidget(parent), m_snapshot(0)
+{
+    m_snapshotButton = new QToolButton();
+    m_snapshotButton->setText(tr("Take Snapshot"));
+    m_exportButton = new QToolButton();
+    m_exportButton->setText(tr("Export..."));
+    m_summary = new QLabel();
+    QObject::connect(m_snapshotButton, SIGNAL(clicked()), this, SIGNAL(snapshotRequested()));
+    QObject::connect(m_exportButton, SIGNAL(clicked()), this, SLOT(exportSnapshot()));
+
+    QHBoxLayout *buttons = new QHBoxLayout();
+    buttons->addWidget(m_snapshotButton);
+    buttons->addWidget(m_exportButton);
+    buttons->addStretch();
+    buttons->addWidget(m_summary);
+
+    m_tree = new QTreeWidget();
+    m_tree->setColumnCount(ColumnCount);
+    QStringList labels;
+    labels << tr("Object") << tr("Self") << tr("Retained");
+    m_tree->setHeaderLabels(labels);
+    m_tree->setUniformRowHeights(true);
+    m_tree->header()->setStretchLastSection(false);
+    m_tree->header()->setResizeMode(ObjectColumn, QHeaderView::Stretch);
+    QObject::connect(m_tree, SIGNAL(itemExpanded(QTreeWidgetItem*)),
+                     this, SLOT(onItemExpanded(QTreeWidgetItem*)));
+
+    QVBoxLayout *vbox = new QVBoxLayout(this);
+    vbox->setMargin(0);
+    vbox->addLayout(buttons);
+    vbox->addWidget(m_tree);
+
+    refresh();
+}
+
+QScriptDebuggerHeapSnapshotWidget::~QScriptDebuggerHeapSnapshotWidget()
+{
+}
+
+const QScriptDebuggerHeapSnapshot *QScriptDebuggerHeapSnapshotWidget::snapshot() const
+{
+    return m_snapshot;
+}
+
+/*!
+  Shows the given \a snapshot, which must stay alive until another one
+  is set; 0 shows nothing.
+*/
+void QScriptDebuggerHeapSnapshotWidget::setSnapshot(const QScriptDebuggerHeapSnapshot *snapshot)
+{
+    m_snapshot = snapshot;
+    refresh();
+}
+
+/*!
+  Sets whether a snapshot can be asked for to \a enabled.
+*/
+void QScriptDebuggerHeapSnapshotWidget::setSnapshotEnabled(bool enabled)
+{
+    m_snapshotButton->setEnabled(enabled);
+}
+
+/*!
+  Rebuilds the tree from the snapshot.
+*/
+void QScriptDebuggerHeapSnapshotWidget::refresh()
+{
+    m_tree->clear();
+    bool complete = m_snapshot && m_snapshot->isComplete() && (m_snapshot->nodeCount() > 0);
+    if (complete) {
+        addNodes(m_tree->invisibleRootItem(), 0);
+        if (m_snapshot->isTruncated()) {
+            m_summary->setText(tr("%n object(s), %0 bytes (incomplete)", 0, m_snapshot->nodeCount() - 1)
+                               .arg(m_snapshot->retainedSize(0)));
+        } else {
+            m_summary->setText(tr("%n object(s), %0 bytes", 0, m_snapshot->nodeCount() - 1)
+                               .arg(m_snapshot->retainedSize(0)));
+        }
+    } else if (m_snapshot && (m_snapshot->snapshot() != 0)) {
+        m_summary->setText(tr("Receiving %n object(s)...", 0, m_snapshot->nodeCount()));
+    } else {
+        m_summary->clear();
+    }
+    m_exportButton->setEnabled(complete);
+}
+
+void QScriptDebuggerHeapSnapshotWidget::addNodes(QTreeWidgetItem *parent, int node)
+{
+    QList<int> nodes = m_snapshot->dominatedNodes(node);
+    int count = qMin(nodes.size(), int(MaxChildren));
+    for (int i = 0; i < count; ++i) {
+        int child = nodes.at(i);
+        QTreeWidgetItem *item = new QTreeWidgetItem(parent);
+        QString retainer = m_snapshot->retainerName(child);
+        QString label = QString::fromLatin1("%0 @%1").arg(m_snapshot->name(child))
+                        .arg(m_snapshot->objectId(child));
+        if (!retainer.isEmpty())
+            label = retainer + QLatin1String(": ") + label;
+        item->setText(ObjectColumn, label);
+        item->setData(ObjectColumn, NodeRole, child);
+        item->setData(SelfColumn, Qt::DisplayRole, m_snapshot->selfSize(child));
+        item->setData(RetainedColumn, Qt::DisplayRole, m_snapshot->retainedSize(child));
+        item->setTextAlignment(SelfColumn, Qt::AlignRight);
+        item->setTextAlignment(RetainedColumn, Qt::AlignRight);
+        if (!m_snapshot->dominatedNodes(child).isEmpty())
+            item->setChildIndicatorPolicy(QTreeWidgetItem::ShowIndicator);
+    }
+    if (nodes.size() > count) {
+        QTreeWidgetItem *item = new QTreeWidgetItem(parent);
+        item->setText(ObjectColumn, tr("(%n more)", 0, nodes.size() - count));
+        item->setFlags(Qt::NoItemFlags);
+    }
+}
+
+void QScriptDebuggerHeapSnapshotWidget::onItemExpanded(QTreeWidgetItem *item)
+{
+    if (!m_snapshot || item->data(ObjectColumn, PopulatedRole).toBool())
+        return;
+    item->setData(ObjectColumn, PopulatedRole, true);
+    addNodes(item, item->data(ObjectColumn, NodeRole).toInt());
+}
+
+void QScriptDebuggerHeapSnapshotWidget::exportSnapshot()
+{
+    if (!m_snapshot)
+        return;
+    QString fileName = QFileDialog::getSaveFileName(
+        this, tr("Export Heap Snapshot"), QString(),
+        tr("Heap snapshots (*.heap);;All files (*)"));
+    if (fileName.isEmpty())
+        return;
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)
+        || !m_snapshot->write(&file)) {
+        QMessageBox::warning(this, tr("Export Heap Snapshot"),
+                             tr("Could not write %0: %1").arg(fileName).arg(file.errorString()));
+    }
+}
@@ -0,0 +1,85 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef QSCRIPTDEBUGGERHEAPSNAPSHOTWIDGET_P_H
+#define QSCRIPTDEBUGGERHEAPSNAPSHOTWIDGET_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtGui/qwidget.h>
+
+class QScriptDebuggerHeapSnapshot;
+class QTreeWidget;
+class QTreeWidgetItem;
+class QLabel;
+class QToolButton;
+
+// Shows the dominator tree of a QScriptDebuggerHeapSnapshot, with the
+// size of every object and the size it retains. Children are added when
+// an item is first expanded, since snapshots can be large. A new
+// snapshot is asked for through a signal; the snapshot can be exported
+// for comparison with another one.
+class QScriptDebuggerHeapSnapshotWidget : public QWidget
+{
+    Q_OBJECT
+public:
+    QScriptDebuggerHeapSnapshotWidget(QWidget *parent = 0);
+    ~QScriptDebuggerHeapSnapshotWidget();
+
+    const QScriptDebuggerHeapSnapshot *snapshot() const;
+    void setSnapshot(const QScriptDebuggerHeapSnapshot *snapshot);
+
+    void setSnapshotEnabled(bool enabled);
+
+public Q_SLOTS:
+    void refresh();
+
+Q_SIGNALS:
+    void snapshotRequested();
+
+private Q_SLOTS:
+    void onItemExpanded(QTreeWidgetItem *item);
+    void exportSnapshot();
+
+private:
+    enum {
+        MaxChildren = 500
+    };
+
+    void addNodes(QTreeWidgetItem *parent, int node);
+
+    const QScriptDebuggerHeapSnapshot *m_snapshot;
+    QTreeWidget *m_tree;
+    QLabel *m_summary;
+    QToolButton *m_snapshotButton;
+    QToolButton *m_exportButton;
+};
+
+#endif
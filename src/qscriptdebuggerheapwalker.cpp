@@ -0,0 +1,229 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "qscriptdebuggerheapwalker_p.h"
+
+#include <QtCore/qmetaobject.h>
+#include <QtCore/qvariant.h>
+#include <QtScript/qscriptcontext.h>
+#include <QtScript/qscriptengine.h>
+#include <QtScript/qscriptvalueiterator.h>
+
+QScriptDebuggerHeapWalker::QScriptDebuggerHeapWalker(QScriptEngine *engine, quint32 snapshot)
+    : m_engine(engine), m_snapshot(snapshot), m_started(false), m_chunkSize(0), m_nodeCount(0)
+{
+}
+
+QScriptDebuggerHeapWalker::~QScriptDebuggerHeapWalker()
+{
+}
+
+/*!
+  Returns true if every reachable object has been handed out.
+*/
+bool QScriptDebuggerHeapWalker::atEnd() const
+{
+    return m_started && m_pending.isEmpty();
+}
+
+/*!
+  Visits objects until the chunk reaches its size limit or there are no
+  objects left, and returns the chunk.
+*/
+QScriptDebuggerHeapSnapshotChunk QScriptDebuggerHeapWalker::next()
+{
+    QScriptDebuggerHeapSnapshotChunk chunk;
+    chunk.snapshot = m_snapshot;
+    m_chunkSize = 0;
+    if (!m_started) {
+        m_started = true;
+        addRoots(&chunk);
+    }
+    while (!m_pending.isEmpty() && (m_chunkSize < MaxChunkSize))
+        visit(m_pending.dequeue(), &chunk);
+    chunk.last = m_pending.isEmpty();
+    return chunk;
+}
+
+int QScriptDebuggerHeapWalker::nodeCount() const
+{
+    return m_nodeCount;
+}
+
+void QScriptDebuggerHeapWalker::addRoots(QScriptDebuggerHeapSnapshotChunk *chunk)
+{
+    QScriptDebuggerHeapNode root;
+    root.id = 0;
+    root.type = QScriptDebuggerHeapNode::RootNode;
+    root.nameIndex = stringIndex(QString::fromLatin1("(root)"), chunk);
+    chunk->nodes.append(root);
+    m_chunkSize += NodeSize;
+    ++m_nodeCount;
+
+    addEdge(0, m_engine->globalObject(), QScriptDebuggerHeapEdge::RootEdge,
+            QString::fromLatin1("global"), chunk);
+    int depth = 0;
+    for (QScriptContext *ctx = m_engine->currentContext(); ctx; ctx = ctx->parentContext(), ++depth) {
+        QString prefix = QString::fromLatin1("context %0 ").arg(depth);
+        addEdge(0, ctx->activationObject(), QScriptDebuggerHeapEdge::RootEdge,
+                prefix + QLatin1String("activation"), chunk);
+        addEdge(0, ctx->thisObject(), QScriptDebuggerHeapEdge::RootEdge,
+                prefix + QLatin1String("this"), chunk);
+        addEdge(0, ctx->callee(), QScriptDebuggerHeapEdge::RootEdge,
+                prefix + QLatin1String("callee"), chunk);
+        QScriptValueList scopes = ctx->scopeChain();
+        for (int i = 0; i < scopes.size(); ++i) {
+            addEdge(0, scopes.at(i), QScriptDebuggerHeapEdge::RootEdge,
+                    prefix + QLatin1String("scope"), chunk);
+        }
+    }
+}
+
+void QScriptDebuggerHeapWalker::visit(const QScriptValue &object,
+                                      QScriptDebuggerHeapSnapshotChunk *chunk)
+{
+    QScriptDebuggerHeapNode node;
+    node.id = object.objectId();
+    node.selfSize = ObjectSize;
+    bool expand = true;
+    if (object.isQObject() || object.isQMetaObject()) {
+        node.type = QScriptDebuggerHeapNode::QObjectNode;
+        expand = false;
+    } else if (object.isVariant()) {
+        node.type = QScriptDebuggerHeapNode::VariantNode;
+        expand = false;
+    } else if (object.isFunction()) {
+        node.type = QScriptDebuggerHeapNode::FunctionNode;
+    } else if (object.isArray()) {
+        node.type = QScriptDebuggerHeapNode::ArrayNode;
+    } else if (object.isRegExp()) {
+        node.type = QScriptDebuggerHeapNode::RegExpNode;
+    } else if (object.isDate()) {
+        node.type = QScriptDebuggerHeapNode::DateNode;
+    } else {
+        node.type = QScriptDebuggerHeapNode::ObjectNode;
+    }
+    node.nameIndex = stringIndex(className(object), chunk);
+
+    if (expand) {
+        addEdge(node.id, object.prototype(), QScriptDebuggerHeapEdge::PrototypeEdge,
+                QString::fromLatin1("__proto__"), chunk);
+        if (node.type == QScriptDebuggerHeapNode::FunctionNode) {
+            addEdge(node.id, object.scope(), QScriptDebuggerHeapEdge::ScopeEdge,
+                    QString::fromLatin1("[[Scope]]"), chunk);
+        }
+        bool isArray = (node.type == QScriptDebuggerHeapNode::ArrayNode);
+        QScriptValueIterator it(object);
+        while (it.hasNext()) {
+            it.next();
+            node.selfSize += SlotSize;
+            if (it.flags() & (QScriptValue::PropertyGetter | QScriptValue::PropertySetter))
+                continue;
+            QScriptValue value = it.value();
+            if (value.isObject()) {
+                // array elements share one name, so that large arrays
+                // don't fill the string table
+                QString name = it.name();
+                bool isIndex = false;
+                if (isArray)
+                    name.toUInt(&isIndex);
+                addEdge(node.id, value, QScriptDebuggerHeapEdge::PropertyEdge,
+                        isIndex ? QString::fromLatin1("[]") : name, chunk);
+            } else if (value.isString()) {
+                node.selfSize += SlotSize + 2 * value.toString().size();
+            }
+        }
+    }
+
+    chunk->nodes.append(node);
+    m_chunkSize += NodeSize;
+    ++m_nodeCount;
+}
+
+void QScriptDebuggerHeapWalker::addEdge(qint64 from, const QScriptValue &to, quint8 type,
+                                        const QString &name,
+                                        QScriptDebuggerHeapSnapshotChunk *chunk)
+{
+    if (!to.isObject())
+        return;
+    QScriptDebuggerHeapEdge edge;
+    edge.from = from;
+    edge.to = to.objectId();
+    edge.type = type;
+    edge.nameIndex = stringIndex(name, chunk);
+    chunk->edges.append(edge);
+    m_chunkSize += EdgeSize;
+    if (!m_seen.contains(edge.to)) {
+        m_seen.insert(edge.to);
+        m_pending.enqueue(to);
+    }
+}
+
+qint32 QScriptDebuggerHeapWalker::stringIndex(const QString &string,
+                                              QScriptDebuggerHeapSnapshotChunk *chunk)
+{
+    QHash<QString, qint32>::const_iterator it = m_strings.constFind(string);
+    if (it != m_strings.constEnd())
+        return it.value();
+    qint32 index = m_strings.size();
+    m_strings.insert(string, index);
+    chunk->strings.append(string);
+    m_chunkSize += 4 + 2 * string.size();
+    return index;
+}
+
+/*!
+  Returns the name shown for \a object: the name of a function, the class
+  of a QObject, or the name of an object's constructor.
+*/
+QString QScriptDebuggerHeapWalker::className(const QScriptValue &object)
+{
+    if (object.isQObject()) {
+        if (QObject *qobject = object.toQObject())
+            return QString::fromLatin1(qobject->metaObject()->className());
+        return QString::fromLatin1("QObject");
+    }
+    if (object.isQMetaObject())
+        return QString::fromLatin1("QMetaObject");
+    if (object.isVariant())
+        return QString::fromLatin1(object.toVariant().typeName());
+    if (object.isFunction()) {
+        QString name = object.property(QString::fromLatin1("name")).toString();
+        return name.isEmpty() ? QString::fromLatin1("(anonymous function)") : name;
+    }
+    if (object.isArray())
+        return QString::fromLatin1("Array");
+    if (object.isRegExp())
+        return QString::fromLatin1("RegExp");
+    if (object.isDate())
+        return QString::fromLatin1("Date");
+    // don't run a getter to find the constructor
+    QString constructor = QString::fromLatin1("constructor");
+    if (!(object.propertyFlags(constructor) & QScriptValue::PropertyGetter)) {
+        QScriptValue ctor = object.property(constructor);
+        if (ctor.isFunction()) {
+            QString name = ctor.property(QString::fromLatin1("name")).toString();
+            if (!name.isEmpty())
+                return name;
+        }
+    }
+    return QString::fromLatin1("Object");
+}
@@ -0,0 +1,91 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef QSCRIPTDEBUGGERHEAPWALKER_P_H
+#define QSCRIPTDEBUGGERHEAPWALKER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/qhash.h>
+#include <QtCore/qqueue.h>
+#include <QtCore/qset.h>
+#include <QtScript/qscriptvalue.h>
+
+#include "qscriptdebuggerprotocol_p.h"
+
+class QScriptEngine;
+
+// Walks the objects reachable from an engine's global object and active
+// contexts, breadth first, and hands out what it finds one bounded chunk
+// at a time (see QScriptDebuggerHeapSnapshotChunk). Only the ids of the
+// objects seen so far, the objects still to be visited and the string
+// table are kept between chunks.
+//
+// Accessor properties are not followed, since reading them would run
+// script code; the properties of QObjects and variants aren't either,
+// since every read may create a new wrapper object.
+class QScriptDebuggerHeapWalker
+{
+public:
+    QScriptDebuggerHeapWalker(QScriptEngine *engine, quint32 snapshot);
+    ~QScriptDebuggerHeapWalker();
+
+    bool atEnd() const;
+    QScriptDebuggerHeapSnapshotChunk next();
+
+    int nodeCount() const;
+
+private:
+    enum {
+        MaxChunkSize = 32 * 1024, // estimated bytes per chunk
+        NodeSize = 17,
+        EdgeSize = 21,
+        ObjectSize = 32,          // estimated bytes per object
+        SlotSize = 16             // estimated bytes per property
+    };
+
+    void addRoots(QScriptDebuggerHeapSnapshotChunk *chunk);
+    void visit(const QScriptValue &object, QScriptDebuggerHeapSnapshotChunk *chunk);
+    void addEdge(qint64 from, const QScriptValue &to, quint8 type, const QString &name,
+                 QScriptDebuggerHeapSnapshotChunk *chunk);
+    qint32 stringIndex(const QString &string, QScriptDebuggerHeapSnapshotChunk *chunk);
+    static QString className(const QScriptValue &object);
+
+    QScriptEngine *m_engine;
+    quint32 m_snapshot;
+    bool m_started;
+    int m_chunkSize;
+    int m_nodeCount;
+    QQueue<QScriptValue> m_pending;
+    QSet<qint64> m_seen;
+    QHash<QString, qint32> m_strings;
+};
+
+#endif
@@ -0,0 +1,148 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "qscriptdebuggerhookagent_p.h"
+#include "qscriptdebuggerprofiler_p.h"
+#include "qscriptdebuggercoveragerecorder_p.h"
+
+#include <QtCore/qobject.h>
+#include <QtCore/qvariant.h>
+
+QScriptDebuggerHookAgent::QScriptDebuggerHookAgent(QScriptEngine *engine, QScriptEngineAgent *next)
+    : QScriptEngineAgent(engine), m_next(next), m_profiler(0), m_coverage(0),
+      m_pollFlag(0), m_pollReceiver(0), m_pollMember(0)
+{
+}
+
+QScriptDebuggerHookAgent::~QScriptDebuggerHookAgent()
+{
+}
+
+QScriptEngineAgent *QScriptDebuggerHookAgent::next() const
+{
+    return m_next;
+}
+
+void QScriptDebuggerHookAgent::setNext(QScriptEngineAgent *next)
+{
+    m_next = next;
+}
+
+void QScriptDebuggerHookAgent::setProfiler(QScriptDebuggerProfiler *profiler)
+{
+    m_profiler = profiler;
+}
+
+void QScriptDebuggerHookAgent::setCoverageRecorder(QScriptDebuggerCoverageRecorder *recorder)
+{
+    m_coverage = recorder;
+}
+
+/*!
+  Makes the agent invoke \a member of \a receiver before the next
+  statement whenever \a flag is raised. Pass a null \a flag to stop.
+*/
+void QScriptDebuggerHookAgent::setPoll(QAtomicInt *flag, QObject *receiver, const char *member)
+{
+    m_pollFlag = flag;
+    m_pollReceiver = receiver;
+    m_pollMember = member;
+}
+
+void QScriptDebuggerHookAgent::scriptLoad(qint64 id, const QString &program,
+                                          const QString &fileName, int baseLineNumber)
+{
+    if (m_coverage)
+        m_coverage->scriptLoad(id, program, fileName, baseLineNumber);
+    if (m_next)
+        m_next->scriptLoad(id, program, fileName, baseLineNumber);
+}
+
+void QScriptDebuggerHookAgent::scriptUnload(qint64 id)
+{
+    if (m_coverage)
+        m_coverage->scriptUnload(id);
+    if (m_next)
+        m_next->scriptUnload(id);
+}
+
+void QScriptDebuggerHookAgent::contextPush()
+{
+    if (m_next)
+        m_next->contextPush();
+}
+
+void QScriptDebuggerHookAgent::contextPop()
+{
+    if (m_next)
+        m_next->contextPop();
+}
+
+void QScriptDebuggerHookAgent::functionEntry(qint64 scriptId)
+{
+    if (m_next)
+        m_next->functionEntry(scriptId);
+}
+
+void QScriptDebuggerHookAgent::functionExit(qint64 scriptId, const QScriptValue &returnValue)
+{
+    if (m_next)
+        m_next->functionExit(scriptId, returnValue);
+}
+
+void QScriptDebuggerHookAgent::positionChange(qint64 scriptId, int lineNumber, int columnNumber)
+{
+    if (m_coverage)
+        m_coverage->hit(scriptId, lineNumber);
+    // the next agent may block (e.g. at a breakpoint), so the sample
+    // must be taken before calling it
+    if (m_profiler)
+        m_profiler->positionChange();
+    // before the next agent, so that an interrupt that is polled here
+    // takes effect at this statement
+    if (m_pollFlag && (*m_pollFlag != 0))
+        QMetaObject::invokeMethod(m_pollReceiver, m_pollMember, Qt::DirectConnection);
+    if (m_next)
+        m_next->positionChange(scriptId, lineNumber, columnNumber);
+}
+
+void QScriptDebuggerHookAgent::exceptionThrow(qint64 scriptId, const QScriptValue &exception,
+                                              bool hasHandler)
+{
+    if (m_next)
+        m_next->exceptionThrow(scriptId, exception, hasHandler);
+}
+
+void QScriptDebuggerHookAgent::exceptionCatch(qint64 scriptId, const QScriptValue &exception)
+{
+    if (m_next)
+        m_next->exceptionCatch(scriptId, exception);
+}
+
+bool QScriptDebuggerHookAgent::supportsExtension(Extension extension) const
+{
+    return m_next && m_next->supportsExtension(extension);
+}
+
+QVariant QScriptDebuggerHookAgent::extension(Extension extension, const QVariant &argument)
+{
+    return m_next ? m_next->extension(extension, argument) : QVariant();
+}
@@ -0,0 +1,83 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef QSCRIPTDEBUGGERHOOKAGENT_P_H
+#define QSCRIPTDEBUGGERHOOKAGENT_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/qatomic.h>
+#include <QtScript/qscriptengineagent.h>
+
+class QScriptDebuggerProfiler;
+class QScriptDebuggerCoverageRecorder;
+
+// An agent that is put in front of the engine's agent (normally the
+// debugger's) while the target is being profiled or its coverage is
+// being recorded. Every notification is forwarded to the next agent;
+// position changes and script loads are seen by the profiler and the
+// coverage recorder first. For a target on a worker thread, it is also
+// where commands that arrive while the target runs get executed.
+class QScriptDebuggerHookAgent : public QScriptEngineAgent
+{
+public:
+    QScriptDebuggerHookAgent(QScriptEngine *engine, QScriptEngineAgent *next);
+    ~QScriptDebuggerHookAgent();
+
+    QScriptEngineAgent *next() const;
+    void setNext(QScriptEngineAgent *next);
+
+    void setProfiler(QScriptDebuggerProfiler *profiler);
+    void setCoverageRecorder(QScriptDebuggerCoverageRecorder *recorder);
+    void setPoll(QAtomicInt *flag, QObject *receiver, const char *member);
+
+    void scriptLoad(qint64 id, const QString &program,
+                    const QString &fileName, int baseLineNumber);
+    void scriptUnload(qint64 id);
+    void contextPush();
+    void contextPop();
+    void functionEntry(qint64 scriptId);
+    void functionExit(qint64 scriptId, const QScriptValue &returnValue);
+    void positionChange(qint64 scriptId, int lineNumber, int columnNumber);
+    void exceptionThrow(qint64 scriptId, const QScriptValue &exception, bool hasHandler);
+    void exceptionCatch(qint64 scriptId, const QScriptValue &exception);
+    bool supportsExtension(Extension extension) const;
+    QVariant extension(Extension extension, const QVariant &argument = QVariant());
+
+private:
+    QScriptEngineAgent *m_next;
+    QScriptDebuggerProfiler *m_profiler;
+    QScriptDebuggerCoverageRecorder *m_coverage;
+    QAtomicInt *m_pollFlag;
+    QObject *m_pollReceiver;
+    const char *m_pollMember;
+};
+
+#endif
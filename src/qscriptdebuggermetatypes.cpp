@@ -19,31 +19,7 @@
 **
 ****************************************************************************/
 
-#include <QtScript/qscriptcontextinfo.h>
-#include <private/qscriptdebuggercommand_p.h>
-#include <private/qscriptdebuggerevent_p.h>
-#include <private/qscriptdebuggerresponse_p.h>
-#include <private/qscriptdebuggerbackend_p.h>
-#include <private/qscriptdebuggerobjectsnapshotdelta_p.h>
-
-Q_DECLARE_METATYPE(QScriptDebuggerCommand)
-Q_DECLARE_METATYPE(QScriptDebuggerResponse)
-Q_DECLARE_METATYPE(QScriptDebuggerEvent)
-Q_DECLARE_METATYPE(QScriptContextInfo)
-Q_DECLARE_METATYPE(QScriptContextInfoList)
-Q_DECLARE_METATYPE(QScriptDebuggerValue)
-Q_DECLARE_METATYPE(QScriptDebuggerValueList)
-Q_DECLARE_METATYPE(QScriptValue::PropertyFlags)
-Q_DECLARE_METATYPE(QScriptBreakpointData)
-Q_DECLARE_METATYPE(QScriptBreakpointMap)
-Q_DECLARE_METATYPE(QScriptScriptData)
-Q_DECLARE_METATYPE(QScriptScriptMap)
-Q_DECLARE_METATYPE(QScriptScriptsDelta)
-Q_DECLARE_METATYPE(QScriptDebuggerValueProperty)
-Q_DECLARE_METATYPE(QScriptDebuggerValuePropertyList)
-Q_DECLARE_METATYPE(QScriptDebuggerObjectSnapshotDelta)
-Q_DECLARE_METATYPE(QList<int>)
-Q_DECLARE_METATYPE(QList<qint64>)
+#include "qscriptdebuggermetatypes_p.h"
 
 void qScriptDebugRegisterMetaTypes()
 {
@@ -0,0 +1,255 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "qscriptdebuggermetrics_p.h"
+#include "qscriptdebuggerprotocol_p.h"
+
+#include <QtCore/qfile.h>
+#include <QtCore/qtextstream.h>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+// the upper bounds of the histogram buckets, in us; the last bucket
+// takes the rest
+static const qint64 bucketBounds[] = {
+    10, 50, 100, 500, 1000, 5000, 10000, 50000, 100000, 500000,
+    1000000, 10000000
+};
+
+QScriptDebuggerMetrics::Histogram::Histogram()
+    : count(0), sum(0)
+{
+    for (int i = 0; i < BucketCount; ++i)
+        buckets[i] = 0;
+}
+
+QScriptDebuggerMetrics::QScriptDebuggerMetrics()
+{
+}
+
+QScriptDebuggerMetrics::~QScriptDebuggerMetrics()
+{
+}
+
+/*!
+  Returns a monotonic time in microseconds; QTime only has ms
+  resolution, which is too coarse for encoding a single frame.
+*/
+qint64 QScriptDebuggerMetrics::now()
+{
+#ifdef Q_OS_WIN
+    static LARGE_INTEGER frequency;
+    if (frequency.QuadPart == 0)
+        QueryPerformanceFrequency(&frequency);
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return qint64(double(counter.QuadPart) * 1000000.0 / frequency.QuadPart);
+#else
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return qint64(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+/*!
+  Returns the name that frames of the given \a type are reported under.
+*/
+QString QScriptDebuggerMetrics::frameTypeName(quint8 type)
+{
+    static const char * const names[] = {
+        "event", "response", "command", "channel_opened", "channel_closed",
+        "output", "command_batch", "response_batch", "script_hashes",
+        "profiler_control", "profile", "coverage_control", "coverage",
+        "heap_snapshot_request", "heap_snapshot", "session", "resume_request",
+        "ack", "detach", "heartbeat"
+    };
+    if (type < sizeof(names) / sizeof(names[0]))
+        return QString::fromLatin1(names[type]);
+    return QString::number(type);
+}
+
+QString QScriptDebuggerMetrics::key(const QString &name, const QString &labels)
+{
+    if (labels.isEmpty())
+        return name;
+    return name + QLatin1Char('{') + labels + QLatin1Char('}');
+}
+
+/*!
+  Counts a frame of \a size bytes, including its header, of the given
+  \a type going in the given \a direction.
+*/
+void QScriptDebuggerMetrics::addFrame(Direction direction, quint8 type, int size)
+{
+    QString labels = QString::fromLatin1("direction=\"%0\",type=\"%1\"")
+                     .arg(QLatin1String((direction == Sent) ? "sent" : "received"))
+                     .arg(frameTypeName(type));
+    QMutexLocker locker(&m_mutex);
+    m_counters[key(QString::fromLatin1("frames_total"), labels)] += 1;
+    m_counters[key(QString::fromLatin1("bytes_total"), labels)] += size;
+}
+
+/*!
+  Adds \a amount to the counter \a name with the given \a labels.
+*/
+void QScriptDebuggerMetrics::increment(const QString &name, const QString &labels, qint64 amount)
+{
+    QMutexLocker locker(&m_mutex);
+    m_counters[key(name, labels)] += amount;
+}
+
+/*!
+  Sets the gauge \a name with the given \a labels to \a value.
+*/
+void QScriptDebuggerMetrics::setGauge(const QString &name, const QString &labels, qint64 value)
+{
+    QMutexLocker locker(&m_mutex);
+    m_gauges[key(name, labels)] = value;
+}
+
+/*!
+  Adds a time of \a usecs microseconds to the histogram \a name with the
+  given \a labels.
+*/
+void QScriptDebuggerMetrics::addTime(const QString &name, const QString &labels, qint64 usecs)
+{
+    int bucket = 0;
+    while ((bucket < BucketCount - 1) && (usecs > bucketBounds[bucket]))
+        ++bucket;
+    QMutexLocker locker(&m_mutex);
+    Histogram &histogram = m_histograms[key(name, labels)];
+    ++histogram.buckets[bucket];
+    ++histogram.count;
+    histogram.sum += usecs;
+}
+
+/*!
+  Sets every counter and histogram back to 0, and forgets the gauges.
+*/
+void QScriptDebuggerMetrics::reset()
+{
+    QMutexLocker locker(&m_mutex);
+    m_counters.clear();
+    m_gauges.clear();
+    m_histograms.clear();
+}
+
+/*!
+  Returns every value, keyed by its name and labels. A histogram
+  contributes its _count, and its _sum in seconds.
+*/
+QVariantMap QScriptDebuggerMetrics::values() const
+{
+    QMutexLocker locker(&m_mutex);
+    QVariantMap result;
+    QMap<QString, qint64>::const_iterator it;
+    for (it = m_counters.constBegin(); it != m_counters.constEnd(); ++it)
+        result.insert(it.key(), it.value());
+    for (it = m_gauges.constBegin(); it != m_gauges.constEnd(); ++it)
+        result.insert(it.key(), it.value());
+    QMap<QString, Histogram>::const_iterator hit;
+    for (hit = m_histograms.constBegin(); hit != m_histograms.constEnd(); ++hit) {
+        QString name = hit.key().section(QLatin1Char('{'), 0, 0);
+        QString labels = hit.key().mid(name.size());
+        result.insert(name + QLatin1String("_count") + labels, hit.value().count);
+        result.insert(name + QLatin1String("_sum") + labels, hit.value().sum / 1000000.0);
+    }
+    return result;
+}
+
+static void writeType(QTextStream &out, const QString &name, const char *type, QString *last)
+{
+    if (name == *last)
+        return;
+    out << "# TYPE " << name << ' ' << type << '\n';
+    *last = name;
+}
+
+/*!
+  Writes every value to \a out in the Prometheus text format, with
+  \a prefix and an underscore in front of the names.
+*/
+void QScriptDebuggerMetrics::writePrometheus(QTextStream &out, const QString &prefix) const
+{
+    QMutexLocker locker(&m_mutex);
+    QString pre = prefix + QLatin1Char('_');
+    QString last;
+    // the maps are sorted by key, so the values of a metric are together
+    QMap<QString, qint64>::const_iterator it;
+    for (it = m_counters.constBegin(); it != m_counters.constEnd(); ++it) {
+        writeType(out, pre + it.key().section(QLatin1Char('{'), 0, 0), "counter", &last);
+        out << pre << it.key() << ' ' << it.value() << '\n';
+    }
+    for (it = m_gauges.constBegin(); it != m_gauges.constEnd(); ++it) {
+        writeType(out, pre + it.key().section(QLatin1Char('{'), 0, 0), "gauge", &last);
+        out << pre << it.key() << ' ' << it.value() << '\n';
+    }
+    QMap<QString, Histogram>::const_iterator hit;
+    for (hit = m_histograms.constBegin(); hit != m_histograms.constEnd(); ++hit) {
+        QString name = pre + hit.key().section(QLatin1Char('{'), 0, 0);
+        QString labels = hit.key().section(QLatin1Char('{'), 1).section(QLatin1Char('}'), 0, 0);
+        QString sep = labels.isEmpty() ? QString() : QString::fromLatin1(",");
+        writeType(out, name, "histogram", &last);
+        const Histogram &histogram = hit.value();
+        qint64 cumulative = 0;
+        for (int i = 0; i < BucketCount; ++i) {
+            cumulative += histogram.buckets[i];
+            QString bound = (i < BucketCount - 1)
+                            ? QString::number(bucketBounds[i] / 1000000.0)
+                            : QString::fromLatin1("+Inf");
+            out << name << "_bucket{" << labels << sep << "le=\"" << bound << "\"} "
+                << cumulative << '\n';
+        }
+        QString braced = labels.isEmpty() ? QString() : (QLatin1Char('{') + labels + QLatin1Char('}'));
+        out << name << "_sum" << braced << ' ' << histogram.sum / 1000000.0 << '\n';
+        out << name << "_count" << braced << ' ' << histogram.count << '\n';
+    }
+}
+
+/*!
+  Writes every value to \a fileName in the Prometheus text format, as
+  writePrometheus() does. The file is replaced as a whole, so that a
+  collector reading it never sees half of it. Returns false if it can't
+  be written.
+*/
+bool QScriptDebuggerMetrics::dump(const QString &fileName, const QString &prefix) const
+{
+    QString tempName = fileName + QLatin1String(".tmp");
+    QFile file(tempName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+        return false;
+    {
+        QTextStream out(&file);
+        writePrometheus(out, prefix);
+    }
+    file.close();
+    if (file.error() != QFile::NoError) {
+        QFile::remove(tempName);
+        return false;
+    }
+    // QFile::rename() doesn't replace an existing file
+    QFile::remove(fileName);
+    return QFile::rename(tempName, fileName);
+}
@@ -0,0 +1,98 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef QSCRIPTDEBUGGERMETRICS_P_H
+#define QSCRIPTDEBUGGERMETRICS_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/qmap.h>
+#include <QtCore/qmutex.h>
+#include <QtCore/qstring.h>
+#include <QtCore/qvariant.h>
+
+class QTextStream;
+
+// Counters, gauges and latency histograms kept by one side of the
+// protocol. Each value is identified by a metric name and a set of
+// labels, as in the Prometheus text format, e.g.
+// frames_total{direction="sent",type="event"}; writePrometheus() puts
+// the given prefix in front of the names.
+//
+// Times are taken with now(), in microseconds, and reported in seconds.
+// All functions may be called from any thread.
+class QScriptDebuggerMetrics
+{
+public:
+    enum Direction {
+        Sent,
+        Received
+    };
+
+    QScriptDebuggerMetrics();
+    ~QScriptDebuggerMetrics();
+
+    static qint64 now();
+    static QString frameTypeName(quint8 type);
+
+    void addFrame(Direction direction, quint8 type, int size);
+    void increment(const QString &name, const QString &labels = QString(), qint64 amount = 1);
+    void setGauge(const QString &name, const QString &labels, qint64 value);
+    void addTime(const QString &name, const QString &labels, qint64 usecs);
+    void reset();
+
+    QVariantMap values() const;
+    void writePrometheus(QTextStream &out, const QString &prefix) const;
+    bool dump(const QString &fileName, const QString &prefix) const;
+
+private:
+    enum { BucketCount = 13 };
+
+    struct Histogram
+    {
+        Histogram();
+
+        qint64 buckets[BucketCount];
+        qint64 count;
+        qint64 sum; // us
+    };
+
+    static QString key(const QString &name, const QString &labels);
+
+    mutable QMutex m_mutex;
+    // keyed by key(); the name is what comes before the labels
+    QMap<QString, qint64> m_counters;
+    QMap<QString, qint64> m_gauges;
+    QMap<QString, Histogram> m_histograms;
+
+    Q_DISABLE_COPY(QScriptDebuggerMetrics)
+};
+
+#endif
@@ -0,0 +1,420 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "qscriptdebuggerpager_p.h"
+#include "qscriptdebuggerprotocol_p.h"
+
+#include <QtCore/qstringlist.h>
+#include <QtCore/qvariant.h>
+#include <QtScript/qscriptclass.h>
+#include <QtScript/qscriptclasspropertyiterator.h>
+#include <QtScript/qscriptcontext.h>
+#include <QtScript/qscriptengine.h>
+#include <QtScript/qscriptstring.h>
+#include <QtScript/qscriptvalueiterator.h>
+#include <private/qscriptdebuggerbackend_p.h>
+#include <private/qscriptdebuggercommand_p.h>
+#include <private/qscriptdebuggercommandexecutor_p.h>
+#include <private/qscriptdebuggerresponse_p.h>
+#include <private/qscriptdebuggervalue_p.h>
+
+// The class of the range objects of one engine. It is a child of the
+// engine, so that it outlives every object that uses it.
+class QScriptDebuggerRangeClass : public QObject, public QScriptClass
+{
+    Q_OBJECT
+public:
+    QScriptDebuggerRangeClass(QScriptEngine *engine);
+    ~QScriptDebuggerRangeClass();
+
+    QScriptValue newRange(const QScriptValue &target, const QStringList &names,
+                          quint32 offset, quint32 count, bool withLength);
+    void clear();
+
+    int childCount(const QScriptValue &object);
+    QString childName(const QScriptValue &object, int index);
+
+    QueryFlags queryProperty(const QScriptValue &object, const QScriptString &name,
+                             QueryFlags flags, uint *id);
+    QScriptValue property(const QScriptValue &object, const QScriptString &name, uint id);
+    QScriptValue::PropertyFlags propertyFlags(const QScriptValue &object,
+                                              const QScriptString &name, uint id);
+    QScriptClassPropertyIterator *newIterator(const QScriptValue &object);
+    QString name() const;
+
+private:
+    struct Range
+    {
+        QScriptValue target;
+        // the property names of a non-array target; empty for arrays,
+        // whose elements are named by their index
+        QStringList names;
+        quint32 offset;
+        quint32 count;
+        // the number of elements in each child range, or 1 if the
+        // children are the elements themselves
+        quint64 bucketSize;
+        bool withLength;
+        QHash<QString, int> positions;
+        QHash<int, QScriptValue> buckets;
+    };
+
+    Range *range(const QScriptValue &object);
+    static int childCount(const Range &range);
+    static QString childName(const Range &range, int index);
+    int findChild(Range *range, const QString &name);
+
+    QHash<int, Range> m_ranges;
+    int m_nextRangeId;
+};
+
+class QScriptDebuggerRangeIterator : public QScriptClassPropertyIterator
+{
+public:
+    QScriptDebuggerRangeIterator(QScriptDebuggerRangeClass *rangeClass, const QScriptValue &object)
+        : QScriptClassPropertyIterator(object), m_rangeClass(rangeClass),
+          m_count(rangeClass->childCount(object)), m_index(0), m_last(-1) {}
+
+    bool hasNext() const { return m_index < m_count; }
+    void next() { m_last = m_index++; }
+    bool hasPrevious() const { return m_index > 0; }
+    void previous() { m_last = --m_index; }
+    void toFront() { m_index = 0; m_last = -1; }
+    void toBack() { m_index = m_count; m_last = -1; }
+
+    QScriptString name() const
+    {
+        return object().engine()->toStringHandle(m_rangeClass->childName(object(), m_last));
+    }
+    uint id() const { return m_last; }
+
+private:
+    QScriptDebuggerRangeClass *m_rangeClass;
+    int m_count;
+    int m_index;
+    int m_last;
+};
+
+QScriptDebuggerRangeClass::QScriptDebuggerRangeClass(QScriptEngine *engine)
+    : QObject(engine), QScriptClass(engine), m_nextRangeId(0)
+{
+}
+
+QScriptDebuggerRangeClass::~QScriptDebuggerRangeClass()
+{
+}
+
+/*!
+  Returns a new object that shows \a count properties of \a target,
+  starting at \a offset; \a names are the property names of a non-array
+  target. If \a withLength is true, the object also shows the target's
+  length.
+*/
+QScriptValue QScriptDebuggerRangeClass::newRange(const QScriptValue &target, const QStringList &names,
+                                                 quint32 offset, quint32 count, bool withLength)
+{
+    Range range;
+    range.target = target;
+    range.names = names;
+    range.offset = offset;
+    range.count = count;
+    range.bucketSize = 1;
+    while ((count - 1) / range.bucketSize >= QScriptDebuggerPager::PageSize)
+        range.bucketSize *= QScriptDebuggerPager::PageSize;
+    range.withLength = withLength;
+    int id = m_nextRangeId++;
+    m_ranges.insert(id, range);
+    QScriptValue result = engine()->newObject(this, QScriptValue(engine(), id));
+    result.setPrototype(QScriptValue(engine(), QScriptValue::NullValue));
+    return result;
+}
+
+/*!
+  Forgets all ranges; the properties of the range objects that are still
+  around read as undefined.
+*/
+void QScriptDebuggerRangeClass::clear()
+{
+    m_ranges.clear();
+}
+
+QScriptDebuggerRangeClass::Range *QScriptDebuggerRangeClass::range(const QScriptValue &object)
+{
+    QHash<int, Range>::iterator it = m_ranges.find(object.data().toInt32());
+    if (it == m_ranges.end())
+        return 0;
+    return &it.value();
+}
+
+int QScriptDebuggerRangeClass::childCount(const Range &range)
+{
+    int count = int((range.count + range.bucketSize - 1) / range.bucketSize);
+    return range.withLength ? count + 1 : count;
+}
+
+QString QScriptDebuggerRangeClass::childName(const Range &range, int index)
+{
+    if (range.withLength && (index == childCount(range) - 1))
+        return QString::fromLatin1("length");
+    if (range.bucketSize == 1) {
+        if (range.names.isEmpty())
+            return QString::number(range.offset + index);
+        return range.names.at(range.offset + index);
+    }
+    quint64 first = range.offset + index * range.bucketSize;
+    quint64 last = qMin(first + range.bucketSize, quint64(range.offset) + range.count) - 1;
+    return QString::fromLatin1("[%0..%1]").arg(first).arg(last);
+}
+
+int QScriptDebuggerRangeClass::childCount(const QScriptValue &object)
+{
+    Range *r = range(object);
+    return r ? childCount(*r) : 0;
+}
+
+QString QScriptDebuggerRangeClass::childName(const QScriptValue &object, int index)
+{
+    Range *r = range(object);
+    return r ? childName(*r, index) : QString();
+}
+
+/*!
+  Returns the index of the child of \a range called \a name, or -1.
+*/
+int QScriptDebuggerRangeClass::findChild(Range *range, const QString &name)
+{
+    int index = -1;
+    if (range->withLength && (name == QLatin1String("length"))) {
+        index = childCount(*range) - 1;
+    } else if (range->bucketSize != 1) {
+        if (name.startsWith(QLatin1Char('['))) {
+            quint64 first = name.mid(1, name.indexOf(QLatin1Char('.')) - 1).toULongLong();
+            if (first >= range->offset)
+                index = int((first - range->offset) / range->bucketSize);
+        }
+    } else if (range->names.isEmpty()) {
+        bool ok;
+        quint32 element = name.toUInt(&ok);
+        if (ok && (element >= range->offset))
+            index = int(element - range->offset);
+    } else {
+        if (range->positions.isEmpty()) {
+            for (quint32 i = 0; i < range->count; ++i)
+                range->positions.insert(range->names.at(range->offset + i), i);
+        }
+        index = range->positions.value(name, -1);
+    }
+    if ((index < 0) || (index >= childCount(*range)) || (childName(*range, index) != name))
+        return -1;
+    return index;
+}
+
+QScriptClass::QueryFlags QScriptDebuggerRangeClass::queryProperty(
+    const QScriptValue &object, const QScriptString &name, QueryFlags flags, uint *id)
+{
+    Range *r = range(object);
+    if (!r)
+        return 0;
+    int index = findChild(r, name.toString());
+    if (index == -1)
+        return 0;
+    *id = index;
+    return flags & HandlesReadAccess;
+}
+
+QScriptValue QScriptDebuggerRangeClass::property(const QScriptValue &object,
+                                                 const QScriptString &, uint id)
+{
+    Range *r = range(object);
+    if (!r || (int(id) >= childCount(*r)))
+        return QScriptValue();
+    int index = id;
+    if ((r->bucketSize == 1) || (r->withLength && (index == childCount(*r) - 1)))
+        return r->target.property(childName(*r, index));
+    QHash<int, QScriptValue>::const_iterator it = r->buckets.constFind(index);
+    if (it != r->buckets.constEnd())
+        return it.value();
+    quint64 first = r->offset + index * r->bucketSize;
+    quint64 count = qMin(r->bucketSize, quint64(r->offset) + r->count - first);
+    QScriptValue target = r->target;
+    QStringList names = r->names;
+    // newRange() may rehash m_ranges, so r must not be used after it
+    QScriptValue bucket = newRange(target, names, quint32(first), quint32(count), false);
+    m_ranges[object.data().toInt32()].buckets.insert(index, bucket);
+    return bucket;
+}
+
+QScriptValue::PropertyFlags QScriptDebuggerRangeClass::propertyFlags(
+    const QScriptValue &, const QScriptString &, uint)
+{
+    return QScriptValue::ReadOnly | QScriptValue::Undeletable;
+}
+
+QScriptClassPropertyIterator *QScriptDebuggerRangeClass::newIterator(const QScriptValue &object)
+{
+    return new QScriptDebuggerRangeIterator(this, object);
+}
+
+QString QScriptDebuggerRangeClass::name() const
+{
+    return QString::fromLatin1("Range");
+}
+
+QScriptDebuggerPager::QScriptDebuggerPager()
+{
+}
+
+QScriptDebuggerPager::~QScriptDebuggerPager()
+{
+}
+
+/*!
+  Executes \a command with \a backend's command executor, paging the
+  object it refers to or the backtrace it asks for.
+*/
+QScriptDebuggerResponse QScriptDebuggerPager::execute(QScriptDebuggerBackend *backend,
+                                                      const QScriptDebuggerCommand &command)
+{
+    QScriptDebuggerCommandExecutor *executor = backend->commandExecutor();
+    switch (command.type()) {
+    case QScriptDebuggerCommand::ScriptObjectSnapshotCapture:
+    case QScriptDebuggerCommand::NewScriptValueIterator: {
+        QScriptEngine *engine = backend->engine();
+        if (!engine)
+            break;
+        QScriptValue object = command.scriptValue().toScriptValue(engine);
+        QScriptValue paged = pagedObject(engine, object);
+        if (paged.strictlyEquals(object))
+            break;
+        QScriptDebuggerCommand pagedCommand(command);
+        pagedCommand.setScriptValue(QScriptDebuggerValue(paged));
+        return executor->execute(backend, pagedCommand);
+    }
+    case QScriptDebuggerCommand::GetBacktrace:
+        return backtrace(backend, command);
+    default:
+        break;
+    }
+
+    QScriptDebuggerResponse response = executor->execute(backend, command);
+    switch (command.type()) {
+    case QScriptDebuggerCommand::Continue:
+    case QScriptDebuggerCommand::StepInto:
+    case QScriptDebuggerCommand::StepOver:
+    case QScriptDebuggerCommand::StepOut:
+    case QScriptDebuggerCommand::RunToLocation:
+    case QScriptDebuggerCommand::RunToLocationByID:
+    case QScriptDebuggerCommand::ForceReturn:
+    case QScriptDebuggerCommand::Resume:
+        // the objects may change once the target runs
+        clear();
+        break;
+    default:
+        break;
+    }
+    return response;
+}
+
+/*!
+  Returns the page of \a backend's backtrace that \a command asks for.
+  Only the contexts on the page are turned into text; the ones after it
+  are merely counted.
+*/
+QScriptDebuggerResponse QScriptDebuggerPager::backtrace(QScriptDebuggerBackend *backend,
+                                                        const QScriptDebuggerCommand &command)
+{
+    QScriptDebuggerResponse response;
+    int first = qMax(0, command.contextIndex());
+    QVariant countAttribute = command.attribute(QScriptDebuggerCommand::Attribute(
+        QScriptDebuggerProtocol::BacktraceFrameCountAttribute));
+    int count = countAttribute.isValid() ? countAttribute.toInt() : int(PageSize);
+    QScriptContext *context = backend->engine() ? backend->context(first) : 0;
+    if (!context && (first > 0)) {
+        response.setError(QScriptDebuggerResponse::InvalidContextIndex);
+        return response;
+    }
+    QStringList lines;
+    for ( ; context && (lines.size() < count); context = context->parentContext())
+        lines.append(context->toString());
+    int more = 0;
+    for ( ; context; context = context->parentContext())
+        ++more;
+    if (more > 0)
+        lines.append(QString::fromLatin1("... %0 more frame(s)").arg(more));
+    response.setResult(QVariant(lines));
+    return response;
+}
+
+/*!
+  Releases the range objects, so that they and the objects they refer
+  to can be garbage collected.
+*/
+void QScriptDebuggerPager::clear()
+{
+    m_paged.clear();
+    if (m_rangeClass)
+        m_rangeClass->clear();
+}
+
+/*!
+  Returns the range object that stands for \a object, or \a object itself
+  if it has no more than PageSize properties. The elements of an array
+  are paged by index, which leaves out any other properties except
+  length; the properties of other objects are paged in the order in
+  which they are iterated.
+*/
+QScriptValue QScriptDebuggerPager::pagedObject(QScriptEngine *engine, const QScriptValue &object)
+{
+    if (!object.isObject())
+        return object;
+    if (m_rangeClass && (object.scriptClass() == m_rangeClass))
+        return object;
+    QHash<qint64, QScriptValue>::const_iterator it = m_paged.constFind(object.objectId());
+    if (it != m_paged.constEnd())
+        return it.value();
+
+    QStringList names;
+    quint32 count;
+    if (object.isArray()) {
+        count = object.property(QLatin1String("length")).toUInt32();
+    } else {
+        QScriptValueIterator properties(object);
+        while (properties.hasNext()) {
+            properties.next();
+            names.append(properties.name());
+        }
+        count = names.size();
+    }
+    if (count <= PageSize)
+        return object;
+
+    if (!m_rangeClass || (m_rangeClass->engine() != engine)) {
+        clear();
+        m_rangeClass = engine->findChild<QScriptDebuggerRangeClass*>();
+        if (!m_rangeClass)
+            m_rangeClass = new QScriptDebuggerRangeClass(engine);
+    }
+    QScriptValue paged = m_rangeClass->newRange(object, names, 0, count, object.isArray());
+    m_paged.insert(object.objectId(), paged);
+    return paged;
+}
+
+#include "qscriptdebuggerpager.moc"
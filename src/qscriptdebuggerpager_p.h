@@ -0,0 +1,84 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef QSCRIPTDEBUGGERPAGER_P_H
+#define QSCRIPTDEBUGGERPAGER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/qhash.h>
+#include <QtCore/qpointer.h>
+#include <QtScript/qscriptvalue.h>
+
+class QScriptEngine;
+class QScriptDebuggerBackend;
+class QScriptDebuggerCommand;
+class QScriptDebuggerResponse;
+class QScriptDebuggerRangeClass;
+
+// Sits between a backend and its command executor and bounds the work
+// done for a single command while the target is stopped.
+//
+// Objects with more than PageSize properties are replaced by range
+// objects before they are captured or iterated: a range object has at
+// most PageSize properties, which are either properties of the real
+// object or nested ranges named "[first..last]", so the debugger's views
+// fetch a page only when the user expands it. Ranges are kept alive
+// until the target resumes.
+//
+// Backtraces are paged by frame: a GetBacktrace command gets the frames
+// from its context index on, PageSize of them unless it asks for another
+// number (see QScriptDebuggerProtocol::BacktraceFrameCountAttribute),
+// and a last line telling how many are left. Context info is fetched
+// one context at a time already, so every frame can be inspected.
+class QScriptDebuggerPager
+{
+public:
+    enum {
+        PageSize = 100
+    };
+
+    QScriptDebuggerPager();
+    ~QScriptDebuggerPager();
+
+    QScriptDebuggerResponse execute(QScriptDebuggerBackend *backend,
+                                    const QScriptDebuggerCommand &command);
+    void clear();
+
+private:
+    QScriptDebuggerResponse backtrace(QScriptDebuggerBackend *backend,
+                                      const QScriptDebuggerCommand &command);
+    QScriptValue pagedObject(QScriptEngine *engine, const QScriptValue &object);
+
+    QPointer<QScriptDebuggerRangeClass> m_rangeClass;
+    QHash<qint64, QScriptValue> m_paged;
+};
+
+#endif
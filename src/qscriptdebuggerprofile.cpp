@@ -0,0 +1,189 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "qscriptdebuggerprofile_p.h"
+
+#include <QtCore/qiodevice.h>
+#include <QtCore/qstringlist.h>
+
+QScriptDebuggerProfile::QScriptDebuggerProfile()
+    : m_session(0), m_interval(0), m_sampleCount(0)
+{
+}
+
+QScriptDebuggerProfile::~QScriptDebuggerProfile()
+{
+}
+
+/*!
+  Forgets everything and expects chunks of the given \a session from now
+  on.
+*/
+void QScriptDebuggerProfile::reset(quint32 session)
+{
+    m_session = session;
+    m_interval = 0;
+    m_sampleCount = 0;
+    m_frames.clear();
+    m_nodes.clear();
+    m_roots.clear();
+}
+
+/*!
+  Sets all counts to zero. The tree itself is kept, since later chunks of
+  the same session refer to its nodes.
+*/
+void QScriptDebuggerProfile::clearCounts()
+{
+    for (int i = 0; i < m_nodes.size(); ++i) {
+        m_nodes[i].self = 0;
+        m_nodes[i].total = 0;
+    }
+    m_sampleCount = 0;
+}
+
+quint32 QScriptDebuggerProfile::session() const
+{
+    return m_session;
+}
+
+/*!
+  Applies \a chunk to the tree. Returns false if the chunk belongs to
+  another session, in which case it's ignored, or if it doesn't fit the
+  tree built so far; the profile is then incomplete.
+*/
+bool QScriptDebuggerProfile::append(const QScriptDebuggerProfileChunk &chunk)
+{
+    if (chunk.session != m_session)
+        return false;
+    m_interval = chunk.interval;
+    for (int i = 0; i < chunk.frames.size(); ++i)
+        m_frames.insert(chunk.frames.at(i).id, chunk.frames.at(i));
+    for (int i = 0; i < chunk.nodes.size(); ++i) {
+        const QScriptDebuggerProfileNode &node = chunk.nodes.at(i);
+        // ids are handed out in order, starting from 0
+        if ((node.id != m_nodes.size()) || (node.parentId >= node.id))
+            return false;
+        Node n;
+        n.parentId = node.parentId;
+        n.frameId = node.frameId;
+        m_nodes.append(n);
+        if (node.parentId == -1)
+            m_roots.append(node.id);
+        else
+            m_nodes[node.parentId].children.append(node.id);
+    }
+    QMap<qint32, quint32>::const_iterator it;
+    for (it = chunk.hits.constBegin(); it != chunk.hits.constEnd(); ++it) {
+        if ((it.key() < 0) || (it.key() >= m_nodes.size()))
+            return false;
+        m_nodes[it.key()].self += it.value();
+        for (qint32 id = it.key(); id != -1; id = m_nodes.at(id).parentId)
+            m_nodes[id].total += it.value();
+        m_sampleCount += it.value();
+    }
+    return true;
+}
+
+/*!
+  Returns the sampling interval, in milliseconds.
+*/
+int QScriptDebuggerProfile::interval() const
+{
+    return m_interval;
+}
+
+quint32 QScriptDebuggerProfile::sampleCount() const
+{
+    return m_sampleCount;
+}
+
+QList<qint32> QScriptDebuggerProfile::rootNodes() const
+{
+    return m_roots;
+}
+
+QList<qint32> QScriptDebuggerProfile::childNodes(qint32 node) const
+{
+    return m_nodes.value(node).children;
+}
+
+QScriptDebuggerProfileFrame QScriptDebuggerProfile::frame(qint32 node) const
+{
+    return m_frames.value(m_nodes.value(node).frameId);
+}
+
+/*!
+  Returns the number of samples in which \a node was the innermost frame.
+*/
+quint32 QScriptDebuggerProfile::selfCount(qint32 node) const
+{
+    return m_nodes.value(node).self;
+}
+
+/*!
+  Returns the number of samples in which \a node was on the stack.
+*/
+quint32 QScriptDebuggerProfile::totalCount(qint32 node) const
+{
+    return m_nodes.value(node).total;
+}
+
+/*!
+  Returns how \a frame is shown to the user, e.g. "foo (script.js:12)".
+*/
+QString QScriptDebuggerProfile::frameLabel(const QScriptDebuggerProfileFrame &frame)
+{
+    if (frame.fileName.isEmpty())
+        return frame.functionName;
+    if (frame.lineNumber == -1)
+        return QString::fromLatin1("%0 (%1)").arg(frame.functionName).arg(frame.fileName);
+    return QString::fromLatin1("%0 (%1:%2)").arg(frame.functionName)
+        .arg(frame.fileName).arg(frame.lineNumber);
+}
+
+/*!
+  Writes the profile to \a device in the folded stack format read by
+  flamegraph.pl and compatible tools: one line per call stack, outermost
+  frame first, frames separated by semicolons and followed by the number
+  of samples.
+*/
+bool QScriptDebuggerProfile::writeFoldedStacks(QIODevice *device) const
+{
+    for (int i = 0; i < m_nodes.size(); ++i) {
+        if (m_nodes.at(i).self == 0)
+            continue;
+        QStringList stack;
+        for (qint32 id = i; id != -1; id = m_nodes.at(id).parentId) {
+            QString label = frameLabel(m_frames.value(m_nodes.at(id).frameId));
+            label.replace(QLatin1Char(';'), QLatin1Char(':'));
+            label.replace(QLatin1Char('\n'), QLatin1Char(' '));
+            stack.prepend(label);
+        }
+        QByteArray line = stack.join(QLatin1String(";")).toUtf8();
+        line += ' ';
+        line += QByteArray::number(m_nodes.at(i).self);
+        line += '\n';
+        if (device->write(line) != line.size())
+            return false;
+    }
+    return true;
+}
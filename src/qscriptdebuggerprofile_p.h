@@ -0,0 +1,92 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef QSCRIPTDEBUGGERPROFILE_P_H
+#define QSCRIPTDEBUGGERPROFILE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/qhash.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qstring.h>
+#include <QtCore/qvector.h>
+
+#include "qscriptdebuggerprotocol_p.h"
+
+class QIODevice;
+
+// The call tree built from the chunks streamed by a target's profiler
+// (see QScriptDebuggerProfileChunk). Node ids are the ones assigned by the
+// target; a node's total count includes the counts of its descendants.
+class QScriptDebuggerProfile
+{
+public:
+    QScriptDebuggerProfile();
+    ~QScriptDebuggerProfile();
+
+    void reset(quint32 session);
+    void clearCounts();
+    quint32 session() const;
+
+    bool append(const QScriptDebuggerProfileChunk &chunk);
+
+    int interval() const;
+    quint32 sampleCount() const;
+
+    QList<qint32> rootNodes() const;
+    QList<qint32> childNodes(qint32 node) const;
+    QScriptDebuggerProfileFrame frame(qint32 node) const;
+    quint32 selfCount(qint32 node) const;
+    quint32 totalCount(qint32 node) const;
+
+    static QString frameLabel(const QScriptDebuggerProfileFrame &frame);
+    bool writeFoldedStacks(QIODevice *device) const;
+
+private:
+    struct Node
+    {
+        Node() : parentId(-1), frameId(-1), self(0), total(0) {}
+
+        qint32 parentId;
+        qint32 frameId;
+        quint32 self;
+        quint32 total;
+        QList<qint32> children;
+    };
+
+    quint32 m_session;
+    int m_interval;
+    quint32 m_sampleCount;
+    QHash<qint32, QScriptDebuggerProfileFrame> m_frames;
+    QVector<Node> m_nodes;
+    QList<qint32> m_roots;
+};
+
+#endif
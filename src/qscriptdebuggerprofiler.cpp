@@ -0,0 +1,220 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "qscriptdebuggerprofiler_p.h"
+
+#include <QtCore/qthread.h>
+#include <QtCore/qtimer.h>
+#include <QtScript/qscriptcontext.h>
+#include <QtScript/qscriptcontextinfo.h>
+
+class QScriptDebuggerProfilerTicker : public QThread
+{
+public:
+    QScriptDebuggerProfilerTicker(int interval, QAtomicInt *tick)
+        : m_interval(interval), m_tick(tick), m_stopped(0) {}
+
+    void stop()
+    {
+        m_stopped.fetchAndStoreOrdered(1);
+        wait();
+    }
+
+protected:
+    void run()
+    {
+        while (!int(m_stopped)) {
+            msleep(m_interval);
+            m_tick->fetchAndStoreRelaxed(1);
+        }
+    }
+
+private:
+    int m_interval;
+    QAtomicInt *m_tick;
+    QAtomicInt m_stopped;
+};
+
+uint qHash(const QScriptDebuggerProfiler::FrameKey &key)
+{
+    return qHash(key.scriptId) ^ uint(key.lineNumber) ^ qHash(key.functionName);
+}
+
+QScriptDebuggerProfiler::QScriptDebuggerProfiler(QObject *parent)
+    : QObject(parent), m_ticker(0), m_tick(0), m_interval(0),
+      m_session(0), m_sampleCount(0)
+{
+    m_reportTimer = new QTimer(this);
+    m_reportTimer->setInterval(ReportInterval);
+    QObject::connect(m_reportTimer, SIGNAL(timeout()), this, SLOT(report()));
+}
+
+QScriptDebuggerProfiler::~QScriptDebuggerProfiler()
+{
+    // whoever listens for chunks may be half destroyed by now
+    blockSignals(true);
+    stop();
+}
+
+/*!
+  Starts sampling the scripts run by \a engine every \a interval ms. The
+  chunks produced are tagged with \a session. If the profiler is already
+  active, it's stopped first; frame and node ids start over.
+*/
+void QScriptDebuggerProfiler::start(QScriptEngine *engine, int interval, quint32 session)
+{
+    stop();
+    m_engine = engine;
+    m_interval = qMax(1, interval);
+    m_session = session;
+    m_samples.resize(MaxSamples * MaxDepth);
+    m_depths.resize(MaxSamples);
+    m_sampleCount = 0;
+    m_frameIds.clear();
+    m_nodeIds.clear();
+    m_chunk = QScriptDebuggerProfileChunk();
+
+    m_tick.fetchAndStoreOrdered(0);
+    m_ticker = new QScriptDebuggerProfilerTicker(m_interval, &m_tick);
+    m_ticker->start();
+    m_reportAge.start();
+    m_reportTimer->start();
+}
+
+/*!
+  Stops sampling. What has been sampled since the last chunk is
+  reported.
+*/
+void QScriptDebuggerProfiler::stop()
+{
+    if (!m_ticker)
+        return;
+    m_ticker->stop();
+    delete m_ticker;
+    m_ticker = 0;
+    m_reportTimer->stop();
+    report();
+}
+
+bool QScriptDebuggerProfiler::isActive() const
+{
+    return (m_ticker != 0);
+}
+
+/*!
+  Returns the frames, nodes and hits collected since the previous call.
+*/
+QScriptDebuggerProfileChunk QScriptDebuggerProfiler::takeChunk()
+{
+    QScriptDebuggerProfileChunk result = m_chunk;
+    m_chunk = QScriptDebuggerProfileChunk();
+    return result;
+}
+
+void QScriptDebuggerProfiler::report()
+{
+    m_reportAge.start();
+    aggregate();
+    if (m_chunk.isEmpty())
+        return;
+    m_chunk.session = m_session;
+    m_chunk.interval = m_interval;
+    emit chunkReady();
+}
+
+/*!
+  Records the frames on the engine's stack.
+*/
+void QScriptDebuggerProfiler::sample()
+{
+    qint32 *frames = m_samples.data() + m_sampleCount * MaxDepth;
+    int depth = 0;
+    QScriptContext *context = m_engine->currentContext();
+    for ( ; context && (depth < MaxDepth); context = context->parentContext())
+        frames[depth++] = frameId(context);
+    m_depths[m_sampleCount++] = depth;
+    // the report timer can't fire while the engine is busy, so also
+    // check the age of the samples here
+    if ((m_sampleCount == MaxSamples) || (m_reportAge.elapsed() >= ReportInterval))
+        report();
+}
+
+/*!
+  Returns the id of the function that \a context is executing, adding the
+  function to the next chunk if it hasn't been seen before.
+*/
+qint32 QScriptDebuggerProfiler::frameId(QScriptContext *context)
+{
+    QScriptContextInfo info(context);
+    FrameKey key;
+    key.scriptId = info.scriptId();
+    key.lineNumber = info.functionStartLineNumber();
+    key.functionName = info.functionName();
+    QHash<FrameKey, qint32>::const_iterator it = m_frameIds.constFind(key);
+    if (it != m_frameIds.constEnd())
+        return it.value();
+
+    QScriptDebuggerProfileFrame frame;
+    frame.id = m_frameIds.size();
+    frame.functionName = key.functionName;
+    if (frame.functionName.isEmpty()) {
+        if (info.functionType() == QScriptContextInfo::NativeFunction)
+            frame.functionName = QString::fromLatin1("<native>");
+        else if (!context->parentContext())
+            frame.functionName = QString::fromLatin1("<global>");
+        else
+            frame.functionName = QString::fromLatin1("<anonymous>");
+    }
+    frame.fileName = info.fileName();
+    frame.lineNumber = key.lineNumber;
+    m_frameIds.insert(key, frame.id);
+    m_chunk.frames.append(frame);
+    return frame.id;
+}
+
+/*!
+  Folds the buffered samples into the call tree.
+*/
+void QScriptDebuggerProfiler::aggregate()
+{
+    for (int i = 0; i < m_sampleCount; ++i) {
+        const qint32 *frames = m_samples.constData() + i * MaxDepth;
+        qint32 parent = -1;
+        for (int j = m_depths.at(i) - 1; j >= 0; --j) {
+            QPair<qint32, qint32> key(parent, frames[j]);
+            QHash<QPair<qint32, qint32>, qint32>::const_iterator it = m_nodeIds.constFind(key);
+            if (it != m_nodeIds.constEnd()) {
+                parent = it.value();
+                continue;
+            }
+            QScriptDebuggerProfileNode node;
+            node.id = m_nodeIds.size();
+            node.parentId = parent;
+            node.frameId = frames[j];
+            m_nodeIds.insert(key, node.id);
+            m_chunk.nodes.append(node);
+            parent = node.id;
+        }
+        if (parent != -1)
+            ++m_chunk.hits[parent];
+    }
+    m_sampleCount = 0;
+}
@@ -0,0 +1,130 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef QSCRIPTDEBUGGERPROFILER_P_H
+#define QSCRIPTDEBUGGERPROFILER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/qobject.h>
+#include <QtCore/qatomic.h>
+#include <QtCore/qdatetime.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qpair.h>
+#include <QtCore/qpointer.h>
+#include <QtCore/qvector.h>
+#include <QtScript/qscriptengine.h>
+
+#include "qscriptdebuggerprotocol_p.h"
+
+class QScriptContext;
+class QTimer;
+class QScriptDebuggerProfilerTicker;
+
+// A sampling profiler for the scripts run by one engine. While active, a
+// ticker thread raises a flag every interval ms; the next time the
+// engine's position changes (see QScriptDebuggerHookAgent), the frames on
+// the stack are recorded in a fixed-size buffer. Samples are folded into
+// a call tree every ReportInterval ms, or when the buffer is full, and
+// chunkReady() is emitted with what has changed since the previous chunk.
+//
+// Everything except the ticker runs in the engine's thread.
+class QScriptDebuggerProfiler : public QObject
+{
+    Q_OBJECT
+public:
+    QScriptDebuggerProfiler(QObject *parent = 0);
+    ~QScriptDebuggerProfiler();
+
+    void start(QScriptEngine *engine, int interval, quint32 session);
+    void stop();
+    bool isActive() const;
+
+    QScriptDebuggerProfileChunk takeChunk();
+
+    // called on every position change; a plain read first, so that the
+    // common case is as cheap as it gets
+    inline void positionChange()
+    {
+        if (int(m_tick) && m_tick.testAndSetRelaxed(1, 0))
+            sample();
+    }
+
+Q_SIGNALS:
+    void chunkReady();
+
+private Q_SLOTS:
+    void report();
+
+private:
+    enum {
+        MaxSamples = 512,
+        MaxDepth = 64,      // deeper stacks lose their outermost frames
+        ReportInterval = 500 // ms
+    };
+
+    void sample();
+    qint32 frameId(QScriptContext *context);
+    void aggregate();
+
+    struct FrameKey
+    {
+        qint64 scriptId;
+        int lineNumber;
+        QString functionName;
+
+        bool operator==(const FrameKey &other) const
+        {
+            return (scriptId == other.scriptId) && (lineNumber == other.lineNumber)
+                && (functionName == other.functionName);
+        }
+    };
+    friend uint qHash(const FrameKey &key);
+
+    QPointer<QScriptEngine> m_engine;
+    QScriptDebuggerProfilerTicker *m_ticker;
+    QAtomicInt m_tick;
+    QTimer *m_reportTimer;
+    QTime m_reportAge;
+    int m_interval;
+    quint32 m_session;
+
+    QVector<qint32> m_samples; // MaxSamples x MaxDepth frame ids, innermost first
+    QVector<int> m_depths;
+    int m_sampleCount;
+
+    QHash<FrameKey, qint32> m_frameIds;
+    QHash<QPair<qint32, qint32>, qint32> m_nodeIds; // (parent node, frame) -> node
+    QScriptDebuggerProfileChunk m_chunk;
+
+    Q_DISABLE_COPY(QScriptDebuggerProfiler)
+};
+
+#endif
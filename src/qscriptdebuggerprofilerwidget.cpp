@@ -0,0 +1,195 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "qscriptdebuggerprofilerwidget_p.h"
+#include "qscriptdebuggerprofile_p.h"
+
+#include <QtCore/qfile.h>
+#include <QtGui/qboxlayout.h>
+#include <QtGui/qfiledialog.h>
+#include <QtGui/qheaderview.h>
+#include <QtGui/qlabel.h>
+#include <QtGui/qmessagebox.h>
+#include <QtGui/qtoolbutton.h>
+#include <QtGui/qtreewidget.h>
+
+namespace {
+
+enum Column {
+    FunctionColumn,
+    TotalColumn,
+    SelfColumn,
+    ColumnCount
+};
+
+enum {
+    NodeRole = Qt::UserRole + 1
+};
+
+} // namespace
+
+QScriptDebuggerProfilerWidget::QScriptDebuggerProfilerWidget(QWidget *parent)
+    : QWidget(parent), m_profile(0)
+{
+    m_startButton = new QToolButton();
+    m_startButton->setText(tr("Start"));
+    m_stopButton = new QToolButton();
+    m_stopButton->setText(tr("Stop"));
+    m_clearButton = new QToolButton();
+    m_clearButton->setText(tr("Clear"));
+    m_exportButton = new QToolButton();
+    m_exportButton->setText(tr("Export..."));
+    m_summary = new QLabel();
+    QObject::connect(m_startButton, SIGNAL(clicked()), this, SIGNAL(startRequested()));
+    QObject::connect(m_stopButton, SIGNAL(clicked()), this, SIGNAL(stopRequested()));
+    QObject::connect(m_clearButton, SIGNAL(clicked()), this, SIGNAL(clearRequested()));
+    QObject::connect(m_exportButton, SIGNAL(clicked()), this, SLOT(exportProfile()));
+
+    QHBoxLayout *buttons = new QHBoxLayout();
+    buttons->addWidget(m_startButton);
+    buttons->addWidget(m_stopButton);
+    buttons->addWidget(m_clearButton);
+    buttons->addWidget(m_exportButton);
+    buttons->addStretch();
+    buttons->addWidget(m_summary);
+
+    m_tree = new QTreeWidget();
+    m_tree->setColumnCount(ColumnCount);
+    QStringList labels;
+    labels << tr("Function") << tr("Total") << tr("Self");
+    m_tree->setHeaderLabels(labels);
+    m_tree->setUniformRowHeights(true);
+    m_tree->setSortingEnabled(true);
+    m_tree->sortByColumn(TotalColumn, Qt::DescendingOrder);
+    m_tree->header()->setStretchLastSection(false);
+    m_tree->header()->setResizeMode(FunctionColumn, QHeaderView::Stretch);
+
+    QVBoxLayout *vbox = new QVBoxLayout(this);
+    vbox->setMargin(0);
+    vbox->addLayout(buttons);
+    vbox->addWidget(m_tree);
+
+    setProfiling(false);
+}
+
+QScriptDebuggerProfilerWidget::~QScriptDebuggerProfilerWidget()
+{
+}
+
+const QScriptDebuggerProfile *QScriptDebuggerProfilerWidget::profile() const
+{
+    return m_profile;
+}
+
+/*!
+  Shows the given \a profile, which must stay alive until another one is
+  set; 0 shows nothing.
+*/
+void QScriptDebuggerProfilerWidget::setProfile(const QScriptDebuggerProfile *profile)
+{
+    m_profile = profile;
+    m_tree->clear();
+    refresh();
+}
+
+/*!
+  Enables the buttons that make sense when the target is being profiled,
+  if \a profiling is true, or when it isn't.
+*/
+void QScriptDebuggerProfilerWidget::setProfiling(bool profiling)
+{
+    m_startButton->setEnabled(!profiling);
+    m_stopButton->setEnabled(profiling);
+}
+
+/*!
+  Rebuilds the tree from the profile, keeping the expanded items
+  expanded.
+*/
+void QScriptDebuggerProfilerWidget::refresh()
+{
+    QSet<qint32> expanded;
+    QList<QTreeWidgetItem*> items;
+    for (int i = 0; i < m_tree->topLevelItemCount(); ++i)
+        items.append(m_tree->topLevelItem(i));
+    while (!items.isEmpty()) {
+        QTreeWidgetItem *item = items.takeLast();
+        if (!item->isExpanded())
+            continue;
+        expanded.insert(item->data(FunctionColumn, NodeRole).toInt());
+        for (int i = 0; i < item->childCount(); ++i)
+            items.append(item->child(i));
+    }
+
+    m_tree->setUpdatesEnabled(false);
+    m_tree->clear();
+    if (m_profile)
+        addNodes(m_tree->invisibleRootItem(), m_profile->rootNodes(), expanded);
+    m_tree->setUpdatesEnabled(true);
+
+    quint32 samples = m_profile ? m_profile->sampleCount() : 0;
+    if (samples == 0) {
+        m_summary->clear();
+    } else {
+        m_summary->setText(tr("%n sample(s), %0 ms apart", 0, samples)
+                           .arg(m_profile->interval()));
+    }
+    m_exportButton->setEnabled(samples != 0);
+    m_clearButton->setEnabled(samples != 0);
+}
+
+void QScriptDebuggerProfilerWidget::addNodes(QTreeWidgetItem *parent, const QList<qint32> &nodes,
+                                             const QSet<qint32> &expanded)
+{
+    for (int i = 0; i < nodes.size(); ++i) {
+        qint32 node = nodes.at(i);
+        quint32 total = m_profile->totalCount(node);
+        if (total == 0)
+            continue;
+        QTreeWidgetItem *item = new QTreeWidgetItem(parent);
+        item->setText(FunctionColumn, QScriptDebuggerProfile::frameLabel(m_profile->frame(node)));
+        item->setData(FunctionColumn, NodeRole, node);
+        item->setData(TotalColumn, Qt::DisplayRole, total);
+        item->setData(SelfColumn, Qt::DisplayRole, m_profile->selfCount(node));
+        item->setTextAlignment(TotalColumn, Qt::AlignRight);
+        item->setTextAlignment(SelfColumn, Qt::AlignRight);
+        addNodes(item, m_profile->childNodes(node), expanded);
+        if (expanded.contains(node))
+            item->setExpanded(true);
+    }
+}
+
+void QScriptDebuggerProfilerWidget::exportProfile()
+{
+    if (!m_profile)
+        return;
+    QString fileName = QFileDialog::getSaveFileName(
+        this, tr("Export Profile"), QString(),
+        tr("Folded stacks (*.folded);;All files (*)"));
+    if (fileName.isEmpty())
+        return;
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)
+        || !m_profile->writeFoldedStacks(&file)) {
+        QMessageBox::warning(this, tr("Export Profile"),
+                             tr("Could not write %0: %1").arg(fileName).arg(file.errorString()));
+    }
+}
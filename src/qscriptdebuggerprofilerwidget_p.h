@@ -0,0 +1,85 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef QSCRIPTDEBUGGERPROFILERWIDGET_P_H
+#define QSCRIPTDEBUGGERPROFILERWIDGET_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtGui/qwidget.h>
+#include <QtCore/qset.h>
+
+class QScriptDebuggerProfile;
+class QTreeWidget;
+class QTreeWidgetItem;
+class QLabel;
+class QToolButton;
+
+// Shows the call tree of a QScriptDebuggerProfile, with the number of
+// samples spent in each function and in the functions it called. The
+// buttons ask for profiling to be started or stopped through signals;
+// the profile can be exported as folded stacks for flame graph tools.
+class QScriptDebuggerProfilerWidget : public QWidget
+{
+    Q_OBJECT
+public:
+    QScriptDebuggerProfilerWidget(QWidget *parent = 0);
+    ~QScriptDebuggerProfilerWidget();
+
+    const QScriptDebuggerProfile *profile() const;
+    void setProfile(const QScriptDebuggerProfile *profile);
+
+    void setProfiling(bool profiling);
+
+public Q_SLOTS:
+    void refresh();
+
+Q_SIGNALS:
+    void startRequested();
+    void stopRequested();
+    void clearRequested();
+
+private Q_SLOTS:
+    void exportProfile();
+
+private:
+    void addNodes(QTreeWidgetItem *parent, const QList<qint32> &nodes,
+                  const QSet<qint32> &expanded);
+
+    const QScriptDebuggerProfile *m_profile;
+    QTreeWidget *m_tree;
+    QLabel *m_summary;
+    QToolButton *m_startButton;
+    QToolButton *m_stopButton;
+    QToolButton *m_clearButton;
+    QToolButton *m_exportButton;
+};
+
+#endif
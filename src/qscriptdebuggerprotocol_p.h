@@ -0,0 +1,561 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef QSCRIPTDEBUGGERPROTOCOL_P_H
+#define QSCRIPTDEBUGGERPROTOCOL_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/qbytearray.h>
+#include <QtCore/qdatastream.h>
+#include <QtCore/qdatetime.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qmap.h>
+#include <QtCore/qstring.h>
+#include <QtCore/qstringlist.h>
+
+namespace QScriptDebuggerProtocol
+{
+    // Every frame starts with a quint32 block size (not counting the size
+    // field itself), followed by a quint8 frame type and a quint32 channel.
+    // A channel identifies one target QScriptEngine, so that several
+    // engines can share a single connection.
+    enum FrameType {
+        EventFrame = 0,          // backend -> frontend: event
+        ResponseFrame = 1,       // backend -> frontend: qint32 id, response
+        CommandFrame = 2,        // frontend -> backend: qint32 id, command
+        ChannelOpenedFrame = 3,  // backend -> frontend: QString name
+        ChannelClosedFrame = 4,  // backend -> frontend: no payload
+        OutputFrame = 5,         // backend -> frontend: QList<QScriptDebuggerOutputEntry>
+        CommandBatchFrame = 6,   // frontend -> backend: quint32 count, count x (qint32 id, command)
+        ResponseBatchFrame = 7,  // backend -> frontend: quint32 count, count x (qint32 id, response)
+        ScriptHashesFrame = 8,   // backend -> frontend: QList<QScriptDebuggerScriptHash>
+        ProfilerControlFrame = 9, // frontend -> backend: qint32 interval, quint32 session
+        ProfileFrame = 10,       // backend -> frontend: QScriptDebuggerProfileChunk
+        CoverageControlFrame = 11, // frontend -> backend: qint32 interval, quint32 session
+        CoverageFrame = 12,      // backend -> frontend: QScriptDebuggerCoverageChunk
+        HeapSnapshotRequestFrame = 13, // frontend -> backend: quint32 snapshot
+        HeapSnapshotFrame = 14,  // backend -> frontend: QScriptDebuggerHeapSnapshotChunk
+        SessionFrame = 15,       // backend -> frontend: QByteArray token, quint32 received, bool resumed, qint32 grace
+        ResumeRequestFrame = 16, // frontend -> backend: QByteArray token, quint32 received
+        AckFrame = 17,           // both ways: quint32 received
+        DetachFrame = 18,        // frontend -> backend: no payload
+        HeartbeatFrame = 19      // both ways: qint32 interval
+    };
+
+    enum {
+        FrameHeaderSize = sizeof(quint8) + sizeof(quint32)
+    };
+
+    // Set in the type byte of a frame whose payload has been compressed
+    // with qCompress().
+    enum {
+        CompressedFrameFlag = 0x80
+    };
+
+    // A GetBacktrace command can carry the number of frames it wants as
+    // this attribute (QScriptDebuggerCommand::UserAttribute); it gets
+    // the frames from its context index on. The target answers commands
+    // without it with a page of QScriptDebuggerPager::PageSize frames.
+    enum {
+        BacktraceFrameCountAttribute = 1000
+    };
+
+    // The debugger sends the handshake data followed by a quint16
+    // protocol version and a quint32 with the capabilities it wants; the
+    // target replies with the handshake data, the version it speaks and
+    // the capabilities that will be used (the intersection of both sides).
+    //
+    // Version 1 debuggers send the bare handshake data and expect it
+    // echoed back; a target that receives nothing more within
+    // LegacyHandshakeTimeout ms doesn't answer, reports a handshake
+    // error and closes the connection, since version 1 frames have
+    // neither a channel nor a type byte.
+    enum {
+        LegacyProtocolVersion = 1,
+        ProtocolVersion = 2
+    };
+
+    enum Capability {
+        CompressionCapability = 0x1,    // see CompressedFrameFlag
+        CompactEncodingCapability = 0x2, // see QScriptDebuggerCompactEncoding
+        ScriptCacheCapability = 0x4,    // see QScriptDebuggerScriptHash
+        ProfilerCapability = 0x8,       // see QScriptDebuggerProfileChunk
+        CoverageCapability = 0x10,      // see QScriptDebuggerCoverageChunk
+        HeapSnapshotCapability = 0x20,  // see QScriptDebuggerHeapSnapshotChunk
+        SessionResumeCapability = 0x40, // see isControlFrame()
+        HeartbeatCapability = 0x80      // see HeartbeatFrame
+    };
+
+    inline QByteArray handshakeData()
+    { return QByteArray("QtScriptDebug-Handshake"); }
+
+    // A target that accepts observers keeps listening once a debugger
+    // has connected; that one controls the target, and the ones that
+    // connect while it is connected can only observe it. An observer
+    // must speak version 2, and ask for at least the capabilities agreed
+    // on with the controlling debugger; it is answered with exactly
+    // those, so that event, output, script hash, profile, coverage and
+    // channel frames can be encoded once and sent to every debugger as
+    // they are. Responses and heap snapshots only go to the debugger that
+    // asked for them. Commands of an observer that would change the state
+    // of the target, or of the controlling debugger's session, are
+    // answered with ObserverCommandError (a batch that holds one of them
+    // is refused as a whole); its profiler and coverage control frames
+    // are ignored. Object snapshot and script value iterator ids are the
+    // target's, so a command of any debugger that refers to one that
+    // another debugger created is answered with ObserverCommandError as
+    // well; those of an observer are deleted when it goes away.
+    enum {
+        ObserverCommandError = 1001 // QScriptDebuggerResponse::UserError + 1
+    };
+
+    // With the session resume capability, the debugger's first frame is
+    // a ResumeRequestFrame with the token of the session it wants to
+    // resume (empty for a new one) and the number of frames it has
+    // received in that session. The target answers with a SessionFrame
+    // holding the token of the session, the number of frames it has
+    // received from the debugger, whether the session was resumed, and
+    // how long (in ms) it keeps the session once the connection drops.
+    // If it was resumed, each side sends the frames that the other hasn't
+    // received again, exactly as they were sent the first time, and
+    // carries on; the target doesn't announce its channels again.
+    // Otherwise a new session starts as if the capability hadn't been
+    // agreed on.
+    //
+    // Frames are counted from the start of a session, leaving out the
+    // control frames, which manage the connection itself. Each side sends
+    // an AckFrame with the number of frames it has received every
+    // QScriptDebuggerSessionLog::AckInterval frames, so that the other
+    // can forget the frames before. A target keeps a session whose
+    // connection dropped for a grace period; a DetachFrame ends it right
+    // away. Observers never get this capability.
+    inline bool isControlFrame(int type)
+    {
+        return (type == SessionFrame) || (type == ResumeRequestFrame)
+            || (type == AckFrame) || (type == DetachFrame)
+            || (type == HeartbeatFrame);
+    }
+
+    // With the heartbeat capability, the target sends a HeartbeatFrame
+    // with its heartbeat interval (in ms) that often while the debugger
+    // is connected, and the debugger answers each one with a
+    // HeartbeatFrame of its own. Either side closes a connection on which
+    // nothing has arrived for MaxMissedHeartbeats intervals, so that a
+    // debugger that hangs, or a network that partitions, doesn't go
+    // unnoticed. Observers never get this capability.
+    enum {
+        MaxMissedHeartbeats = 3
+    };
+
+    enum {
+        LegacyHandshakeSize = sizeof("QtScriptDebug-Handshake") - 1,
+        HandshakeSize = LegacyHandshakeSize + sizeof(quint16) + sizeof(quint32),
+        LegacyHandshakeTimeout = 250
+    };
+
+    // A breakpoint whose QScriptBreakpointData::data() is a QVariantMap
+    // with one of these kinds doesn't suspend the target. A logpoint
+    // evaluates the "expression" entry in the context that hit the
+    // breakpoint; a tracepoint captures at most "maxFrames" frames of the
+    // backtrace. The result is streamed to the frontend in OutputFrames.
+    inline QString breakpointKindKey()
+    { return QString::fromLatin1("kind"); }
+    inline QString logpointKind()
+    { return QString::fromLatin1("log"); }
+    inline QString tracepointKind()
+    { return QString::fromLatin1("trace"); }
+    inline QString expressionKey()
+    { return QString::fromLatin1("expression"); }
+    inline QString maxFramesKey()
+    { return QString::fromLatin1("maxFrames"); }
+
+    // A coverage file, as written by QScriptDebuggerEngine::writeCoverage(),
+    // is a QDataStream (Qt_4_5) with a quint32 magic and version, followed
+    // by one record per script that has been hit, each introduced by a
+    // quint8 1: QString fileName, qint32 baseLineNumber, qint32 firstLine,
+    // quint32 count and count x quint32 hits for the lines starting at
+    // firstLine. A quint8 0 ends the file.
+    enum {
+        CoverageFileMagic = 0x51534356, // "QSCV"
+        CoverageFileVersion = 1
+    };
+
+    // A trace file, as written by startRecording(), starts with
+    // TraceFileMagic, a quint16 version, a quint16 0 and a quint32 start
+    // time (seconds since the epoch). Records follow back to back, each
+    // one a quint32 data size, a quint8 TraceRecordType, three 0 bytes, a
+    // quint32 time in ms since the trace started and the data, padded
+    // with 0 bytes to a multiple of 4. A frame record holds the frame
+    // exactly as it went over the wire; a handshake record holds the
+    // agreed capabilities as a quint32. All numbers in the file header
+    // and the record headers are little endian, so that the file can be
+    // read in place once it is mapped into memory.
+    enum TraceRecordType {
+        BackendFrameRecord = 0,  // a frame sent by the backend
+        FrontendFrameRecord = 1, // a frame sent by the frontend
+        HandshakeRecord = 2      // a connection has been established
+    };
+
+    inline QByteArray traceFileMagic()
+    { return QByteArray("QSDTRACE"); }
+
+    enum {
+        TraceFileVersion = 1,
+        TraceFileHeaderSize = 8 + sizeof(quint16) + sizeof(quint16) + sizeof(quint32),
+        TraceRecordHeaderSize = sizeof(quint32) + 4 * sizeof(quint8) + sizeof(quint32)
+    };
+}
+
+// One line of output produced on the target without suspending it.
+struct QScriptDebuggerOutputEntry
+{
+    QScriptDebuggerOutputEntry() : type(0), lineNumber(-1) {}
+
+    qint32 type; // QtMsgType
+    QString message;
+    QString fileName;
+    qint32 lineNumber;
+};
+
+inline QDataStream &operator<<(QDataStream &out, const QScriptDebuggerOutputEntry &entry)
+{
+    out << entry.type << entry.message << entry.fileName << entry.lineNumber;
+    return out;
+}
+
+inline QDataStream &operator>>(QDataStream &in, QScriptDebuggerOutputEntry &entry)
+{
+    in >> entry.type >> entry.message >> entry.fileName >> entry.lineNumber;
+    return in;
+}
+
+// Describes a script that the target has loaded. When the script cache
+// capability has been agreed on, the target sends these in a
+// ScriptHashesFrame for the scripts reported as added by a
+// ScriptsCheckpoint or GetScriptsDelta command, ahead of the response.
+// The debugger can then answer GetScriptData commands for scripts it
+// has seen before from its cache, without asking the target.
+struct QScriptDebuggerScriptHash
+{
+    QScriptDebuggerScriptHash() : scriptId(-1), baseLineNumber(-1) {}
+
+    qint64 scriptId;
+    QByteArray hash; // SHA-1 of the UTF-8 encoded contents
+    QString fileName;
+    qint32 baseLineNumber;
+    QDateTime timeStamp;
+};
+
+inline QDataStream &operator<<(QDataStream &out, const QScriptDebuggerScriptHash &script)
+{
+    out << script.scriptId << script.hash << script.fileName
+        << script.baseLineNumber << script.timeStamp;
+    return out;
+}
+
+inline QDataStream &operator>>(QDataStream &in, QScriptDebuggerScriptHash &script)
+{
+    in >> script.scriptId >> script.hash >> script.fileName
+       >> script.baseLineNumber >> script.timeStamp;
+    return in;
+}
+
+// A function that has been seen on the stack by the sampling profiler.
+struct QScriptDebuggerProfileFrame
+{
+    QScriptDebuggerProfileFrame() : id(-1), lineNumber(-1) {}
+
+    qint32 id;
+    QString functionName;
+    QString fileName;
+    qint32 lineNumber; // where the function starts
+};
+
+inline QDataStream &operator<<(QDataStream &out, const QScriptDebuggerProfileFrame &frame)
+{
+    out << frame.id << frame.functionName << frame.fileName << frame.lineNumber;
+    return out;
+}
+
+inline QDataStream &operator>>(QDataStream &in, QScriptDebuggerProfileFrame &frame)
+{
+    in >> frame.id >> frame.functionName >> frame.fileName >> frame.lineNumber;
+    return in;
+}
+
+// A node of the profile's call tree: a frame, called from the node
+// parentId (-1 for the outermost frames).
+struct QScriptDebuggerProfileNode
+{
+    QScriptDebuggerProfileNode() : id(-1), parentId(-1), frameId(-1) {}
+
+    qint32 id;
+    qint32 parentId;
+    qint32 frameId;
+};
+
+inline QDataStream &operator<<(QDataStream &out, const QScriptDebuggerProfileNode &node)
+{
+    out << node.id << node.parentId << node.frameId;
+    return out;
+}
+
+inline QDataStream &operator>>(QDataStream &in, QScriptDebuggerProfileNode &node)
+{
+    in >> node.id >> node.parentId >> node.frameId;
+    return in;
+}
+
+// The samples taken by the target since the previous chunk. When the
+// profiler capability has been agreed on, a ProfilerControlFrame with a
+// non-zero interval makes the target sample the stack of the running
+// script every interval ms, without suspending it; a zero interval
+// stops sampling. The target streams ProfileFrames until then.
+//
+// Frames and nodes are only sent the first time they are seen, so
+// chunks must be applied in order. Ids start over with every session,
+// which is the number given in the ProfilerControlFrame; chunks of an
+// earlier session are to be ignored.
+struct QScriptDebuggerProfileChunk
+{
+    QScriptDebuggerProfileChunk() : session(0), interval(0) {}
+
+    bool isEmpty() const
+    { return frames.isEmpty() && nodes.isEmpty() && hits.isEmpty(); }
+
+    void append(const QScriptDebuggerProfileChunk &other)
+    {
+        session = other.session;
+        interval = other.interval;
+        frames += other.frames;
+        nodes += other.nodes;
+        QMap<qint32, quint32>::const_iterator it;
+        for (it = other.hits.constBegin(); it != other.hits.constEnd(); ++it)
+            hits[it.key()] += it.value();
+    }
+
+    quint32 session;
+    qint32 interval;
+    QList<QScriptDebuggerProfileFrame> frames; // first seen in this chunk
+    QList<QScriptDebuggerProfileNode> nodes;   // first seen in this chunk
+    QMap<qint32, quint32> hits; // node id -> samples with the node innermost
+};
+
+inline QDataStream &operator<<(QDataStream &out, const QScriptDebuggerProfileChunk &chunk)
+{
+    out << chunk.session << chunk.interval << chunk.frames << chunk.nodes << chunk.hits;
+    return out;
+}
+
+inline QDataStream &operator>>(QDataStream &in, QScriptDebuggerProfileChunk &chunk)
+{
+    in >> chunk.session >> chunk.interval >> chunk.frames >> chunk.nodes >> chunk.hits;
+    return in;
+}
+
+// The lines of one script hit since the previous chunk. When the coverage
+// capability has been agreed on, a CoverageControlFrame with a non-zero
+// interval makes the target count how often every line is executed, and
+// send the counts that have changed every interval ms; a zero interval
+// stops it. The first chunk of a session carries the counts collected so
+// far; chunks of an earlier session are to be ignored.
+struct QScriptDebuggerCoverageScript
+{
+    QScriptDebuggerCoverageScript() : scriptId(-1), baseLineNumber(-1) {}
+
+    qint64 scriptId;
+    QString fileName;
+    qint32 baseLineNumber;
+    QMap<qint32, quint32> hits; // line number -> hits since the previous chunk
+};
+
+inline QDataStream &operator<<(QDataStream &out, const QScriptDebuggerCoverageScript &script)
+{
+    out << script.scriptId << script.fileName << script.baseLineNumber << script.hits;
+    return out;
+}
+
+inline QDataStream &operator>>(QDataStream &in, QScriptDebuggerCoverageScript &script)
+{
+    in >> script.scriptId >> script.fileName >> script.baseLineNumber >> script.hits;
+    return in;
+}
+
+struct QScriptDebuggerCoverageChunk
+{
+    QScriptDebuggerCoverageChunk() : session(0) {}
+
+    bool isEmpty() const
+    { return scripts.isEmpty(); }
+
+    void append(const QScriptDebuggerCoverageChunk &other)
+    {
+        session = other.session;
+        for (int i = 0; i < other.scripts.size(); ++i) {
+            const QScriptDebuggerCoverageScript &script = other.scripts.at(i);
+            int j = 0;
+            while ((j < scripts.size()) && (scripts.at(j).scriptId != script.scriptId))
+                ++j;
+            if (j == scripts.size()) {
+                scripts.append(script);
+                continue;
+            }
+            QMap<qint32, quint32>::const_iterator it;
+            for (it = script.hits.constBegin(); it != script.hits.constEnd(); ++it)
+                scripts[j].hits[it.key()] += it.value();
+        }
+    }
+
+    quint32 session;
+    QList<QScriptDebuggerCoverageScript> scripts;
+};
+
+inline QDataStream &operator<<(QDataStream &out, const QScriptDebuggerCoverageChunk &chunk)
+{
+    out << chunk.session << chunk.scripts;
+    return out;
+}
+
+inline QDataStream &operator>>(QDataStream &in, QScriptDebuggerCoverageChunk &chunk)
+{
+    in >> chunk.session >> chunk.scripts;
+    return in;
+}
+
+// An object reached by a heap snapshot. Node 0 is the synthetic root,
+// whose edges lead to the global object and to the objects of the active
+// contexts; the other ids are QScriptValue::objectId()s. The size is an
+// estimate: the object itself, its property slots and the strings held
+// by its properties.
+struct QScriptDebuggerHeapNode
+{
+    enum Type {
+        RootNode,
+        ObjectNode,
+        ArrayNode,
+        FunctionNode,
+        RegExpNode,
+        DateNode,
+        QObjectNode,
+        VariantNode
+    };
+
+    QScriptDebuggerHeapNode() : id(-1), type(ObjectNode), nameIndex(-1), selfSize(0) {}
+
+    qint64 id;
+    quint8 type;
+    qint32 nameIndex; // class or function name, in the string table
+    quint32 selfSize;
+};
+
+inline QDataStream &operator<<(QDataStream &out, const QScriptDebuggerHeapNode &node)
+{
+    out << node.id << node.type << node.nameIndex << node.selfSize;
+    return out;
+}
+
+inline QDataStream &operator>>(QDataStream &in, QScriptDebuggerHeapNode &node)
+{
+    in >> node.id >> node.type >> node.nameIndex >> node.selfSize;
+    return in;
+}
+
+// A reference from one object to another.
+struct QScriptDebuggerHeapEdge
+{
+    enum Type {
+        PropertyEdge,
+        PrototypeEdge,
+        ScopeEdge,
+        RootEdge
+    };
+
+    QScriptDebuggerHeapEdge() : from(-1), to(-1), type(PropertyEdge), nameIndex(-1) {}
+
+    qint64 from;
+    qint64 to;
+    quint8 type;
+    qint32 nameIndex; // property name, in the string table
+};
+
+inline QDataStream &operator<<(QDataStream &out, const QScriptDebuggerHeapEdge &edge)
+{
+    out << edge.from << edge.to << edge.type << edge.nameIndex;
+    return out;
+}
+
+inline QDataStream &operator>>(QDataStream &in, QScriptDebuggerHeapEdge &edge)
+{
+    in >> edge.from >> edge.to >> edge.type >> edge.nameIndex;
+    return in;
+}
+
+// A part of a heap snapshot. When the heap snapshot capability has been
+// agreed on, a HeapSnapshotRequestFrame makes the target walk the objects
+// reachable from its global object and active contexts, and stream what
+// it finds in HeapSnapshotFrames of bounded size, tagged with the number
+// given in the request; the last chunk has last set. The next chunk is
+// only collected once the debugger has read most of the previous ones.
+// A snapshot that the target couldn't finish (the debugger that asked
+// for it went away, or the target was replaced) ends with a chunk that
+// has truncated set as well.
+//
+// Names are sent once, in the chunk that first uses them, and are
+// referred to by their index in the string table of the whole snapshot;
+// so chunks must be applied in order. An edge may refer to a node that
+// only arrives in a later chunk.
+struct QScriptDebuggerHeapSnapshotChunk
+{
+    QScriptDebuggerHeapSnapshotChunk() : snapshot(0), last(false), truncated(false) {}
+
+    quint32 snapshot;
+    bool last;
+    bool truncated; // only with last
+    QStringList strings; // appended to the string table
+    QList<QScriptDebuggerHeapNode> nodes;
+    QList<QScriptDebuggerHeapEdge> edges;
+};
+
+inline QDataStream &operator<<(QDataStream &out, const QScriptDebuggerHeapSnapshotChunk &chunk)
+{
+    out << chunk.snapshot << chunk.last << chunk.truncated
+        << chunk.strings << chunk.nodes << chunk.edges;
+    return out;
+}
+
+inline QDataStream &operator>>(QDataStream &in, QScriptDebuggerHeapSnapshotChunk &chunk)
+{
+    in >> chunk.snapshot >> chunk.last >> chunk.truncated
+       >> chunk.strings >> chunk.nodes >> chunk.edges;
+    return in;
+}
+
+#endif
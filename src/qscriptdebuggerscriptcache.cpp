@@ -0,0 +1,148 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "qscriptdebuggerscriptcache_p.h"
+
+#include <QtCore/qcryptographichash.h>
+#include <QtCore/qdir.h>
+#include <QtCore/qfile.h>
+#include <QtGui/qdesktopservices.h>
+
+QScriptDebuggerScriptCache::QScriptDebuggerScriptCache()
+    : m_hits(0), m_misses(0)
+{
+}
+
+QScriptDebuggerScriptCache::~QScriptDebuggerScriptCache()
+{
+}
+
+/*!
+  Returns the directory used unless another one is set, a subdirectory of
+  the platform's cache location; or an empty string if there is none.
+*/
+QString QScriptDebuggerScriptCache::defaultDirectory()
+{
+    QString location = QDesktopServices::storageLocation(QDesktopServices::CacheLocation);
+    if (location.isEmpty())
+        return QString();
+    return location + QLatin1String("/qtscript-debugger/scripts");
+}
+
+/*!
+  Returns the hash under which \a contents is stored.
+*/
+QByteArray QScriptDebuggerScriptCache::hash(const QString &contents)
+{
+    return QCryptographicHash::hash(contents.toUtf8(), QCryptographicHash::Sha1);
+}
+
+QString QScriptDebuggerScriptCache::directory() const
+{
+    return m_directory;
+}
+
+/*!
+  Sets the directory in which entries are stored to \a path; it is
+  created when the first entry is inserted. An empty \a path disables
+  the cache.
+*/
+void QScriptDebuggerScriptCache::setDirectory(const QString &path)
+{
+    m_directory = path;
+}
+
+bool QScriptDebuggerScriptCache::isEnabled() const
+{
+    return !m_directory.isEmpty();
+}
+
+/*!
+  Looks up the source with the given \a hash. Returns true and stores the
+  source in \a contents if it is in the cache; otherwise returns false.
+*/
+bool QScriptDebuggerScriptCache::lookup(const QByteArray &hash, QString *contents)
+{
+    if (!isEnabled() || hash.isEmpty()) {
+        ++m_misses;
+        return false;
+    }
+    QFile file(fileName(hash));
+    if (!file.open(QIODevice::ReadOnly)) {
+        ++m_misses;
+        return false;
+    }
+    QByteArray utf8 = file.readAll();
+    file.close();
+    if (QCryptographicHash::hash(utf8, QCryptographicHash::Sha1) != hash) {
+        // truncated or tampered with
+        file.remove();
+        ++m_misses;
+        return false;
+    }
+    *contents = QString::fromUtf8(utf8.constData(), utf8.size());
+    ++m_hits;
+    return true;
+}
+
+/*!
+  Stores \a contents under the given \a hash. Returns false if the entry
+  couldn't be written.
+*/
+bool QScriptDebuggerScriptCache::insert(const QByteArray &hash, const QString &contents)
+{
+    if (!isEnabled() || hash.isEmpty())
+        return false;
+    QString name = fileName(hash);
+    if (QFile::exists(name))
+        return true;
+    if (!QDir().mkpath(m_directory))
+        return false;
+    // write to a temporary file first, so that another debugger reading
+    // the same cache never sees a partial entry
+    QString tmpName = name + QLatin1String(".tmp");
+    QFile file(tmpName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    QByteArray utf8 = contents.toUtf8();
+    bool ok = (file.write(utf8) == utf8.size());
+    file.close();
+    if (!ok || !file.rename(name)) {
+        file.remove();
+        return QFile::exists(name);
+    }
+    return true;
+}
+
+int QScriptDebuggerScriptCache::hits() const
+{
+    return m_hits;
+}
+
+int QScriptDebuggerScriptCache::misses() const
+{
+    return m_misses;
+}
+
+QString QScriptDebuggerScriptCache::fileName(const QByteArray &hash) const
+{
+    return m_directory + QLatin1Char('/') + QString::fromLatin1(hash.toHex());
+}
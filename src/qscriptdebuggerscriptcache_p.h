@@ -0,0 +1,72 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef QSCRIPTDEBUGGERSCRIPTCACHE_P_H
+#define QSCRIPTDEBUGGERSCRIPTCACHE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/qbytearray.h>
+#include <QtCore/qstring.h>
+
+// An on-disk store of script sources, keyed by the SHA-1 hash of their
+// UTF-8 encoded contents (see QScriptDebuggerProtocol::ScriptHashesFrame).
+// Every entry is a file in the cache directory named after the hex form
+// of its hash. Entries are never invalidated, since a hash can only ever
+// name one source; an entry whose contents no longer match its name is
+// treated as a miss and removed.
+class QScriptDebuggerScriptCache
+{
+public:
+    QScriptDebuggerScriptCache();
+    ~QScriptDebuggerScriptCache();
+
+    static QString defaultDirectory();
+    static QByteArray hash(const QString &contents);
+
+    QString directory() const;
+    void setDirectory(const QString &path);
+    bool isEnabled() const;
+
+    bool lookup(const QByteArray &hash, QString *contents);
+    bool insert(const QByteArray &hash, const QString &contents);
+
+    int hits() const;
+    int misses() const;
+
+private:
+    QString fileName(const QByteArray &hash) const;
+
+    QString m_directory;
+    int m_hits;
+    int m_misses;
+};
+
+#endif
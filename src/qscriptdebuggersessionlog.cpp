@@ -0,0 +1,139 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "qscriptdebuggersessionlog_p.h"
+#include "qscriptdebuggerprotocol_p.h"
+
+#include <QtCore/qendian.h>
+#include <QtCore/qiodevice.h>
+
+QScriptDebuggerSessionLog::QScriptDebuggerSessionLog()
+    : m_size(0), m_sent(0), m_received(0), m_acknowledged(0)
+{
+}
+
+QScriptDebuggerSessionLog::~QScriptDebuggerSessionLog()
+{
+}
+
+/*!
+  Forgets everything, for a new session.
+*/
+void QScriptDebuggerSessionLog::reset()
+{
+    m_frames.clear();
+    m_size = 0;
+    m_sent = 0;
+    m_received = 0;
+    m_acknowledged = 0;
+}
+
+/*!
+  Records the \a size bytes of whole frames at \a data, as they are
+  written to the peer.
+*/
+void QScriptDebuggerSessionLog::recordSent(const char *data, int size)
+{
+    const int headerSize = int(sizeof(quint32)) + QScriptDebuggerProtocol::FrameHeaderSize;
+    while (size >= headerSize) {
+        int frameSize = int(sizeof(quint32))
+                        + int(qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(data)));
+        Q_ASSERT(frameSize <= size);
+        quint8 type = quint8(data[sizeof(quint32)]) & ~QScriptDebuggerProtocol::CompressedFrameFlag;
+        if (!QScriptDebuggerProtocol::isControlFrame(type)) {
+            m_frames.append(QByteArray(data, frameSize));
+            m_size += frameSize;
+            ++m_sent;
+        }
+        data += frameSize;
+        size -= frameSize;
+    }
+    while ((m_size > MaxLogSize) && !m_frames.isEmpty())
+        m_size -= m_frames.takeFirst().size();
+}
+
+quint32 QScriptDebuggerSessionLog::sentCount() const
+{
+    return m_sent;
+}
+
+/*!
+  Forgets the frames up to and including frame \a count, which the peer
+  has received.
+*/
+void QScriptDebuggerSessionLog::acknowledge(quint32 count)
+{
+    quint32 first = m_sent - quint32(m_frames.size()) + 1;
+    while (!m_frames.isEmpty() && (first <= count)) {
+        m_size -= m_frames.takeFirst().size();
+        ++first;
+    }
+}
+
+/*!
+  Returns true if the frames after frame \a count, which is the last
+  one the peer has received, are all still there.
+*/
+bool QScriptDebuggerSessionLog::canReplay(quint32 count) const
+{
+    quint32 first = m_sent - quint32(m_frames.size()) + 1;
+    return (count <= m_sent) && (count + 1 >= first);
+}
+
+/*!
+  Writes the frames after frame \a count to \a device again. canReplay()
+  must have returned true for \a count.
+*/
+void QScriptDebuggerSessionLog::replay(quint32 count, QIODevice *device) const
+{
+    Q_ASSERT(canReplay(count));
+    quint32 first = m_sent - quint32(m_frames.size()) + 1;
+    for (int i = int(count + 1 - first); i < m_frames.size(); ++i)
+        device->write(m_frames.at(i));
+}
+
+/*!
+  Counts a frame received from the peer; the caller leaves out control
+  frames.
+*/
+void QScriptDebuggerSessionLog::recordReceived()
+{
+    ++m_received;
+}
+
+quint32 QScriptDebuggerSessionLog::receivedCount() const
+{
+    return m_received;
+}
+
+/*!
+  Returns true if enough frames have been received since the last
+  acknowledgement to send another one.
+*/
+bool QScriptDebuggerSessionLog::needsAcknowledgement() const
+{
+    return (m_received - m_acknowledged) >= quint32(AckInterval);
+}
+
+void QScriptDebuggerSessionLog::setAcknowledged()
+{
+    m_acknowledged = m_received;
+}
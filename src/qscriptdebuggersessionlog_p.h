@@ -0,0 +1,85 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef QSCRIPTDEBUGGERSESSIONLOG_P_H
+#define QSCRIPTDEBUGGERSESSIONLOG_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/qbytearray.h>
+#include <QtCore/qlist.h>
+
+class QIODevice;
+
+// One side's record of a resumable session (see
+// QScriptDebuggerProtocol::SessionResumeCapability): the frames it has
+// sent that the peer hasn't acknowledged yet, and the number of frames it
+// has received. Frames are counted from 1 in the order they are sent;
+// control frames aren't counted.
+//
+// At most MaxLogSize bytes of frames are kept. Once older frames have
+// been dropped to make room, a peer that hasn't received them can't
+// resume the session.
+class QScriptDebuggerSessionLog
+{
+public:
+    enum {
+        MaxLogSize = 8 * 1024 * 1024,
+        AckInterval = 32
+    };
+
+    QScriptDebuggerSessionLog();
+    ~QScriptDebuggerSessionLog();
+
+    void reset();
+
+    // sending
+    void recordSent(const char *data, int size);
+    quint32 sentCount() const;
+    void acknowledge(quint32 count);
+    bool canReplay(quint32 count) const;
+    void replay(quint32 count, QIODevice *device) const;
+
+    // receiving
+    void recordReceived();
+    quint32 receivedCount() const;
+    bool needsAcknowledgement() const;
+    void setAcknowledged();
+
+private:
+    // the last m_frames.size() frames sent, as they went over the wire
+    QList<QByteArray> m_frames;
+    int m_size;
+    quint32 m_sent;
+    quint32 m_received;
+    quint32 m_acknowledged;
+};
+
+#endif
@@ -0,0 +1,123 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "qscriptdebuggersessionswidget_p.h"
+
+#include <QtGui/qboxlayout.h>
+#include <QtGui/qlistwidget.h>
+
+namespace {
+
+enum {
+    SessionRole = Qt::UserRole + 1,
+    NameRole,
+    SuspendedRole
+};
+
+} // namespace
+
+QScriptDebuggerSessionsWidget::QScriptDebuggerSessionsWidget(QWidget *parent)
+    : QWidget(parent), m_updating(false)
+{
+    m_list = new QListWidget();
+    m_list->setUniformItemSizes(true);
+    QObject::connect(m_list, SIGNAL(currentItemChanged(QListWidgetItem*,QListWidgetItem*)),
+                     this, SLOT(onCurrentItemChanged(QListWidgetItem*)));
+
+    QVBoxLayout *vbox = new QVBoxLayout(this);
+    vbox->setMargin(0);
+    vbox->addWidget(m_list);
+}
+
+QScriptDebuggerSessionsWidget::~QScriptDebuggerSessionsWidget()
+{
+}
+
+/*!
+  Adds the session \a id under the given \a name, or renames it if it
+  is already listed.
+*/
+void QScriptDebuggerSessionsWidget::addSession(int id, const QString &name)
+{
+    QListWidgetItem *it = item(id);
+    if (!it) {
+        it = new QListWidgetItem();
+        it->setData(SessionRole, id);
+        it->setData(SuspendedRole, false);
+        m_updating = true;
+        m_list->addItem(it);
+        m_updating = false;
+    }
+    it->setData(NameRole, name);
+    updateItem(it);
+}
+
+void QScriptDebuggerSessionsWidget::removeSession(int id)
+{
+    m_updating = true;
+    delete item(id);
+    m_updating = false;
+}
+
+void QScriptDebuggerSessionsWidget::setSessionSuspended(int id, bool suspended)
+{
+    QListWidgetItem *it = item(id);
+    if (!it)
+        return;
+    it->setData(SuspendedRole, suspended);
+    updateItem(it);
+}
+
+/*!
+  Selects the session \a id, without asking for it to be made current.
+*/
+void QScriptDebuggerSessionsWidget::setCurrentSession(int id)
+{
+    m_updating = true;
+    m_list->setCurrentItem(item(id));
+    m_updating = false;
+}
+
+void QScriptDebuggerSessionsWidget::onCurrentItemChanged(QListWidgetItem *current)
+{
+    if (!m_updating && current)
+        emit currentSessionRequested(current->data(SessionRole).toInt());
+}
+
+QListWidgetItem *QScriptDebuggerSessionsWidget::item(int id) const
+{
+    for (int i = 0; i < m_list->count(); ++i) {
+        QListWidgetItem *it = m_list->item(i);
+        if (it->data(SessionRole).toInt() == id)
+            return it;
+    }
+    return 0;
+}
+
+void QScriptDebuggerSessionsWidget::updateItem(QListWidgetItem *item)
+{
+    QString name = item->data(NameRole).toString();
+    if (name.isEmpty())
+        name = tr("Session %0").arg(item->data(SessionRole).toInt());
+    if (item->data(SuspendedRole).toBool())
+        name = tr("%0 (suspended)").arg(name);
+    item->setText(name);
+}
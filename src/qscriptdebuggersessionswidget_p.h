@@ -0,0 +1,71 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef QSCRIPTDEBUGGERSESSIONSWIDGET_P_H
+#define QSCRIPTDEBUGGERSESSIONSWIDGET_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtGui/qwidget.h>
+
+class QListWidget;
+class QListWidgetItem;
+
+// Lists the sessions of a debugger that is attached to several engines,
+// possibly of several targets, and shows which are suspended. Picking a
+// session only asks for it to be made current; the debugger then calls
+// setCurrentSession().
+class QScriptDebuggerSessionsWidget : public QWidget
+{
+    Q_OBJECT
+public:
+    QScriptDebuggerSessionsWidget(QWidget *parent = 0);
+    ~QScriptDebuggerSessionsWidget();
+
+    void addSession(int id, const QString &name);
+    void removeSession(int id);
+    void setSessionSuspended(int id, bool suspended);
+    void setCurrentSession(int id);
+
+Q_SIGNALS:
+    void currentSessionRequested(int id);
+
+private Q_SLOTS:
+    void onCurrentItemChanged(QListWidgetItem *current);
+
+private:
+    QListWidgetItem *item(int id) const;
+    void updateItem(QListWidgetItem *item);
+
+    QListWidget *m_list;
+    bool m_updating;
+};
+
+#endif
@@ -0,0 +1,132 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef QSCRIPTDEBUGGERSPSCQUEUE_P_H
+#define QSCRIPTDEBUGGERSPSCQUEUE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/qatomic.h>
+
+// A bounded, lock-free queue with exactly one producer thread and one
+// consumer thread. One slot is always left empty so that a full queue
+// can be told apart from an empty one.
+template <typename T>
+class QScriptDebuggerSpscQueue
+{
+public:
+    explicit QScriptDebuggerSpscQueue(int capacity = 256);
+    ~QScriptDebuggerSpscQueue();
+
+    // producer side
+    bool enqueue(const T &value);
+    bool isFull() const;
+
+    // consumer side
+    bool dequeue(T *value);
+    bool isEmpty() const;
+
+private:
+    T *m_items;
+    int m_mask;
+    QAtomicInt m_head; // next slot to read; written by the consumer only
+    QAtomicInt m_tail; // next slot to write; written by the producer only
+
+    Q_DISABLE_COPY(QScriptDebuggerSpscQueue)
+};
+
+template <typename T>
+QScriptDebuggerSpscQueue<T>::QScriptDebuggerSpscQueue(int capacity)
+    : m_head(0), m_tail(0)
+{
+    int size = 2;
+    while (size < capacity)
+        size <<= 1;
+    m_items = new T[size];
+    m_mask = size - 1;
+}
+
+template <typename T>
+QScriptDebuggerSpscQueue<T>::~QScriptDebuggerSpscQueue()
+{
+    delete[] m_items;
+}
+
+/*!
+  Appends \a value to the queue. Returns false if the queue is full.
+*/
+template <typename T>
+bool QScriptDebuggerSpscQueue<T>::enqueue(const T &value)
+{
+    int tail = m_tail;
+    int next = (tail + 1) & m_mask;
+    if (next == m_head.fetchAndAddAcquire(0))
+        return false;
+    m_items[tail] = value;
+    m_tail.fetchAndStoreRelease(next);
+    return true;
+}
+
+/*!
+  Takes the first value off the queue and stores it in \a value.
+  Returns false if the queue is empty.
+*/
+template <typename T>
+bool QScriptDebuggerSpscQueue<T>::dequeue(T *value)
+{
+    int head = m_head;
+    if (head == m_tail.fetchAndAddAcquire(0))
+        return false;
+    *value = m_items[head];
+    // don't keep implicitly shared data alive in the free slot
+    m_items[head] = T();
+    m_head.fetchAndStoreRelease((head + 1) & m_mask);
+    return true;
+}
+
+/*!
+  Returns true if the next enqueue() would fail. Only meaningful when
+  called by the producer.
+*/
+template <typename T>
+bool QScriptDebuggerSpscQueue<T>::isFull() const
+{
+    int next = (int(m_tail) + 1) & m_mask;
+    return (next == const_cast<QAtomicInt&>(m_head).fetchAndAddAcquire(0));
+}
+
+template <typename T>
+bool QScriptDebuggerSpscQueue<T>::isEmpty() const
+{
+    return (const_cast<QAtomicInt&>(m_head).fetchAndAddAcquire(0)
+            == const_cast<QAtomicInt&>(m_tail).fetchAndAddAcquire(0));
+}
+
+#endif
@@ -0,0 +1,496 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "qscriptdebuggertrace_p.h"
+#include "qscriptdebuggerprotocol_p.h"
+
+#include <QtCore/qendian.h>
+#include <QtCore/qiodevice.h>
+
+#include <string.h>
+
+QScriptDebuggerTraceWriter::QScriptDebuggerTraceWriter(Side side)
+    : m_side(side)
+{
+}
+
+QScriptDebuggerTraceWriter::~QScriptDebuggerTraceWriter()
+{
+}
+
+/*!
+  Creates the trace file \a fileName, replacing any existing file, and
+  writes its header. Returns false if the file can't be written.
+*/
+bool QScriptDebuggerTraceWriter::open(const QString &fileName)
+{
+    close();
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    uchar header[QScriptDebuggerProtocol::TraceFileHeaderSize];
+    QByteArray magic = QScriptDebuggerProtocol::traceFileMagic();
+    memcpy(header, magic.constData(), magic.size());
+    qToLittleEndian<quint16>(QScriptDebuggerProtocol::TraceFileVersion, header + 8);
+    qToLittleEndian<quint16>(0, header + 10);
+    qToLittleEndian<quint32>(QDateTime::currentDateTime().toTime_t(), header + 12);
+    if ((m_file.write(reinterpret_cast<const char*>(header), sizeof(header)) != sizeof(header))
+        || !m_file.flush()) {
+        m_file.close();
+        return false;
+    }
+    m_clock.start();
+    return true;
+}
+
+void QScriptDebuggerTraceWriter::close()
+{
+    if (m_file.isOpen())
+        m_file.close();
+}
+
+bool QScriptDebuggerTraceWriter::isOpen() const
+{
+    return m_file.isOpen();
+}
+
+QString QScriptDebuggerTraceWriter::errorString() const
+{
+    return m_file.errorString();
+}
+
+/*!
+  Records that a connection has been established with the given
+  \a capabilities; the frames that follow belong to that connection.
+*/
+void QScriptDebuggerTraceWriter::writeHandshake(quint32 capabilities)
+{
+    uchar field[sizeof(quint32)];
+    qToLittleEndian<quint32>(capabilities, field);
+    writeRecord(QScriptDebuggerProtocol::HandshakeRecord,
+                reinterpret_cast<const char*>(field), sizeof(field));
+}
+
+/*!
+  Records the \a size bytes of a frame that is being sent, as they go
+  over the wire.
+*/
+void QScriptDebuggerTraceWriter::writeSentFrame(const char *data, int size)
+{
+    writeRecord(m_side == BackendSide ? QScriptDebuggerProtocol::BackendFrameRecord
+                                      : QScriptDebuggerProtocol::FrontendFrameRecord,
+                data, size);
+}
+
+void QScriptDebuggerTraceWriter::writeReceivedFrame(const char *data, int size)
+{
+    writeRecord(m_side == BackendSide ? QScriptDebuggerProtocol::FrontendFrameRecord
+                                      : QScriptDebuggerProtocol::BackendFrameRecord,
+                data, size);
+}
+
+void QScriptDebuggerTraceWriter::writeRecord(quint8 type, const char *data, int size)
+{
+    if (!m_file.isOpen())
+        return;
+    int padding = (4 - (size & 3)) & 3;
+    // one write per record, so that a record is either complete or at the
+    // end of the file
+    m_buffer.resize(QScriptDebuggerProtocol::TraceRecordHeaderSize + size + padding);
+    uchar *header = reinterpret_cast<uchar*>(m_buffer.data());
+    qToLittleEndian<quint32>(size, header);
+    header[4] = type;
+    header[5] = header[6] = header[7] = 0;
+    qToLittleEndian<quint32>(m_clock.elapsed(), header + 8);
+    memcpy(m_buffer.data() + QScriptDebuggerProtocol::TraceRecordHeaderSize, data, size);
+    memset(m_buffer.data() + QScriptDebuggerProtocol::TraceRecordHeaderSize + size, 0, padding);
+    if ((m_file.write(m_buffer) != m_buffer.size()) || !m_file.flush()) {
+        qWarning("QScriptDebugger: writing to %s failed (%s); recording stopped",
+                 qPrintable(m_file.fileName()), qPrintable(m_file.errorString()));
+        m_file.close();
+    }
+}
+
+QScriptDebuggerTraceReader::QScriptDebuggerTraceReader()
+    : m_data(0), m_size(0), m_pos(0), m_startTime(0)
+{
+}
+
+QScriptDebuggerTraceReader::~QScriptDebuggerTraceReader()
+{
+    close();
+}
+
+/*!
+  Opens the trace file \a fileName and checks its header. Returns false
+  if it isn't a trace file of a version that can be read.
+*/
+bool QScriptDebuggerTraceReader::open(const QString &fileName)
+{
+    close();
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        m_errorString = m_file.errorString();
+        return false;
+    }
+    m_size = m_file.size();
+    m_data = m_file.map(0, m_size);
+    if (!m_data) {
+        // e.g. a pipe, or a file system that can't map
+        m_contents = m_file.readAll();
+        m_data = reinterpret_cast<const uchar*>(m_contents.constData());
+        m_size = m_contents.size();
+    }
+    QByteArray magic = QScriptDebuggerProtocol::traceFileMagic();
+    if ((m_size < QScriptDebuggerProtocol::TraceFileHeaderSize)
+        || (memcmp(m_data, magic.constData(), magic.size()) != 0)) {
+        m_errorString = QString::fromLatin1("%0 is not a trace file").arg(fileName);
+        close();
+        return false;
+    }
+    quint16 version = qFromLittleEndian<quint16>(m_data + 8);
+    if (version != QScriptDebuggerProtocol::TraceFileVersion) {
+        m_errorString = QString::fromLatin1("%0 has unsupported version %1").arg(fileName).arg(version);
+        close();
+        return false;
+    }
+    m_startTime = qFromLittleEndian<quint32>(m_data + 12);
+    m_pos = QScriptDebuggerProtocol::TraceFileHeaderSize;
+    return true;
+}
+
+void QScriptDebuggerTraceReader::close()
+{
+    if (m_data && m_contents.isEmpty())
+        m_file.unmap(const_cast<uchar*>(m_data));
+    m_file.close();
+    m_contents = QByteArray();
+    m_data = 0;
+    m_size = 0;
+    m_pos = 0;
+}
+
+QString QScriptDebuggerTraceReader::errorString() const
+{
+    return m_errorString;
+}
+
+/*!
+  Returns the time at which the trace was started.
+*/
+QDateTime QScriptDebuggerTraceReader::startTime() const
+{
+    return QDateTime::fromTime_t(m_startTime);
+}
+
+/*!
+  Reads the next record into \a record, whose data points into the
+  reader's memory and stays valid until the reader is closed. Returns
+  false at the end of the trace.
+*/
+bool QScriptDebuggerTraceReader::readRecord(Record *record)
+{
+    if (m_size - m_pos < QScriptDebuggerProtocol::TraceRecordHeaderSize)
+        return false;
+    const uchar *header = m_data + m_pos;
+    quint32 size = qFromLittleEndian<quint32>(header);
+    qint64 padded = (qint64(size) + 3) & ~qint64(3);
+    if (m_size - m_pos - QScriptDebuggerProtocol::TraceRecordHeaderSize < padded)
+        return false;
+    record->type = header[4];
+    record->time = qFromLittleEndian<quint32>(header + 8);
+    record->data = reinterpret_cast<const char*>(header) + QScriptDebuggerProtocol::TraceRecordHeaderSize;
+    record->size = int(size);
+    m_pos += QScriptDebuggerProtocol::TraceRecordHeaderSize + padded;
+    return true;
+}
+
+/*!
+  Goes back to the first record.
+*/
+void QScriptDebuggerTraceReader::rewind()
+{
+    if (m_data)
+        m_pos = QScriptDebuggerProtocol::TraceFileHeaderSize;
+}
+
+QScriptDebuggerTracePlayer::QScriptDebuggerTracePlayer(QObject *parent)
+    : QObject(parent), m_hasNext(false), m_capabilities(0), m_baseTime(0),
+      m_fullSpeed(false), m_framesPlayed(0)
+{
+    m_timer = new QTimer(this);
+    m_timer->setSingleShot(true);
+    QObject::connect(m_timer, SIGNAL(timeout()), this, SLOT(play()));
+}
+
+QScriptDebuggerTracePlayer::~QScriptDebuggerTracePlayer()
+{
+}
+
+/*!
+  Opens the trace file \a fileName. Returns false if it can't be read or
+  doesn't contain a session.
+*/
+bool QScriptDebuggerTracePlayer::open(const QString &fileName)
+{
+    stop();
+    if (!m_reader.open(fileName))
+        return false;
+    if (!findHandshake()) {
+        m_reader.close();
+        return false;
+    }
+    return true;
+}
+
+QString QScriptDebuggerTracePlayer::errorString() const
+{
+    return m_reader.errorString();
+}
+
+/*!
+  Returns the capabilities agreed on in the session that is played.
+*/
+quint32 QScriptDebuggerTracePlayer::capabilities() const
+{
+    return m_capabilities;
+}
+
+bool QScriptDebuggerTracePlayer::isFullSpeed() const
+{
+    return m_fullSpeed;
+}
+
+void QScriptDebuggerTracePlayer::setFullSpeed(bool fullSpeed)
+{
+    m_fullSpeed = fullSpeed;
+}
+
+/*!
+  Starts playing the session from its beginning.
+*/
+void QScriptDebuggerTracePlayer::start()
+{
+    stop();
+    m_reader.rewind();
+    if (!findHandshake())
+        return;
+    m_framesPlayed = 0;
+    m_clock.start();
+    m_hasNext = m_reader.readRecord(&m_next);
+    m_timer->start(0);
+}
+
+void QScriptDebuggerTracePlayer::stop()
+{
+    m_timer->stop();
+    m_hasNext = false;
+}
+
+int QScriptDebuggerTracePlayer::framesPlayed() const
+{
+    return m_framesPlayed;
+}
+
+bool QScriptDebuggerTracePlayer::findHandshake()
+{
+    QScriptDebuggerTraceReader::Record record;
+    while (m_reader.readRecord(&record)) {
+        if ((record.type == QScriptDebuggerProtocol::HandshakeRecord)
+            && (record.size == int(sizeof(quint32)))) {
+            m_capabilities = qFromLittleEndian<quint32>(reinterpret_cast<const uchar*>(record.data));
+            m_baseTime = record.time;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*!
+  Emits the frames that are due, and schedules the next call.
+*/
+void QScriptDebuggerTracePlayer::play()
+{
+    int elapsed = m_clock.elapsed();
+    while (m_hasNext && (m_next.type != QScriptDebuggerProtocol::HandshakeRecord)) {
+        if (m_next.type == QScriptDebuggerProtocol::BackendFrameRecord) {
+            if (!m_fullSpeed) {
+                int due = int(m_next.time - m_baseTime);
+                if (due > elapsed) {
+                    m_timer->start(due - elapsed);
+                    return;
+                }
+            }
+            emit frameReady(m_next.data, m_next.size);
+            ++m_framesPlayed;
+        }
+        m_hasNext = m_reader.readRecord(&m_next);
+        if (m_fullSpeed && m_hasNext) {
+            m_timer->start(0);
+            return;
+        }
+    }
+    m_hasNext = false;
+    emit finished();
+}
+
+// Hands the played frames to the debugger's connection, and swallows
+// what the connection writes.
+class QScriptDebuggerReplayDevice : public QIODevice
+{
+public:
+    QScriptDebuggerReplayDevice(QObject *parent)
+        : QIODevice(parent), m_pos(0)
+    { open(QIODevice::ReadWrite | QIODevice::Unbuffered); }
+
+    bool isSequential() const
+    { return true; }
+    qint64 bytesAvailable() const
+    { return (m_buffer.size() - m_pos) + QIODevice::bytesAvailable(); }
+
+    void append(const char *data, int size)
+    {
+        if (m_pos == m_buffer.size()) {
+            m_buffer.resize(0);
+            m_pos = 0;
+        }
+        m_buffer.append(data, size);
+    }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize)
+    {
+        int size = int(qMin<qint64>(maxSize, m_buffer.size() - m_pos));
+        memcpy(data, m_buffer.constData() + m_pos, size);
+        m_pos += size;
+        return size;
+    }
+    qint64 writeData(const char *, qint64 size)
+    { return size; }
+
+private:
+    QByteArray m_buffer;
+    int m_pos;
+};
+
+QScriptDebuggerReplayTransport::QScriptDebuggerReplayTransport(QObject *parent)
+    : QScriptDebuggerTransport(parent), m_device(0)
+{
+    m_player = new QScriptDebuggerTracePlayer(this);
+    QObject::connect(m_player, SIGNAL(frameReady(const char*,int)),
+                     this, SLOT(onFrameReady(const char*,int)));
+    QObject::connect(m_player, SIGNAL(finished()), this, SIGNAL(finished()));
+}
+
+QScriptDebuggerReplayTransport::~QScriptDebuggerReplayTransport()
+{
+}
+
+bool QScriptDebuggerReplayTransport::isFullSpeed() const
+{
+    return m_player->isFullSpeed();
+}
+
+/*!
+  Sets whether the frames are played as fast as the debugger takes them,
+  rather than at the recorded pace, to \a fullSpeed.
+*/
+void QScriptDebuggerReplayTransport::setFullSpeed(bool fullSpeed)
+{
+    m_player->setFullSpeed(fullSpeed);
+}
+
+void QScriptDebuggerReplayTransport::connectToPeer(const QString &address)
+{
+    abort();
+    m_fileName = address;
+    // like the other transports, report the outcome asynchronously
+    QMetaObject::invokeMethod(this, "startReplay", Qt::QueuedConnection);
+}
+
+bool QScriptDebuggerReplayTransport::listen(const QString &)
+{
+    m_errorString = QString::fromLatin1("a replay can't listen");
+    return false;
+}
+
+bool QScriptDebuggerReplayTransport::isListening() const
+{
+    return false;
+}
+
+QIODevice *QScriptDebuggerReplayTransport::device() const
+{
+    return m_device;
+}
+
+void QScriptDebuggerReplayTransport::disconnectFromPeer()
+{
+    abort();
+}
+
+void QScriptDebuggerReplayTransport::abort()
+{
+    if (!m_device)
+        return;
+    m_player->stop();
+    m_device->deleteLater();
+    m_device = 0;
+    emit disconnected();
+}
+
+QString QScriptDebuggerReplayTransport::errorString() const
+{
+    return m_errorString;
+}
+
+void QScriptDebuggerReplayTransport::startReplay()
+{
+    if (m_device)
+        return;
+    if (!m_player->open(m_fileName)) {
+        m_errorString = m_player->errorString();
+        if (m_errorString.isEmpty())
+            m_errorString = QString::fromLatin1("%0 contains no session").arg(m_fileName);
+        emit error(UnknownError);
+        return;
+    }
+    m_device = new QScriptDebuggerReplayDevice(this);
+    emit connected();
+    // the debugger has written its handshake; answer it the way the
+    // recorded target did
+    QByteArray reply = QScriptDebuggerProtocol::handshakeData();
+    uchar field[sizeof(quint16) + sizeof(quint32)];
+    qToBigEndian<quint16>(QScriptDebuggerProtocol::ProtocolVersion, field);
+    qToBigEndian<quint32>(m_player->capabilities(), field + sizeof(quint16));
+    reply.append(reinterpret_cast<const char*>(field), sizeof(field));
+    m_device->append(reply.constData(), reply.size());
+    emit readyRead();
+    m_player->start();
+}
+
+void QScriptDebuggerReplayTransport::onFrameReady(const char *data, int size)
+{
+    if (!m_device)
+        return;
+    m_device->append(data, size);
+    emit readyRead();
+}
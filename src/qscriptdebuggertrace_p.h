@@ -0,0 +1,201 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef QSCRIPTDEBUGGERTRACE_P_H
+#define QSCRIPTDEBUGGERTRACE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/qbytearray.h>
+#include <QtCore/qdatetime.h>
+#include <QtCore/qfile.h>
+#include <QtCore/qobject.h>
+#include <QtCore/qstring.h>
+#include <QtCore/qtimer.h>
+
+#include "qscriptdebuggertransport_p.h"
+
+class QScriptDebuggerReplayDevice;
+
+// Appends the frames of a connection to a trace file (see
+// QScriptDebuggerProtocol::TraceRecordType). The codec hands over each
+// frame as it is sent or received; every record is flushed right away,
+// so that a trace survives a crash of the process that wrote it.
+class QScriptDebuggerTraceWriter
+{
+public:
+    enum Side {
+        BackendSide,
+        FrontendSide
+    };
+
+    QScriptDebuggerTraceWriter(Side side);
+    ~QScriptDebuggerTraceWriter();
+
+    bool open(const QString &fileName);
+    void close();
+    bool isOpen() const;
+    QString errorString() const;
+
+    void writeHandshake(quint32 capabilities);
+    void writeSentFrame(const char *data, int size);
+    void writeReceivedFrame(const char *data, int size);
+
+private:
+    void writeRecord(quint8 type, const char *data, int size);
+
+    Side m_side;
+    QFile m_file;
+    QTime m_clock;
+    QByteArray m_buffer;
+
+    Q_DISABLE_COPY(QScriptDebuggerTraceWriter)
+};
+
+// Reads a trace file in place, from memory mapped if possible.
+// A record that was cut short, e.g. because the writer crashed, ends the
+// trace.
+class QScriptDebuggerTraceReader
+{
+public:
+    struct Record
+    {
+        quint8 type;
+        quint32 time;
+        const char *data;
+        int size;
+    };
+
+    QScriptDebuggerTraceReader();
+    ~QScriptDebuggerTraceReader();
+
+    bool open(const QString &fileName);
+    void close();
+    QString errorString() const;
+
+    QDateTime startTime() const;
+    bool readRecord(Record *record);
+    void rewind();
+
+private:
+    QFile m_file;
+    const uchar *m_data;
+    qint64 m_size;
+    qint64 m_pos;
+    QByteArray m_contents;
+    quint32 m_startTime;
+    QString m_errorString;
+
+    Q_DISABLE_COPY(QScriptDebuggerTraceReader)
+};
+
+// Plays back the frames that the backend sent in one session of a trace,
+// either at the recorded pace or as fast as the receiver takes them (one
+// frame per pass through the event loop). Playback starts at the first
+// handshake record and ends at the next one, or at the end of the trace.
+class QScriptDebuggerTracePlayer : public QObject
+{
+    Q_OBJECT
+public:
+    QScriptDebuggerTracePlayer(QObject *parent = 0);
+    ~QScriptDebuggerTracePlayer();
+
+    bool open(const QString &fileName);
+    QString errorString() const;
+    quint32 capabilities() const;
+
+    bool isFullSpeed() const;
+    void setFullSpeed(bool fullSpeed);
+
+    void start();
+    void stop();
+
+    int framesPlayed() const;
+
+Q_SIGNALS:
+    // data is only valid during the emission
+    void frameReady(const char *data, int size);
+    void finished();
+
+private Q_SLOTS:
+    void play();
+
+private:
+    bool findHandshake();
+
+    QScriptDebuggerTraceReader m_reader;
+    QScriptDebuggerTraceReader::Record m_next;
+    bool m_hasNext;
+    quint32 m_capabilities;
+    quint32 m_baseTime;
+    bool m_fullSpeed;
+    int m_framesPlayed;
+    QTime m_clock;
+    QTimer *m_timer;
+};
+
+// A transport that plays the backend's side of a recorded session to the
+// debugger; what the debugger sends is dropped. The address is the name
+// of the trace file. The handshake is answered with the recorded
+// capabilities, so the debugger decodes the frames just like it did
+// while the session was recorded.
+class QScriptDebuggerReplayTransport : public QScriptDebuggerTransport
+{
+    Q_OBJECT
+public:
+    QScriptDebuggerReplayTransport(QObject *parent = 0);
+    ~QScriptDebuggerReplayTransport();
+
+    bool isFullSpeed() const;
+    void setFullSpeed(bool fullSpeed);
+
+    void connectToPeer(const QString &address);
+    bool listen(const QString &address);
+    bool isListening() const;
+    QIODevice *device() const;
+    void disconnectFromPeer();
+    void abort();
+    QString errorString() const;
+
+Q_SIGNALS:
+    void finished();
+
+private Q_SLOTS:
+    void startReplay();
+    void onFrameReady(const char *data, int size);
+
+private:
+    QScriptDebuggerTracePlayer *m_player;
+    QScriptDebuggerReplayDevice *m_device;
+    QString m_fileName;
+    QString m_errorString;
+};
+
+#endif
@@ -0,0 +1,1282 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "qscriptdebuggertransport_p.h"
+
+#include <QtCore/qbytearray.h>
+#include <QtCore/qfile.h>
+#include <QtCore/qmutex.h>
+#include <QtCore/qprocess.h>
+#include <QtCore/qsharedmemory.h>
+#include <QtCore/qsystemsemaphore.h>
+#include <QtCore/qthread.h>
+#include <QtNetwork/qhostaddress.h>
+#include <QtNetwork/qlocalserver.h>
+#include <QtNetwork/qlocalsocket.h>
+#include <QtNetwork/qtcpserver.h>
+#include <QtNetwork/qtcpsocket.h>
+
+#include <stdio.h>
+#include <string.h>
+
+QScriptDebuggerTransport::QScriptDebuggerTransport(QObject *parent)
+    : QObject(parent), m_maxObservers(0), m_maxPeers(0)
+{
+}
+
+QScriptDebuggerTransport::~QScriptDebuggerTransport()
+{
+}
+
+int QScriptDebuggerTransport::maxObservers() const
+{
+    return m_maxObservers;
+}
+
+/*!
+  Sets the number of peers that a listening transport accepts while the
+  first one is connected to \a count. Takes effect on the next
+  connection; transports that can't accept more than one peer ignore it.
+*/
+void QScriptDebuggerTransport::setMaxObservers(int count)
+{
+    m_maxObservers = qMax(0, count);
+}
+
+void QScriptDebuggerTransport::abortObserver(QIODevice *)
+{
+}
+
+bool QScriptDebuggerTransport::relisten()
+{
+    return false;
+}
+
+QString QScriptDebuggerTransport::peerName() const
+{
+    return QString();
+}
+
+int QScriptDebuggerTransport::maxPeers() const
+{
+    return m_maxPeers;
+}
+
+/*!
+  Sets the number of peers that a listening transport hands out with
+  peerConnected() to \a count. Must be called before listen(); with a
+  \a count of 0, the transport connects to the first peer itself.
+  Transports that can't accept more than one peer ignore it.
+*/
+void QScriptDebuggerTransport::setMaxPeers(int count)
+{
+    m_maxPeers = qMax(0, count);
+}
+
+/*!
+  Returns true if another peer can be handed out; peers that have been
+  deleted by their owners no longer count.
+*/
+bool QScriptDebuggerTransport::hasRoomForPeer()
+{
+    m_peers.removeAll(QPointer<QScriptDebuggerTransport>());
+    return (m_peers.size() < m_maxPeers);
+}
+
+class QScriptDebuggerTcpTransport : public QScriptDebuggerTransport
+{
+    Q_OBJECT
+public:
+    QScriptDebuggerTcpTransport(QObject *parent = 0);
+
+    void connectToPeer(const QString &address);
+    bool listen(const QString &address);
+    bool isListening() const;
+    QIODevice *device() const;
+    void disconnectFromPeer();
+    void abort();
+    bool relisten();
+    QString errorString() const;
+    QString peerName() const;
+    void abortObserver(QIODevice *device);
+
+private Q_SLOTS:
+    void onNewConnection();
+    void onObserverDisconnected();
+    void onStateChanged(QAbstractSocket::SocketState state);
+    void onError(QAbstractSocket::SocketError error);
+
+private:
+    static bool parseAddress(const QString &address, QHostAddress *host, quint16 *port);
+    void setSocket(QTcpSocket *socket);
+    void removeObserver(QTcpSocket *socket);
+
+    QTcpServer *m_server;
+    QTcpSocket *m_socket;
+    QList<QTcpSocket*> m_observers;
+    QHostAddress m_listenHost;
+    quint16 m_listenPort;
+    QString m_errorString;
+};
+
+QScriptDebuggerTcpTransport::QScriptDebuggerTcpTransport(QObject *parent)
+    : QScriptDebuggerTransport(parent), m_server(0), m_socket(0), m_listenPort(0)
+{
+}
+
+bool QScriptDebuggerTcpTransport::parseAddress(const QString &address, QHostAddress *host, quint16 *port)
+{
+    // the host part of an IPv6 address contains colons too
+    int colon = address.lastIndexOf(QLatin1Char(':'));
+    if (colon == -1)
+        return false;
+    bool ok;
+    *port = address.mid(colon + 1).toUShort(&ok);
+    return ok && host->setAddress(address.left(colon));
+}
+
+void QScriptDebuggerTcpTransport::setSocket(QTcpSocket *socket)
+{
+    m_socket = socket;
+    QObject::connect(m_socket, SIGNAL(stateChanged(QAbstractSocket::SocketState)),
+                     this, SLOT(onStateChanged(QAbstractSocket::SocketState)));
+    QObject::connect(m_socket, SIGNAL(error(QAbstractSocket::SocketError)),
+                     this, SLOT(onError(QAbstractSocket::SocketError)));
+    QObject::connect(m_socket, SIGNAL(readyRead()), this, SIGNAL(readyRead()));
+}
+
+void QScriptDebuggerTcpTransport::connectToPeer(const QString &address)
+{
+    QHostAddress host;
+    quint16 port;
+    if (!parseAddress(address, &host, &port)) {
+        m_errorString = QString::fromLatin1("Invalid address: %0").arg(address);
+        emit error(HostNotFoundError);
+        return;
+    }
+    if (!m_socket)
+        setSocket(new QTcpSocket(this));
+    m_socket->connectToHost(host, port);
+}
+
+bool QScriptDebuggerTcpTransport::listen(const QString &address)
+{
+    if (m_socket)
+        return false;
+    QHostAddress host;
+    quint16 port;
+    if (!parseAddress(address, &host, &port)) {
+        m_errorString = QString::fromLatin1("Invalid address: %0").arg(address);
+        return false;
+    }
+    if (!m_server) {
+        m_server = new QTcpServer(this);
+        QObject::connect(m_server, SIGNAL(newConnection()), this, SLOT(onNewConnection()));
+    }
+    if (!m_server->listen(host, port)) {
+        m_errorString = m_server->errorString();
+        return false;
+    }
+    // the port that was picked if port was 0, so that relisten() gets
+    // the same one
+    m_listenHost = host;
+    m_listenPort = m_server->serverPort();
+    return true;
+}
+
+bool QScriptDebuggerTcpTransport::isListening() const
+{
+    return m_server && m_server->isListening();
+}
+
+QIODevice *QScriptDebuggerTcpTransport::device() const
+{
+    return m_socket;
+}
+
+void QScriptDebuggerTcpTransport::disconnectFromPeer()
+{
+    if (m_socket)
+        m_socket->disconnectFromHost();
+}
+
+void QScriptDebuggerTcpTransport::abort()
+{
+    if (m_server)
+        m_server->close();
+    while (!m_observers.isEmpty())
+        abortObserver(m_observers.first());
+    if (m_socket)
+        m_socket->abort();
+}
+
+bool QScriptDebuggerTcpTransport::relisten()
+{
+    if (!m_server)
+        return false;
+    if (m_socket) {
+        m_socket->disconnect(this);
+        m_socket->deleteLater();
+        m_socket = 0;
+    }
+    if (m_server->isListening())
+        return true;
+    if (!m_server->listen(m_listenHost, m_listenPort)) {
+        m_errorString = m_server->errorString();
+        return false;
+    }
+    return true;
+}
+
+QString QScriptDebuggerTcpTransport::errorString() const
+{
+    if (m_socket && (m_socket->error() != QAbstractSocket::UnknownSocketError))
+        return m_socket->errorString();
+    return m_errorString;
+}
+
+QString QScriptDebuggerTcpTransport::peerName() const
+{
+    if (!m_socket)
+        return QString();
+    return QString::fromLatin1("%0:%1").arg(m_socket->peerAddress().toString())
+        .arg(m_socket->peerPort());
+}
+
+void QScriptDebuggerTcpTransport::abortObserver(QIODevice *device)
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket*>(device);
+    if (!socket || !m_observers.contains(socket))
+        return;
+    removeObserver(socket);
+    socket->abort();
+}
+
+void QScriptDebuggerTcpTransport::removeObserver(QTcpSocket *socket)
+{
+    if (!m_observers.removeAll(socket))
+        return;
+    socket->disconnect(this);
+    emit observerDisconnected(socket);
+    socket->deleteLater();
+}
+
+void QScriptDebuggerTcpTransport::onNewConnection()
+{
+    while (m_server->hasPendingConnections()) {
+        QTcpSocket *socket = m_server->nextPendingConnection();
+        if (m_maxPeers > 0) {
+            // a hub; the server stays open for the next peer
+            if (hasRoomForPeer()) {
+                QScriptDebuggerTcpTransport *peer = new QScriptDebuggerTcpTransport();
+                socket->setParent(peer);
+                peer->setSocket(socket);
+                m_peers.append(peer);
+                emit peerConnected(peer);
+            } else {
+                socket->abort();
+                socket->deleteLater();
+            }
+        } else if (!m_socket) {
+            setSocket(socket);
+            // unless observers are accepted, there's only ever one
+            // debugger per connection
+            if (m_maxObservers == 0)
+                m_server->close();
+            emit connected();
+        } else if (m_observers.size() < m_maxObservers) {
+            m_observers.append(socket);
+            QObject::connect(socket, SIGNAL(disconnected()), this, SLOT(onObserverDisconnected()));
+            emit observerConnected(socket);
+        } else {
+            socket->abort();
+            socket->deleteLater();
+        }
+    }
+}
+
+void QScriptDebuggerTcpTransport::onObserverDisconnected()
+{
+    removeObserver(qobject_cast<QTcpSocket*>(sender()));
+}
+
+void QScriptDebuggerTcpTransport::onStateChanged(QAbstractSocket::SocketState state)
+{
+    if (state == QAbstractSocket::ConnectedState)
+        emit connected();
+    else if (state == QAbstractSocket::UnconnectedState) {
+        // the observers came with the first peer, and go with it
+        if (m_server)
+            m_server->close();
+        while (!m_observers.isEmpty())
+            abortObserver(m_observers.first());
+        emit disconnected();
+    }
+}
+
+void QScriptDebuggerTcpTransport::onError(QAbstractSocket::SocketError err)
+{
+    switch (err) {
+    case QAbstractSocket::RemoteHostClosedError:
+        break;
+    case QAbstractSocket::HostNotFoundError:
+        emit error(HostNotFoundError);
+        break;
+    case QAbstractSocket::ConnectionRefusedError:
+        emit error(ConnectionRefusedError);
+        break;
+    default:
+        emit error(UnknownError);
+        break;
+    }
+}
+
+class QScriptDebuggerLocalSocketTransport : public QScriptDebuggerTransport
+{
+    Q_OBJECT
+public:
+    QScriptDebuggerLocalSocketTransport(QObject *parent = 0);
+
+    void connectToPeer(const QString &address);
+    bool listen(const QString &address);
+    bool isListening() const;
+    QIODevice *device() const;
+    void disconnectFromPeer();
+    void abort();
+    bool relisten();
+    QString errorString() const;
+    void abortObserver(QIODevice *device);
+
+private Q_SLOTS:
+    void onNewConnection();
+    void onObserverDisconnected();
+    void onStateChanged(QLocalSocket::LocalSocketState state);
+    void onError(QLocalSocket::LocalSocketError error);
+
+private:
+    void setSocket(QLocalSocket *socket);
+    void removeObserver(QLocalSocket *socket);
+
+    QLocalServer *m_server;
+    QLocalSocket *m_socket;
+    QList<QLocalSocket*> m_observers;
+    QString m_listenAddress;
+    QString m_errorString;
+};
+
+QScriptDebuggerLocalSocketTransport::QScriptDebuggerLocalSocketTransport(QObject *parent)
+    : QScriptDebuggerTransport(parent), m_server(0), m_socket(0)
+{
+}
+
+void QScriptDebuggerLocalSocketTransport::setSocket(QLocalSocket *socket)
+{
+    m_socket = socket;
+    QObject::connect(m_socket, SIGNAL(stateChanged(QLocalSocket::LocalSocketState)),
+                     this, SLOT(onStateChanged(QLocalSocket::LocalSocketState)));
+    QObject::connect(m_socket, SIGNAL(error(QLocalSocket::LocalSocketError)),
+                     this, SLOT(onError(QLocalSocket::LocalSocketError)));
+    QObject::connect(m_socket, SIGNAL(readyRead()), this, SIGNAL(readyRead()));
+}
+
+void QScriptDebuggerLocalSocketTransport::connectToPeer(const QString &address)
+{
+    if (!m_socket)
+        setSocket(new QLocalSocket(this));
+    m_socket->connectToServer(address);
+}
+
+bool QScriptDebuggerLocalSocketTransport::listen(const QString &address)
+{
+    if (m_socket)
+        return false;
+    if (!m_server) {
+        m_server = new QLocalServer(this);
+        QObject::connect(m_server, SIGNAL(newConnection()), this, SLOT(onNewConnection()));
+    }
+    // a server that crashed may have left its socket file behind
+    QLocalServer::removeServer(address);
+    if (!m_server->listen(address)) {
+        m_errorString = m_server->errorString();
+        return false;
+    }
+    m_listenAddress = address;
+    return true;
+}
+
+bool QScriptDebuggerLocalSocketTransport::isListening() const
+{
+    return m_server && m_server->isListening();
+}
+
+QIODevice *QScriptDebuggerLocalSocketTransport::device() const
+{
+    return m_socket;
+}
+
+void QScriptDebuggerLocalSocketTransport::disconnectFromPeer()
+{
+    if (m_socket)
+        m_socket->disconnectFromServer();
+}
+
+void QScriptDebuggerLocalSocketTransport::abort()
+{
+    if (m_server)
+        m_server->close();
+    while (!m_observers.isEmpty())
+        abortObserver(m_observers.first());
+    if (m_socket)
+        m_socket->abort();
+}
+
+bool QScriptDebuggerLocalSocketTransport::relisten()
+{
+    if (!m_server)
+        return false;
+    if (m_socket) {
+        m_socket->disconnect(this);
+        m_socket->deleteLater();
+        m_socket = 0;
+    }
+    if (m_server->isListening())
+        return true;
+    QLocalServer::removeServer(m_listenAddress);
+    if (!m_server->listen(m_listenAddress)) {
+        m_errorString = m_server->errorString();
+        return false;
+    }
+    return true;
+}
+
+QString QScriptDebuggerLocalSocketTransport::errorString() const
+{
+    if (m_socket && (m_socket->error() != QLocalSocket::UnknownSocketError))
+        return m_socket->errorString();
+    return m_errorString;
+}
+
+void QScriptDebuggerLocalSocketTransport::abortObserver(QIODevice *device)
+{
+    QLocalSocket *socket = qobject_cast<QLocalSocket*>(device);
+    if (!socket || !m_observers.contains(socket))
+        return;
+    removeObserver(socket);
+    socket->abort();
+}
+
+void QScriptDebuggerLocalSocketTransport::removeObserver(QLocalSocket *socket)
+{
+    if (!m_observers.removeAll(socket))
+        return;
+    socket->disconnect(this);
+    emit observerDisconnected(socket);
+    socket->deleteLater();
+}
+
+void QScriptDebuggerLocalSocketTransport::onNewConnection()
+{
+    while (m_server->hasPendingConnections()) {
+        QLocalSocket *socket = m_server->nextPendingConnection();
+        if (m_maxPeers > 0) {
+            if (hasRoomForPeer()) {
+                QScriptDebuggerLocalSocketTransport *peer = new QScriptDebuggerLocalSocketTransport();
+                socket->setParent(peer);
+                peer->setSocket(socket);
+                m_peers.append(peer);
+                emit peerConnected(peer);
+            } else {
+                socket->abort();
+                socket->deleteLater();
+            }
+        } else if (!m_socket) {
+            setSocket(socket);
+            // unless observers are accepted, there's only ever one
+            // debugger per connection
+            if (m_maxObservers == 0)
+                m_server->close();
+            emit connected();
+        } else if (m_observers.size() < m_maxObservers) {
+            m_observers.append(socket);
+            QObject::connect(socket, SIGNAL(disconnected()), this, SLOT(onObserverDisconnected()));
+            emit observerConnected(socket);
+        } else {
+            socket->abort();
+            socket->deleteLater();
+        }
+    }
+}
+
+void QScriptDebuggerLocalSocketTransport::onObserverDisconnected()
+{
+    removeObserver(qobject_cast<QLocalSocket*>(sender()));
+}
+
+void QScriptDebuggerLocalSocketTransport::onStateChanged(QLocalSocket::LocalSocketState state)
+{
+    if (state == QLocalSocket::ConnectedState)
+        emit connected();
+    else if (state == QLocalSocket::UnconnectedState) {
+        // the observers came with the first peer, and go with it
+        if (m_server)
+            m_server->close();
+        while (!m_observers.isEmpty())
+            abortObserver(m_observers.first());
+        emit disconnected();
+    }
+}
+
+void QScriptDebuggerLocalSocketTransport::onError(QLocalSocket::LocalSocketError err)
+{
+    switch (err) {
+    case QLocalSocket::PeerClosedError:
+        break;
+    case QLocalSocket::ServerNotFoundError:
+        emit error(HostNotFoundError);
+        break;
+    case QLocalSocket::ConnectionRefusedError:
+        emit error(ConnectionRefusedError);
+        break;
+    default:
+        emit error(UnknownError);
+        break;
+    }
+}
+
+// Reads this process' stdin in a thread of its own, since there's no
+// portable way to be notified when it becomes readable. There is only
+// one (see stdinReader()), and it is never deleted: it may be blocked
+// in read() for as long as the process runs, and a thread that might
+// hold the mutex can't be terminated.
+class QScriptDebuggerStdinReader : public QThread
+{
+    Q_OBJECT
+public:
+    QScriptDebuggerStdinReader(QObject *parent = 0)
+        : QThread(parent), m_atEnd(false) {}
+
+    QByteArray takeData()
+    {
+        QMutexLocker locker(&m_mutex);
+        QByteArray data = m_data;
+        m_data.clear();
+        return data;
+    }
+
+    qint64 size()
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_data.size();
+    }
+
+    qint64 read(char *data, qint64 maxSize)
+    {
+        QMutexLocker locker(&m_mutex);
+        int n = int(qMin<qint64>(maxSize, m_data.size()));
+        memcpy(data, m_data.constData(), n);
+        m_data.remove(0, n);
+        return n;
+    }
+
+    // true once endOfFile() has been emitted
+    bool atEnd()
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_atEnd;
+    }
+
+Q_SIGNALS:
+    void dataAvailable();
+    void endOfFile();
+
+protected:
+    void run()
+    {
+        QFile in;
+        if (!in.open(0, QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+            setAtEnd();
+            return;
+        }
+        char buffer[16384];
+        for (;;) {
+            qint64 n = in.read(buffer, sizeof(buffer));
+            if (n <= 0)
+                break;
+            bool wasEmpty;
+            {
+                QMutexLocker locker(&m_mutex);
+                wasEmpty = m_data.isEmpty();
+                m_data.append(buffer, int(n));
+            }
+            if (wasEmpty)
+                emit dataAvailable();
+        }
+        setAtEnd();
+    }
+
+private:
+    void setAtEnd()
+    {
+        {
+            QMutexLocker locker(&m_mutex);
+            m_atEnd = true;
+        }
+        emit endOfFile();
+    }
+
+    QMutex m_mutex;
+    QByteArray m_data;
+    bool m_atEnd;
+};
+
+Q_GLOBAL_STATIC(QMutex, stdinReaderMutex)
+
+// Returns the reader of stdin, starting it when first asked for.
+static QScriptDebuggerStdinReader *stdinReader()
+{
+    static QScriptDebuggerStdinReader *reader = 0;
+    QMutexLocker locker(stdinReaderMutex());
+    if (!reader) {
+        reader = new QScriptDebuggerStdinReader();
+        reader->start();
+    }
+    return reader;
+}
+
+// This process' stdin and stdout as one device. Deleting it merely
+// disconnects it from the reader of stdin, which keeps what arrives
+// in the meantime for the next one.
+class QScriptDebuggerStdioDevice : public QIODevice
+{
+    Q_OBJECT
+public:
+    QScriptDebuggerStdioDevice(QObject *parent = 0)
+        : QIODevice(parent), m_reader(0)
+    {
+    }
+
+    bool open(OpenMode mode)
+    {
+        if (!m_out.open(1, QIODevice::WriteOnly | QIODevice::Unbuffered))
+            return false;
+        m_reader = stdinReader();
+        QObject::connect(m_reader, SIGNAL(dataAvailable()), this, SIGNAL(readyRead()),
+                         Qt::QueuedConnection);
+        QObject::connect(m_reader, SIGNAL(endOfFile()), this, SIGNAL(readChannelFinished()),
+                         Qt::QueuedConnection);
+        // what was read before this device was opened
+        if (m_reader->size() > 0)
+            QMetaObject::invokeMethod(this, "readyRead", Qt::QueuedConnection);
+        if (m_reader->atEnd())
+            QMetaObject::invokeMethod(this, "readChannelFinished", Qt::QueuedConnection);
+        return QIODevice::open(mode | QIODevice::Unbuffered);
+    }
+
+    bool isSequential() const
+    { return true; }
+    qint64 bytesAvailable() const
+    { return (m_reader ? m_reader->size() : 0) + QIODevice::bytesAvailable(); }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize)
+    { return m_reader ? m_reader->read(data, maxSize) : 0; }
+    qint64 writeData(const char *data, qint64 size)
+    { return m_out.write(data, size); }
+
+private:
+    QScriptDebuggerStdinReader *m_reader;
+    QFile m_out;
+};
+
+class QScriptDebuggerPipeTransport : public QScriptDebuggerTransport
+{
+    Q_OBJECT
+public:
+    QScriptDebuggerPipeTransport(QObject *parent = 0);
+
+    void connectToPeer(const QString &address);
+    bool listen(const QString &address);
+    bool isListening() const;
+    QIODevice *device() const;
+    void disconnectFromPeer();
+    void abort();
+    QString errorString() const;
+
+private Q_SLOTS:
+    void onStarted();
+    void onFinished();
+    void onProcessError(QProcess::ProcessError error);
+    void onStandardError();
+    void onEndOfFile();
+
+private:
+    QProcess *m_process;
+    QScriptDebuggerStdioDevice *m_stdio;
+    QString m_errorString;
+};
+
+QScriptDebuggerPipeTransport::QScriptDebuggerPipeTransport(QObject *parent)
+    : QScriptDebuggerTransport(parent), m_process(0), m_stdio(0)
+{
+}
+
+void QScriptDebuggerPipeTransport::connectToPeer(const QString &address)
+{
+    if (address.isEmpty()) {
+        // the peer is our parent
+        listen(address);
+        return;
+    }
+    if (!m_process) {
+        m_process = new QProcess(this);
+        m_process->setReadChannel(QProcess::StandardOutput);
+        QObject::connect(m_process, SIGNAL(started()), this, SLOT(onStarted()));
+        QObject::connect(m_process, SIGNAL(finished(int,QProcess::ExitStatus)),
+                         this, SLOT(onFinished()));
+        QObject::connect(m_process, SIGNAL(error(QProcess::ProcessError)),
+                         this, SLOT(onProcessError(QProcess::ProcessError)));
+        QObject::connect(m_process, SIGNAL(readyReadStandardOutput()), this, SIGNAL(readyRead()));
+        QObject::connect(m_process, SIGNAL(readyReadStandardError()), this, SLOT(onStandardError()));
+    }
+    m_process->start(address);
+}
+
+bool QScriptDebuggerPipeTransport::listen(const QString &)
+{
+    if (m_process)
+        return false;
+    if (!m_stdio) {
+        m_stdio = new QScriptDebuggerStdioDevice(this);
+        QObject::connect(m_stdio, SIGNAL(readyRead()), this, SIGNAL(readyRead()));
+        QObject::connect(m_stdio, SIGNAL(readChannelFinished()), this, SLOT(onEndOfFile()));
+        if (!m_stdio->open(QIODevice::ReadWrite)) {
+            m_errorString = QString::fromLatin1("Unable to open stdin/stdout");
+            delete m_stdio;
+            m_stdio = 0;
+            return false;
+        }
+    }
+    // the parent has been there all along
+    QMetaObject::invokeMethod(this, "connected", Qt::QueuedConnection);
+    return true;
+}
+
+bool QScriptDebuggerPipeTransport::isListening() const
+{
+    return false;
+}
+
+QIODevice *QScriptDebuggerPipeTransport::device() const
+{
+    if (m_process)
+        return m_process;
+    return m_stdio;
+}
+
+void QScriptDebuggerPipeTransport::disconnectFromPeer()
+{
+    if (m_process)
+        m_process->closeWriteChannel();
+    else if (m_stdio)
+        onEndOfFile();
+}
+
+void QScriptDebuggerPipeTransport::abort()
+{
+    if (m_process) {
+        m_process->kill();
+    } else if (m_stdio) {
+        // this may be called from the device's readyRead()
+        m_stdio->disconnect(this);
+        m_stdio->deleteLater();
+        m_stdio = 0;
+        emit disconnected();
+    }
+}
+
+QString QScriptDebuggerPipeTransport::errorString() const
+{
+    if (m_process)
+        return m_process->errorString();
+    return m_errorString;
+}
+
+void QScriptDebuggerPipeTransport::onStarted()
+{
+    emit connected();
+}
+
+void QScriptDebuggerPipeTransport::onFinished()
+{
+    emit disconnected();
+}
+
+void QScriptDebuggerPipeTransport::onProcessError(QProcess::ProcessError err)
+{
+    if (err == QProcess::FailedToStart) {
+        emit error(ConnectionRefusedError);
+        emit disconnected();
+    } else if (err != QProcess::Crashed) {
+        emit error(UnknownError);
+    }
+}
+
+void QScriptDebuggerPipeTransport::onStandardError()
+{
+    // don't let the child block on a full stderr pipe
+    QByteArray data = m_process->readAllStandardError();
+    fwrite(data.constData(), 1, data.size(), stderr);
+}
+
+void QScriptDebuggerPipeTransport::onEndOfFile()
+{
+    if (!m_stdio)
+        return;
+    m_stdio->deleteLater();
+    m_stdio = 0;
+    emit disconnected();
+}
+
+// The shared memory segment holds a header followed by two rings of
+// RingSize bytes: ring 0 carries data from the listening end to the
+// connecting end, ring 1 the other way. The indices are free-running
+// and only accessed with the segment locked. Each end has a system
+// semaphore that the other end releases whenever it has written data,
+// read data (making room) or changed the state.
+struct QScriptDebuggerSharedMemoryHeader
+{
+    enum State {
+        Listening,
+        Connected,
+        Closed
+    };
+
+    quint32 magic;
+    qint32 state;
+    quint32 head[2];
+    quint32 tail[2];
+};
+
+// Waits on a system semaphore in a thread of its own, and emits woken()
+// every time it is released.
+class QScriptDebuggerSemaphoreWaiter : public QThread
+{
+    Q_OBJECT
+public:
+    QScriptDebuggerSemaphoreWaiter(QSystemSemaphore *semaphore, QObject *parent = 0)
+        : QThread(parent), m_semaphore(semaphore), m_stopped(0) {}
+
+    void stop()
+    {
+        m_stopped.fetchAndStoreOrdered(1);
+        m_semaphore->release();
+        wait();
+    }
+
+Q_SIGNALS:
+    void woken();
+
+protected:
+    void run()
+    {
+        while (m_semaphore->acquire()) {
+            if (m_stopped)
+                break;
+            emit woken();
+        }
+    }
+
+private:
+    QSystemSemaphore *m_semaphore;
+    QAtomicInt m_stopped;
+};
+
+class QScriptDebuggerSharedMemoryTransport;
+
+class QScriptDebuggerSharedMemoryDevice : public QIODevice
+{
+    Q_OBJECT
+public:
+    QScriptDebuggerSharedMemoryDevice(QScriptDebuggerSharedMemoryTransport *transport);
+
+    bool isSequential() const
+    { return true; }
+    qint64 bytesAvailable() const;
+    qint64 bytesToWrite() const
+    { return m_pending.size(); }
+
+    void flushPending();
+
+protected:
+    qint64 readData(char *data, qint64 maxSize);
+    qint64 writeData(const char *data, qint64 size);
+
+private:
+    QScriptDebuggerSharedMemoryTransport *m_transport;
+    QByteArray m_pending;
+};
+
+class QScriptDebuggerSharedMemoryTransport : public QScriptDebuggerTransport
+{
+    Q_OBJECT
+public:
+    enum {
+        Magic = 0x51534454, // 'QSDT'
+        RingSize = 1024 * 1024
+    };
+
+    QScriptDebuggerSharedMemoryTransport(QObject *parent = 0);
+    ~QScriptDebuggerSharedMemoryTransport();
+
+    void connectToPeer(const QString &address);
+    bool listen(const QString &address);
+    bool isListening() const;
+    QIODevice *device() const;
+    void disconnectFromPeer();
+    void abort();
+    QString errorString() const;
+
+private Q_SLOTS:
+    void onWoken();
+
+private:
+    QScriptDebuggerSharedMemoryHeader *header() const;
+    char *ring(int index) const;
+    bool open(const QString &address, bool create);
+    void close();
+    void wakePeer();
+    qint64 inboundSize();
+    qint64 readInbound(char *data, qint64 maxSize);
+    qint64 writeOutbound(const char *data, qint64 size);
+
+    QSharedMemory m_memory;
+    QSystemSemaphore *m_ownSemaphore;
+    QSystemSemaphore *m_peerSemaphore;
+    QScriptDebuggerSemaphoreWaiter *m_waiter;
+    QScriptDebuggerSharedMemoryDevice *m_device;
+    int m_side; // 0 = listening end, 1 = connecting end
+    bool m_connected;
+    QString m_errorString;
+
+    friend class QScriptDebuggerSharedMemoryDevice;
+};
+
+QScriptDebuggerSharedMemoryDevice::QScriptDebuggerSharedMemoryDevice(QScriptDebuggerSharedMemoryTransport *transport)
+    : QIODevice(transport), m_transport(transport)
+{
+    open(QIODevice::ReadWrite | QIODevice::Unbuffered);
+}
+
+qint64 QScriptDebuggerSharedMemoryDevice::bytesAvailable() const
+{
+    return m_transport->inboundSize() + QIODevice::bytesAvailable();
+}
+
+qint64 QScriptDebuggerSharedMemoryDevice::readData(char *data, qint64 maxSize)
+{
+    return m_transport->readInbound(data, maxSize);
+}
+
+qint64 QScriptDebuggerSharedMemoryDevice::writeData(const char *data, qint64 size)
+{
+    if (m_pending.isEmpty()) {
+        qint64 written = m_transport->writeOutbound(data, size);
+        if (written < 0)
+            return -1;
+        m_pending.append(data + written, int(size - written));
+    } else {
+        // keep the order; the rest goes out when the peer has made room
+        m_pending.append(data, int(size));
+    }
+    return size;
+}
+
+void QScriptDebuggerSharedMemoryDevice::flushPending()
+{
+    if (m_pending.isEmpty())
+        return;
+    qint64 written = m_transport->writeOutbound(m_pending.constData(), m_pending.size());
+    if (written > 0) {
+        m_pending.remove(0, int(written));
+        emit bytesWritten(written);
+    }
+}
+
+QScriptDebuggerSharedMemoryTransport::QScriptDebuggerSharedMemoryTransport(QObject *parent)
+    : QScriptDebuggerTransport(parent), m_ownSemaphore(0), m_peerSemaphore(0),
+      m_waiter(0), m_device(0), m_side(0), m_connected(false)
+{
+}
+
+QScriptDebuggerSharedMemoryTransport::~QScriptDebuggerSharedMemoryTransport()
+{
+    close();
+}
+
+QScriptDebuggerSharedMemoryHeader *QScriptDebuggerSharedMemoryTransport::header() const
+{
+    return static_cast<QScriptDebuggerSharedMemoryHeader*>(const_cast<void*>(m_memory.constData()));
+}
+
+char *QScriptDebuggerSharedMemoryTransport::ring(int index) const
+{
+    return static_cast<char*>(const_cast<void*>(m_memory.constData()))
+        + sizeof(QScriptDebuggerSharedMemoryHeader) + index * RingSize;
+}
+
+bool QScriptDebuggerSharedMemoryTransport::open(const QString &address, bool create)
+{
+    m_memory.setKey(address);
+    int size = sizeof(QScriptDebuggerSharedMemoryHeader) + 2 * RingSize;
+    if (create) {
+        if (!m_memory.create(size) && (m_memory.error() == QSharedMemory::AlreadyExists)) {
+            // left behind by a process that crashed; on Unix the segment
+            // goes away with the last process detaching from it
+            if (m_memory.attach())
+                m_memory.detach();
+            m_memory.create(size);
+        }
+        if (!m_memory.isAttached()) {
+            m_errorString = m_memory.errorString();
+            return false;
+        }
+        m_memory.lock();
+        memset(header(), 0, sizeof(QScriptDebuggerSharedMemoryHeader));
+        header()->magic = Magic;
+        header()->state = QScriptDebuggerSharedMemoryHeader::Listening;
+        m_memory.unlock();
+    } else if (!m_memory.attach()) {
+        m_errorString = m_memory.errorString();
+        return false;
+    }
+
+    m_side = create ? 0 : 1;
+    QSystemSemaphore::AccessMode mode = create ? QSystemSemaphore::Create : QSystemSemaphore::Open;
+    QString ownKey = address + QString::fromLatin1("-%0").arg(m_side);
+    QString peerKey = address + QString::fromLatin1("-%0").arg(1 - m_side);
+    m_ownSemaphore = new QSystemSemaphore(ownKey, 0, mode);
+    m_peerSemaphore = new QSystemSemaphore(peerKey, 0, mode);
+    m_waiter = new QScriptDebuggerSemaphoreWaiter(m_ownSemaphore, this);
+    QObject::connect(m_waiter, SIGNAL(woken()), this, SLOT(onWoken()), Qt::QueuedConnection);
+    m_waiter->start();
+    return true;
+}
+
+void QScriptDebuggerSharedMemoryTransport::close()
+{
+    if (m_memory.isAttached()) {
+        m_memory.lock();
+        header()->state = QScriptDebuggerSharedMemoryHeader::Closed;
+        m_memory.unlock();
+        wakePeer();
+    }
+    if (m_waiter) {
+        m_waiter->stop();
+        delete m_waiter;
+        m_waiter = 0;
+    }
+    delete m_ownSemaphore;
+    m_ownSemaphore = 0;
+    delete m_peerSemaphore;
+    m_peerSemaphore = 0;
+    if (m_memory.isAttached())
+        m_memory.detach();
+    if (m_device) {
+        // this may be called from the device's readyRead() handling, by
+        // way of abort() or disconnectFromPeer(); until it is deleted,
+        // the device reads as empty and refuses writes
+        m_device->disconnect();
+        m_device->deleteLater();
+        m_device = 0;
+    }
+    if (m_connected) {
+        m_connected = false;
+        emit disconnected();
+    }
+}
+
+void QScriptDebuggerSharedMemoryTransport::connectToPeer(const QString &address)
+{
+    if (m_memory.isAttached())
+        return;
+    if (!open(address, /*create=*/false)) {
+        emit error(HostNotFoundError);
+        emit disconnected();
+        return;
+    }
+    m_memory.lock();
+    bool ok = (header()->magic == quint32(Magic))
+              && (header()->state == QScriptDebuggerSharedMemoryHeader::Listening);
+    if (ok)
+        header()->state = QScriptDebuggerSharedMemoryHeader::Connected;
+    m_memory.unlock();
+    if (!ok) {
+        m_errorString = QString::fromLatin1("%0 is not accepting connections").arg(address);
+        close();
+        emit error(ConnectionRefusedError);
+        emit disconnected();
+        return;
+    }
+    m_device = new QScriptDebuggerSharedMemoryDevice(this);
+    m_connected = true;
+    wakePeer();
+    // like the other transports, report the connection asynchronously
+    QMetaObject::invokeMethod(this, "connected", Qt::QueuedConnection);
+}
+
+bool QScriptDebuggerSharedMemoryTransport::listen(const QString &address)
+{
+    if (m_memory.isAttached())
+        return false;
+    return open(address, /*create=*/true);
+}
+
+bool QScriptDebuggerSharedMemoryTransport::isListening() const
+{
+    return m_memory.isAttached() && (m_side == 0) && !m_connected;
+}
+
+QIODevice *QScriptDebuggerSharedMemoryTransport::device() const
+{
+    return m_device;
+}
+
+void QScriptDebuggerSharedMemoryTransport::disconnectFromPeer()
+{
+    // writes are handed to the peer right away, except what doesn't fit;
+    // don't wait for that
+    close();
+}
+
+void QScriptDebuggerSharedMemoryTransport::abort()
+{
+    close();
+}
+
+QString QScriptDebuggerSharedMemoryTransport::errorString() const
+{
+    return m_errorString;
+}
+
+void QScriptDebuggerSharedMemoryTransport::wakePeer()
+{
+    if (m_peerSemaphore)
+        m_peerSemaphore->release();
+}
+
+void QScriptDebuggerSharedMemoryTransport::onWoken()
+{
+    if (!m_memory.isAttached())
+        return;
+    m_memory.lock();
+    qint32 state = header()->state;
+    m_memory.unlock();
+
+    if (!m_connected) {
+        if ((m_side == 0) && (state == QScriptDebuggerSharedMemoryHeader::Connected)) {
+            m_device = new QScriptDebuggerSharedMemoryDevice(this);
+            m_connected = true;
+            emit connected();
+        }
+        return;
+    }
+    m_device->flushPending();
+    if (inboundSize() > 0)
+        emit readyRead();
+    if (state == QScriptDebuggerSharedMemoryHeader::Closed)
+        close();
+}
+
+qint64 QScriptDebuggerSharedMemoryTransport::inboundSize()
+{
+    if (!m_memory.isAttached())
+        return 0;
+    int in = 1 - m_side;
+    m_memory.lock();
+    qint64 size = header()->tail[in] - header()->head[in];
+    m_memory.unlock();
+    return size;
+}
+
+qint64 QScriptDebuggerSharedMemoryTransport::readInbound(char *data, qint64 maxSize)
+{
+    if (!m_memory.isAttached())
+        return -1;
+    int in = 1 - m_side;
+    m_memory.lock();
+    QScriptDebuggerSharedMemoryHeader *h = header();
+    quint32 head = h->head[in];
+    quint32 size = qMin<quint32>(h->tail[in] - head, quint32(qMin<qint64>(maxSize, RingSize)));
+    quint32 offset = head % RingSize;
+    quint32 first = qMin<quint32>(size, RingSize - offset);
+    memcpy(data, ring(in) + offset, first);
+    memcpy(data + first, ring(in), size - first);
+    h->head[in] = head + size;
+    m_memory.unlock();
+    if (size > 0)
+        wakePeer();
+    return size;
+}
+
+qint64 QScriptDebuggerSharedMemoryTransport::writeOutbound(const char *data, qint64 size)
+{
+    if (!m_connected)
+        return -1;
+    int out = m_side;
+    m_memory.lock();
+    QScriptDebuggerSharedMemoryHeader *h = header();
+    if (h->state == QScriptDebuggerSharedMemoryHeader::Closed) {
+        m_memory.unlock();
+        return -1;
+    }
+    quint32 tail = h->tail[out];
+    quint32 room = RingSize - (tail - h->head[out]);
+    quint32 n = quint32(qMin<qint64>(size, room));
+    quint32 offset = tail % RingSize;
+    quint32 first = qMin<quint32>(n, RingSize - offset);
+    memcpy(ring(out) + offset, data, first);
+    memcpy(ring(out), data + first, n - first);
+    h->tail[out] = tail + n;
+    m_memory.unlock();
+    if (n > 0)
+        wakePeer();
+    return n;
+}
+
+/*!
+  Creates a transport of the given \a type.
+*/
+QScriptDebuggerTransport *QScriptDebuggerTransport::create(Type type, QObject *parent)
+{
+    switch (type) {
+    case TcpTransport:
+        return new QScriptDebuggerTcpTransport(parent);
+    case LocalSocketTransport:
+        return new QScriptDebuggerLocalSocketTransport(parent);
+    case PipeTransport:
+        return new QScriptDebuggerPipeTransport(parent);
+    case SharedMemoryTransport:
+        return new QScriptDebuggerSharedMemoryTransport(parent);
+    }
+    return 0;
+}
+
+#include "qscriptdebuggertransport.moc"
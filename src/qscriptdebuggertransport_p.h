@@ -0,0 +1,143 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef QSCRIPTDEBUGGERTRANSPORT_P_H
+#define QSCRIPTDEBUGGERTRANSPORT_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/qlist.h>
+#include <QtCore/qobject.h>
+#include <QtCore/qpointer.h>
+#include <QtCore/qstring.h>
+
+class QIODevice;
+
+// One end of the byte stream that the debugger protocol runs over.
+//
+// A transport either connects to a peer or listens for one; once
+// connected() has been emitted, device() can be read from and written to.
+// Writes never block; data that the underlying channel can't take yet is
+// kept by the device. The meaning of the address depends on the type:
+//
+//   TcpTransport            "host:port"
+//   LocalSocketTransport    a QLocalServer name
+//   PipeTransport           when connecting, the command line of a child
+//                           process to talk to over its stdin/stdout; an
+//                           empty address (or listening) uses this
+//                           process' own stdin/stdout
+//   SharedMemoryTransport   a key shared by both ends; the peers must be
+//                           on the same host
+//
+// A listening TCP or local socket transport can accept further peers
+// while the first one is connected (see setMaxObservers()). They are
+// handed out with observerConnected(), and are all dropped when the
+// first one disconnects. The other transports only ever have one peer.
+//
+// Once the peer of a listening TCP or local socket transport has gone,
+// relisten() waits for another one at the same address.
+//
+// A listening TCP or local socket transport can also act as a hub for
+// many peers (see setMaxPeers()). It then keeps listening, and hands
+// each peer out with peerConnected(), as a connected transport of its
+// own.
+class QScriptDebuggerTransport : public QObject
+{
+    Q_OBJECT
+public:
+    // same values as QScriptDebuggerEngine::Transport and
+    // QScriptRemoteTargetDebugger::Transport
+    enum Type {
+        TcpTransport,
+        LocalSocketTransport,
+        PipeTransport,
+        SharedMemoryTransport
+    };
+
+    enum TransportError {
+        UnknownError,
+        HostNotFoundError,
+        ConnectionRefusedError
+    };
+
+    QScriptDebuggerTransport(QObject *parent = 0);
+    ~QScriptDebuggerTransport();
+
+    static QScriptDebuggerTransport *create(Type type, QObject *parent = 0);
+
+    virtual void connectToPeer(const QString &address) = 0;
+    virtual bool listen(const QString &address) = 0;
+    virtual bool isListening() const = 0;
+
+    // 0 unless connecting or connected
+    virtual QIODevice *device() const = 0;
+
+    // closes the connection once pending data has been written
+    virtual void disconnectFromPeer() = 0;
+    // closes the connection and stops listening, right away
+    virtual void abort() = 0;
+    // forgets the peer that has disconnected and listens again; returns
+    // false if the transport wasn't listening, or can't listen again
+    virtual bool relisten();
+
+    virtual QString errorString() const = 0;
+    // the address of the peer, if the transport has one
+    virtual QString peerName() const;
+
+    // the number of peers accepted besides the first one; 0 by default
+    int maxObservers() const;
+    void setMaxObservers(int count);
+    // closes the connection to an observer right away
+    virtual void abortObserver(QIODevice *device);
+
+    // the number of peers handed out with peerConnected() that may be
+    // connected at once; 0 by default, which keeps the first peer
+    int maxPeers() const;
+    void setMaxPeers(int count);
+
+Q_SIGNALS:
+    void connected();
+    void disconnected();
+    void readyRead();
+    void error(QScriptDebuggerTransport::TransportError error);
+    void observerConnected(QIODevice *device);
+    void observerDisconnected(QIODevice *device);
+    // the receiver takes ownership of the transport
+    void peerConnected(QScriptDebuggerTransport *transport);
+
+protected:
+    bool hasRoomForPeer();
+
+    int m_maxObservers;
+    int m_maxPeers;
+    QList<QPointer<QScriptDebuggerTransport> > m_peers;
+};
+
+#endif
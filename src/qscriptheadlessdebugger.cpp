@@ -0,0 +1,864 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "qscriptheadlessdebugger.h"
+#include "qscriptremotetargetdebuggerconnection_p.h"
+#include "qscriptdebuggermetatypes_p.h"
+#include <QtCore/qeventloop.h>
+#include <QtCore/qpointer.h>
+#include <QtCore/qstringlist.h>
+#include <QtCore/qtimer.h>
+
+#include <private/qscriptdebuggercommand_p.h>
+#include <private/qscriptdebuggerevent_p.h>
+#include <private/qscriptdebuggerresponse_p.h>
+#include <private/qscriptdebuggervalue_p.h>
+#include <private/qscriptdebuggervalueproperty_p.h>
+#include <private/qscriptdebuggereventhandlerinterface_p.h>
+#include <private/qscriptdebuggerresponsehandlerinterface_p.h>
+#include <private/qscriptbreakpointdata_p.h>
+#include <private/qscriptscriptdata_p.h>
+
+/*!
+  \class QScriptHeadlessDebugger
+
+  \brief The QScriptHeadlessDebugger class debugs a remote target without
+  a user interface.
+
+  It speaks the same protocol as QScriptRemoteTargetDebugger, but has no
+  widgets and doesn't need a QApplication; it is meant for programs that
+  drive a target on their own, such as test runners or tools that collect
+  the stack when a script throws.
+
+  Every command returns a QScriptHeadlessDebuggerReply, which is finished
+  once the target has answered. The caller owns the reply and should
+  delete it, e.g. with deleteLater(), when done with it.
+
+  Like the standard debugger, the target suspends when the debugger
+  attaches, and again on breakpoints, on exceptions without a handler and
+  on debugger statements; evaluationSuspended() is emitted each time, and
+  the target stays suspended until continueEvaluation() or one of the
+  step functions is called.
+*/
+
+// The events of the target engine on one channel, and the commands that
+// are waiting for its answers.
+class QScriptHeadlessDebuggerSession
+    : public QScriptDebuggerEventHandlerInterface
+{
+public:
+    QScriptHeadlessDebuggerSession(QScriptHeadlessDebugger *debugger,
+                                   QScriptRemoteTargetDebuggerFrontend *frontend);
+    ~QScriptHeadlessDebuggerSession();
+
+    QScriptRemoteTargetDebuggerFrontend *frontend() const;
+    int channel() const;
+
+    bool isSuspended() const;
+    void setSuspended(bool suspended);
+    QScriptDebuggerEvent suspendEvent() const;
+
+    void addJob(QScriptHeadlessDebuggerJob *job);
+    void removeJob(QScriptHeadlessDebuggerJob *job);
+    void abortJobs(const QString &errorString);
+
+    bool debuggerEvent(const QScriptDebuggerEvent &event);
+
+private:
+    QScriptHeadlessDebugger *m_debugger;
+    QScriptRemoteTargetDebuggerFrontend *m_frontend;
+    QList<QScriptHeadlessDebuggerJob*> m_jobs;
+    bool m_suspended;
+    QScriptDebuggerEvent m_suspendEvent;
+};
+
+// A command, or a sequence of commands, whose outcome is reported to a
+// QScriptHeadlessDebuggerReply. A job deletes itself when it finishes.
+class QScriptHeadlessDebuggerJob
+    : public QScriptDebuggerResponseHandlerInterface
+{
+public:
+    QScriptHeadlessDebuggerJob() : m_session(0) {}
+    virtual ~QScriptHeadlessDebuggerJob() {}
+
+    void start(QScriptHeadlessDebuggerSession *session, QScriptHeadlessDebuggerReply *reply);
+    void abort(const QString &errorString);
+
+    // Gives the job the chance to consume an event of its session;
+    // returns true if it did.
+    virtual bool handleEvent(const QScriptDebuggerEvent &) { return false; }
+
+protected:
+    virtual void run() = 0;
+
+    void schedule(const QScriptDebuggerCommand &command);
+    bool failed(const QScriptDebuggerResponse &response);
+    void finish(const QVariant &result = QVariant());
+    void fail(const QString &errorString);
+
+    QScriptHeadlessDebuggerSession *m_session;
+
+private:
+    QPointer<QScriptHeadlessDebuggerReply> m_reply;
+};
+
+void QScriptHeadlessDebuggerJob::start(QScriptHeadlessDebuggerSession *session,
+                                       QScriptHeadlessDebuggerReply *reply)
+{
+    m_session = session;
+    m_reply = reply;
+    m_session->addJob(this);
+    run();
+}
+
+void QScriptHeadlessDebuggerJob::abort(const QString &errorString)
+{
+    if (m_reply)
+        m_reply->setFinished(QVariant(), errorString);
+    delete this;
+}
+
+void QScriptHeadlessDebuggerJob::schedule(const QScriptDebuggerCommand &command)
+{
+    m_session->frontend()->scheduleCommand(command, this);
+}
+
+/*!
+  If \a response is an error, fails the job and returns true; the job
+  has been deleted then.
+*/
+bool QScriptHeadlessDebuggerJob::failed(const QScriptDebuggerResponse &response)
+{
+    if (response.error() == QScriptDebuggerResponse::NoError)
+        return false;
+    switch (response.error()) {
+    case QScriptDebuggerResponse::InvalidContextIndex:
+        fail(QString::fromLatin1("invalid frame index"));
+        break;
+    case QScriptDebuggerResponse::InvalidArgumentIndex:
+        fail(QString::fromLatin1("invalid argument index"));
+        break;
+    case QScriptDebuggerResponse::InvalidScriptID:
+        fail(QString::fromLatin1("invalid script id"));
+        break;
+    case QScriptDebuggerResponse::InvalidBreakpointID:
+        fail(QString::fromLatin1("invalid breakpoint id"));
+        break;
+    default:
+        fail(QString::fromLatin1("the target couldn't execute the command (error %0)")
+             .arg(int(response.error())));
+        break;
+    }
+    return true;
+}
+
+void QScriptHeadlessDebuggerJob::finish(const QVariant &result)
+{
+    m_session->removeJob(this);
+    if (m_reply)
+        m_reply->setFinished(result, QString());
+    delete this;
+}
+
+void QScriptHeadlessDebuggerJob::fail(const QString &errorString)
+{
+    m_session->removeJob(this);
+    abort(errorString);
+}
+
+namespace {
+
+// A single command whose result is passed on as it is, or converted to a
+// list of strings.
+class CommandJob : public QScriptHeadlessDebuggerJob
+{
+public:
+    enum Conversion {
+        NoConversion,
+        NoResult,
+        ScriptFileNames
+    };
+
+    CommandJob(const QScriptDebuggerCommand &command, Conversion conversion = NoConversion)
+        : m_command(command), m_conversion(conversion) {}
+
+    void run()
+    {
+        schedule(m_command);
+    }
+
+    void handleResponse(const QScriptDebuggerResponse &response, int)
+    {
+        if (failed(response))
+            return;
+        switch (m_conversion) {
+        case NoConversion:
+            finish(response.result());
+            break;
+        case NoResult:
+            finish();
+            break;
+        case ScriptFileNames: {
+            QScriptScriptMap scripts = qvariant_cast<QScriptScriptMap>(response.result());
+            QStringList fileNames;
+            QScriptScriptMap::const_iterator it;
+            for (it = scripts.constBegin(); it != scripts.constEnd(); ++it)
+                fileNames.append(it.value().fileName());
+            finish(fileNames);
+        }   break;
+        }
+    }
+
+private:
+    QScriptDebuggerCommand m_command;
+    Conversion m_conversion;
+};
+
+// Continue or one of the step commands; the target is no longer
+// suspended once it has been answered.
+class ResumeJob : public QScriptHeadlessDebuggerJob
+{
+public:
+    ResumeJob(const QScriptDebuggerCommand &command)
+        : m_command(command) {}
+
+    void run()
+    {
+        if (!m_session->isSuspended()) {
+            fail(QString::fromLatin1("the target isn't suspended"));
+            return;
+        }
+        schedule(m_command);
+    }
+
+    void handleResponse(const QScriptDebuggerResponse &response, int)
+    {
+        if (failed(response))
+            return;
+        m_session->setSuspended(false);
+        finish();
+    }
+
+private:
+    QScriptDebuggerCommand m_command;
+};
+
+// Lists the variables of a frame: its activation object is iterated and
+// each property is returned with the string form of its value.
+class LocalsJob : public QScriptHeadlessDebuggerJob
+{
+public:
+    LocalsJob(int frameIndex)
+        : m_frameIndex(frameIndex), m_state(GettingObject), m_iteratorId(-1) {}
+
+    enum { PropertiesPerCommand = 100 };
+
+    void run()
+    {
+        schedule(QScriptDebuggerCommand::getActivationObjectCommand(m_frameIndex));
+    }
+
+    void handleResponse(const QScriptDebuggerResponse &response, int)
+    {
+        if (response.error() != QScriptDebuggerResponse::NoError) {
+            // the iterator would be kept on the target otherwise
+            releaseIterator();
+            failed(response);
+            return;
+        }
+        switch (m_state) {
+        case GettingObject:
+            m_state = CreatingIterator;
+            schedule(QScriptDebuggerCommand::newScriptValueIteratorCommand(
+                         qvariant_cast<QScriptDebuggerValue>(response.result())));
+            break;
+        case CreatingIterator:
+            m_state = GettingProperties;
+            m_iteratorId = response.resultAsInt();
+            schedule(QScriptDebuggerCommand::getPropertiesByIteratorCommand(
+                         m_iteratorId, PropertiesPerCommand));
+            break;
+        case GettingProperties: {
+            QScriptDebuggerValuePropertyList properties =
+                qvariant_cast<QScriptDebuggerValuePropertyList>(response.result());
+            for (int i = 0; i < properties.size(); ++i)
+                m_locals.insert(properties.at(i).name(), properties.at(i).valueAsString());
+            if (properties.size() == PropertiesPerCommand) {
+                schedule(QScriptDebuggerCommand::getPropertiesByIteratorCommand(
+                             m_iteratorId, PropertiesPerCommand));
+                break;
+            }
+            releaseIterator();
+            finish(m_locals);
+        }   break;
+        }
+    }
+
+private:
+    enum State {
+        GettingObject,
+        CreatingIterator,
+        GettingProperties
+    };
+
+    void releaseIterator()
+    {
+        if (m_iteratorId != -1) {
+            m_session->frontend()->scheduleCommand(
+                QScriptDebuggerCommand::deleteScriptValueIteratorCommand(m_iteratorId),
+                /*responseHandler=*/0);
+        }
+    }
+
+    int m_frameIndex;
+    State m_state;
+    int m_iteratorId;
+    QVariantMap m_locals;
+};
+
+// Evaluates a program in a frame. The target answers the command right
+// away, and reports the result with an event once it has run the program.
+class EvaluateJob : public QScriptHeadlessDebuggerJob
+{
+public:
+    EvaluateJob(const QString &program, int frameIndex)
+        : m_program(program), m_frameIndex(frameIndex) {}
+
+    void run()
+    {
+        if (!m_session->isSuspended()) {
+            fail(QString::fromLatin1("the target isn't suspended"));
+            return;
+        }
+        schedule(QScriptDebuggerCommand::evaluateCommand(m_frameIndex, m_program));
+    }
+
+    void handleResponse(const QScriptDebuggerResponse &response, int)
+    {
+        failed(response);
+    }
+
+    bool handleEvent(const QScriptDebuggerEvent &event)
+    {
+        if (event.type() != QScriptDebuggerEvent::InlineEvalFinished)
+            return false;
+        finish(event.message());
+        return true;
+    }
+
+private:
+    QString m_program;
+    int m_frameIndex;
+};
+
+} // namespace
+
+QScriptHeadlessDebuggerSession::QScriptHeadlessDebuggerSession(
+    QScriptHeadlessDebugger *debugger, QScriptRemoteTargetDebuggerFrontend *frontend)
+    : m_debugger(debugger), m_frontend(frontend), m_suspended(false),
+      m_suspendEvent(QScriptDebuggerEvent::None)
+{
+    m_frontend->setEventHandler(this);
+}
+
+QScriptHeadlessDebuggerSession::~QScriptHeadlessDebuggerSession()
+{
+    abortJobs(QString::fromLatin1("the channel was closed"));
+    m_frontend->setEventHandler(0);
+}
+
+QScriptRemoteTargetDebuggerFrontend *QScriptHeadlessDebuggerSession::frontend() const
+{
+    return m_frontend;
+}
+
+int QScriptHeadlessDebuggerSession::channel() const
+{
+    return m_frontend->channel();
+}
+
+bool QScriptHeadlessDebuggerSession::isSuspended() const
+{
+    return m_suspended;
+}
+
+/*!
+  Returns the event that the target last suspended on.
+*/
+QScriptDebuggerEvent QScriptHeadlessDebuggerSession::suspendEvent() const
+{
+    return m_suspendEvent;
+}
+
+void QScriptHeadlessDebuggerSession::setSuspended(bool suspended)
+{
+    if (suspended == m_suspended)
+        return;
+    m_suspended = suspended;
+    if (!suspended)
+        m_debugger->notifyResumed(channel());
+}
+
+void QScriptHeadlessDebuggerSession::addJob(QScriptHeadlessDebuggerJob *job)
+{
+    m_jobs.append(job);
+}
+
+void QScriptHeadlessDebuggerSession::removeJob(QScriptHeadlessDebuggerJob *job)
+{
+    m_jobs.removeOne(job);
+}
+
+/*!
+  Fails the jobs that are waiting for the target; their commands won't
+  be answered.
+*/
+void QScriptHeadlessDebuggerSession::abortJobs(const QString &errorString)
+{
+    QList<QScriptHeadlessDebuggerJob*> jobs = m_jobs;
+    m_jobs.clear();
+    for (int i = 0; i < jobs.size(); ++i)
+        jobs.at(i)->abort(errorString);
+}
+
+/*!
+  \reimp
+
+  Returns true if the target should be resumed.
+*/
+bool QScriptHeadlessDebuggerSession::debuggerEvent(const QScriptDebuggerEvent &event)
+{
+    QList<QScriptHeadlessDebuggerJob*> jobs = m_jobs;
+    for (int i = 0; i < jobs.size(); ++i) {
+        // a job that consumes an event leaves the target as it was
+        if (jobs.at(i)->handleEvent(event))
+            return false;
+    }
+    switch (event.type()) {
+    case QScriptDebuggerEvent::Trace:
+        m_debugger->notifyOutput(channel(), event.message());
+        return true;
+    case QScriptDebuggerEvent::Exception:
+        // let the script handle it
+        if (event.hasExceptionHandler())
+            return true;
+        break;
+    case QScriptDebuggerEvent::Interrupted:
+    case QScriptDebuggerEvent::SteppingFinished:
+    case QScriptDebuggerEvent::LocationReached:
+    case QScriptDebuggerEvent::Breakpoint:
+    case QScriptDebuggerEvent::DebuggerInvocationRequest:
+        break;
+    case QScriptDebuggerEvent::InlineEvalFinished:
+        // the result of an evaluation that nobody is waiting for
+        return false;
+    default:
+        return true;
+    }
+    m_suspended = true;
+    m_suspendEvent = event;
+    // not while the frame is being dispatched, so that the receivers can
+    // wait for the replies to their commands
+    QMetaObject::invokeMethod(m_debugger, "deliverSuspended", Qt::QueuedConnection,
+                              Q_ARG(int, channel()));
+    return false;
+}
+
+/*!
+  \class QScriptHeadlessDebuggerReply
+
+  \brief The QScriptHeadlessDebuggerReply class holds the outcome of a
+  command sent by QScriptHeadlessDebugger.
+
+  finished() is emitted once the target has answered, or once it is
+  clear that it won't, e.g. because the debugger has detached; it is
+  always emitted from the event loop, even if the reply is finished by
+  the time it is returned.
+*/
+
+QScriptHeadlessDebuggerReply::QScriptHeadlessDebuggerReply(int channel, QObject *parent)
+    : QObject(parent), m_channel(channel), m_finished(false)
+{
+}
+
+QScriptHeadlessDebuggerReply::~QScriptHeadlessDebuggerReply()
+{
+}
+
+/*!
+  Returns the channel of the session that the command was sent to.
+*/
+int QScriptHeadlessDebuggerReply::channel() const
+{
+    return m_channel;
+}
+
+bool QScriptHeadlessDebuggerReply::isFinished() const
+{
+    return m_finished;
+}
+
+bool QScriptHeadlessDebuggerReply::hasError() const
+{
+    return m_finished && !m_errorString.isEmpty();
+}
+
+QString QScriptHeadlessDebuggerReply::errorString() const
+{
+    return m_errorString;
+}
+
+/*!
+  Returns the result of the command, once finished; see the function of
+  QScriptHeadlessDebugger that returned the reply for its type.
+*/
+QVariant QScriptHeadlessDebuggerReply::result() const
+{
+    return m_result;
+}
+
+/*!
+  Processes events until the reply is finished, or until \a msecs ms
+  have passed. Returns true if the reply is finished.
+*/
+bool QScriptHeadlessDebuggerReply::waitForFinished(int msecs)
+{
+    if (m_finished)
+        return true;
+    QEventLoop loop;
+    QObject::connect(this, SIGNAL(finished()), &loop, SLOT(quit()));
+    QTimer::singleShot(msecs, &loop, SLOT(quit()));
+    loop.exec();
+    return m_finished;
+}
+
+void QScriptHeadlessDebuggerReply::setFinished(const QVariant &result, const QString &errorString)
+{
+    m_finished = true;
+    m_result = result;
+    m_errorString = errorString;
+    // a reply may be finished before it has been returned to the caller;
+    // make sure that the caller gets the signal
+    QMetaObject::invokeMethod(this, "finished", Qt::QueuedConnection);
+}
+
+QScriptHeadlessDebugger::QScriptHeadlessDebugger(QObject *parent)
+    : QObject(parent), m_connection(0)
+{
+}
+
+QScriptHeadlessDebugger::~QScriptHeadlessDebugger()
+{
+    qDeleteAll(m_sessions);
+    delete m_connection;
+}
+
+void QScriptHeadlessDebugger::attachTo(const QHostAddress &address, quint16 port)
+{
+    attachTo(TcpTransport, QString::fromLatin1("%0:%1").arg(address.toString()).arg(port));
+}
+
+/*!
+  Attaches to the target at the given \a address over the given \a
+  transport; see QScriptRemoteTargetDebugger::attachTo() for the format
+  of the address.
+*/
+void QScriptHeadlessDebugger::attachTo(Transport transport, const QString &address)
+{
+    createConnection();
+    m_connection->attachTo(transport, address);
+}
+
+void QScriptHeadlessDebugger::detach()
+{
+    if (m_connection)
+        m_connection->detach();
+}
+
+bool QScriptHeadlessDebugger::isAttached() const
+{
+    return m_connection && m_connection->isAttached();
+}
+
+bool QScriptHeadlessDebugger::listen(const QHostAddress &address, quint16 port)
+{
+    return listen(TcpTransport, QString::fromLatin1("%0:%1").arg(address.toString()).arg(port));
+}
+
+/*!
+  Listens for a target to connect over the given \a transport, on the
+  given \a address. PipeTransport can only be used with attachTo().
+*/
+bool QScriptHeadlessDebugger::listen(Transport transport, const QString &address)
+{
+    if (transport == PipeTransport)
+        return false;
+    createConnection();
+    return m_connection->listen(transport, address);
+}
+
+/*!
+  Returns the channels of the target engines that the debugger is
+  attached to.
+*/
+QList<int> QScriptHeadlessDebugger::channels() const
+{
+    return m_sessions.keys();
+}
+
+QString QScriptHeadlessDebugger::channelName(int channel) const
+{
+    QScriptHeadlessDebuggerSession *session = m_sessions.value(channel);
+    return session ? session->frontend()->name() : QString();
+}
+
+/*!
+  Returns true if the target engine on \a channel is suspended, i.e. if
+  evaluationSuspended() has been emitted for it and it hasn't been told
+  to continue since.
+*/
+bool QScriptHeadlessDebugger::isSuspended(int channel) const
+{
+    QScriptHeadlessDebuggerSession *session = m_sessions.value(channel);
+    return session && session->isSuspended();
+}
+
+/*!
+  Asks the target engine on \a channel to suspend at the next statement
+  it executes. The reply is finished when the target has received the
+  request; evaluationSuspended() follows once it has suspended.
+*/
+QScriptHeadlessDebuggerReply *QScriptHeadlessDebugger::interrupt(int channel)
+{
+    return start(channel, new CommandJob(QScriptDebuggerCommand::interruptCommand(),
+                                         CommandJob::NoResult));
+}
+
+/*!
+  Lets the suspended target engine on \a channel run on.
+*/
+QScriptHeadlessDebuggerReply *QScriptHeadlessDebugger::continueEvaluation(int channel)
+{
+    return start(channel, new ResumeJob(QScriptDebuggerCommand::continueCommand()));
+}
+
+QScriptHeadlessDebuggerReply *QScriptHeadlessDebugger::stepInto(int channel)
+{
+    return start(channel, new ResumeJob(QScriptDebuggerCommand::stepIntoCommand()));
+}
+
+QScriptHeadlessDebuggerReply *QScriptHeadlessDebugger::stepOver(int channel)
+{
+    return start(channel, new ResumeJob(QScriptDebuggerCommand::stepOverCommand()));
+}
+
+QScriptHeadlessDebuggerReply *QScriptHeadlessDebugger::stepOut(int channel)
+{
+    return start(channel, new ResumeJob(QScriptDebuggerCommand::stepOutCommand()));
+}
+
+/*!
+  Sets a breakpoint at the given \a fileName and \a lineNumber of the
+  target engine on \a channel. If \a condition is not empty, the target
+  only suspends if it evaluates to true. The result is the id of the
+  breakpoint, as an int.
+*/
+QScriptHeadlessDebuggerReply *QScriptHeadlessDebugger::setBreakpoint(int channel, const QString &fileName,
+                                                                     int lineNumber, const QString &condition)
+{
+    QScriptBreakpointData data(fileName, lineNumber);
+    if (!condition.isEmpty())
+        data.setCondition(condition);
+    return start(channel, new CommandJob(QScriptDebuggerCommand::setBreakpointCommand(data)));
+}
+
+QScriptHeadlessDebuggerReply *QScriptHeadlessDebugger::deleteBreakpoint(int channel, int breakpointId)
+{
+    return start(channel, new CommandJob(QScriptDebuggerCommand::deleteBreakpointCommand(breakpointId),
+                                         CommandJob::NoResult));
+}
+
+/*!
+  Asks for the file names of the scripts that the target engine on \a
+  channel has loaded. The result is a QStringList.
+*/
+QScriptHeadlessDebuggerReply *QScriptHeadlessDebugger::scripts(int channel)
+{
+    return start(channel, new CommandJob(QScriptDebuggerCommand::getScriptsCommand(),
+                                         CommandJob::ScriptFileNames));
+}
+
+/*!
+  Asks for \a frameCount frames of the stack of the target engine on \a
+  channel, starting with \a firstFrame; 0 is the innermost frame. The
+  result is a QStringList with one line per frame, followed by one that
+  tells how many frames are left if the stack goes on.
+*/
+QScriptHeadlessDebuggerReply *QScriptHeadlessDebugger::backtrace(int channel, int firstFrame, int frameCount)
+{
+    QScriptDebuggerCommand command = QScriptDebuggerCommand::getBacktraceCommand();
+    command.setContextIndex(firstFrame);
+    command.setAttribute(QScriptDebuggerCommand::Attribute(QScriptDebuggerProtocol::BacktraceFrameCountAttribute),
+                         frameCount);
+    return start(channel, new CommandJob(command));
+}
+
+/*!
+  Asks for the local variables of the given frame of the suspended
+  target engine on \a channel; 0 is the innermost frame. The result is a
+  QVariantMap from the names of the variables to the string forms of
+  their values.
+*/
+QScriptHeadlessDebuggerReply *QScriptHeadlessDebugger::locals(int channel, int frameIndex)
+{
+    return start(channel, new LocalsJob(frameIndex));
+}
+
+/*!
+  Evaluates \a program in the given frame of the suspended target engine
+  on \a channel. The result is the string form of the value of the
+  program.
+*/
+QScriptHeadlessDebuggerReply *QScriptHeadlessDebugger::evaluate(int channel, const QString &program,
+                                                                int frameIndex)
+{
+    return start(channel, new EvaluateJob(program, frameIndex));
+}
+
+QScriptHeadlessDebuggerReply *QScriptHeadlessDebugger::start(int channel, QScriptHeadlessDebuggerJob *job)
+{
+    QScriptHeadlessDebuggerReply *reply = new QScriptHeadlessDebuggerReply(channel, this);
+    QScriptHeadlessDebuggerSession *session = m_sessions.value(channel);
+    if (!session || !isAttached()) {
+        reply->setFinished(QVariant(), QString::fromLatin1("not attached to channel %0").arg(channel));
+        delete job;
+        return reply;
+    }
+    job->start(session, reply);
+    return reply;
+}
+
+void QScriptHeadlessDebugger::deliverSuspended(int channel)
+{
+    QScriptHeadlessDebuggerSession *session = m_sessions.value(channel);
+    // it may have been told to continue in the meantime
+    if (!session || !session->isSuspended())
+        return;
+    QScriptDebuggerEvent event = session->suspendEvent();
+    SuspendReason reason;
+    switch (event.type()) {
+    case QScriptDebuggerEvent::SteppingFinished:
+        reason = SteppingFinished;
+        break;
+    case QScriptDebuggerEvent::LocationReached:
+        reason = LocationReached;
+        break;
+    case QScriptDebuggerEvent::Breakpoint:
+        reason = BreakpointReached;
+        break;
+    case QScriptDebuggerEvent::Exception:
+        reason = ExceptionThrown;
+        break;
+    case QScriptDebuggerEvent::DebuggerInvocationRequest:
+        reason = DebuggerStatement;
+        break;
+    default:
+        reason = Interrupted;
+        break;
+    }
+    emit evaluationSuspended(channel, reason, event.fileName(), event.lineNumber(), event.message());
+}
+
+void QScriptHeadlessDebugger::notifyResumed(int channel)
+{
+    emit evaluationResumed(channel);
+}
+
+void QScriptHeadlessDebugger::notifyOutput(int channel, const QString &message)
+{
+    emit debugOutput(channel, message);
+}
+
+void QScriptHeadlessDebugger::createConnection()
+{
+    if (m_connection)
+        return;
+    m_connection = new QScriptRemoteTargetDebuggerConnection();
+    QObject::connect(m_connection, SIGNAL(attached()), this, SLOT(onAttached()), Qt::QueuedConnection);
+    QObject::connect(m_connection, SIGNAL(detached()), this, SLOT(onDetached()), Qt::QueuedConnection);
+    QObject::connect(m_connection, SIGNAL(error(int)), this, SLOT(onConnectionError(int)));
+    // the session must exist before the first event for the channel is
+    // delivered, so these connections must be direct
+    QObject::connect(m_connection, SIGNAL(channelOpened(QScriptRemoteTargetDebuggerFrontend*)),
+                     this, SLOT(onChannelOpened(QScriptRemoteTargetDebuggerFrontend*)));
+    QObject::connect(m_connection, SIGNAL(channelClosed(QScriptRemoteTargetDebuggerFrontend*)),
+                     this, SLOT(onChannelClosed(QScriptRemoteTargetDebuggerFrontend*)));
+    QObject::connect(m_connection, SIGNAL(outputAvailable(QScriptRemoteTargetDebuggerFrontend*)),
+                     this, SLOT(onOutputAvailable(QScriptRemoteTargetDebuggerFrontend*)),
+                     Qt::QueuedConnection);
+}
+
+void QScriptHeadlessDebugger::onAttached()
+{
+    emit attached();
+}
+
+void QScriptHeadlessDebugger::onDetached()
+{
+    // the frontends are kept for the next connection, but nothing that
+    // was sent on this one will be answered
+    QMap<int, QScriptHeadlessDebuggerSession*>::const_iterator it;
+    for (it = m_sessions.constBegin(); it != m_sessions.constEnd(); ++it) {
+        it.value()->abortJobs(QString::fromLatin1("detached from the target"));
+        it.value()->setSuspended(false);
+    }
+    emit detached();
+}
+
+void QScriptHeadlessDebugger::onConnectionError(int error)
+{
+    emit this->error(Error(error));
+}
+
+void QScriptHeadlessDebugger::onChannelOpened(QScriptRemoteTargetDebuggerFrontend *frontend)
+{
+    int channel = frontend->channel();
+    if (!m_sessions.contains(channel))
+        m_sessions.insert(channel, new QScriptHeadlessDebuggerSession(this, frontend));
+    emit channelOpened(channel, frontend->name());
+}
+
+void QScriptHeadlessDebugger::onChannelClosed(QScriptRemoteTargetDebuggerFrontend *frontend)
+{
+    int channel = frontend->channel();
+    delete m_sessions.take(channel);
+    emit channelClosed(channel);
+}
+
+void QScriptHeadlessDebugger::onOutputAvailable(QScriptRemoteTargetDebuggerFrontend *frontend)
+{
+    // the frontend may have been deleted since the signal was posted
+    if (!m_connection || !m_connection->frontends().contains(frontend))
+        return;
+    QList<QScriptDebuggerOutputEntry> output = frontend->takeOutput();
+    for (int i = 0; i < output.size(); ++i)
+        emit debugOutput(frontend->channel(), output.at(i).message);
+}
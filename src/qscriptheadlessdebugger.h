@@ -0,0 +1,171 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef QSCRIPTHEADLESSDEBUGGER_H
+#define QSCRIPTHEADLESSDEBUGGER_H
+
+#include <QtCore/qobject.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qmap.h>
+#include <QtCore/qstring.h>
+#include <QtCore/qvariant.h>
+#include <QtNetwork/qhostaddress.h>
+
+class QScriptRemoteTargetDebuggerConnection;
+class QScriptRemoteTargetDebuggerFrontend;
+class QScriptHeadlessDebuggerSession;
+class QScriptHeadlessDebuggerJob;
+
+class QScriptHeadlessDebuggerReply
+    : public QObject
+{
+    Q_OBJECT
+public:
+    ~QScriptHeadlessDebuggerReply();
+
+    int channel() const;
+
+    bool isFinished() const;
+    bool hasError() const;
+    QString errorString() const;
+    QVariant result() const;
+
+    bool waitForFinished(int msecs = 30000);
+
+Q_SIGNALS:
+    void finished();
+
+private:
+    QScriptHeadlessDebuggerReply(int channel, QObject *parent);
+    void setFinished(const QVariant &result, const QString &errorString);
+
+private:
+    int m_channel;
+    bool m_finished;
+    QVariant m_result;
+    QString m_errorString;
+
+    friend class QScriptHeadlessDebugger;
+    friend class QScriptHeadlessDebuggerJob;
+    Q_DISABLE_COPY(QScriptHeadlessDebuggerReply)
+};
+
+class QScriptHeadlessDebugger
+    : public QObject
+{
+    Q_OBJECT
+public:
+    // same values as QScriptRemoteTargetDebugger::Error
+    enum Error {
+        NoError,
+        HostNotFoundError,
+        ConnectionRefusedError,
+        HandshakeError,
+        SocketError,
+        ProtocolError
+    };
+
+    // same values as QScriptRemoteTargetDebugger::Transport
+    enum Transport {
+        TcpTransport,
+        LocalSocketTransport,
+        PipeTransport,
+        SharedMemoryTransport
+    };
+
+    enum SuspendReason {
+        Interrupted,
+        SteppingFinished,
+        LocationReached,
+        BreakpointReached,
+        ExceptionThrown,
+        DebuggerStatement
+    };
+
+    QScriptHeadlessDebugger(QObject *parent = 0);
+    ~QScriptHeadlessDebugger();
+
+    void attachTo(const QHostAddress &address, quint16 port);
+    void attachTo(Transport transport, const QString &address);
+    void detach();
+    bool isAttached() const;
+
+    bool listen(const QHostAddress &address = QHostAddress::Any, quint16 port = 0);
+    bool listen(Transport transport, const QString &address);
+
+    QList<int> channels() const;
+    QString channelName(int channel) const;
+    bool isSuspended(int channel) const;
+
+    QScriptHeadlessDebuggerReply *interrupt(int channel);
+    QScriptHeadlessDebuggerReply *continueEvaluation(int channel);
+    QScriptHeadlessDebuggerReply *stepInto(int channel);
+    QScriptHeadlessDebuggerReply *stepOver(int channel);
+    QScriptHeadlessDebuggerReply *stepOut(int channel);
+
+    QScriptHeadlessDebuggerReply *setBreakpoint(int channel, const QString &fileName, int lineNumber,
+                                                const QString &condition = QString());
+    QScriptHeadlessDebuggerReply *deleteBreakpoint(int channel, int breakpointId);
+
+    QScriptHeadlessDebuggerReply *scripts(int channel);
+    QScriptHeadlessDebuggerReply *backtrace(int channel, int firstFrame = 0, int frameCount = 100);
+    QScriptHeadlessDebuggerReply *locals(int channel, int frameIndex = 0);
+    QScriptHeadlessDebuggerReply *evaluate(int channel, const QString &program, int frameIndex = 0);
+
+Q_SIGNALS:
+    void attached();
+    void detached();
+    void error(QScriptHeadlessDebugger::Error error);
+
+    void channelOpened(int channel, const QString &name);
+    void channelClosed(int channel);
+
+    void evaluationSuspended(int channel, QScriptHeadlessDebugger::SuspendReason reason,
+                             const QString &fileName, int lineNumber, const QString &message);
+    void evaluationResumed(int channel);
+    void debugOutput(int channel, const QString &message);
+
+private Q_SLOTS:
+    void onAttached();
+    void onDetached();
+    void onConnectionError(int error);
+    void onChannelOpened(QScriptRemoteTargetDebuggerFrontend *frontend);
+    void onChannelClosed(QScriptRemoteTargetDebuggerFrontend *frontend);
+    void onOutputAvailable(QScriptRemoteTargetDebuggerFrontend *frontend);
+    void deliverSuspended(int channel);
+
+private:
+    void createConnection();
+    QScriptHeadlessDebuggerReply *start(int channel, QScriptHeadlessDebuggerJob *job);
+    QScriptHeadlessDebuggerReply *resume(int channel, int command);
+    void notifyResumed(int channel);
+    void notifyOutput(int channel, const QString &message);
+
+private:
+    QScriptRemoteTargetDebuggerConnection *m_connection;
+    QMap<int, QScriptHeadlessDebuggerSession*> m_sessions;
+
+    friend class QScriptHeadlessDebuggerSession;
+    friend class QScriptHeadlessDebuggerJob;
+    Q_DISABLE_COPY(QScriptHeadlessDebugger)
+};
+
+#endif
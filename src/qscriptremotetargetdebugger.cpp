@@ -20,333 +20,955 @@
 ****************************************************************************/
 
 #include "qscriptremotetargetdebugger.h"
-#include <QtNetwork/qtcpserver.h>
-#include <QtNetwork/qtcpsocket.h>
+#include "qscriptremotetargetdebuggerconnection_p.h"
+#include "qscriptdebuggermetatypes_p.h"
+#include "qscriptdebuggerprofilerwidget_p.h"
+#include "qscriptdebuggercoveragegutter_p.h"
+#include "qscriptdebuggerheapsnapshotwidget_p.h"
+#include "qscriptdebuggersessionswidget_p.h"
 #include <QtGui>
 
-#include <private/qscriptdebuggerfrontend_p.h>
 #include <private/qscriptdebugger_p.h>
 #include <private/qscriptdebuggercommand_p.h>
 #include <private/qscriptdebuggerevent_p.h>
 #include <private/qscriptdebuggerresponse_p.h>
 #include <private/qscriptdebuggerstandardwidgetfactory_p.h>
+#include <private/qscriptdebugoutputwidgetinterface_p.h>
+#include <private/qscriptdebuggercodewidgetinterface_p.h>
+#include <private/qscriptdebuggercodeviewinterface_p.h>
+#include <private/qscriptdebuggerscriptswidgetinterface_p.h>
+#include <private/qscriptbreakpointdata_p.h>
 
-// #define DEBUG_DEBUGGER
+QScriptRemoteTargetDebugger::QScriptRemoteTargetDebugger(QObject *parent)
+    : QObject(parent), m_connection(0), m_debugger(0), m_currentChannel(-1),
+      m_maxConnections(1), m_hubTransport(0), m_autoShow(true), m_commandBatching(true), m_compression(true),
+      m_scriptCacheDirectory(QScriptDebuggerScriptCache::defaultDirectory()),
+      m_standardWindow(0), m_standardToolBar(0), m_profilerWidget(0),
+      m_heapSnapshotWidget(0), m_sessionsWidget(0)
+{
+}
 
-class QScriptRemoteTargetDebuggerFrontend
-    : public QObject, public QScriptDebuggerFrontend
+QScriptRemoteTargetDebugger::~QScriptRemoteTargetDebugger()
 {
-    Q_OBJECT
-public:
-    enum State {
-        UnattachedState,
-        ConnectingState,
-        HandshakingState,
-        AttachedState,
-        DetachingState
-    };
+    if (m_profilerWidget && !m_profilerWidget->parent())
+        delete m_profilerWidget;
+    if (m_heapSnapshotWidget && !m_heapSnapshotWidget->parent())
+        delete m_heapSnapshotWidget;
+    if (m_sessionsWidget && !m_sessionsWidget->parent())
+        delete m_sessionsWidget;
+    qDeleteAll(m_hubConnections);
+    delete m_connection;
+    QList<QScriptDebugger*> debuggers = m_debuggers.values();
+    if (!debuggers.contains(m_debugger))
+        debuggers.append(m_debugger);
+    qDeleteAll(debuggers);
+}
 
-    QScriptRemoteTargetDebuggerFrontend();
-    ~QScriptRemoteTargetDebuggerFrontend();
+void QScriptRemoteTargetDebugger::attachTo(const QHostAddress &address, quint16 port)
+{
+    attachTo(TcpTransport, QString::fromLatin1("%0:%1").arg(address.toString()).arg(port));
+}
 
-    void attachTo(const QHostAddress &address, quint16 port);
-    void detach();
-    bool listen(const QHostAddress &address, quint16 port);
+/*!
+  Attaches to the target at the given \a address over the given \a
+  transport. The address is interpreted as follows:
 
-Q_SIGNALS:
-    void attached();
-    void detached();
-    void error(QScriptRemoteTargetDebugger::Error error);
+  \table
+  \header \o Transport \o Address
+  \row \o TcpTransport \o "host:port"
+  \row \o LocalSocketTransport \o the name the target listens on (see
+       QLocalServer)
+  \row \o PipeTransport \o the command line of a program to start; the
+       debugger talks to it over its stdin and stdout (see
+       QScriptDebuggerEngine::connectToDebugger())
+  \row \o SharedMemoryTransport \o the key the target listens on
+  \endtable
+*/
+void QScriptRemoteTargetDebugger::attachTo(Transport transport, const QString &address)
+{
+    createConnection();
+    m_connection->attachTo(transport, address);
+}
 
-protected:
-    void processCommand(int id, const QScriptDebuggerCommand &command);
+void QScriptRemoteTargetDebugger::detach()
+{
+    if (m_connection)
+        m_connection->detach();
+    // the list changes as they go
+    QList<QScriptRemoteTargetDebuggerConnection*> connections = m_hubConnections;
+    for (int i = 0; i < connections.size(); ++i)
+        connections.at(i)->detach();
+}
 
-private Q_SLOTS:
-    void onSocketStateChanged(QAbstractSocket::SocketState);
-    void onSocketError(QAbstractSocket::SocketError);
-    void onReadyRead();
-    void onNewConnection();
+bool QScriptRemoteTargetDebugger::listen(const QHostAddress &address, quint16 port)
+{
+    return listen(TcpTransport, QString::fromLatin1("%0:%1").arg(address.toString()).arg(port));
+}
 
-private:
-    void initiateHandshake();
+/*!
+  Listens for a target to connect over the given \a transport, on the
+  given \a address (see attachTo() for its format). PipeTransport can
+  only be used with attachTo().
 
-private:
-    State m_state;
-    QTcpServer *m_server;
-    QTcpSocket *m_socket;
-    int m_blockSize;
+  \sa setMaxConnections()
+*/
+bool QScriptRemoteTargetDebugger::listen(Transport transport, const QString &address)
+{
+    if (transport == PipeTransport)
+        return false;
+    createConnection();
+    m_connection->setMaxPeers((m_maxConnections > 1) ? m_maxConnections : 0);
+    m_hubTransport = transport;
+    return m_connection->listen(transport, address);
+}
 
-    Q_DISABLE_COPY(QScriptRemoteTargetDebuggerFrontend)
-};
+/*!
+  Returns the number of targets that listen() accepts at once.
+*/
+int QScriptRemoteTargetDebugger::maxConnections() const
+{
+    return m_maxConnections;
+}
+
+/*!
+  Sets the number of targets that listen() accepts at once to \a count.
+  By default only one is accepted, and listening stops once it has
+  connected. Must be called before listen().
 
-QScriptRemoteTargetDebuggerFrontend::QScriptRemoteTargetDebuggerFrontend()
-    : m_state(UnattachedState), m_server(0), m_socket(0), m_blockSize(0)
+  With a larger \a count the debugger acts as a hub: it keeps listening,
+  and every target that connects, e.g. each worker process of a cluster
+  calling QScriptDebuggerEngine::connectToDebugger() at startup, gets a
+  connection of its own, and a session for each of its engines. The
+  channels of these sessions are numbered by the debugger, and their
+  names include the target's address. The sessions widget (see
+  widget()) lists them and switches between them.
+
+  A session of a hub is idle until it is made current: it has no
+  debugger widgets, and nothing is sent to its target, not even a
+  request for the source of a script. The target is resumed right away
+  when it stops on connecting; if it stops for another reason, it stays
+  suspended until its session is opened, and is shown as suspended in
+  the sessions widget. The sessions of a target are closed when it
+  disconnects.
+
+  startRecording() and startMetricsDump() don't cover the targets of a
+  hub; metrics() returns those of the current session's target.
+
+  \sa setCurrentChannel()
+*/
+void QScriptRemoteTargetDebugger::setMaxConnections(int count)
 {
+    m_maxConnections = qMax(1, count);
 }
 
-QScriptRemoteTargetDebuggerFrontend::~QScriptRemoteTargetDebuggerFrontend()
+/*!
+  Plays back the first session recorded in the trace file \a fileName
+  (see startRecording() and QScriptDebuggerEngine::startRecording()) as
+  if a target was attached: the frames that the target sent are decoded
+  and shown at the given \a speed, and what the debugger sends is
+  dropped. replayFinished() is emitted after the last frame; the
+  debugger stays attached until detach() is called.
+
+  Returns false if the debugger is already attached. A trace that can't
+  be read is reported through error().
+*/
+bool QScriptRemoteTargetDebugger::replay(const QString &fileName, ReplaySpeed speed)
 {
+    createConnection();
+    return m_connection->replay(fileName, speed == FullSpeed);
 }
 
-void QScriptRemoteTargetDebuggerFrontend::attachTo(const QHostAddress &address, quint16 port)
+/*!
+  Starts recording every frame exchanged with the target, with its
+  direction and the time, to the trace file \a fileName. The file is
+  replaced. Recording continues across sessions until stopRecording()
+  is called. Returns false if the file can't be written.
+
+  \sa replay()
+*/
+bool QScriptRemoteTargetDebugger::startRecording(const QString &fileName)
 {
-    Q_ASSERT(m_state == UnattachedState);
-    if (!m_socket) {
-        m_socket = new QTcpSocket(this);
-        QObject::connect(m_socket, SIGNAL(stateChanged(QAbstractSocket::SocketState)),
-                         this, SLOT(onSocketStateChanged(QAbstractSocket::SocketState)));
-        QObject::connect(m_socket, SIGNAL(error(QAbstractSocket::SocketError)),
-                         this, SLOT(onSocketError(QAbstractSocket::SocketError)));
-        QObject::connect(m_socket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+    createConnection();
+    return m_connection->startRecording(fileName);
+}
+
+/*!
+  Stops recording and closes the trace file.
+*/
+void QScriptRemoteTargetDebugger::stopRecording()
+{
+    if (m_connection)
+        m_connection->stopRecording();
+}
+
+/*!
+  Returns what the debugger has counted and timed, keyed by metric name
+  and labels in the Prometheus notation, e.g.
+  command_round_trip_seconds_count{type="3"}.
+
+  \table
+  \header \o Metric \o What it counts
+  \row \o frames_total, bytes_total \o frames and bytes, by direction
+       and frame type
+  \row \o encode_seconds, decode_seconds \o the time spent encoding
+       commands and decoding events, by their type
+  \row \o command_round_trip_seconds \o the time from sending a command
+       to receiving its response, by command type
+  \row \o commands_in_flight \o the commands waiting for a response
+  \endtable
+
+  Times are histograms; this function returns their _count, and their
+  _sum in seconds. startMetricsDump() writes the buckets as well. The
+  target's side is kept by QScriptDebuggerEngine::metrics().
+
+  \sa resetMetrics()
+*/
+QVariantMap QScriptRemoteTargetDebugger::metrics() const
+{
+    QScriptRemoteTargetDebuggerConnection *connection = currentConnection();
+    if (!connection)
+        return QVariantMap();
+    return connection->metrics()->values();
+}
+
+/*!
+  Sets every metric back to 0.
+
+  \sa metrics()
+*/
+void QScriptRemoteTargetDebugger::resetMetrics()
+{
+    QScriptRemoteTargetDebuggerConnection *connection = currentConnection();
+    if (connection)
+        connection->metrics()->reset();
+}
+
+/*!
+  Starts writing the metrics to \a fileName in the Prometheus text
+  format every \a interval ms, with names prefixed by
+  qscriptremotetargetdebugger_. The file is replaced as a whole each
+  time. Returns false if it can't be written.
+
+  \sa stopMetricsDump(), metrics()
+*/
+bool QScriptRemoteTargetDebugger::startMetricsDump(const QString &fileName, int interval)
+{
+    createConnection();
+    return m_connection->startMetricsDump(fileName, interval);
+}
+
+/*!
+  Stops writing the metrics, after writing them one last time.
+*/
+void QScriptRemoteTargetDebugger::stopMetricsDump()
+{
+    if (m_connection)
+        m_connection->stopMetricsDump();
+}
+
+/*!
+  Returns the channels of the target engines that the debugger is
+  currently attached to. Each channel has its own debugging session
+  (scripts, breakpoints, stack and so on).
+*/
+QList<int> QScriptRemoteTargetDebugger::channels() const
+{
+    return m_frontends.keys();
+}
+
+/*!
+  Returns the name that the debuggee gave to the engine on the given
+  \a channel.
+*/
+QString QScriptRemoteTargetDebugger::channelName(int channel) const
+{
+    return m_channelNames.value(channel);
+}
+
+/*!
+  Returns the channel whose session is shown by widget(), action() and
+  the standard window, or -1 if no target engine has been attached yet.
+*/
+int QScriptRemoteTargetDebugger::currentChannel() const
+{
+    return m_currentChannel;
+}
+
+/*!
+  Makes the session of the given \a channel the current one. The
+  standard window, if created, is updated to show the session's widgets.
+  An idle session of a hub (see setMaxConnections()) is opened.
+*/
+void QScriptRemoteTargetDebugger::setCurrentChannel(int channel)
+{
+    QScriptRemoteTargetDebuggerFrontend *frontend = m_frontends.value(channel);
+    if (!frontend || (channel == m_currentChannel))
+        return;
+    m_debugger = openSession(channel);
+    m_currentChannel = channel;
+    if (m_standardWindow)
+        updateStandardWindow();
+    updateProfilerWidget();
+    updateHeapSnapshotWidget();
+    if (m_sessionsWidget)
+        m_sessionsWidget->setCurrentSession(channel);
+    emit currentChannelChanged(channel);
+    if (frontend->areEventsHeld()) {
+        // what happened while nobody was looking
+        frontend->setEventsHeld(false);
+        onOutputAvailable(frontend);
     }
-    m_socket->connectToHost(address, port);
 }
 
-void QScriptRemoteTargetDebuggerFrontend::detach()
+/*!
+  Sets a logpoint at the given \a fileName and \a lineNumber in the
+  current session. When the target reaches the location, \a expression
+  is evaluated in the current script context and the result is shown in
+  the debug output widget; the target is not suspended.
+
+  Returns false if there is no current session.
+*/
+bool QScriptRemoteTargetDebugger::setLogpoint(const QString &fileName, int lineNumber,
+                                              const QString &expression)
+{
+    QVariantMap spec;
+    spec.insert(QScriptDebuggerProtocol::breakpointKindKey(), QScriptDebuggerProtocol::logpointKind());
+    spec.insert(QScriptDebuggerProtocol::expressionKey(), expression);
+    return setNonSuspendingBreakpoint(fileName, lineNumber, spec);
+}
+
+/*!
+  Sets a tracepoint at the given \a fileName and \a lineNumber in the
+  current session. When the target reaches the location, at most
+  \a maxFrames frames of the backtrace are shown in the debug output
+  widget; the target is not suspended.
+
+  Returns false if there is no current session.
+*/
+bool QScriptRemoteTargetDebugger::setTracepoint(const QString &fileName, int lineNumber,
+                                                int maxFrames)
 {
-    Q_ASSERT_X(false, Q_FUNC_INFO, "implement me");
+    QVariantMap spec;
+    spec.insert(QScriptDebuggerProtocol::breakpointKindKey(), QScriptDebuggerProtocol::tracepointKind());
+    spec.insert(QScriptDebuggerProtocol::maxFramesKey(), maxFrames);
+    return setNonSuspendingBreakpoint(fileName, lineNumber, spec);
 }
 
-bool QScriptRemoteTargetDebuggerFrontend::listen(const QHostAddress &address, quint16 port)
+/*!
+  Starts profiling the current session: the target samples the stack of
+  the running script every \a interval ms without being suspended, and
+  streams the samples to the debugger, where they are shown by the
+  profiler widget (see widget()). Any previous profile of the session is
+  discarded.
+
+  Returns false if there is no current session, or if the target doesn't
+  support profiling.
+
+  \sa stopProfiling(), exportProfile()
+*/
+bool QScriptRemoteTargetDebugger::startProfiling(int interval)
 {
-    if (m_socket)
+    QScriptRemoteTargetDebuggerFrontend *frontend = currentFrontend();
+    if (!frontend || !frontend->connection()->isAttached() || !frontend->startProfiling(interval))
         return false;
-    if (!m_server) {
-        m_server = new QTcpServer(this);
-        QObject::connect(m_server, SIGNAL(newConnection()),
-                         this, SLOT(onNewConnection()));
+    updateProfilerWidget();
+    return true;
+}
+
+/*!
+  Stops profiling the current session. The profile is kept until
+  profiling is started again.
+*/
+void QScriptRemoteTargetDebugger::stopProfiling()
+{
+    QScriptRemoteTargetDebuggerFrontend *frontend = currentFrontend();
+    if (frontend)
+        frontend->stopProfiling();
+    updateProfilerWidget();
+}
+
+/*!
+  Returns true if the current session is being profiled.
+*/
+bool QScriptRemoteTargetDebugger::isProfiling() const
+{
+    QScriptRemoteTargetDebuggerFrontend *frontend = currentFrontend();
+    return frontend && frontend->isProfiling();
+}
+
+/*!
+  Writes the profile of the current session to the file \a fileName, in
+  the folded stack format understood by flamegraph.pl and compatible
+  tools. Returns false if there is no profile or the file can't be
+  written.
+*/
+bool QScriptRemoteTargetDebugger::exportProfile(const QString &fileName) const
+{
+    QScriptRemoteTargetDebuggerFrontend *frontend = currentFrontend();
+    if (!frontend)
+        return false;
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    return frontend->profile()->writeFoldedStacks(&file);
+}
+
+/*!
+  Starts collecting the line coverage of the current session: the
+  target counts how often each line is executed and sends the counts
+  that have changed every \a interval ms. The code widget shows the
+  counts beside the lines of the current script. Any previous coverage
+  of the session is discarded.
+
+  Returns false if there is no current session, or if the target doesn't
+  support coverage.
+
+  \sa stopCoverage()
+*/
+bool QScriptRemoteTargetDebugger::startCoverage(int interval)
+{
+    QScriptRemoteTargetDebuggerFrontend *frontend = currentFrontend();
+    if (!frontend || !frontend->connection()->isAttached() || !frontend->startCoverage(interval))
+        return false;
+    updateCoverageGutters();
+    return true;
+}
+
+/*!
+  Stops collecting the line coverage of the current session. The counts
+  are kept, and shown, until coverage is started again.
+*/
+void QScriptRemoteTargetDebugger::stopCoverage()
+{
+    QScriptRemoteTargetDebuggerFrontend *frontend = currentFrontend();
+    if (frontend)
+        frontend->stopCoverage();
+}
+
+/*!
+  Returns true if the line coverage of the current session is being
+  collected.
+*/
+bool QScriptRemoteTargetDebugger::isCollectingCoverage() const
+{
+    QScriptRemoteTargetDebuggerFrontend *frontend = currentFrontend();
+    return frontend && frontend->isCollectingCoverage();
+}
+
+/*!
+  Asks the target of the current session for a snapshot of the objects
+  reachable from its global object and active contexts. The snapshot is
+  streamed in chunks and shown by the heap snapshot widget (see
+  widget()) once complete. Any previous snapshot of the session is
+  discarded.
+
+  Returns false if there is no current session, or if the target doesn't
+  support heap snapshots.
+
+  \sa exportHeapSnapshot()
+*/
+bool QScriptRemoteTargetDebugger::takeHeapSnapshot()
+{
+    QScriptRemoteTargetDebuggerFrontend *frontend = currentFrontend();
+    if (!frontend || !frontend->connection()->isAttached() || !frontend->takeHeapSnapshot())
+        return false;
+    updateHeapSnapshotWidget();
+    return true;
+}
+
+/*!
+  Writes the heap snapshot of the current session to the file \a
+  fileName, as text that can be compared with another snapshot using a
+  line based diff. Returns false if there is no complete snapshot or the
+  file can't be written.
+*/
+bool QScriptRemoteTargetDebugger::exportHeapSnapshot(const QString &fileName) const
+{
+    QScriptRemoteTargetDebuggerFrontend *frontend = currentFrontend();
+    if (!frontend || !frontend->heapSnapshot()->isComplete())
+        return false;
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    return frontend->heapSnapshot()->write(&file);
+}
+
+bool QScriptRemoteTargetDebugger::setNonSuspendingBreakpoint(const QString &fileName, int lineNumber,
+                                                             const QVariantMap &spec)
+{
+    QScriptRemoteTargetDebuggerFrontend *frontend = currentFrontend();
+    if (!frontend || !frontend->connection()->isAttached())
+        return false;
+    QScriptBreakpointData data(fileName, lineNumber);
+    data.setData(spec);
+    frontend->scheduleCommand(QScriptDebuggerCommand::setBreakpointCommand(data),
+                              /*responseHandler=*/0);
+    return true;
+}
+
+QScriptDebugger *QScriptRemoteTargetDebugger::newDebugger()
+{
+    QScriptDebugger *debugger = new QScriptDebugger();
+    debugger->setWidgetFactory(new QScriptDebuggerStandardWidgetFactory(this));
+    QObject::connect(debugger, SIGNAL(started()),
+                     this, SLOT(onDebuggerStarted()));
+    QObject::connect(debugger, SIGNAL(stopped()),
+                     this, SLOT(onDebuggerStopped()));
+    return debugger;
+}
+
+void QScriptRemoteTargetDebugger::createDebugger()
+{
+    if (!m_debugger) {
+        m_debugger = newDebugger();
+        if (m_autoShow) {
+            QObject::connect(this, SIGNAL(evaluationSuspended()),
+                             this, SLOT(showStandardWindow()));
+        }
     }
-    return m_server->listen(address, port);
-}
-
-void QScriptRemoteTargetDebuggerFrontend::onSocketStateChanged(QAbstractSocket::SocketState state)
-{
-    switch (state) {
-    case QAbstractSocket::UnconnectedState:
-        m_state = UnattachedState;
-        break;
-    case QAbstractSocket::HostLookupState:
-    case QAbstractSocket::ConnectingState:
-        m_state = ConnectingState;
-        break;
-    case QAbstractSocket::ConnectedState:
-        initiateHandshake();
-        break;
-    case QAbstractSocket::BoundState:
-        break;
-    case QAbstractSocket::ClosingState:
-        emit detached();
-        break;
-    case QAbstractSocket::ListeningState:
-        break;
+}
+
+void QScriptRemoteTargetDebugger::createConnection()
+{
+    if (!m_connection) {
+        m_connection = newConnection();
+        QObject::connect(m_connection, SIGNAL(attached()),
+                         this, SIGNAL(attached()), Qt::QueuedConnection);
+        QObject::connect(m_connection, SIGNAL(detached()),
+                         this, SIGNAL(detached()), Qt::QueuedConnection);
+        QObject::connect(m_connection, SIGNAL(replayFinished()),
+                         this, SIGNAL(replayFinished()), Qt::QueuedConnection);
+        QObject::connect(m_connection, SIGNAL(peerConnected(QScriptDebuggerTransport*)),
+                         this, SLOT(onPeerConnected(QScriptDebuggerTransport*)));
+        QObject::connect(this, SIGNAL(detached()), this, SLOT(updateProfilerWidget()));
+        QObject::connect(this, SIGNAL(detached()), this, SLOT(updateHeapSnapshotWidget()));
+        createDebugger();
     }
 }
 
-void QScriptRemoteTargetDebuggerFrontend::onSocketError(QAbstractSocket::SocketError err)
+/*!
+  \internal
+
+  Creates a connection set up like the others, and connects it to the
+  sessions.
+*/
+QScriptRemoteTargetDebuggerConnection *QScriptRemoteTargetDebugger::newConnection()
+{
+    QScriptRemoteTargetDebuggerConnection *connection = new QScriptRemoteTargetDebuggerConnection();
+    connection->setCommandBatchingEnabled(m_commandBatching);
+    connection->setCompressionEnabled(m_compression);
+    connection->scriptCache()->setDirectory(m_scriptCacheDirectory);
+    QObject::connect(connection, SIGNAL(error(int)),
+                     this, SLOT(onConnectionError(int)));
+    // the session must exist before the first event for the channel
+    // is delivered, so these connections must be direct
+    QObject::connect(connection, SIGNAL(channelOpened(QScriptRemoteTargetDebuggerFrontend*)),
+                     this, SLOT(onChannelOpened(QScriptRemoteTargetDebuggerFrontend*)));
+    QObject::connect(connection, SIGNAL(channelClosed(QScriptRemoteTargetDebuggerFrontend*)),
+                     this, SLOT(onChannelClosed(QScriptRemoteTargetDebuggerFrontend*)));
+    // queued, so that a burst of frames is appended in one go
+    QObject::connect(connection, SIGNAL(outputAvailable(QScriptRemoteTargetDebuggerFrontend*)),
+                     this, SLOT(onOutputAvailable(QScriptRemoteTargetDebuggerFrontend*)),
+                     Qt::QueuedConnection);
+    QObject::connect(connection, SIGNAL(profileAvailable(QScriptRemoteTargetDebuggerFrontend*)),
+                     this, SLOT(onProfileAvailable(QScriptRemoteTargetDebuggerFrontend*)),
+                     Qt::QueuedConnection);
+    QObject::connect(connection, SIGNAL(coverageAvailable(QScriptRemoteTargetDebuggerFrontend*)),
+                     this, SLOT(updateCoverageGutters()), Qt::QueuedConnection);
+    QObject::connect(connection, SIGNAL(heapSnapshotAvailable(QScriptRemoteTargetDebuggerFrontend*)),
+                     this, SLOT(onHeapSnapshotAvailable(QScriptRemoteTargetDebuggerFrontend*)),
+                     Qt::QueuedConnection);
+    return connection;
+}
+
+void QScriptRemoteTargetDebugger::onPeerConnected(QScriptDebuggerTransport *transport)
+{
+    QScriptRemoteTargetDebuggerConnection *connection = newConnection();
+    QObject::connect(connection, SIGNAL(attached()),
+                     this, SIGNAL(attached()), Qt::QueuedConnection);
+    QObject::connect(connection, SIGNAL(detached()),
+                     this, SLOT(onHubConnectionDetached()));
+    QObject::connect(connection, SIGNAL(detached()),
+                     this, SIGNAL(detached()), Qt::QueuedConnection);
+    m_hubConnections.append(connection);
+    connection->adoptTransport(transport, m_hubTransport);
+}
+
+void QScriptRemoteTargetDebugger::onHubConnectionDetached()
 {
-    if (err != QAbstractSocket::RemoteHostClosedError) {
-        qDebug("%s", qPrintable(m_socket->errorString()));
-        emit error(QScriptRemoteTargetDebugger::SocketError);
+    QScriptRemoteTargetDebuggerConnection *connection
+        = static_cast<QScriptRemoteTargetDebuggerConnection*>(sender());
+    if (!m_hubConnections.removeAll(connection))
+        return;
+    QList<QScriptRemoteTargetDebuggerFrontend*> frontends = connection->frontends();
+    for (int i = 0; i < frontends.size(); ++i)
+        onChannelClosed(frontends.at(i));
+    connection->deleteLater();
+}
+
+/*!
+  \internal
+
+  Returns the current session's connection, which is the one attached
+  with attachTo() or listen() unless this is a hub.
+*/
+QScriptRemoteTargetDebuggerConnection *QScriptRemoteTargetDebugger::currentConnection() const
+{
+    QScriptRemoteTargetDebuggerFrontend *frontend = currentFrontend();
+    return frontend ? frontend->connection() : m_connection;
+}
+
+QScriptRemoteTargetDebuggerFrontend *QScriptRemoteTargetDebugger::currentFrontend() const
+{
+    return m_frontends.value(m_currentChannel);
+}
+
+QString QScriptRemoteTargetDebugger::sessionName(QScriptRemoteTargetDebuggerFrontend *frontend) const
+{
+    QScriptRemoteTargetDebuggerConnection *connection = frontend->connection();
+    if (connection == m_connection)
+        return frontend->name();
+    QString name = connection->peerName();
+    if (!frontend->name().isEmpty())
+        name.append(QString::fromLatin1(" - %0").arg(frontend->name()));
+    return name;
+}
+
+/*!
+  \internal
+
+  Returns the debugger of the session of the given \a channel, creating
+  it if the session is idle.
+*/
+QScriptDebugger *QScriptRemoteTargetDebugger::openSession(int channel)
+{
+    QScriptDebugger *debugger = m_debuggers.value(channel);
+    if (debugger)
+        return debugger;
+    createDebugger();
+    if (m_currentChannel == -1) {
+        // the first session uses the debugger that widget() and
+        // action() may already have handed out
+        debugger = m_debugger;
+        m_currentChannel = channel;
+    } else {
+        debugger = newDebugger();
     }
+    m_debuggers.insert(channel, debugger);
+    debugger->setFrontend(m_frontends.value(channel));
+    // queued, so that the code widget has switched scripts by then
+    QObject::connect(debugger->scriptsWidget(), SIGNAL(currentScriptChanged(qint64)),
+                     this, SLOT(updateCoverageGutters()),
+                     Qt::ConnectionType(Qt::QueuedConnection | Qt::UniqueConnection));
+    return debugger;
 }
 
-void QScriptRemoteTargetDebuggerFrontend::onReadyRead()
+void QScriptRemoteTargetDebugger::onChannelOpened(QScriptRemoteTargetDebuggerFrontend *frontend)
 {
-    switch (m_state) {
-    case UnattachedState:
-    case ConnectingState:
-    case DetachingState:
-        Q_ASSERT(0);
-        break;
+    int channel = m_frontends.key(frontend, -1);
+    if (channel != -1) {
+        // announced again (the engine may do so when a target is added
+        // while the session starts); only the name can have changed
+        QString name = sessionName(frontend);
+        m_channelNames.insert(channel, name);
+        if (m_sessionsWidget)
+            m_sessionsWidget->addSession(channel, name);
+        return;
+    }
+    channel = frontend->channel();
+    if (frontend->connection() != m_connection) {
+        // the channels of different targets collide
+        channel = 0;
+        while (m_frontends.contains(channel))
+            ++channel;
+    }
+    QString name = sessionName(frontend);
+    m_frontends.insert(channel, frontend);
+    m_channelNames.insert(channel, name);
+    QScriptDebugger *debugger = m_debuggers.value(channel);
+    if (debugger) {
+        debugger->setFrontend(frontend);
+    } else if ((frontend->connection() != m_connection) && (m_currentChannel != -1)) {
+        // an idle session of a hub; nothing goes to the target until
+        // it's opened
+        frontend->setEventsHeld(true);
+        QObject::connect(frontend, SIGNAL(eventHeld()), this, SLOT(onEventHeld()),
+                         Qt::UniqueConnection);
+    } else {
+        openSession(channel);
+    }
+    if (channel == m_currentChannel) {
+        updateProfilerWidget();
+        updateHeapSnapshotWidget();
+    }
+    if (m_sessionsWidget) {
+        m_sessionsWidget->addSession(channel, name);
+        m_sessionsWidget->setCurrentSession(m_currentChannel);
+    }
+    emit channelOpened(channel, name);
+}
 
-    case HandshakingState: {
-        QByteArray handshakeData("QtScriptDebug-Handshake");
-        if (m_socket->bytesAvailable() >= handshakeData.size()) {
-            QByteArray ba = m_socket->read(handshakeData.size());
-            if (ba == handshakeData) {
-#ifdef DEBUG_DEBUGGER
-                qDebug("handshake ok!");
-#endif
-                m_state = AttachedState;
-                emit attached();
-                if (m_socket->bytesAvailable() > 0)
-                    QMetaObject::invokeMethod(this, "onReadyRead", Qt::QueuedConnection);
+void QScriptRemoteTargetDebugger::onChannelClosed(QScriptRemoteTargetDebuggerFrontend *frontend)
+{
+    int channel = m_frontends.key(frontend, -1);
+    if (channel == -1)
+        return;
+    m_frontends.remove(channel);
+    m_channelNames.remove(channel);
+    if (m_sessionsWidget)
+        m_sessionsWidget->removeSession(channel);
+    // the profile goes away with the frontend
+    if (m_profilerWidget && (m_profilerWidget->profile() == frontend->profile()))
+        m_profilerWidget->setProfile(0);
+    if (m_heapSnapshotWidget && (m_heapSnapshotWidget->snapshot() == frontend->heapSnapshot()))
+        m_heapSnapshotWidget->setSnapshot(0);
+    QScriptDebugger *debugger = m_debuggers.take(channel);
+    if (debugger) {
+        debugger->setFrontend(0);
+        if (channel == m_currentChannel) {
+            if (!m_frontends.isEmpty()) {
+                setCurrentChannel(m_frontends.constBegin().key());
+                delete debugger;
             } else {
-//                d->error = HandshakeError;
-//                d->errorString = QString::fromLatin1("Incorrect handshake data received");
-                m_state = DetachingState;
-                emit error(QScriptRemoteTargetDebugger::HandshakeError);
-                m_socket->close();
+                // keep the debugger around for the next session
+                m_currentChannel = -1;
             }
+        } else {
+            delete debugger;
         }
-    }   break;
+    }
+    emit channelClosed(channel);
+}
 
-    case AttachedState: {
-#ifdef DEBUG_DEBUGGER
-        qDebug() << "got something! bytes available:" << m_socket->bytesAvailable();
-#endif
-        QDataStream in(m_socket);
-        in.setVersion(QDataStream::Qt_4_5);
-        if (m_blockSize == 0) {
-            if (m_socket->bytesAvailable() < (int)sizeof(quint32))
-                return;
-            in >> m_blockSize;
-#ifdef DEBUG_DEBUGGER
-            qDebug() << "blockSize:" << m_blockSize;
-#endif
-        }
-        if (m_socket->bytesAvailable() < m_blockSize) {
-#ifdef DEBUG_DEBUGGER
-            qDebug("waiting for %lld more bytes...", m_blockSize - m_socket->bytesAvailable());
-#endif
-            return;
+void QScriptRemoteTargetDebugger::onEventHeld()
+{
+    QScriptRemoteTargetDebuggerFrontend *frontend
+        = static_cast<QScriptRemoteTargetDebuggerFrontend*>(sender());
+    int channel = m_frontends.key(frontend, -1);
+    if (m_sessionsWidget && (channel != -1))
+        m_sessionsWidget->setSessionSuspended(channel, true);
+}
+
+void QScriptRemoteTargetDebugger::onSessionRequested(int channel)
+{
+    setCurrentChannel(channel);
+}
+
+QScriptDebuggerSessionsWidget *QScriptRemoteTargetDebugger::sessionsWidget() const
+{
+    if (!m_sessionsWidget) {
+        QScriptRemoteTargetDebugger *that = const_cast<QScriptRemoteTargetDebugger*>(this);
+        that->m_sessionsWidget = new QScriptDebuggerSessionsWidget();
+        QMap<int, QScriptRemoteTargetDebuggerFrontend*>::const_iterator it;
+        for (it = m_frontends.constBegin(); it != m_frontends.constEnd(); ++it) {
+            m_sessionsWidget->addSession(it.key(), m_channelNames.value(it.key()));
+            QScriptDebugger *debugger = m_debuggers.value(it.key());
+            m_sessionsWidget->setSessionSuspended(
+                it.key(), debugger ? debugger->isInteractive() : it.value()->hasHeldEvent());
         }
+        m_sessionsWidget->setCurrentSession(m_currentChannel);
+        QObject::connect(m_sessionsWidget, SIGNAL(currentSessionRequested(int)),
+                         that, SLOT(onSessionRequested(int)));
+    }
+    return m_sessionsWidget;
+}
 
-        int wasAvailable = m_socket->bytesAvailable();
-        quint8 type;
-        in >> type;
-        if (type == 0) {
-            // event
-#ifdef DEBUG_DEBUGGER
-            qDebug("deserializing event");
-#endif
-            QScriptDebuggerEvent event(QScriptDebuggerEvent::None);
-            in >> event;
-#ifdef DEBUG_DEBUGGER
-            qDebug("notifying event of type %d", event.type());
-#endif
-            bool handled = notifyEvent(event);
-            if (handled) {
-                scheduleCommand(QScriptDebuggerCommand::resumeCommand(),
-                                /*responseHandler=*/0);
+void QScriptRemoteTargetDebugger::onOutputAvailable(QScriptRemoteTargetDebuggerFrontend *frontend)
+{
+    // the frontend may have been deleted since the signal was posted
+    if (m_frontends.key(frontend, -1) == -1)
+        return;
+    // an idle session keeps its output until it's opened
+    QScriptDebugger *debugger = m_debuggers.value(m_frontends.key(frontend));
+    if (!debugger)
+        return;
+    QList<QScriptDebuggerOutputEntry> output = frontend->takeOutput();
+    if (output.isEmpty())
+        return;
+    QScriptDebugOutputWidgetInterface *outputWidget = debugger->debugOutputWidget();
+    if (!outputWidget)
+        return;
+    // the target sends its output in batches; show each as one update,
+    // merging runs of plain messages (what the target print()s) into one
+    bool updatesEnabled = outputWidget->updatesEnabled();
+    outputWidget->setUpdatesEnabled(false);
+    int i = 0;
+    while (i < output.size()) {
+        const QScriptDebuggerOutputEntry &entry = output.at(i++);
+        QString message = entry.message;
+        if (entry.fileName.isEmpty()) {
+            while ((i < output.size()) && (output.at(i).type == entry.type)
+                   && output.at(i).fileName.isEmpty()) {
+                message.append(QLatin1Char('\n'));
+                message.append(output.at(i++).message);
             }
-        } else {
-            // command response
-#ifdef DEBUG_DEBUGGER
-            qDebug("deserializing command response");
-#endif
-            qint32 id;
-            in >> id;
-            QScriptDebuggerResponse response;
-            in >> response;
-#ifdef DEBUG_DEBUGGER
-            qDebug("notifying command %d finished", id);
-#endif
-            notifyCommandFinished((int)id, response);
         }
-        Q_ASSERT(m_socket->bytesAvailable() == wasAvailable - m_blockSize);
-        m_blockSize = 0;
-#ifdef DEBUG_DEBUGGER
-        qDebug("bytes available is now %lld", m_socket->bytesAvailable());
-#endif
-        if (m_socket->bytesAvailable() != 0)
-            QMetaObject::invokeMethod(this, "onReadyRead", Qt::QueuedConnection);
-    }   break;
+        outputWidget->message(QtMsgType(entry.type), message,
+                              entry.fileName, entry.lineNumber);
     }
+    outputWidget->setUpdatesEnabled(updatesEnabled);
 }
 
-void QScriptRemoteTargetDebuggerFrontend::onNewConnection()
+void QScriptRemoteTargetDebugger::onProfileAvailable(QScriptRemoteTargetDebuggerFrontend *frontend)
 {
-    qDebug("received connection");
-    m_socket = m_server->nextPendingConnection();
-    m_server->close();
-    QObject::connect(m_socket, SIGNAL(stateChanged(QAbstractSocket::SocketState)),
-                     this, SLOT(onSocketStateChanged(QAbstractSocket::SocketState)));
-    QObject::connect(m_socket, SIGNAL(error(QAbstractSocket::SocketError)),
-                     this, SLOT(onSocketError(QAbstractSocket::SocketError)));
-    QObject::connect(m_socket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
-    initiateHandshake();
+    // the frontend may have been deleted since the signal was posted
+    if (m_frontends.key(frontend, -1) == -1)
+        return;
+    if (m_profilerWidget && (m_profilerWidget->profile() == frontend->profile()))
+        m_profilerWidget->refresh();
 }
 
 /*!
-  \reimp
+  \internal
+
+  Shows the coverage of every session beside the script in its code
+  widget.
 */
-void QScriptRemoteTargetDebuggerFrontend::processCommand(int id, const QScriptDebuggerCommand &command)
+void QScriptRemoteTargetDebugger::updateCoverageGutters()
 {
-    Q_ASSERT(m_state == AttachedState);
-    QByteArray block;
-    QDataStream out(&block, QIODevice::WriteOnly);
-    out.setVersion(QDataStream::Qt_4_5);
-    out << (quint32)0; // reserve 4 bytes for block size
-    out << (qint32)id;
-    out << command;
-    out.device()->seek(0);
-    out << (quint32)(block.size() - sizeof(quint32));
-#ifdef DEBUG_DEBUGGER
-    qDebug("writing command (id=%d, %d bytes)", id, block.size());
-#endif
-    m_socket->write(block);
+    QMap<int, QScriptDebugger*>::const_iterator it;
+    for (it = m_debuggers.constBegin(); it != m_debuggers.constEnd(); ++it) {
+        QScriptDebuggerCodeWidgetInterface *codeWidget = it.value()->codeWidget();
+        QWidget *view = codeWidget ? codeWidget->currentView() : 0;
+        if (!view)
+            continue;
+        QScriptRemoteTargetDebuggerFrontend *frontend = m_frontends.value(it.key());
+        qint64 scriptId = codeWidget->currentScriptId();
+        QScriptDebuggerCoverageGutter *gutter;
+        if (frontend && frontend->coverage()->hasScript(scriptId)) {
+            gutter = QScriptDebuggerCoverageGutter::install(view);
+            if (gutter)
+                gutter->setCoverage(frontend->coverage(), scriptId);
+        } else {
+            // don't touch the layout of views that never showed coverage
+            gutter = view->findChild<QScriptDebuggerCoverageGutter*>();
+            if (gutter)
+                gutter->setCoverage(0, -1);
+        }
+    }
 }
 
-void QScriptRemoteTargetDebuggerFrontend::initiateHandshake()
+void QScriptRemoteTargetDebugger::onProfilerStartRequested()
 {
-    m_state = HandshakingState;
-    QByteArray handshakeData("QtScriptDebug-Handshake");
-#ifdef DEBUG_DEBUGGER
-    qDebug("writing handshake data");
-#endif
-    m_socket->write(handshakeData);
+    startProfiling();
 }
 
-QScriptRemoteTargetDebugger::QScriptRemoteTargetDebugger(QObject *parent)
-    : QObject(parent), m_frontend(0), m_debugger(0), m_autoShow(true),
-      m_standardWindow(0)
+void QScriptRemoteTargetDebugger::onProfilerStopRequested()
 {
+    stopProfiling();
 }
 
-QScriptRemoteTargetDebugger::~QScriptRemoteTargetDebugger()
+void QScriptRemoteTargetDebugger::onProfilerClearRequested()
 {
-    delete m_frontend;
-    delete m_debugger;
+    QScriptRemoteTargetDebuggerFrontend *frontend = currentFrontend();
+    if (frontend)
+        frontend->profile()->clearCounts();
+    updateProfilerWidget();
 }
 
-void QScriptRemoteTargetDebugger::attachTo(const QHostAddress &address, quint16 port)
+/*!
+  \internal
+
+  Makes the profiler widget show the profile of the current session.
+*/
+void QScriptRemoteTargetDebugger::updateProfilerWidget()
 {
-    createFrontend();
-    m_frontend->attachTo(address, port);
+    if (!m_profilerWidget)
+        return;
+    QScriptRemoteTargetDebuggerFrontend *frontend = currentFrontend();
+    const QScriptDebuggerProfile *profile = frontend ? frontend->profile() : 0;
+    if (m_profilerWidget->profile() != profile)
+        m_profilerWidget->setProfile(profile);
+    else
+        m_profilerWidget->refresh();
+    m_profilerWidget->setProfiling(frontend && frontend->isProfiling());
 }
 
-void QScriptRemoteTargetDebugger::detach()
+void QScriptRemoteTargetDebugger::onHeapSnapshotAvailable(QScriptRemoteTargetDebuggerFrontend *frontend)
 {
-    if (m_frontend)
-        m_frontend->detach();
+    // the frontend may have been deleted since the signal was posted
+    if (m_frontends.key(frontend, -1) == -1)
+        return;
+    if (m_heapSnapshotWidget && (m_heapSnapshotWidget->snapshot() == frontend->heapSnapshot()))
+        m_heapSnapshotWidget->refresh();
 }
 
-bool QScriptRemoteTargetDebugger::listen(const QHostAddress &address, quint16 port)
+/*!
+  \internal
+
+  Makes the heap snapshot widget show the snapshot of the current
+  session.
+*/
+void QScriptRemoteTargetDebugger::updateHeapSnapshotWidget()
 {
-    createFrontend();
-    return m_frontend->listen(address, port);
+    if (!m_heapSnapshotWidget)
+        return;
+    QScriptRemoteTargetDebuggerFrontend *frontend = currentFrontend();
+    const QScriptDebuggerHeapSnapshot *snapshot = frontend ? frontend->heapSnapshot() : 0;
+    if (m_heapSnapshotWidget->snapshot() != snapshot)
+        m_heapSnapshotWidget->setSnapshot(snapshot);
+    else
+        m_heapSnapshotWidget->refresh();
+    m_heapSnapshotWidget->setSnapshotEnabled(frontend && frontend->connection()->isAttached());
 }
 
-void QScriptRemoteTargetDebugger::createDebugger()
+QScriptDebuggerHeapSnapshotWidget *QScriptRemoteTargetDebugger::heapSnapshotWidget() const
 {
-    if (!m_debugger) {
-        m_debugger = new QScriptDebugger();
-        m_debugger->setWidgetFactory(new QScriptDebuggerStandardWidgetFactory(this));
-        QObject::connect(m_debugger, SIGNAL(started()),
-                         this, SIGNAL(evaluationResumed()));
-        QObject::connect(m_debugger, SIGNAL(stopped()),
-                         this, SIGNAL(evaluationSuspended()));
-        if (m_autoShow) {
-            QObject::connect(this, SIGNAL(evaluationSuspended()),
-                             this, SLOT(showStandardWindow()));
-        }
+    if (!m_heapSnapshotWidget) {
+        QScriptRemoteTargetDebugger *that = const_cast<QScriptRemoteTargetDebugger*>(this);
+        that->m_heapSnapshotWidget = new QScriptDebuggerHeapSnapshotWidget();
+        QObject::connect(m_heapSnapshotWidget, SIGNAL(snapshotRequested()),
+                         that, SLOT(onHeapSnapshotRequested()));
+        that->updateHeapSnapshotWidget();
     }
+    return m_heapSnapshotWidget;
 }
 
-void QScriptRemoteTargetDebugger::createFrontend()
+void QScriptRemoteTargetDebugger::onHeapSnapshotRequested()
 {
-    if (!m_frontend) {
-        m_frontend = new QScriptRemoteTargetDebuggerFrontend();
-        QObject::connect(m_frontend, SIGNAL(attached()),
-                         this, SIGNAL(attached()), Qt::QueuedConnection);
-        QObject::connect(m_frontend, SIGNAL(detached()),
-                         this, SIGNAL(detached()), Qt::QueuedConnection);
-        QObject::connect(m_frontend, SIGNAL(error(QScriptRemoteTargetDebugger::Error)),
-                         this, SIGNAL(error(QScriptRemoteTargetDebugger::Error)));
-        createDebugger();
-        m_debugger->setFrontend(m_frontend);
+    takeHeapSnapshot();
+}
+
+QScriptDebuggerProfilerWidget *QScriptRemoteTargetDebugger::profilerWidget() const
+{
+    if (!m_profilerWidget) {
+        QScriptRemoteTargetDebugger *that = const_cast<QScriptRemoteTargetDebugger*>(this);
+        that->m_profilerWidget = new QScriptDebuggerProfilerWidget();
+        QObject::connect(m_profilerWidget, SIGNAL(startRequested()),
+                         that, SLOT(onProfilerStartRequested()));
+        QObject::connect(m_profilerWidget, SIGNAL(stopRequested()),
+                         that, SLOT(onProfilerStopRequested()));
+        QObject::connect(m_profilerWidget, SIGNAL(clearRequested()),
+                         that, SLOT(onProfilerClearRequested()));
+        that->updateProfilerWidget();
     }
+    return m_profilerWidget;
+}
+
+void QScriptRemoteTargetDebugger::onDebuggerStarted()
+{
+    QScriptDebugger *debugger = static_cast<QScriptDebugger*>(sender());
+    if (m_sessionsWidget)
+        m_sessionsWidget->setSessionSuspended(m_debuggers.key(debugger, -1), false);
+    if (debugger == m_debugger)
+        emit evaluationResumed();
+}
+
+void QScriptRemoteTargetDebugger::onDebuggerStopped()
+{
+    // the code widget shows the script that stopped once this returns
+    QMetaObject::invokeMethod(this, "updateCoverageGutters", Qt::QueuedConnection);
+    QScriptDebugger *debugger = static_cast<QScriptDebugger*>(sender());
+    if (m_sessionsWidget)
+        m_sessionsWidget->setSessionSuspended(m_debuggers.key(debugger, -1), true);
+    if (debugger != m_debugger) {
+        // switch to the session that stopped, unless the user is busy
+        // with the current one
+        if (m_debugger && m_debugger->isInteractive())
+            return;
+        setCurrentChannel(m_debuggers.key(debugger, -1));
+    }
+    emit evaluationSuspended();
 }
 
 QMainWindow *QScriptRemoteTargetDebugger::standardWindow() const
@@ -358,6 +980,12 @@ QMainWindow *QScriptRemoteTargetDebugger::standardWindow() const
     QScriptRemoteTargetDebugger *that = const_cast<QScriptRemoteTargetDebugger*>(this);
 
     QMainWindow *win = new QMainWindow();
+    QDockWidget *sessionsDock = new QDockWidget(win);
+    sessionsDock->setObjectName(QLatin1String("qtscriptdebugger_sessionsDockWidget"));
+    sessionsDock->setWindowTitle(QObject::tr("Sessions"));
+    sessionsDock->setWidget(widget(SessionsWidget));
+    win->addDockWidget(Qt::LeftDockWidgetArea, sessionsDock);
+
     QDockWidget *scriptsDock = new QDockWidget(win);
     scriptsDock->setObjectName(QLatin1String("qtscriptdebugger_scriptsDockWidget"));
     scriptsDock->setWindowTitle(QObject::tr("Loaded Scripts"));
@@ -400,22 +1028,32 @@ QMainWindow *QScriptRemoteTargetDebugger::standardWindow() const
     errorLogDock->setWidget(widget(ErrorLogWidget));
     win->addDockWidget(Qt::BottomDockWidgetArea, errorLogDock);
 
+    QDockWidget *profilerDock = new QDockWidget(win);
+    profilerDock->setObjectName(QLatin1String("qtscriptdebugger_profilerDockWidget"));
+    profilerDock->setWindowTitle(QObject::tr("Profiler"));
+    profilerDock->setWidget(widget(ProfilerWidget));
+    win->addDockWidget(Qt::BottomDockWidgetArea, profilerDock);
+
+    QDockWidget *heapSnapshotDock = new QDockWidget(win);
+    heapSnapshotDock->setObjectName(QLatin1String("qtscriptdebugger_heapSnapshotDockWidget"));
+    heapSnapshotDock->setWindowTitle(QObject::tr("Heap"));
+    heapSnapshotDock->setWidget(widget(HeapSnapshotWidget));
+    win->addDockWidget(Qt::BottomDockWidgetArea, heapSnapshotDock);
+
     win->tabifyDockWidget(errorLogDock, debugOutputDock);
     win->tabifyDockWidget(debugOutputDock, consoleDock);
+    win->tabifyDockWidget(consoleDock, profilerDock);
+    win->tabifyDockWidget(profilerDock, heapSnapshotDock);
 
-    win->addToolBar(Qt::TopToolBarArea, that->createStandardToolBar());
+    that->m_standardToolBar = that->createStandardToolBar();
+    win->addToolBar(Qt::TopToolBarArea, m_standardToolBar);
 
 #ifndef QT_NO_MENUBAR
     win->menuBar()->addMenu(that->createStandardMenu(win));
-
-    QMenu *editMenu = win->menuBar()->addMenu(QObject::tr("Search"));
-    editMenu->addAction(action(FindInScriptAction));
-    editMenu->addAction(action(FindNextInScriptAction));
-    editMenu->addAction(action(FindPreviousInScriptAction));
-    editMenu->addSeparator();
-    editMenu->addAction(action(GoToLineAction));
+    win->menuBar()->addMenu(that->createSearchMenu(win));
 
     QMenu *viewMenu = win->menuBar()->addMenu(QObject::tr("View"));
+    viewMenu->addAction(sessionsDock->toggleViewAction());
     viewMenu->addAction(scriptsDock->toggleViewAction());
     viewMenu->addAction(breakpointsDock->toggleViewAction());
     viewMenu->addAction(stackDock->toggleViewAction());
@@ -423,6 +1061,8 @@ QMainWindow *QScriptRemoteTargetDebugger::standardWindow() const
     viewMenu->addAction(consoleDock->toggleViewAction());
     viewMenu->addAction(debugOutputDock->toggleViewAction());
     viewMenu->addAction(errorLogDock->toggleViewAction());
+    viewMenu->addAction(profilerDock->toggleViewAction());
+    viewMenu->addAction(heapSnapshotDock->toggleViewAction());
 #endif
 
     QWidget *central = new QWidget();
@@ -432,7 +1072,10 @@ QMainWindow *QScriptRemoteTargetDebugger::standardWindow() const
     widget(CodeFinderWidget)->hide();
     win->setCentralWidget(central);
 
-    win->setWindowTitle(QObject::tr("Qt Script Debugger"));
+    if (m_channelNames.value(m_currentChannel).isEmpty())
+        win->setWindowTitle(QObject::tr("Qt Script Debugger"));
+    else
+        win->setWindowTitle(QObject::tr("Qt Script Debugger - %0").arg(m_channelNames.value(m_currentChannel)));
 
     QSettings settings(QSettings::UserScope, QLatin1String("Trolltech"));
     QVariant geometry = settings.value(QLatin1String("Qt/scripttools/debugging/mainWindowGeometry"));
@@ -446,14 +1089,115 @@ QMainWindow *QScriptRemoteTargetDebugger::standardWindow() const
     return win;
 }
 
+/*!
+  \internal
+
+  Replaces the widgets and actions shown by the standard window with
+  the ones of the current session.
+*/
+void QScriptRemoteTargetDebugger::updateStandardWindow()
+{
+    static const struct {
+        const char *objectName;
+        DebuggerWidget widget;
+    } docks[] = {
+        { "qtscriptdebugger_scriptsDockWidget", ScriptsWidget },
+        { "qtscriptdebugger_breakpointsDockWidget", BreakpointsWidget },
+        { "qtscriptdebugger_stackDockWidget", StackWidget },
+        { "qtscriptdebugger_localsDockWidget", LocalsWidget },
+        { "qtscriptdebugger_consoleDockWidget", ConsoleWidget },
+        { "qtscriptdebugger_debugOutputDockWidget", DebugOutputWidget },
+        { "qtscriptdebugger_errorLogDockWidget", ErrorLogWidget }
+    };
+
+    QMainWindow *win = m_standardWindow;
+    // the widgets are owned by their debugger, so take them out of the
+    // window rather than letting the window delete them
+    for (uint i = 0; i < sizeof(docks) / sizeof(docks[0]); ++i) {
+        QDockWidget *dock = win->findChild<QDockWidget*>(QLatin1String(docks[i].objectName));
+        QWidget *w = widget(docks[i].widget);
+        if (!dock || (dock->widget() == w))
+            continue;
+        if (QWidget *old = dock->widget()) {
+            old->hide();
+            old->setParent(0);
+        }
+        dock->setWidget(w);
+        w->show();
+    }
+
+    QLayout *vbox = win->centralWidget()->layout();
+    while (QLayoutItem *item = vbox->takeAt(0)) {
+        if (QWidget *old = item->widget()) {
+            old->hide();
+            old->setParent(0);
+        }
+        delete item;
+    }
+    vbox->addWidget(widget(CodeWidget));
+    vbox->addWidget(widget(CodeFinderWidget));
+    widget(CodeWidget)->show();
+    widget(CodeFinderWidget)->hide();
+
+    win->removeToolBar(m_standardToolBar);
+    delete m_standardToolBar;
+    m_standardToolBar = createStandardToolBar();
+    win->addToolBar(Qt::TopToolBarArea, m_standardToolBar);
+    m_standardToolBar->show();
+
+#ifndef QT_NO_MENUBAR
+    // the last menu is the View menu, which does not depend on the session
+    QList<QAction*> menuActions = win->menuBar()->actions();
+    QAction *viewMenuAction = menuActions.takeLast();
+    for (int i = 0; i < menuActions.size(); ++i)
+        delete menuActions.at(i)->menu();
+    win->menuBar()->insertMenu(viewMenuAction, createStandardMenu(win));
+    win->menuBar()->insertMenu(viewMenuAction, createSearchMenu(win));
+#endif
+
+    if (m_channelNames.value(m_currentChannel).isEmpty())
+        win->setWindowTitle(QObject::tr("Qt Script Debugger"));
+    else
+        win->setWindowTitle(QObject::tr("Qt Script Debugger - %0").arg(m_channelNames.value(m_currentChannel)));
+}
+
+QMenu *QScriptRemoteTargetDebugger::createSearchMenu(QWidget *parent)
+{
+    QMenu *editMenu = new QMenu(QObject::tr("Search"), parent);
+    editMenu->addAction(action(FindInScriptAction));
+    editMenu->addAction(action(FindNextInScriptAction));
+    editMenu->addAction(action(FindPreviousInScriptAction));
+    editMenu->addSeparator();
+    editMenu->addAction(action(GoToLineAction));
+    return editMenu;
+}
+
 void QScriptRemoteTargetDebugger::showStandardWindow()
 {
     (void)standardWindow(); // ensure it's created
     m_standardWindow->show();
 }
 
+void QScriptRemoteTargetDebugger::onConnectionError(int error)
+{
+    emit this->error(Error(error));
+}
+
+/*!
+  Returns the given debugger \a widget of the current session. The
+  ProfilerWidget and HeapSnapshotWidget are shared by all sessions and
+  show the profile and heap snapshot of whichever session is current.
+  The SessionsWidget lists the sessions and makes the one clicked on
+  current.
+*/
 QWidget *QScriptRemoteTargetDebugger::widget(DebuggerWidget widget) const
 {
+    if (widget == ProfilerWidget)
+        return profilerWidget();
+    if (widget == HeapSnapshotWidget)
+        return heapSnapshotWidget();
+    if (widget == SessionsWidget)
+        return sessionsWidget();
     const_cast<QScriptRemoteTargetDebugger*>(this)->createDebugger();
     return m_debugger->widget(static_cast<QScriptDebugger::DebuggerWidget>(widget));
 }
@@ -477,6 +1221,102 @@ QMenu *QScriptRemoteTargetDebugger::createStandardMenu(QWidget *parent)
     return m_debugger->createStandardMenu(parent, this);
 }
 
+/*!
+  Returns true if compression is asked for when attaching; this is the
+  default.
+*/
+bool QScriptRemoteTargetDebugger::isCompressionEnabled() const
+{
+    return m_compression;
+}
+
+/*!
+  Sets whether frames are compressed to \a enable, if the target
+  supports it; this is negotiated when attaching. Only frames whose
+  payload is larger than a threshold (1 KB) are compressed, and only if
+  that makes them smaller.
+*/
+void QScriptRemoteTargetDebugger::setCompressionEnabled(bool enable)
+{
+    m_compression = enable;
+    if (m_connection)
+        m_connection->setCompressionEnabled(enable);
+    for (int i = 0; i < m_hubConnections.size(); ++i)
+        m_hubConnections.at(i)->setCompressionEnabled(enable);
+}
+
+/*!
+  Returns the combined size of the compressed frames, as sent or
+  received over the current session's connection, divided by their size
+  before compression. Returns 1 if no
+  frame has been compressed.
+*/
+qreal QScriptRemoteTargetDebugger::compressionRatio() const
+{
+    QScriptRemoteTargetDebuggerConnection *connection = currentConnection();
+    return connection ? connection->compressionRatio() : 1;
+}
+
+/*!
+  Returns the time spent compressing and decompressing frames, in
+  milliseconds.
+*/
+int QScriptRemoteTargetDebugger::compressionTime() const
+{
+    QScriptRemoteTargetDebuggerConnection *connection = currentConnection();
+    return connection ? connection->compressionTime() : 0;
+}
+
+/*!
+  Returns the directory in which the sources of the target's scripts are
+  cached between sessions. By default this is a subdirectory of the
+  platform's cache location.
+*/
+QString QScriptRemoteTargetDebugger::scriptCacheDirectory() const
+{
+    return m_scriptCacheDirectory;
+}
+
+/*!
+  Sets the directory in which script sources are cached to \a path. An
+  empty \a path disables the cache. Takes effect the next time the
+  debugger attaches.
+
+  When the cache is enabled the target sends a hash of each script it
+  has loaded, and the source of a script is only transferred if no
+  script with the same hash has been seen before.
+*/
+void QScriptRemoteTargetDebugger::setScriptCacheDirectory(const QString &path)
+{
+    m_scriptCacheDirectory = path;
+    if (m_connection)
+        m_connection->scriptCache()->setDirectory(path);
+    for (int i = 0; i < m_hubConnections.size(); ++i)
+        m_hubConnections.at(i)->scriptCache()->setDirectory(path);
+}
+
+/*!
+  Returns true if commands that the debugger issues in one go are sent
+  to the target in a single frame; this is the default.
+*/
+bool QScriptRemoteTargetDebugger::isCommandBatchingEnabled() const
+{
+    return m_commandBatching;
+}
+
+/*!
+  Sets whether commands are batched to \a enable. Disabling batching
+  sends one frame per command, which is mainly useful for comparison.
+*/
+void QScriptRemoteTargetDebugger::setCommandBatchingEnabled(bool enable)
+{
+    m_commandBatching = enable;
+    if (m_connection)
+        m_connection->setCommandBatchingEnabled(enable);
+    for (int i = 0; i < m_hubConnections.size(); ++i)
+        m_hubConnections.at(i)->setCommandBatchingEnabled(enable);
+}
+
 bool QScriptRemoteTargetDebugger::autoShowStandardWindow() const
 {
     return m_autoShow;
@@ -495,5 +1335,3 @@ void QScriptRemoteTargetDebugger::setAutoShowStandardWindow(bool autoShow)
     }
     m_autoShow = autoShow;
 }
-
-#include "qscriptremotetargetdebugger.moc"
@@ -23,11 +23,20 @@
 #define QSCRIPTREMOTETARGETDEBUGGER_H
 
 #include <QtCore/qobject.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qmap.h>
+#include <QtCore/qstring.h>
+#include <QtCore/qvariant.h>
 #include <QtNetwork/qabstractsocket.h>
 #include <QtNetwork/qhostaddress.h>
 
 class QScriptDebugger;
 class QScriptRemoteTargetDebuggerFrontend;
+class QScriptRemoteTargetDebuggerConnection;
+class QScriptDebuggerTransport;
+class QScriptDebuggerProfilerWidget;
+class QScriptDebuggerHeapSnapshotWidget;
+class QScriptDebuggerSessionsWidget;
 class QAction;
 class QWidget;
 class QMainWindow;
@@ -44,7 +53,20 @@ public:
         HostNotFoundError,
         ConnectionRefusedError,
         HandshakeError,
-        SocketError
+        SocketError,
+        ProtocolError
+    };
+
+    enum Transport {
+        TcpTransport,
+        LocalSocketTransport,
+        PipeTransport,
+        SharedMemoryTransport
+    };
+
+    enum ReplaySpeed {
+        RecordedSpeed,
+        FullSpeed
     };
 
     enum DebuggerWidget {
@@ -56,7 +78,10 @@ public:
         CodeFinderWidget,
         BreakpointsWidget,
         DebugOutputWidget,
-        ErrorLogWidget
+        ErrorLogWidget,
+        ProfilerWidget,
+        HeapSnapshotWidget,
+        SessionsWidget
     };
 
     enum DebuggerAction {
@@ -81,9 +106,53 @@ public:
     ~QScriptRemoteTargetDebugger();
 
     void attachTo(const QHostAddress &address, quint16 port);
+    void attachTo(Transport transport, const QString &address);
     void detach();
 
     bool listen(const QHostAddress &address = QHostAddress::Any, quint16 port = 0);
+    bool listen(Transport transport, const QString &address);
+    int maxConnections() const;
+    void setMaxConnections(int count);
+
+    bool replay(const QString &fileName, ReplaySpeed speed = RecordedSpeed);
+    bool startRecording(const QString &fileName);
+    void stopRecording();
+
+    QVariantMap metrics() const;
+    void resetMetrics();
+    bool startMetricsDump(const QString &fileName, int interval = 10000);
+    void stopMetricsDump();
+
+    QList<int> channels() const;
+    QString channelName(int channel) const;
+    int currentChannel() const;
+    void setCurrentChannel(int channel);
+
+    bool setLogpoint(const QString &fileName, int lineNumber, const QString &expression);
+    bool setTracepoint(const QString &fileName, int lineNumber, int maxFrames = 5);
+
+    bool startProfiling(int interval = 1);
+    void stopProfiling();
+    bool isProfiling() const;
+    bool exportProfile(const QString &fileName) const;
+
+    bool startCoverage(int interval = 1000);
+    void stopCoverage();
+    bool isCollectingCoverage() const;
+
+    bool takeHeapSnapshot();
+    bool exportHeapSnapshot(const QString &fileName) const;
+
+    bool isCommandBatchingEnabled() const;
+    void setCommandBatchingEnabled(bool enable);
+
+    bool isCompressionEnabled() const;
+    void setCompressionEnabled(bool enable);
+    qreal compressionRatio() const;
+    int compressionTime() const;
+
+    QString scriptCacheDirectory() const;
+    void setScriptCacheDirectory(const QString &path);
 
     bool autoShowStandardWindow() const;
     void setAutoShowStandardWindow(bool autoShow);
@@ -99,22 +168,76 @@ Q_SIGNALS:
     void attached();
     void detached();
     void error(QScriptRemoteTargetDebugger::Error error);
+    void replayFinished();
 
     void evaluationSuspended();
     void evaluationResumed();
 
+    void channelOpened(int channel, const QString &name);
+    void channelClosed(int channel);
+    void currentChannelChanged(int channel);
+
 private Q_SLOTS:
     void showStandardWindow();
+    void onConnectionError(int error);
+    void onChannelOpened(QScriptRemoteTargetDebuggerFrontend *frontend);
+    void onChannelClosed(QScriptRemoteTargetDebuggerFrontend *frontend);
+    void onOutputAvailable(QScriptRemoteTargetDebuggerFrontend *frontend);
+    void onProfileAvailable(QScriptRemoteTargetDebuggerFrontend *frontend);
+    void onProfilerStartRequested();
+    void onProfilerStopRequested();
+    void onProfilerClearRequested();
+    void updateProfilerWidget();
+    void updateCoverageGutters();
+    void onHeapSnapshotAvailable(QScriptRemoteTargetDebuggerFrontend *frontend);
+    void onHeapSnapshotRequested();
+    void updateHeapSnapshotWidget();
+    void onDebuggerStarted();
+    void onDebuggerStopped();
+    void onPeerConnected(QScriptDebuggerTransport *transport);
+    void onHubConnectionDetached();
+    void onEventHeld();
+    void onSessionRequested(int channel);
 
 private:
     void createDebugger();
-    void createFrontend();
+    QScriptDebugger *newDebugger();
+    QScriptDebugger *openSession(int channel);
+    void createConnection();
+    QScriptRemoteTargetDebuggerConnection *newConnection();
+    QScriptRemoteTargetDebuggerConnection *currentConnection() const;
+    QScriptRemoteTargetDebuggerFrontend *currentFrontend() const;
+    QString sessionName(QScriptRemoteTargetDebuggerFrontend *frontend) const;
+    void updateStandardWindow();
+    QMenu *createSearchMenu(QWidget *parent);
+    QScriptDebuggerProfilerWidget *profilerWidget() const;
+    QScriptDebuggerHeapSnapshotWidget *heapSnapshotWidget() const;
+    QScriptDebuggerSessionsWidget *sessionsWidget() const;
+    bool setNonSuspendingBreakpoint(const QString &fileName, int lineNumber,
+                                    const QVariantMap &spec);
 
 private:
-    QScriptRemoteTargetDebuggerFrontend *m_frontend;
+    QScriptRemoteTargetDebuggerConnection *m_connection;
     QScriptDebugger *m_debugger;
+    // by channel; the targets of a hub have a connection each, and the
+    // sessions of their engines are numbered across them
+    QMap<int, QScriptRemoteTargetDebuggerFrontend*> m_frontends;
+    // only for the sessions that have been opened
+    QMap<int, QScriptDebugger*> m_debuggers;
+    QMap<int, QString> m_channelNames;
+    int m_currentChannel;
+    int m_maxConnections;
+    int m_hubTransport;
+    QList<QScriptRemoteTargetDebuggerConnection*> m_hubConnections;
     bool m_autoShow;
+    bool m_commandBatching;
+    bool m_compression;
+    QString m_scriptCacheDirectory;
     QMainWindow *m_standardWindow;
+    QToolBar *m_standardToolBar;
+    QScriptDebuggerProfilerWidget *m_profilerWidget;
+    QScriptDebuggerHeapSnapshotWidget *m_heapSnapshotWidget;
+    QScriptDebuggerSessionsWidget *m_sessionsWidget;
 
     Q_DISABLE_COPY(QScriptRemoteTargetDebugger)
 };
@@ -0,0 +1,1307 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "qscriptremotetargetdebuggerconnection_p.h"
+#include "qscriptremotetargetdebugger.h"
+#include "qscriptdebuggercompactencoding_p.h"
+#include "qscriptdebuggermetatypes_p.h"
+#include <QtCore/qendian.h>
+#include <QtCore/qdebug.h>
+#include <QtCore/qtimer.h>
+
+#include <private/qscriptdebuggercommand_p.h>
+#include <private/qscriptdebuggerevent_p.h>
+#include <private/qscriptdebuggerresponse_p.h>
+
+// #define DEBUG_DEBUGGER
+
+QScriptRemoteTargetDebuggerFrontend::QScriptRemoteTargetDebuggerFrontend(
+    QScriptRemoteTargetDebuggerConnection *connection, quint32 channel, const QString &name)
+    : m_connection(connection), m_channel(channel), m_name(name), m_eventsHeld(false),
+      m_hasHeldEvent(false), m_flushScheduled(false), m_profiling(false),
+      m_collectingCoverage(false)
+{
+}
+
+QScriptRemoteTargetDebuggerFrontend::~QScriptRemoteTargetDebuggerFrontend()
+{
+}
+
+QScriptRemoteTargetDebuggerConnection *QScriptRemoteTargetDebuggerFrontend::connection() const
+{
+    return m_connection;
+}
+
+quint32 QScriptRemoteTargetDebuggerFrontend::channel() const
+{
+    return m_channel;
+}
+
+QString QScriptRemoteTargetDebuggerFrontend::name() const
+{
+    return m_name;
+}
+
+void QScriptRemoteTargetDebuggerFrontend::setName(const QString &name)
+{
+    m_name = name;
+}
+
+bool QScriptRemoteTargetDebuggerFrontend::areEventsHeld() const
+{
+    return m_eventsHeld;
+}
+
+/*!
+  Sets whether events are kept from the debugger to \a held. This is
+  how an idle session of a hub avoids all traffic beyond what the target
+  sends by itself. A target that stops (e.g. on an exception) stays
+  suspended, and the event that suspended it is delivered once the
+  events are no longer held; the stop on connecting is answered right
+  away.
+*/
+void QScriptRemoteTargetDebuggerFrontend::setEventsHeld(bool held)
+{
+    m_eventsHeld = held;
+    if (held || !m_hasHeldEvent)
+        return;
+    m_hasHeldEvent = false;
+    QScriptDebuggerEvent event = m_heldEvent;
+    m_heldEvent = QScriptDebuggerEvent();
+    handleEvent(event);
+}
+
+/*!
+  Returns true if the target is suspended by an event that is being
+  held.
+*/
+bool QScriptRemoteTargetDebuggerFrontend::hasHeldEvent() const
+{
+    return m_hasHeldEvent;
+}
+
+void QScriptRemoteTargetDebuggerFrontend::handleEvent(const QScriptDebuggerEvent &event)
+{
+    if (m_eventsHeld) {
+        if (event.type() == QScriptDebuggerEvent::Interrupted) {
+            // the target stops when a debugger connects, so that the
+            // breakpoints can be set; an idle session has none
+            scheduleCommand(QScriptDebuggerCommand::resumeCommand(),
+                            /*responseHandler=*/0);
+            return;
+        }
+        // a suspended target sends nothing else until it is resumed
+        m_heldEvent = event;
+        m_hasHeldEvent = true;
+        emit eventHeld();
+        return;
+    }
+#ifdef DEBUG_DEBUGGER
+    qDebug("notifying event of type %d (channel=%u)", event.type(), m_channel);
+#endif
+    bool handled = notifyEvent(event);
+    if (handled) {
+        scheduleCommand(QScriptDebuggerCommand::resumeCommand(),
+                        /*responseHandler=*/0);
+    }
+}
+
+void QScriptRemoteTargetDebuggerFrontend::handleResponse(qint32 id, const QScriptDebuggerResponse &response)
+{
+#ifdef DEBUG_DEBUGGER
+    qDebug("notifying command %d finished (channel=%u)", id, m_channel);
+#endif
+    QByteArray hash = m_scriptRequests.take(id);
+    if (!hash.isEmpty() && (response.error() == QScriptDebuggerResponse::NoError)) {
+        // a script that wasn't in the cache; it will be next time
+        QScriptScriptData data = qvariant_cast<QScriptScriptData>(response.result());
+        if (data.isValid()) {
+            m_connection->scriptCache()->insert(QScriptDebuggerScriptCache::hash(data.contents()),
+                                                data.contents());
+        }
+    }
+    notifyCommandFinished((int)id, response);
+}
+
+void QScriptRemoteTargetDebuggerFrontend::handleOutput(const QList<QScriptDebuggerOutputEntry> &output)
+{
+    m_output += output;
+    // nobody takes the output of an idle session; keep the latest
+    if (m_eventsHeld && (m_output.size() > MaxHeldOutput))
+        m_output.erase(m_output.begin(), m_output.end() - MaxHeldOutput);
+}
+
+QList<QScriptDebuggerOutputEntry> QScriptRemoteTargetDebuggerFrontend::takeOutput()
+{
+    QList<QScriptDebuggerOutputEntry> result = m_output;
+    m_output.clear();
+    return result;
+}
+
+void QScriptRemoteTargetDebuggerFrontend::handleScriptHashes(const QList<QScriptDebuggerScriptHash> &scripts)
+{
+    for (int i = 0; i < scripts.size(); ++i)
+        m_scripts.insert(scripts.at(i).scriptId, scripts.at(i));
+}
+
+/*!
+  Asks the target to sample its stack every \a interval ms, starting a
+  new profile. Returns false if the target can't be profiled.
+*/
+bool QScriptRemoteTargetDebuggerFrontend::startProfiling(int interval)
+{
+    if (!(m_connection->agreedCapabilities() & QScriptDebuggerProtocol::ProfilerCapability))
+        return false;
+    // chunks of the previous session may still be on their way; they
+    // are told apart by the session number
+    m_profile.reset(m_profile.session() + 1);
+    m_profiling = true;
+    m_connection->writeProfilerControl(m_channel, qMax(1, interval), m_profile.session());
+    return true;
+}
+
+/*!
+  Asks the target to stop sampling. The profile is kept; the target
+  sends what it has sampled since the last chunk.
+*/
+void QScriptRemoteTargetDebuggerFrontend::stopProfiling()
+{
+    if (!isProfiling())
+        return;
+    m_profiling = false;
+    m_connection->writeProfilerControl(m_channel, 0, m_profile.session());
+}
+
+bool QScriptRemoteTargetDebuggerFrontend::isProfiling() const
+{
+    return m_profiling && m_connection->isAttached();
+}
+
+QScriptDebuggerProfile *QScriptRemoteTargetDebuggerFrontend::profile()
+{
+    return &m_profile;
+}
+
+/*!
+  Adds \a chunk to the profile. Returns false if the chunk was ignored.
+*/
+bool QScriptRemoteTargetDebuggerFrontend::handleProfile(const QScriptDebuggerProfileChunk &chunk)
+{
+    if (chunk.session != m_profile.session())
+        return false;
+    if (!m_profile.append(chunk))
+        qWarning("QScriptRemoteTargetDebugger: inconsistent profile data (channel=%u)", m_channel);
+    return true;
+}
+
+/*!
+  Asks the target to record line coverage and to send what has changed
+  every \a interval ms, starting from zero. Returns false if the target
+  can't record coverage.
+*/
+bool QScriptRemoteTargetDebuggerFrontend::startCoverage(int interval)
+{
+    if (!(m_connection->agreedCapabilities() & QScriptDebuggerProtocol::CoverageCapability))
+        return false;
+    m_coverage.reset(m_coverage.session() + 1);
+    m_collectingCoverage = true;
+    m_connection->writeCoverageControl(m_channel, qMax(1, interval), m_coverage.session());
+    return true;
+}
+
+/*!
+  Asks the target to stop sending coverage. The counts are kept; the
+  target sends what has changed since the last chunk.
+*/
+void QScriptRemoteTargetDebuggerFrontend::stopCoverage()
+{
+    if (!isCollectingCoverage())
+        return;
+    m_collectingCoverage = false;
+    m_connection->writeCoverageControl(m_channel, 0, m_coverage.session());
+}
+
+bool QScriptRemoteTargetDebuggerFrontend::isCollectingCoverage() const
+{
+    return m_collectingCoverage && m_connection->isAttached();
+}
+
+QScriptDebuggerCoverage *QScriptRemoteTargetDebuggerFrontend::coverage()
+{
+    return &m_coverage;
+}
+
+/*!
+  Adds \a chunk to the coverage. Returns false if the chunk was ignored.
+*/
+bool QScriptRemoteTargetDebuggerFrontend::handleCoverage(const QScriptDebuggerCoverageChunk &chunk)
+{
+    return m_coverage.append(chunk);
+}
+
+/*!
+  Asks the target for a snapshot of its objects, replacing the previous
+  snapshot. Returns false if the target can't take heap snapshots.
+*/
+bool QScriptRemoteTargetDebuggerFrontend::takeHeapSnapshot()
+{
+    if (!(m_connection->agreedCapabilities() & QScriptDebuggerProtocol::HeapSnapshotCapability))
+        return false;
+    m_heapSnapshot.reset(m_heapSnapshot.snapshot() + 1);
+    m_connection->writeHeapSnapshotRequest(m_channel, m_heapSnapshot.snapshot());
+    return true;
+}
+
+QScriptDebuggerHeapSnapshot *QScriptRemoteTargetDebuggerFrontend::heapSnapshot()
+{
+    return &m_heapSnapshot;
+}
+
+/*!
+  Adds \a chunk to the heap snapshot. Returns false if the chunk was
+  ignored.
+*/
+bool QScriptRemoteTargetDebuggerFrontend::handleHeapSnapshot(const QScriptDebuggerHeapSnapshotChunk &chunk)
+{
+    return m_heapSnapshot.append(chunk);
+}
+
+/*!
+  If \a command asks for the data of a script whose contents are in the
+  script cache, stores the response in \a response and returns true.
+*/
+bool QScriptRemoteTargetDebuggerFrontend::lookupScript(int id, const QScriptDebuggerCommand &command,
+                                                       QScriptDebuggerResponse *response)
+{
+    if (command.type() != QScriptDebuggerCommand::GetScriptData)
+        return false;
+    QHash<qint64, QScriptDebuggerScriptHash>::const_iterator it = m_scripts.constFind(command.scriptId());
+    if (it == m_scripts.constEnd())
+        return false;
+    QString contents;
+    if (!m_connection->scriptCache()->lookup(it.value().hash, &contents)) {
+        m_scriptRequests.insert(id, it.value().hash);
+        return false;
+    }
+#ifdef DEBUG_DEBUGGER
+    qDebug("script %lld found in the cache", command.scriptId());
+#endif
+    QScriptScriptData data(contents, it.value().fileName, it.value().baseLineNumber,
+                           it.value().timeStamp);
+    response->setResult(qVariantFromValue(data));
+    return true;
+}
+
+/*!
+  \reimp
+*/
+void QScriptRemoteTargetDebuggerFrontend::processCommand(int id, const QScriptDebuggerCommand &command)
+{
+    Q_ASSERT(m_connection->isAttached());
+    QScriptDebuggerResponse cached;
+    if (lookupScript(id, command, &cached)) {
+        // answered when control returns to the event loop, like any
+        // other response
+        m_cachedIds.append(id);
+        m_cachedResponses.append(cached);
+        scheduleFlush();
+        return;
+    }
+    if (!m_connection->isCommandBatchingEnabled()) {
+        m_connection->writeCommand(m_channel, id, command);
+        return;
+    }
+    // the debugger tends to schedule commands in bursts (e.g. when the
+    // locals are populated); collect them and send them in one frame
+    m_pendingIds.append(id);
+    m_pendingCommands.append(command);
+    scheduleFlush();
+}
+
+void QScriptRemoteTargetDebuggerFrontend::scheduleFlush()
+{
+    if (m_flushScheduled)
+        return;
+    m_flushScheduled = true;
+    QMetaObject::invokeMethod(this, "flushCommands", Qt::QueuedConnection);
+}
+
+void QScriptRemoteTargetDebuggerFrontend::flushCommands()
+{
+    m_flushScheduled = false;
+    if (!m_pendingIds.isEmpty() && m_connection->isAttached()) {
+        if (m_pendingIds.size() == 1)
+            m_connection->writeCommand(m_channel, m_pendingIds.first(), m_pendingCommands.first());
+        else
+            m_connection->writeCommands(m_channel, m_pendingIds, m_pendingCommands);
+    }
+    m_pendingIds.clear();
+    m_pendingCommands.clear();
+
+    QList<qint32> ids = m_cachedIds;
+    QList<QScriptDebuggerResponse> responses = m_cachedResponses;
+    m_cachedIds.clear();
+    m_cachedResponses.clear();
+    for (int i = 0; i < ids.size(); ++i)
+        notifyCommandFinished(int(ids.at(i)), responses.at(i));
+}
+
+QScriptRemoteTargetDebuggerConnection::QScriptRemoteTargetDebuggerConnection(QObject *parent)
+    : QObject(parent), m_state(UnattachedState), m_transport(0), m_transportType(0),
+      m_maxPeers(0), m_traceWriter(QScriptDebuggerTraceWriter::FrontendSide),
+      m_capabilities(QScriptDebuggerProtocol::CompressionCapability
+                     | QScriptDebuggerProtocol::CompactEncodingCapability
+                     | QScriptDebuggerProtocol::ScriptCacheCapability
+                     | QScriptDebuggerProtocol::ProfilerCapability
+                     | QScriptDebuggerProtocol::CoverageCapability
+                     | QScriptDebuggerProtocol::HeapSnapshotCapability
+                     | QScriptDebuggerProtocol::SessionResumeCapability
+                     | QScriptDebuggerProtocol::HeartbeatCapability),
+      m_agreedCapabilities(0), m_compact(false), m_commandBatching(true),
+      m_sessionGracePeriod(0), m_reconnecting(false)
+{
+    m_reconnectTimer = new QTimer(this);
+    m_reconnectTimer->setSingleShot(true);
+    m_reconnectTimer->setInterval(ReconnectInterval);
+    QObject::connect(m_reconnectTimer, SIGNAL(timeout()), this, SLOT(reconnect()));
+    m_heartbeatTimer = new QTimer(this);
+    m_heartbeatTimer->setSingleShot(true);
+    QObject::connect(m_heartbeatTimer, SIGNAL(timeout()), this, SLOT(onHeartbeatTimeout()));
+    m_metricsTimer = new QTimer(this);
+    QObject::connect(m_metricsTimer, SIGNAL(timeout()), this, SLOT(dumpMetrics()));
+    m_codec.setMetrics(&m_metrics);
+}
+
+QScriptRemoteTargetDebuggerConnection::~QScriptRemoteTargetDebuggerConnection()
+{
+    qDeleteAll(m_frontends);
+}
+
+/*!
+  Makes sure that the transport is one of the given \a type, replacing
+  the current one if needed. Returns false if the current one is busy.
+*/
+bool QScriptRemoteTargetDebuggerConnection::createTransport(int type)
+{
+    if (m_transport) {
+        if (m_transportType == type)
+            return true;
+        if (m_state != UnattachedState)
+            return false;
+        delete m_transport;
+        m_transport = 0;
+    }
+    setTransport(QScriptDebuggerTransport::create(QScriptDebuggerTransport::Type(type), this), type);
+    return true;
+}
+
+void QScriptRemoteTargetDebuggerConnection::setTransport(QScriptDebuggerTransport *transport, int type)
+{
+    m_transport = transport;
+    m_transportType = type;
+    QObject::connect(m_transport, SIGNAL(connected()), this, SLOT(onTransportConnected()));
+    QObject::connect(m_transport, SIGNAL(disconnected()), this, SLOT(onTransportDisconnected()));
+    QObject::connect(m_transport, SIGNAL(error(QScriptDebuggerTransport::TransportError)),
+                     this, SLOT(onTransportError(QScriptDebuggerTransport::TransportError)));
+    QObject::connect(m_transport, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+    QObject::connect(m_transport, SIGNAL(peerConnected(QScriptDebuggerTransport*)),
+                     this, SIGNAL(peerConnected(QScriptDebuggerTransport*)));
+}
+
+QIODevice *QScriptRemoteTargetDebuggerConnection::device() const
+{
+    return m_transport ? m_transport->device() : 0;
+}
+
+void QScriptRemoteTargetDebuggerConnection::attachTo(int transport, const QString &address)
+{
+    Q_ASSERT(m_state == UnattachedState);
+    if (!createTransport(transport))
+        return;
+    m_address = address;
+    m_state = ConnectingState;
+    m_transport->connectToPeer(address);
+}
+
+/*!
+  Detaches from the target, or stops trying to get a dropped connection
+  back. The target is told that the session is over, so that it doesn't
+  keep it for us.
+*/
+void QScriptRemoteTargetDebuggerConnection::detach()
+{
+    m_reconnectTimer->stop();
+    m_heartbeatTimer->stop();
+    bool wasReconnecting = m_reconnecting;
+    m_reconnecting = false;
+    if ((m_state == AttachedState) && !m_sessionToken.isEmpty()) {
+        m_codec.beginFrame(QScriptDebuggerProtocol::DetachFrame, 0);
+        endSessionFrame();
+    }
+    forgetSession();
+    switch (m_state) {
+    case UnattachedState:
+        if (wasReconnecting)
+            emit detached();
+        break;
+    case ConnectingState:
+        // detached() is only emitted if attached() was
+        m_state = wasReconnecting ? DetachingState : UnattachedState;
+        m_transport->abort();
+        break;
+    case HandshakingState:
+    case ResumingState:
+    case AttachedState:
+        m_state = DetachingState;
+        m_transport->disconnectFromPeer();
+        break;
+    case DetachingState:
+        break;
+    }
+}
+
+bool QScriptRemoteTargetDebuggerConnection::listen(int transport, const QString &address)
+{
+    if (device() || !createTransport(transport))
+        return false;
+    // only a target we attached to can be got back
+    m_address = QString();
+    m_transport->setMaxPeers(m_maxPeers);
+    if (!m_transport->listen(address)) {
+        qWarning("QScriptRemoteTargetDebugger: %s", qPrintable(m_transport->errorString()));
+        return false;
+    }
+    return true;
+}
+
+/*!
+  Sets the number of targets that may be connected at once when
+  listening to \a count. With a \a count of 0 (the default), this
+  connection attaches to the first target itself; otherwise it only
+  listens, and hands each target out with peerConnected(), to be
+  adopted by a connection of its own. Takes effect on the next listen().
+*/
+void QScriptRemoteTargetDebuggerConnection::setMaxPeers(int count)
+{
+    m_maxPeers = count;
+}
+
+/*!
+  Takes over \a transport, of the given \a type, which a hub has
+  handed out already connected, and starts the handshake. Returns false
+  if this connection already has a transport.
+*/
+bool QScriptRemoteTargetDebuggerConnection::adoptTransport(QScriptDebuggerTransport *transport, int type)
+{
+    if (m_transport || (m_state != UnattachedState))
+        return false;
+    transport->setParent(this);
+    setTransport(transport, type);
+    m_address = QString();
+    onTransportConnected();
+    return true;
+}
+
+/*!
+  Returns the address of the target, if the transport has one.
+*/
+QString QScriptRemoteTargetDebuggerConnection::peerName() const
+{
+    return m_transport ? m_transport->peerName() : QString();
+}
+
+/*!
+  Attaches to a recorded session instead of a target: the frames that
+  the target sent are played back from the trace file \a fileName, at
+  the recorded pace or, if \a fullSpeed is true, as fast as they are
+  read. Returns false if the connection is busy.
+*/
+bool QScriptRemoteTargetDebuggerConnection::replay(const QString &fileName, bool fullSpeed)
+{
+    if (m_state != UnattachedState)
+        return false;
+    delete m_transport;
+    QScriptDebuggerReplayTransport *transport = new QScriptDebuggerReplayTransport(this);
+    transport->setFullSpeed(fullSpeed);
+    QObject::connect(transport, SIGNAL(finished()), this, SIGNAL(replayFinished()));
+    // a type of its own, so that the next attachTo() or listen() replaces it
+    setTransport(transport, -1);
+    m_address = QString();
+    m_state = ConnectingState;
+    m_transport->connectToPeer(fileName);
+    return true;
+}
+
+/*!
+  Starts recording every frame to the trace file \a fileName, replacing
+  any recording in progress. Returns false if the file can't be written.
+*/
+bool QScriptRemoteTargetDebuggerConnection::startRecording(const QString &fileName)
+{
+    stopRecording();
+    if (!m_traceWriter.open(fileName)) {
+        qWarning("QScriptRemoteTargetDebugger: can't record to %s (%s)",
+                 qPrintable(fileName), qPrintable(m_traceWriter.errorString()));
+        return false;
+    }
+    if (m_state == AttachedState)
+        m_traceWriter.writeHandshake(m_agreedCapabilities);
+    m_codec.setTraceWriter(&m_traceWriter);
+    return true;
+}
+
+void QScriptRemoteTargetDebuggerConnection::stopRecording()
+{
+    m_codec.setTraceWriter(0);
+    m_traceWriter.close();
+}
+
+/*!
+  Starts writing the metrics to \a fileName every \a interval ms,
+  replacing any dump in progress. Returns false if the file can't be
+  written.
+*/
+bool QScriptRemoteTargetDebuggerConnection::startMetricsDump(const QString &fileName, int interval)
+{
+    stopMetricsDump();
+    if (!m_metrics.dump(fileName, QString::fromLatin1("qscriptremotetargetdebugger"))) {
+        qWarning("QScriptRemoteTargetDebugger: can't write metrics to %s", qPrintable(fileName));
+        return false;
+    }
+    m_metricsFileName = fileName;
+    m_metricsTimer->start(qMax(1, interval));
+    return true;
+}
+
+/*!
+  Stops writing the metrics; the file is written one last time.
+*/
+void QScriptRemoteTargetDebuggerConnection::stopMetricsDump()
+{
+    if (m_metricsFileName.isEmpty())
+        return;
+    m_metricsTimer->stop();
+    dumpMetrics();
+    m_metricsFileName = QString();
+}
+
+void QScriptRemoteTargetDebuggerConnection::dumpMetrics()
+{
+    if (!m_metricsFileName.isEmpty())
+        m_metrics.dump(m_metricsFileName, QString::fromLatin1("qscriptremotetargetdebugger"));
+}
+
+QScriptDebuggerMetrics *QScriptRemoteTargetDebuggerConnection::metrics()
+{
+    return &m_metrics;
+}
+
+/*!
+  Notes when the command \a id of the given \a type was sent on
+  \a channel, to time the round trip when its response arrives.
+*/
+void QScriptRemoteTargetDebuggerConnection::commandSent(quint32 channel, qint32 id, int type)
+{
+    quint64 key = (quint64(channel) << 32) | quint32(id);
+    m_commandsInFlight.insert(key, qMakePair(QScriptDebuggerMetrics::now(), type));
+    m_metrics.setGauge(QString::fromLatin1("commands_in_flight"), QString(), m_commandsInFlight.size());
+}
+
+void QScriptRemoteTargetDebuggerConnection::responseReceived(quint32 channel, qint32 id)
+{
+    quint64 key = (quint64(channel) << 32) | quint32(id);
+    QHash<quint64, QPair<qint64, int> >::iterator it = m_commandsInFlight.find(key);
+    if (it == m_commandsInFlight.end())
+        return;
+    m_metrics.addTime(QString::fromLatin1("command_round_trip_seconds"),
+                      QString::fromLatin1("type=\"%0\"").arg(it.value().second),
+                      QScriptDebuggerMetrics::now() - it.value().first);
+    m_commandsInFlight.erase(it);
+    m_metrics.setGauge(QString::fromLatin1("commands_in_flight"), QString(), m_commandsInFlight.size());
+}
+
+bool QScriptRemoteTargetDebuggerConnection::isAttached() const
+{
+    return (m_state == AttachedState);
+}
+
+/*!
+  Returns the capabilities agreed on in the handshake.
+*/
+quint32 QScriptRemoteTargetDebuggerConnection::agreedCapabilities() const
+{
+    return m_agreedCapabilities;
+}
+
+bool QScriptRemoteTargetDebuggerConnection::isCommandBatchingEnabled() const
+{
+    return m_commandBatching;
+}
+
+void QScriptRemoteTargetDebuggerConnection::setCommandBatchingEnabled(bool enable)
+{
+    m_commandBatching = enable;
+}
+
+/*!
+  Sets whether compression is asked for in the handshake to \a enable.
+  Takes effect on the next connection.
+*/
+void QScriptRemoteTargetDebuggerConnection::setCompressionEnabled(bool enable)
+{
+    if (enable)
+        m_capabilities |= QScriptDebuggerProtocol::CompressionCapability;
+    else
+        m_capabilities &= ~QScriptDebuggerProtocol::CompressionCapability;
+}
+
+qreal QScriptRemoteTargetDebuggerConnection::compressionRatio() const
+{
+    if (m_codec.bytesBeforeCompression() == 0)
+        return 1;
+    return qreal(m_codec.bytesAfterCompression()) / m_codec.bytesBeforeCompression();
+}
+
+int QScriptRemoteTargetDebuggerConnection::compressionTime() const
+{
+    return m_codec.compressionTime();
+}
+
+QScriptDebuggerScriptCache *QScriptRemoteTargetDebuggerConnection::scriptCache()
+{
+    return &m_scriptCache;
+}
+
+QScriptRemoteTargetDebuggerFrontend *QScriptRemoteTargetDebuggerConnection::frontend(quint32 channel) const
+{
+    return m_frontends.value(channel);
+}
+
+QList<QScriptRemoteTargetDebuggerFrontend*> QScriptRemoteTargetDebuggerConnection::frontends() const
+{
+    return m_frontends.values();
+}
+
+void QScriptRemoteTargetDebuggerConnection::onTransportConnected()
+{
+#ifdef DEBUG_DEBUGGER
+    qDebug("connected");
+#endif
+    initiateHandshake();
+}
+
+void QScriptRemoteTargetDebuggerConnection::onTransportDisconnected()
+{
+    bool wasConnected = (m_state != UnattachedState) && (m_state != ConnectingState);
+    m_heartbeatTimer->stop();
+    m_compact = false;
+    m_agreedCapabilities = 0;
+    m_codec.reset();
+    if (!m_sessionToken.isEmpty() && !m_address.isEmpty() && (m_state != DetachingState)) {
+        // the target keeps the session for a while; try to get it back
+        // before telling anyone that we're gone
+        if (!m_reconnecting) {
+            m_reconnecting = true;
+            m_reconnectTime.start();
+        }
+        if (m_reconnectTime.elapsed() < m_sessionGracePeriod) {
+#ifdef DEBUG_DEBUGGER
+            qDebug("connection dropped; reconnecting");
+#endif
+            m_state = UnattachedState;
+            m_reconnectTimer->start();
+            return;
+        }
+    }
+    if (m_reconnecting) {
+        wasConnected = true;
+        m_reconnecting = false;
+    }
+    forgetSession();
+    m_state = UnattachedState;
+    if (wasConnected)
+        emit detached();
+}
+
+/*!
+  Drops a connection on which the target has missed several heartbeats;
+  if it keeps our session, we try to get it back as usual.
+*/
+void QScriptRemoteTargetDebuggerConnection::onHeartbeatTimeout()
+{
+    if ((m_state != AttachedState) || !m_transport)
+        return;
+    qWarning("QScriptRemoteTargetDebugger: no heartbeat from the target for %d ms; closing the connection",
+             m_heartbeatTimer->interval());
+    m_transport->abort();
+}
+
+void QScriptRemoteTargetDebuggerConnection::reconnect()
+{
+    if (!m_reconnecting || (m_state != UnattachedState))
+        return;
+    m_state = ConnectingState;
+    m_transport->connectToPeer(m_address);
+}
+
+void QScriptRemoteTargetDebuggerConnection::onTransportError(QScriptDebuggerTransport::TransportError err)
+{
+    qDebug("%s", qPrintable(m_transport->errorString()));
+    // the target may not be listening again yet
+    if (m_reconnecting)
+        return;
+    if (err == QScriptDebuggerTransport::HostNotFoundError)
+        emit error(QScriptRemoteTargetDebugger::HostNotFoundError);
+    else if (err == QScriptDebuggerTransport::ConnectionRefusedError)
+        emit error(QScriptRemoteTargetDebugger::ConnectionRefusedError);
+    else
+        emit error(QScriptRemoteTargetDebugger::SocketError);
+}
+
+void QScriptRemoteTargetDebuggerConnection::onReadyRead()
+{
+    switch (m_state) {
+    case UnattachedState:
+    case ConnectingState:
+        Q_ASSERT(0);
+        break;
+
+    case DetachingState:
+        // nothing more is expected from the target
+        device()->readAll();
+        break;
+
+    case HandshakingState: {
+        QByteArray handshakeData = QScriptDebuggerProtocol::handshakeData();
+        if (device()->bytesAvailable() >= QScriptDebuggerProtocol::HandshakeSize) {
+            QByteArray ba = device()->read(handshakeData.size());
+            if (ba == handshakeData) {
+                uchar field[sizeof(quint16) + sizeof(quint32)];
+                device()->read(reinterpret_cast<char*>(field), sizeof(field));
+                quint16 version = qFromBigEndian<quint16>(field);
+                quint32 capabilities = qFromBigEndian<quint32>(field + sizeof(quint16)) & m_capabilities;
+#ifdef DEBUG_DEBUGGER
+                qDebug("handshake ok! (version=%d, capabilities=0x%x)", version, capabilities);
+#else
+                Q_UNUSED(version);
+#endif
+                m_codec.setCompressionEnabled(capabilities & QScriptDebuggerProtocol::CompressionCapability);
+                m_compact = (capabilities & QScriptDebuggerProtocol::CompactEncodingCapability) != 0;
+                m_agreedCapabilities = capabilities;
+                if (m_traceWriter.isOpen())
+                    m_traceWriter.writeHandshake(capabilities);
+                if (capabilities & QScriptDebuggerProtocol::SessionResumeCapability) {
+                    // ask for the session we had, if any; the target
+                    // answers with a SessionFrame
+                    m_state = ResumingState;
+                    m_codec.beginFrame(QScriptDebuggerProtocol::ResumeRequestFrame, 0)
+                        << m_sessionToken << m_sessionLog.receivedCount();
+                    endSessionFrame();
+                } else {
+                    forgetSession();
+                    m_state = AttachedState;
+                    emit attached();
+                }
+                if (device()->bytesAvailable() > 0)
+                    QMetaObject::invokeMethod(this, "onReadyRead", Qt::QueuedConnection);
+            } else {
+                m_state = DetachingState;
+                emit error(QScriptRemoteTargetDebugger::HandshakeError);
+                m_transport->disconnectFromPeer();
+            }
+        }
+    }   break;
+
+    case ResumingState:
+    case AttachedState: {
+#ifdef DEBUG_DEBUGGER
+        qDebug() << "got something! bytes available:" << device()->bytesAvailable();
+#endif
+        while (device() && ((m_state == AttachedState) || (m_state == ResumingState)) && readFrame())
+            ;
+        if (!m_sessionToken.isEmpty() && (m_state == AttachedState)
+            && m_sessionLog.needsAcknowledgement()) {
+            writeAck();
+        }
+    }   break;
+    }
+}
+
+/*!
+  Reads and dispatches one frame. Returns false if no complete frame is
+  available.
+*/
+bool QScriptRemoteTargetDebuggerConnection::readFrame()
+{
+    quint8 type;
+    quint32 channel;
+    QScriptDebuggerFrameCodec::Status status = m_codec.peekFrame(&type, &channel);
+    while (status == QScriptDebuggerFrameCodec::NeedMoreData) {
+        if (m_codec.readFrom(device()) == 0) {
+#ifdef DEBUG_DEBUGGER
+            qDebug("waiting for more bytes (%d buffered)", m_codec.bytesBuffered());
+#endif
+            return false;
+        }
+        status = m_codec.peekFrame(&type, &channel);
+    }
+    if (status == QScriptDebuggerFrameCodec::FrameError) {
+        protocolError();
+        return false;
+    }
+
+    if ((m_state == ResumingState) != (type == QScriptDebuggerProtocol::SessionFrame)) {
+        qWarning("QScriptRemoteTargetDebugger: frame type %d while %s a session; closing the connection",
+                 type, (m_state == ResumingState) ? "waiting for" : "in");
+        emit error(QScriptRemoteTargetDebugger::ProtocolError);
+        forgetSession();
+        m_transport->abort();
+        return false;
+    }
+    if (!QScriptDebuggerProtocol::isControlFrame(type))
+        m_sessionLog.recordReceived();
+    // anything from the target shows that it's still there
+    if (m_heartbeatTimer->isActive())
+        m_heartbeatTimer->start();
+
+    switch (type) {
+    case QScriptDebuggerProtocol::SessionFrame:
+        return handleSessionFrame();
+
+    case QScriptDebuggerProtocol::AckFrame: {
+        quint32 received;
+        m_codec.beginRead() >> received;
+        if (!m_codec.endRead())
+            break;
+        m_sessionLog.acknowledge(received);
+    }   return true;
+
+    case QScriptDebuggerProtocol::HeartbeatFrame: {
+        qint32 interval;
+        m_codec.beginRead() >> interval;
+        if (!m_codec.endRead())
+            break;
+        m_codec.beginFrame(QScriptDebuggerProtocol::HeartbeatFrame, 0) << interval;
+        endSessionFrame();
+        if (interval > 0)
+            m_heartbeatTimer->start(QScriptDebuggerProtocol::MaxMissedHeartbeats * interval);
+        else
+            m_heartbeatTimer->stop();
+    }   return true;
+
+    case QScriptDebuggerProtocol::EventFrame: {
+#ifdef DEBUG_DEBUGGER
+        qDebug("deserializing event");
+#endif
+        qint64 started = QScriptDebuggerMetrics::now();
+        QScriptDebuggerEvent event(QScriptDebuggerEvent::None);
+        QDataStream &in = m_codec.beginRead();
+        if (m_compact)
+            QScriptDebuggerCompactEncoding::readEvent(in, event);
+        else
+            in >> event;
+        if (!m_codec.endRead())
+            break;
+        m_metrics.addTime(QString::fromLatin1("decode_seconds"),
+                          QString::fromLatin1("message=\"event\",type=\"%0\"").arg(int(event.type())),
+                          QScriptDebuggerMetrics::now() - started);
+        if (QScriptRemoteTargetDebuggerFrontend *target = m_frontends.value(channel))
+            target->handleEvent(event);
+        else
+            qWarning("QScriptRemoteTargetDebugger: event for unknown channel %u", channel);
+    }   return true;
+
+    case QScriptDebuggerProtocol::ResponseFrame: {
+#ifdef DEBUG_DEBUGGER
+        qDebug("deserializing command response");
+#endif
+        QDataStream &in = m_codec.beginRead();
+        qint32 id;
+        in >> id;
+        QScriptDebuggerResponse response;
+        decodeResponse(in, response);
+        if (!m_codec.endRead())
+            break;
+        responseReceived(channel, id);
+        if (QScriptRemoteTargetDebuggerFrontend *target = m_frontends.value(channel))
+            target->handleResponse(id, response);
+        else
+            qWarning("QScriptRemoteTargetDebugger: response for unknown channel %u", channel);
+    }   return true;
+
+    case QScriptDebuggerProtocol::ResponseBatchFrame: {
+        QDataStream &in = m_codec.beginRead();
+        quint32 count;
+        in >> count;
+#ifdef DEBUG_DEBUGGER
+        qDebug("deserializing %u command responses", count);
+#endif
+        QList<qint32> ids;
+        QList<QScriptDebuggerResponse> responses;
+        for (quint32 i = 0; (i < count) && (in.status() == QDataStream::Ok); ++i) {
+            qint32 id;
+            in >> id;
+            QScriptDebuggerResponse response;
+            decodeResponse(in, response);
+            ids.append(id);
+            responses.append(response);
+        }
+        if (!m_codec.endRead())
+            break;
+        for (int i = 0; i < ids.size(); ++i)
+            responseReceived(channel, ids.at(i));
+        if (QScriptRemoteTargetDebuggerFrontend *target = m_frontends.value(channel)) {
+            for (int i = 0; i < responses.size(); ++i)
+                target->handleResponse(ids.at(i), responses.at(i));
+        } else {
+            qWarning("QScriptRemoteTargetDebugger: responses for unknown channel %u", channel);
+        }
+    }   return true;
+
+    case QScriptDebuggerProtocol::OutputFrame: {
+        QList<QScriptDebuggerOutputEntry> output;
+        m_codec.beginRead() >> output;
+        if (!m_codec.endRead())
+            break;
+#ifdef DEBUG_DEBUGGER
+        qDebug("received %d output entries (channel=%u)", output.size(), channel);
+#endif
+        if (QScriptRemoteTargetDebuggerFrontend *target = m_frontends.value(channel)) {
+            target->handleOutput(output);
+            emit outputAvailable(target);
+        } else {
+            qWarning("QScriptRemoteTargetDebugger: output for unknown channel %u", channel);
+        }
+    }   return true;
+
+    case QScriptDebuggerProtocol::ScriptHashesFrame: {
+        QList<QScriptDebuggerScriptHash> scripts;
+        m_codec.beginRead() >> scripts;
+        if (!m_codec.endRead())
+            break;
+#ifdef DEBUG_DEBUGGER
+        qDebug("received %d script hashes (channel=%u)", scripts.size(), channel);
+#endif
+        if (QScriptRemoteTargetDebuggerFrontend *target = m_frontends.value(channel))
+            target->handleScriptHashes(scripts);
+    }   return true;
+
+    case QScriptDebuggerProtocol::ProfileFrame: {
+        QScriptDebuggerProfileChunk chunk;
+        m_codec.beginRead() >> chunk;
+        if (!m_codec.endRead())
+            break;
+#ifdef DEBUG_DEBUGGER
+        qDebug("received profile chunk of session %u (channel=%u)", chunk.session, channel);
+#endif
+        QScriptRemoteTargetDebuggerFrontend *target = m_frontends.value(channel);
+        if (target && target->handleProfile(chunk))
+            emit profileAvailable(target);
+    }   return true;
+
+    case QScriptDebuggerProtocol::CoverageFrame: {
+        QScriptDebuggerCoverageChunk chunk;
+        m_codec.beginRead() >> chunk;
+        if (!m_codec.endRead())
+            break;
+#ifdef DEBUG_DEBUGGER
+        qDebug("received coverage of %d scripts (channel=%u)", chunk.scripts.size(), channel);
+#endif
+        QScriptRemoteTargetDebuggerFrontend *target = m_frontends.value(channel);
+        if (target && target->handleCoverage(chunk))
+            emit coverageAvailable(target);
+    }   return true;
+
+    case QScriptDebuggerProtocol::HeapSnapshotFrame: {
+        QScriptDebuggerHeapSnapshotChunk chunk;
+        m_codec.beginRead() >> chunk;
+        if (!m_codec.endRead())
+            break;
+#ifdef DEBUG_DEBUGGER
+        qDebug("received %d heap nodes of snapshot %u (channel=%u)",
+               chunk.nodes.size(), chunk.snapshot, channel);
+#endif
+        QScriptRemoteTargetDebuggerFrontend *target = m_frontends.value(channel);
+        if (target && target->handleHeapSnapshot(chunk))
+            emit heapSnapshotAvailable(target);
+    }   return true;
+
+    case QScriptDebuggerProtocol::ChannelOpenedFrame: {
+        QString name;
+        m_codec.beginRead() >> name;
+        if (!m_codec.endRead())
+            break;
+#ifdef DEBUG_DEBUGGER
+        qDebug("channel %u opened (%s)", channel, qPrintable(name));
+#endif
+        QScriptRemoteTargetDebuggerFrontend *target = m_frontends.value(channel);
+        if (!target) {
+            target = new QScriptRemoteTargetDebuggerFrontend(this, channel, name);
+            m_frontends.insert(channel, target);
+        } else {
+            target->setName(name);
+        }
+        emit channelOpened(target);
+    }   return true;
+
+    case QScriptDebuggerProtocol::ChannelClosedFrame: {
+        m_codec.skipFrame();
+#ifdef DEBUG_DEBUGGER
+        qDebug("channel %u closed", channel);
+#endif
+        QScriptRemoteTargetDebuggerFrontend *target = m_frontends.take(channel);
+        if (target) {
+            emit channelClosed(target);
+            delete target;
+        }
+    }   return true;
+
+    default:
+        qWarning("QScriptRemoteTargetDebugger: unexpected frame type %d", type);
+        m_codec.skipFrame();
+        return true;
+    }
+
+    // the payload didn't match its frame
+    protocolError();
+    return false;
+}
+
+/*!
+  Drops the connection after receiving data that isn't a valid frame;
+  there's no telling where the next frame would start.
+*/
+void QScriptRemoteTargetDebuggerConnection::protocolError()
+{
+    qWarning("QScriptRemoteTargetDebugger: %s; closing the connection",
+             qPrintable(m_codec.errorString()));
+    emit error(QScriptRemoteTargetDebugger::ProtocolError);
+    forgetSession();
+    m_transport->abort();
+}
+
+/*!
+  Handles the target's answer to our ResumeRequestFrame. Returns false
+  if the connection has been closed.
+*/
+bool QScriptRemoteTargetDebuggerConnection::handleSessionFrame()
+{
+    QByteArray token;
+    quint32 received;
+    bool resumed;
+    qint32 gracePeriod;
+    m_codec.beginRead() >> token >> received >> resumed >> gracePeriod;
+    if (!m_codec.endRead()) {
+        protocolError();
+        return false;
+    }
+    m_sessionGracePeriod = gracePeriod;
+    if (resumed && !m_sessionLog.canReplay(received)) {
+        // we no longer have what the target missed; start over
+        qWarning("QScriptRemoteTargetDebugger: can't resume the session; detaching");
+        m_codec.beginFrame(QScriptDebuggerProtocol::DetachFrame, 0);
+        endSessionFrame();
+        forgetSession();
+        m_state = DetachingState;
+        m_transport->disconnectFromPeer();
+        return false;
+    }
+    bool wasReconnecting = m_reconnecting;
+    m_reconnecting = false;
+    m_state = AttachedState;
+    if (resumed) {
+#ifdef DEBUG_DEBUGGER
+        qDebug("session resumed after frame %u", received);
+#endif
+        // what the target missed, then carry on where we were
+        m_sessionLog.replay(received, device());
+        return true;
+    }
+    m_sessionToken = token;
+    m_sessionLog.reset();
+    // the old session is gone, and with it the answers to what was sent
+    // on it
+    if (wasReconnecting)
+        emit detached();
+    emit attached();
+    return true;
+}
+
+void QScriptRemoteTargetDebuggerConnection::writeCommand(quint32 channel, qint32 id,
+                                                         const QScriptDebuggerCommand &command)
+{
+    qint64 started = QScriptDebuggerMetrics::now();
+    QDataStream &out = m_codec.beginFrame(QScriptDebuggerProtocol::CommandFrame, channel);
+    out << id;
+    encodeCommand(out, command);
+    m_metrics.addTime(QString::fromLatin1("encode_seconds"),
+                      QString::fromLatin1("message=\"command\",type=\"%0\"").arg(int(command.type())),
+                      QScriptDebuggerMetrics::now() - started);
+    commandSent(channel, id, command.type());
+#ifdef DEBUG_DEBUGGER
+    qDebug("writing command (channel=%u, id=%d)", channel, id);
+#endif
+    endFrame();
+}
+
+void QScriptRemoteTargetDebuggerConnection::writeCommands(quint32 channel, const QList<qint32> &ids,
+                                                          const QList<QScriptDebuggerCommand> &commands)
+{
+    Q_ASSERT(ids.size() == commands.size());
+    QDataStream &out = m_codec.beginFrame(QScriptDebuggerProtocol::CommandBatchFrame, channel);
+    out << (quint32)commands.size();
+    for (int i = 0; i < commands.size(); ++i) {
+        qint64 started = QScriptDebuggerMetrics::now();
+        out << ids.at(i);
+        encodeCommand(out, commands.at(i));
+        m_metrics.addTime(QString::fromLatin1("encode_seconds"),
+                          QString::fromLatin1("message=\"command\",type=\"%0\"").arg(int(commands.at(i).type())),
+                          QScriptDebuggerMetrics::now() - started);
+        commandSent(channel, ids.at(i), commands.at(i).type());
+    }
+#ifdef DEBUG_DEBUGGER
+    qDebug("writing %d commands (channel=%u)", commands.size(), channel);
+#endif
+    endFrame();
+}
+
+/*!
+  Tells the target on \a channel to sample its stack every \a interval
+  ms, or to stop sampling if \a interval is 0.
+*/
+void QScriptRemoteTargetDebuggerConnection::writeProfilerControl(quint32 channel, qint32 interval,
+                                                                 quint32 session)
+{
+    QDataStream &out = m_codec.beginFrame(QScriptDebuggerProtocol::ProfilerControlFrame, channel);
+    out << interval << session;
+#ifdef DEBUG_DEBUGGER
+    qDebug("writing profiler control (channel=%u, interval=%d)", channel, interval);
+#endif
+    endFrame();
+}
+
+/*!
+  Tells the target on \a channel to send its line coverage every \a
+  interval ms, or to stop sending it if \a interval is 0.
+*/
+void QScriptRemoteTargetDebuggerConnection::writeCoverageControl(quint32 channel, qint32 interval,
+                                                                 quint32 session)
+{
+    QDataStream &out = m_codec.beginFrame(QScriptDebuggerProtocol::CoverageControlFrame, channel);
+    out << interval << session;
+#ifdef DEBUG_DEBUGGER
+    qDebug("writing coverage control (channel=%u, interval=%d)", channel, interval);
+#endif
+    endFrame();
+}
+
+/*!
+  Asks the target on \a channel for a heap snapshot, tagged with \a
+  snapshot.
+*/
+void QScriptRemoteTargetDebuggerConnection::writeHeapSnapshotRequest(quint32 channel, quint32 snapshot)
+{
+    QDataStream &out = m_codec.beginFrame(QScriptDebuggerProtocol::HeapSnapshotRequestFrame, channel);
+    out << snapshot;
+#ifdef DEBUG_DEBUGGER
+    qDebug("writing heap snapshot request (channel=%u, snapshot=%u)", channel, snapshot);
+#endif
+    endFrame();
+}
+
+void QScriptRemoteTargetDebuggerConnection::decodeResponse(QDataStream &in, QScriptDebuggerResponse &response)
+{
+    if (m_compact)
+        QScriptDebuggerCompactEncoding::readResponse(in, response);
+    else
+        in >> response;
+}
+
+void QScriptRemoteTargetDebuggerConnection::encodeCommand(QDataStream &out, const QScriptDebuggerCommand &command)
+{
+    if (m_compact)
+        QScriptDebuggerCompactEncoding::writeCommand(out, command);
+    else
+        out << command;
+}
+
+void QScriptRemoteTargetDebuggerConnection::endFrame()
+{
+    if (!m_codec.endFrame())
+        qWarning("QScriptRemoteTargetDebugger: %s; frame dropped", qPrintable(m_codec.errorString()));
+    if (!m_sessionToken.isEmpty()) {
+        m_sessionLog.recordSent(m_codec.pendingData(), m_codec.pendingSize());
+        // while the session is being got back, the frame is only logged;
+        // it is sent once the target has said what it is missing
+        if (m_state != AttachedState) {
+            m_codec.discardPending();
+            return;
+        }
+    }
+    if (device())
+        m_codec.writeTo(device());
+}
+
+/*!
+  Finishes a frame that manages the session; it is written right away,
+  and isn't logged.
+*/
+void QScriptRemoteTargetDebuggerConnection::endSessionFrame()
+{
+    m_codec.endFrame();
+    if (device())
+        m_codec.writeTo(device());
+    else
+        m_codec.discardPending();
+}
+
+void QScriptRemoteTargetDebuggerConnection::writeAck()
+{
+    m_codec.beginFrame(QScriptDebuggerProtocol::AckFrame, 0) << m_sessionLog.receivedCount();
+    m_sessionLog.setAcknowledged();
+    endSessionFrame();
+}
+
+void QScriptRemoteTargetDebuggerConnection::forgetSession()
+{
+    m_sessionToken.clear();
+    m_sessionLog.reset();
+    // the commands in flight won't be answered
+    m_commandsInFlight.clear();
+    m_metrics.setGauge(QString::fromLatin1("commands_in_flight"), QString(), 0);
+}
+
+void QScriptRemoteTargetDebuggerConnection::initiateHandshake()
+{
+    m_state = HandshakingState;
+    QByteArray handshakeData = QScriptDebuggerProtocol::handshakeData();
+    uchar field[sizeof(quint16) + sizeof(quint32)];
+    qToBigEndian<quint16>(QScriptDebuggerProtocol::ProtocolVersion, field);
+    quint32 capabilities = m_capabilities;
+    if (!m_scriptCache.isEnabled())
+        capabilities &= ~QScriptDebuggerProtocol::ScriptCacheCapability;
+    qToBigEndian<quint32>(capabilities, field + sizeof(quint16));
+    handshakeData.append(reinterpret_cast<const char*>(field), sizeof(field));
+#ifdef DEBUG_DEBUGGER
+    qDebug("writing handshake data");
+#endif
+    device()->write(handshakeData);
+}
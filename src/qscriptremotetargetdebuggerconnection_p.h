@@ -0,0 +1,294 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef QSCRIPTREMOTETARGETDEBUGGERCONNECTION_P_H
+#define QSCRIPTREMOTETARGETDEBUGGERCONNECTION_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/qdatetime.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qmap.h>
+#include <QtCore/qobject.h>
+#include <QtCore/qstring.h>
+
+#include "qscriptdebuggerprotocol_p.h"
+#include "qscriptdebuggerframecodec_p.h"
+#include "qscriptdebuggerscriptcache_p.h"
+#include "qscriptdebuggertransport_p.h"
+#include "qscriptdebuggertrace_p.h"
+#include "qscriptdebuggerprofile_p.h"
+#include "qscriptdebuggercoverage_p.h"
+#include "qscriptdebuggerheapsnapshot_p.h"
+#include "qscriptdebuggersessionlog_p.h"
+#include "qscriptdebuggermetrics_p.h"
+
+#include <private/qscriptdebuggerfrontend_p.h>
+#include <private/qscriptdebuggerevent_p.h>
+
+class QTimer;
+class QScriptDebuggerCommand;
+class QScriptDebuggerResponse;
+class QScriptRemoteTargetDebuggerConnection;
+
+class QScriptRemoteTargetDebuggerFrontend
+    : public QObject, public QScriptDebuggerFrontend
+{
+    Q_OBJECT
+public:
+    enum {
+        // what is kept of the output of a session whose events are held
+        MaxHeldOutput = 1000
+    };
+
+    QScriptRemoteTargetDebuggerFrontend(QScriptRemoteTargetDebuggerConnection *connection,
+                                        quint32 channel, const QString &name);
+    ~QScriptRemoteTargetDebuggerFrontend();
+
+    QScriptRemoteTargetDebuggerConnection *connection() const;
+    quint32 channel() const;
+    QString name() const;
+    void setName(const QString &name);
+
+    bool areEventsHeld() const;
+    void setEventsHeld(bool held);
+    bool hasHeldEvent() const;
+
+    void handleEvent(const QScriptDebuggerEvent &event);
+    void handleResponse(qint32 id, const QScriptDebuggerResponse &response);
+    void handleOutput(const QList<QScriptDebuggerOutputEntry> &output);
+    QList<QScriptDebuggerOutputEntry> takeOutput();
+    void handleScriptHashes(const QList<QScriptDebuggerScriptHash> &scripts);
+
+    bool startProfiling(int interval);
+    void stopProfiling();
+    bool isProfiling() const;
+    QScriptDebuggerProfile *profile();
+    bool handleProfile(const QScriptDebuggerProfileChunk &chunk);
+
+    bool startCoverage(int interval);
+    void stopCoverage();
+    bool isCollectingCoverage() const;
+    QScriptDebuggerCoverage *coverage();
+    bool handleCoverage(const QScriptDebuggerCoverageChunk &chunk);
+
+    bool takeHeapSnapshot();
+    QScriptDebuggerHeapSnapshot *heapSnapshot();
+    bool handleHeapSnapshot(const QScriptDebuggerHeapSnapshotChunk &chunk);
+
+Q_SIGNALS:
+    void eventHeld();
+
+protected:
+    void processCommand(int id, const QScriptDebuggerCommand &command);
+
+private Q_SLOTS:
+    void flushCommands();
+
+private:
+    bool lookupScript(int id, const QScriptDebuggerCommand &command,
+                      QScriptDebuggerResponse *response);
+    void scheduleFlush();
+
+private:
+    QScriptRemoteTargetDebuggerConnection *m_connection;
+    quint32 m_channel;
+    QString m_name;
+    QList<QScriptDebuggerOutputEntry> m_output;
+    // while nobody looks at the session, the event that suspended the
+    // target is kept until somebody does
+    bool m_eventsHeld;
+    bool m_hasHeldEvent;
+    QScriptDebuggerEvent m_heldEvent;
+    QList<qint32> m_pendingIds;
+    QList<QScriptDebuggerCommand> m_pendingCommands;
+    bool m_flushScheduled;
+
+    // scripts announced by the target, and the responses that have been
+    // answered from the script cache instead
+    QHash<qint64, QScriptDebuggerScriptHash> m_scripts;
+    QHash<int, QByteArray> m_scriptRequests;
+    QList<qint32> m_cachedIds;
+    QList<QScriptDebuggerResponse> m_cachedResponses;
+
+    QScriptDebuggerProfile m_profile;
+    bool m_profiling;
+
+    QScriptDebuggerCoverage m_coverage;
+    bool m_collectingCoverage;
+
+    QScriptDebuggerHeapSnapshot m_heapSnapshot;
+
+    Q_DISABLE_COPY(QScriptRemoteTargetDebuggerFrontend)
+};
+
+class QScriptRemoteTargetDebuggerConnection : public QObject
+{
+    Q_OBJECT
+public:
+    enum State {
+        UnattachedState,
+        ConnectingState,
+        HandshakingState,
+        // waiting for the target to say which session this is
+        ResumingState,
+        AttachedState,
+        DetachingState
+    };
+
+    enum {
+        // how long to wait between attempts to get a dropped connection
+        // back, while the target keeps the session
+        ReconnectInterval = 250 // ms
+    };
+
+    QScriptRemoteTargetDebuggerConnection(QObject *parent = 0);
+    ~QScriptRemoteTargetDebuggerConnection();
+
+    void attachTo(int transport, const QString &address);
+    void detach();
+    bool listen(int transport, const QString &address);
+    bool replay(const QString &fileName, bool fullSpeed);
+    void setMaxPeers(int count);
+    bool adoptTransport(QScriptDebuggerTransport *transport, int type);
+    QString peerName() const;
+
+    bool startRecording(const QString &fileName);
+    void stopRecording();
+
+    bool startMetricsDump(const QString &fileName, int interval);
+    void stopMetricsDump();
+    QScriptDebuggerMetrics *metrics();
+
+    bool isAttached() const;
+    quint32 agreedCapabilities() const;
+
+    bool isCommandBatchingEnabled() const;
+    void setCommandBatchingEnabled(bool enable);
+
+    void setCompressionEnabled(bool enable);
+    qreal compressionRatio() const;
+    int compressionTime() const;
+
+    QScriptDebuggerScriptCache *scriptCache();
+
+    QScriptRemoteTargetDebuggerFrontend *frontend(quint32 channel) const;
+    QList<QScriptRemoteTargetDebuggerFrontend*> frontends() const;
+
+    void writeCommand(quint32 channel, qint32 id, const QScriptDebuggerCommand &command);
+    void writeCommands(quint32 channel, const QList<qint32> &ids,
+                       const QList<QScriptDebuggerCommand> &commands);
+    void writeProfilerControl(quint32 channel, qint32 interval, quint32 session);
+    void writeCoverageControl(quint32 channel, qint32 interval, quint32 session);
+    void writeHeapSnapshotRequest(quint32 channel, quint32 snapshot);
+
+Q_SIGNALS:
+    void attached();
+    void detached();
+    // a QScriptRemoteTargetDebugger::Error
+    void error(int error);
+
+    void channelOpened(QScriptRemoteTargetDebuggerFrontend *frontend);
+    void channelClosed(QScriptRemoteTargetDebuggerFrontend *frontend);
+    void outputAvailable(QScriptRemoteTargetDebuggerFrontend *frontend);
+    void profileAvailable(QScriptRemoteTargetDebuggerFrontend *frontend);
+    void coverageAvailable(QScriptRemoteTargetDebuggerFrontend *frontend);
+    void heapSnapshotAvailable(QScriptRemoteTargetDebuggerFrontend *frontend);
+    void replayFinished();
+    // a target connected to a hub; see setMaxPeers()
+    void peerConnected(QScriptDebuggerTransport *transport);
+
+private Q_SLOTS:
+    void onTransportConnected();
+    void onTransportDisconnected();
+    void onTransportError(QScriptDebuggerTransport::TransportError);
+    void onReadyRead();
+    void reconnect();
+    void onHeartbeatTimeout();
+    void dumpMetrics();
+
+private:
+    QIODevice *device() const;
+    bool createTransport(int type);
+    void setTransport(QScriptDebuggerTransport *transport, int type);
+    void initiateHandshake();
+    bool readFrame();
+    void protocolError();
+    void decodeResponse(QDataStream &in, QScriptDebuggerResponse &response);
+    void encodeCommand(QDataStream &out, const QScriptDebuggerCommand &command);
+    void endFrame();
+    void endSessionFrame();
+    bool handleSessionFrame();
+    void writeAck();
+    void forgetSession();
+    void commandSent(quint32 channel, qint32 id, int type);
+    void responseReceived(quint32 channel, qint32 id);
+
+private:
+    State m_state;
+    QScriptDebuggerTransport *m_transport;
+    int m_transportType;
+    int m_maxPeers;
+    QScriptDebuggerFrameCodec m_codec;
+    QScriptDebuggerTraceWriter m_traceWriter;
+    quint32 m_capabilities;
+    quint32 m_agreedCapabilities;
+    bool m_compact;
+    bool m_commandBatching;
+    QScriptDebuggerScriptCache m_scriptCache;
+    QMap<quint32, QScriptRemoteTargetDebuggerFrontend*> m_frontends;
+
+    // the session that the target keeps for us, if it offered to; while
+    // the connection to an address given to attachTo() is being got
+    // back, frames are only logged
+    QString m_address;
+    QByteArray m_sessionToken;
+    int m_sessionGracePeriod;
+    QScriptDebuggerSessionLog m_sessionLog;
+    bool m_reconnecting;
+    QTime m_reconnectTime;
+    QTimer *m_reconnectTimer;
+
+    // runs out when the target hasn't been heard from for
+    // MaxMissedHeartbeats of the intervals it asked for
+    QTimer *m_heartbeatTimer;
+
+    QScriptDebuggerMetrics m_metrics;
+    QString m_metricsFileName;
+    QTimer *m_metricsTimer;
+    // when each command that hasn't been answered yet was sent, and its
+    // type, keyed by channel and id
+    QHash<quint64, QPair<qint64, int> > m_commandsInFlight;
+
+    Q_DISABLE_COPY(QScriptRemoteTargetDebuggerConnection)
+};
+
+#endif
@@ -1,5 +1,24 @@
 INCLUDEPATH += $$PWD
 DEPENDPATH += $$PWD
-SOURCES += $$PWD/qscriptremotetargetdebugger.cpp $$PWD/qscriptdebuggermetatypes.cpp
-HEADERS += $$PWD/qscriptremotetargetdebugger.h
+SOURCES += $$PWD/qscriptremotetargetdebugger.cpp $$PWD/qscriptremotetargetdebuggerconnection.cpp \
+           $$PWD/qscriptdebuggermetatypes.cpp \
+           $$PWD/qscriptdebuggerframecodec.cpp $$PWD/qscriptdebuggercompactencoding.cpp \
+           $$PWD/qscriptdebuggerscriptcache.cpp $$PWD/qscriptdebuggertransport.cpp \
+           $$PWD/qscriptdebuggerprofile.cpp $$PWD/qscriptdebuggerprofilerwidget.cpp \
+           $$PWD/qscriptdebuggercoverage.cpp $$PWD/qscriptdebuggercoveragegutter.cpp \
+           $$PWD/qscriptdebuggerheapsnapshot.cpp $$PWD/qscriptdebuggerheapsnapshotwidget.cpp \
+           $$PWD/qscriptdebuggertrace.cpp \
+           $$PWD/qscriptdebuggersessionlog.cpp $$PWD/qscriptdebuggermetrics.cpp \
+           $$PWD/qscriptdebuggersessionswidget.cpp
+HEADERS += $$PWD/qscriptremotetargetdebugger.h $$PWD/qscriptremotetargetdebuggerconnection_p.h \
+           $$PWD/qscriptdebuggerprotocol_p.h \
+           $$PWD/qscriptdebuggerframecodec_p.h \
+           $$PWD/qscriptdebuggermetatypes_p.h $$PWD/qscriptdebuggercompactencoding_p.h \
+           $$PWD/qscriptdebuggerscriptcache_p.h $$PWD/qscriptdebuggertransport_p.h \
+           $$PWD/qscriptdebuggerprofile_p.h $$PWD/qscriptdebuggerprofilerwidget_p.h \
+           $$PWD/qscriptdebuggercoverage_p.h $$PWD/qscriptdebuggercoveragegutter_p.h \
+           $$PWD/qscriptdebuggerheapsnapshot_p.h $$PWD/qscriptdebuggerheapsnapshotwidget_p.h \
+           $$PWD/qscriptdebuggertrace_p.h \
+           $$PWD/qscriptdebuggersessionlog_p.h $$PWD/qscriptdebuggermetrics_p.h \
+           $$PWD/qscriptdebuggersessionswidget_p.h
 DEFINES += QT_BUILD_INTERNAL
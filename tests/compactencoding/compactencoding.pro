@@ -0,0 +1,13 @@
+TEMPLATE = app
+TARGET = tst_qscriptdebuggercompactencoding
+DEPENDPATH += .
+INCLUDEPATH += .
+QT += script scripttools
+CONFIG += qtestlib
+win32: CONFIG += console
+mac:CONFIG -= app_bundle
+INCLUDEPATH += ../../src
+SOURCES += tst_qscriptdebuggercompactencoding.cpp ../../src/qscriptdebuggercompactencoding.cpp \
+           ../../src/qscriptdebuggermetatypes.cpp
+HEADERS += ../../src/qscriptdebuggercompactencoding_p.h ../../src/qscriptdebuggermetatypes_p.h
+DEFINES += QT_BUILD_INTERNAL
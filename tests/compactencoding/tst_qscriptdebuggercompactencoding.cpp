@@ -0,0 +1,310 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+
+#include <QtTest/QtTest>
+
+#include "qscriptdebuggercompactencoding_p.h"
+#include "qscriptdebuggermetatypes_p.h"
+
+class tst_QScriptDebuggerCompactEncoding : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void command();
+    void response();
+    void propertyListResponse();
+    void event();
+    void dataStreamFallback();
+    void truncatedCommand();
+    void nestingDepth();
+    void size_data();
+    void size();
+};
+
+// Returns \a command after a trip through the compact encoding.
+static QScriptDebuggerCommand roundTrip(const QScriptDebuggerCommand &command)
+{
+    QByteArray bytes;
+    QDataStream out(&bytes, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_5);
+    QScriptDebuggerCompactEncoding::writeCommand(out, command);
+    QDataStream in(bytes);
+    in.setVersion(QDataStream::Qt_4_5);
+    QScriptDebuggerCommand result;
+    QScriptDebuggerCompactEncoding::readCommand(in, result);
+    if ((in.status() != QDataStream::Ok) || !in.atEnd())
+        return QScriptDebuggerCommand();
+    return result;
+}
+
+static QScriptDebuggerResponse roundTrip(const QScriptDebuggerResponse &response)
+{
+    QByteArray bytes;
+    QDataStream out(&bytes, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_5);
+    QScriptDebuggerCompactEncoding::writeResponse(out, response);
+    QDataStream in(bytes);
+    in.setVersion(QDataStream::Qt_4_5);
+    QScriptDebuggerResponse result;
+    QScriptDebuggerCompactEncoding::readResponse(in, result);
+    if ((in.status() != QDataStream::Ok) || !in.atEnd())
+        return QScriptDebuggerResponse();
+    return result;
+}
+
+static QScriptDebuggerEvent roundTrip(const QScriptDebuggerEvent &event)
+{
+    QByteArray bytes;
+    QDataStream out(&bytes, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_5);
+    QScriptDebuggerCompactEncoding::writeEvent(out, event);
+    QDataStream in(bytes);
+    in.setVersion(QDataStream::Qt_4_5);
+    QScriptDebuggerEvent result;
+    QScriptDebuggerCompactEncoding::readEvent(in, result);
+    if ((in.status() != QDataStream::Ok) || !in.atEnd())
+        return QScriptDebuggerEvent();
+    return result;
+}
+
+void tst_QScriptDebuggerCompactEncoding::initTestCase()
+{
+    qScriptDebugRegisterMetaTypes();
+}
+
+void tst_QScriptDebuggerCompactEncoding::command()
+{
+    QScriptDebuggerCommand evaluate = QScriptDebuggerCommand::evaluateCommand(
+        2, QString::fromLatin1("a + b"), QString::fromLatin1("console"), -1);
+    QScriptDebuggerCommand result = roundTrip(evaluate);
+    QCOMPARE(result.type(), QScriptDebuggerCommand::Evaluate);
+    QCOMPARE(result.contextIndex(), 2);
+    QCOMPARE(result.program(), QString::fromLatin1("a + b"));
+    QCOMPARE(result.fileName(), QString::fromLatin1("console"));
+    QCOMPARE(result.lineNumber(), -1);
+
+    QScriptDebuggerCommand breakpoint = QScriptDebuggerCommand::setBreakpointCommand(
+        QString::fromUtf8("sk\xc3\xa9tch.qs"), 1234567);
+    result = roundTrip(breakpoint);
+    QCOMPARE(result.type(), QScriptDebuggerCommand::SetBreakpoint);
+    QCOMPARE(result.attributes(), breakpoint.attributes());
+}
+
+void tst_QScriptDebuggerCompactEncoding::response()
+{
+    QScriptDebuggerResponse response;
+    response.setResult(QScriptDebuggerValue(QString::fromLatin1("text")));
+    response.setAsync(true);
+    QScriptDebuggerResponse result = roundTrip(response);
+    QCOMPARE(result.error(), QScriptDebuggerResponse::NoError);
+    QVERIFY(result.async());
+    QCOMPARE(result.resultAsScriptValue().type(), QScriptDebuggerValue::StringValue);
+    QCOMPARE(result.resultAsScriptValue().stringValue(), QString::fromLatin1("text"));
+
+    QScriptDebuggerResponse error;
+    error.setError(QScriptDebuggerResponse::InvalidContextIndex);
+    result = roundTrip(error);
+    QCOMPARE(result.error(), QScriptDebuggerResponse::InvalidContextIndex);
+    QVERIFY(!result.result().isValid());
+
+    QVariantMap map;
+    map.insert(QString::fromLatin1("count"), -42);
+    map.insert(QString::fromLatin1("big"), Q_INT64_C(-1) << 40);
+    map.insert(QString::fromLatin1("list"), QVariantList() << 1.5 << true << QString());
+    QScriptDebuggerResponse nested;
+    nested.setResult(map);
+    QCOMPARE(roundTrip(nested).result(), QVariant(map));
+}
+
+void tst_QScriptDebuggerCompactEncoding::propertyListResponse()
+{
+    QScriptDebuggerValuePropertyList props;
+    props.append(QScriptDebuggerValueProperty(QString::fromLatin1("index"), QScriptDebuggerValue(42.0),
+                                              QString::fromLatin1("42"), QScriptValue::PropertyFlags(0)));
+    props.append(QScriptDebuggerValueProperty(QString::fromLatin1("length"), QScriptDebuggerValue(3.0),
+                                              QString::fromLatin1("3"), QScriptValue::ReadOnly
+                                              | QScriptValue::Undeletable));
+    props.append(QScriptDebuggerValueProperty(QString::fromLatin1("parent"),
+                                              QScriptDebuggerValue(QScriptDebuggerValue::NullValue),
+                                              QString::fromLatin1("null"), QScriptValue::PropertyFlags(0)));
+    QScriptDebuggerResponse response;
+    response.setResult(qVariantFromValue(props));
+
+    QScriptDebuggerValuePropertyList result = roundTrip(response).resultAsScriptValuePropertyList();
+    QCOMPARE(result.size(), props.size());
+    for (int i = 0; i < props.size(); ++i) {
+        QCOMPARE(result.at(i).name(), props.at(i).name());
+        QVERIFY(result.at(i).value() == props.at(i).value());
+        QCOMPARE(result.at(i).valueAsString(), props.at(i).valueAsString());
+        QCOMPARE(int(result.at(i).flags()), int(props.at(i).flags()));
+    }
+}
+
+void tst_QScriptDebuggerCompactEncoding::event()
+{
+    QScriptDebuggerEvent event(QScriptDebuggerEvent::Breakpoint, 123456789, 17, 4);
+    event.setBreakpointId(3);
+    event.setFileName(QString::fromLatin1("example.qs"));
+    QScriptDebuggerEvent result = roundTrip(event);
+    QCOMPARE(result.type(), QScriptDebuggerEvent::Breakpoint);
+    QCOMPARE(result.scriptId(), qint64(123456789));
+    QCOMPARE(result.lineNumber(), 17);
+    QCOMPARE(result.columnNumber(), 4);
+    QCOMPARE(result.breakpointId(), 3);
+    QCOMPARE(result.fileName(), QString::fromLatin1("example.qs"));
+}
+
+// Types the encoding has no tag for are embedded in their QDataStream form.
+void tst_QScriptDebuggerCompactEncoding::dataStreamFallback()
+{
+    QByteArray raw("\x00\x01\xff", 3);
+    QScriptDebuggerResponse response;
+    response.setResult(raw);
+    QScriptDebuggerResponse result = roundTrip(response);
+    QCOMPARE(result.result().userType(), int(QVariant::ByteArray));
+    QCOMPARE(result.result().toByteArray(), raw);
+
+    QDateTime when(QDate(2009, 6, 1), QTime(12, 30, 15));
+    response.setResult(when);
+    result = roundTrip(response);
+    QCOMPARE(result.result().userType(), int(QVariant::DateTime));
+    QCOMPARE(result.result().toDateTime(), when);
+
+    QScriptDebuggerEvent event(QScriptDebuggerEvent::UserEvent);
+    event.setAttribute(QScriptDebuggerEvent::UserAttribute, QVariant(QPoint(3, -4)));
+    QCOMPARE(roundTrip(event).attribute(QScriptDebuggerEvent::UserAttribute), QVariant(QPoint(3, -4)));
+}
+
+void tst_QScriptDebuggerCompactEncoding::truncatedCommand()
+{
+    QScriptDebuggerCommand command = QScriptDebuggerCommand::evaluateCommand(
+        0, QString::fromLatin1("print('hello')"), QString(), 1);
+    QByteArray bytes;
+    QDataStream out(&bytes, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_5);
+    QScriptDebuggerCompactEncoding::writeCommand(out, command);
+
+    for (int size = 0; size < bytes.size(); ++size) {
+        QDataStream in(bytes.left(size));
+        in.setVersion(QDataStream::Qt_4_5);
+        QScriptDebuggerCommand result;
+        QScriptDebuggerCompactEncoding::readCommand(in, result);
+        QVERIFY(in.status() != QDataStream::Ok);
+    }
+}
+
+// Returns a list nested \a depth lists deep, holding an int.
+static QVariant nestedList(int depth)
+{
+    QVariant value(1);
+    for (int i = 0; i < depth; ++i)
+        value = QVariantList() << value;
+    return value;
+}
+
+void tst_QScriptDebuggerCompactEncoding::nestingDepth()
+{
+    QScriptDebuggerResponse response;
+    response.setResult(nestedList(QScriptDebuggerCompactEncoding::MaxNestingDepth));
+    QCOMPARE(roundTrip(response).result(), response.result());
+
+    QByteArray bytes;
+    QDataStream out(&bytes, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_5);
+    response.setResult(nestedList(QScriptDebuggerCompactEncoding::MaxNestingDepth + 1));
+    QScriptDebuggerCompactEncoding::writeResponse(out, response);
+    QDataStream in(bytes);
+    in.setVersion(QDataStream::Qt_4_5);
+    QScriptDebuggerResponse result;
+    QScriptDebuggerCompactEncoding::readResponse(in, result);
+    QCOMPARE(in.status(), QDataStream::ReadCorruptData);
+
+    // a hostile frame: a list in a list, far deeper than the stack allows;
+    // the tag of a variant list is 18, and each one holds 1 element
+    QByteArray hostile(1, '\0');
+    for (int i = 0; i < 1000000; ++i)
+        hostile.append("\x12\x01", 2);
+    hostile.append(2, '\0');
+    QDataStream hostileIn(hostile);
+    hostileIn.setVersion(QDataStream::Qt_4_5);
+    QScriptDebuggerCompactEncoding::readResponse(hostileIn, result);
+    QCOMPARE(hostileIn.status(), QDataStream::ReadCorruptData);
+}
+
+void tst_QScriptDebuggerCompactEncoding::size_data()
+{
+    QTest::addColumn<QVariant>("result");
+
+    QScriptDebuggerValuePropertyList props;
+    props.append(QScriptDebuggerValueProperty(QString::fromLatin1("index"), QScriptDebuggerValue(42.0),
+                                              QString::fromLatin1("42"), QScriptValue::PropertyFlags(0)));
+    props.append(QScriptDebuggerValueProperty(QString::fromLatin1("name"),
+                                              QScriptDebuggerValue(QString::fromLatin1("item")),
+                                              QString::fromLatin1("item"), QScriptValue::PropertyFlags(0)));
+    props.append(QScriptDebuggerValueProperty(QString::fromLatin1("visible"), QScriptDebuggerValue(true),
+                                              QString::fromLatin1("true"), QScriptValue::PropertyFlags(0)));
+    props.append(QScriptDebuggerValueProperty(QString::fromLatin1("parent"),
+                                              QScriptDebuggerValue(QScriptDebuggerValue::NullValue),
+                                              QString::fromLatin1("null"), QScriptValue::PropertyFlags(0)));
+    QTest::newRow("properties") << qVariantFromValue(props);
+
+    QStringList backtrace;
+    for (int i = 0; i < 20; ++i)
+        backtrace.append(QString::fromLatin1("<anonymous>() at example.qs:%0").arg(10 + i));
+    backtrace.append(QString::fromLatin1("<global>() at example.qs:3"));
+    QTest::newRow("backtrace") << QVariant(backtrace);
+
+    QString contents;
+    for (int i = 0; i < 50; ++i)
+        contents.append(QString::fromLatin1("    var item%0 = items[%0];\n").arg(i));
+    QScriptScriptData script(contents, QString::fromLatin1("example.qs"), 1,
+                             QDateTime(QDate(2009, 6, 1), QTime(12, 0)));
+    QTest::newRow("script data") << qVariantFromValue(script);
+}
+
+// The compact encoding was introduced to halve the size of typical
+// responses; check that it stays well below what QDataStream takes.
+void tst_QScriptDebuggerCompactEncoding::size()
+{
+    QFETCH(QVariant, result);
+    QScriptDebuggerResponse response;
+    response.setResult(result);
+
+    QByteArray legacy;
+    QDataStream legacyOut(&legacy, QIODevice::WriteOnly);
+    legacyOut.setVersion(QDataStream::Qt_4_5);
+    legacyOut << response;
+
+    QByteArray compact;
+    QDataStream compactOut(&compact, QIODevice::WriteOnly);
+    compactOut.setVersion(QDataStream::Qt_4_5);
+    QScriptDebuggerCompactEncoding::writeResponse(compactOut, response);
+
+    QVERIFY2(compact.size() * 10 <= legacy.size() * 6,
+             qPrintable(QString::fromLatin1("%0 bytes compact, %1 with QDataStream")
+                        .arg(compact.size()).arg(legacy.size())));
+}
+
+QTEST_MAIN(tst_QScriptDebuggerCompactEncoding)
+#include "tst_qscriptdebuggercompactencoding.moc"
@@ -0,0 +1,17 @@
+TEMPLATE = app
+TARGET = tst_qscriptdebuggerframecodec
+DEPENDPATH += .
+INCLUDEPATH += .
+QT += network
+QT -= gui
+CONFIG += qtestlib
+win32: CONFIG += console
+mac:CONFIG -= app_bundle
+INCLUDEPATH += ../../src
+SOURCES += tst_qscriptdebuggerframecodec.cpp ../../src/qscriptdebuggerframecodec.cpp \
+           ../../src/qscriptdebuggertrace.cpp ../../src/qscriptdebuggertransport.cpp \
+           ../../src/qscriptdebuggermetrics.cpp
+HEADERS += ../../src/qscriptdebuggerframecodec_p.h ../../src/qscriptdebuggerprotocol_p.h \
+           ../../src/qscriptdebuggertrace_p.h ../../src/qscriptdebuggertransport_p.h \
+           ../../src/qscriptdebuggermetrics_p.h
+DEFINES += QT_BUILD_INTERNAL
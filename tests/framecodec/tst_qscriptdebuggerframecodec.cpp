@@ -0,0 +1,266 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+
+#include <QtTest/QtTest>
+
+#include "qscriptdebuggerframecodec_p.h"
+#include "qscriptdebuggerprotocol_p.h"
+
+class tst_QScriptDebuggerFrameCodec : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void roundTrip();
+    void partialFrame();
+    void ringWraparound();
+    void largeFrame();
+    void compressedFrame();
+    void incompressibleFrame();
+    void corruptCompressedFrame();
+    void truncatedCommandFrame();
+    void invalidFrameSize();
+};
+
+// Encodes a frame carrying \a payload as a QByteArray.
+static QByteArray encodeFrame(QScriptDebuggerFrameCodec &codec, quint8 type, quint32 channel,
+                              const QByteArray &payload)
+{
+    codec.beginFrame(type, channel) << payload;
+    if (!codec.endFrame())
+        return QByteArray();
+    QByteArray frame(codec.pendingData(), codec.pendingSize());
+    codec.discardPending();
+    return frame;
+}
+
+// Reads the next frame from \a codec, which must be complete, and
+// returns its payload.
+static QByteArray decodeFrame(QScriptDebuggerFrameCodec &codec, quint8 *type, quint32 *channel)
+{
+    if (codec.peekFrame(type, channel) != QScriptDebuggerFrameCodec::FrameAvailable)
+        return QByteArray();
+    QByteArray payload;
+    codec.beginRead() >> payload;
+    if (!codec.endRead())
+        return QByteArray();
+    return payload;
+}
+
+void tst_QScriptDebuggerFrameCodec::roundTrip()
+{
+    QScriptDebuggerFrameCodec sender;
+    QScriptDebuggerFrameCodec receiver;
+    QByteArray first = encodeFrame(sender, QScriptDebuggerProtocol::EventFrame, 3, "hello");
+    QByteArray second = encodeFrame(sender, QScriptDebuggerProtocol::OutputFrame, 7, "world");
+    receiver.append(first.constData(), first.size());
+    receiver.append(second.constData(), second.size());
+
+    quint8 type;
+    quint32 channel;
+    QCOMPARE(decodeFrame(receiver, &type, &channel), QByteArray("hello"));
+    QCOMPARE(int(type), int(QScriptDebuggerProtocol::EventFrame));
+    QCOMPARE(channel, quint32(3));
+    QCOMPARE(decodeFrame(receiver, &type, &channel), QByteArray("world"));
+    QCOMPARE(int(type), int(QScriptDebuggerProtocol::OutputFrame));
+    QCOMPARE(channel, quint32(7));
+    QCOMPARE(receiver.bytesBuffered(), 0);
+    QCOMPARE(receiver.peekFrame(&type, &channel), QScriptDebuggerFrameCodec::NeedMoreData);
+}
+
+void tst_QScriptDebuggerFrameCodec::partialFrame()
+{
+    QScriptDebuggerFrameCodec sender;
+    QScriptDebuggerFrameCodec receiver;
+    QByteArray frame = encodeFrame(sender, QScriptDebuggerProtocol::EventFrame, 0, "payload");
+    quint8 type;
+    quint32 channel;
+    for (int i = 0; i < frame.size() - 1; ++i) {
+        receiver.append(frame.constData() + i, 1);
+        QCOMPARE(receiver.peekFrame(&type, &channel), QScriptDebuggerFrameCodec::NeedMoreData);
+    }
+    receiver.append(frame.constData() + frame.size() - 1, 1);
+    QCOMPARE(decodeFrame(receiver, &type, &channel), QByteArray("payload"));
+}
+
+void tst_QScriptDebuggerFrameCodec::ringWraparound()
+{
+    // frames that don't divide the ring's capacity, fed in pieces that
+    // don't line up with them, end up split across the end of the ring
+    QScriptDebuggerFrameCodec sender;
+    QScriptDebuggerFrameCodec receiver;
+    QByteArray stream;
+    for (int i = 0; i < 500; ++i)
+        stream += encodeFrame(sender, QScriptDebuggerProtocol::OutputFrame, i, QByteArray(37 + i % 50, char('a' + i % 26)));
+
+    int fed = 0;
+    int decoded = 0;
+    while (decoded < 500) {
+        int piece = qMin(211, stream.size() - fed);
+        QVERIFY(piece > 0);
+        receiver.append(stream.constData() + fed, piece);
+        fed += piece;
+        quint8 type;
+        quint32 channel;
+        while (receiver.peekFrame(&type, &channel) == QScriptDebuggerFrameCodec::FrameAvailable) {
+            QByteArray payload;
+            receiver.beginRead() >> payload;
+            QVERIFY(receiver.endRead());
+            QCOMPARE(channel, quint32(decoded));
+            QCOMPARE(payload, QByteArray(37 + decoded % 50, char('a' + decoded % 26)));
+            ++decoded;
+        }
+    }
+    QCOMPARE(receiver.bytesBuffered(), 0);
+}
+
+void tst_QScriptDebuggerFrameCodec::largeFrame()
+{
+    // larger than the ring's initial capacity, which must grow for it
+    QScriptDebuggerFrameCodec sender;
+    QScriptDebuggerFrameCodec receiver;
+    QByteArray payload(100000, 'x');
+    QByteArray frame = encodeFrame(sender, QScriptDebuggerProtocol::ResponseFrame, 1, payload);
+    receiver.append(frame.constData(), 10);
+    quint8 type;
+    quint32 channel;
+    QCOMPARE(receiver.peekFrame(&type, &channel), QScriptDebuggerFrameCodec::NeedMoreData);
+    receiver.append(frame.constData() + 10, frame.size() - 10);
+    QCOMPARE(decodeFrame(receiver, &type, &channel), payload);
+}
+
+void tst_QScriptDebuggerFrameCodec::compressedFrame()
+{
+    QScriptDebuggerFrameCodec sender;
+    sender.setCompressionEnabled(true);
+    QScriptDebuggerFrameCodec receiver;
+    QByteArray payload(8192, 'a');
+    QByteArray frame = encodeFrame(sender, QScriptDebuggerProtocol::ResponseFrame, 2, payload);
+    QVERIFY(frame.size() < payload.size());
+    QVERIFY(quint8(frame.at(sizeof(quint32))) & QScriptDebuggerProtocol::CompressedFrameFlag);
+    QVERIFY(sender.bytesAfterCompression() < sender.bytesBeforeCompression());
+
+    receiver.append(frame.constData(), frame.size());
+    quint8 type;
+    quint32 channel;
+    QCOMPARE(decodeFrame(receiver, &type, &channel), payload);
+    QCOMPARE(int(type), int(QScriptDebuggerProtocol::ResponseFrame));
+    QCOMPARE(channel, quint32(2));
+    QCOMPARE(receiver.bytesBuffered(), 0);
+}
+
+void tst_QScriptDebuggerFrameCodec::incompressibleFrame()
+{
+    // below the threshold, or not smaller when compressed: sent as it is
+    QScriptDebuggerFrameCodec sender;
+    sender.setCompressionEnabled(true);
+    QByteArray small = encodeFrame(sender, QScriptDebuggerProtocol::EventFrame, 0, "short");
+    QVERIFY(!(quint8(small.at(sizeof(quint32))) & QScriptDebuggerProtocol::CompressedFrameFlag));
+
+    QByteArray noise;
+    qsrand(1);
+    for (int i = 0; i < 4096; ++i)
+        noise.append(char(qrand()));
+    QByteArray frame = encodeFrame(sender, QScriptDebuggerProtocol::EventFrame, 0, noise);
+    QVERIFY(!(quint8(frame.at(sizeof(quint32))) & QScriptDebuggerProtocol::CompressedFrameFlag));
+
+    QScriptDebuggerFrameCodec receiver;
+    receiver.append(frame.constData(), frame.size());
+    quint8 type;
+    quint32 channel;
+    QCOMPARE(decodeFrame(receiver, &type, &channel), noise);
+}
+
+void tst_QScriptDebuggerFrameCodec::corruptCompressedFrame()
+{
+    QScriptDebuggerFrameCodec sender;
+    sender.setCompressionEnabled(true);
+    QByteArray frame = encodeFrame(sender, QScriptDebuggerProtocol::ResponseFrame, 0, QByteArray(8192, 'a'));
+    // garble the deflated data, keeping the inflated size in front of it
+    int payloadStart = sizeof(quint32) + QScriptDebuggerProtocol::FrameHeaderSize;
+    for (int i = payloadStart + 4; i < frame.size(); ++i)
+        frame[i] = char(0xff);
+    QByteArray next = encodeFrame(sender, QScriptDebuggerProtocol::EventFrame, 0, "next");
+
+    QScriptDebuggerFrameCodec receiver;
+    receiver.append(frame.constData(), frame.size());
+    receiver.append(next.constData(), next.size());
+    quint8 type;
+    quint32 channel;
+    QCOMPARE(receiver.peekFrame(&type, &channel), QScriptDebuggerFrameCodec::FrameAvailable);
+    QByteArray payload;
+    receiver.beginRead() >> payload;
+    QVERIFY(!receiver.endRead());
+    QVERIFY(!receiver.errorString().isEmpty());
+    // the frame has been skipped as a whole
+    QCOMPARE(decodeFrame(receiver, &type, &channel), QByteArray("next"));
+}
+
+void tst_QScriptDebuggerFrameCodec::truncatedCommandFrame()
+{
+    // a command frame whose payload ends before the command does: the id
+    // and the command type, but not the attributes that should follow
+    QScriptDebuggerFrameCodec sender;
+    sender.beginFrame(QScriptDebuggerProtocol::CommandFrame, 0) << qint32(42) << qint32(7);
+    QVERIFY(sender.endFrame());
+    QByteArray frame(sender.pendingData(), sender.pendingSize());
+    sender.discardPending();
+    QByteArray next = encodeFrame(sender, QScriptDebuggerProtocol::CommandFrame, 0, "next");
+
+    QScriptDebuggerFrameCodec receiver;
+    receiver.append(frame.constData(), frame.size());
+    receiver.append(next.constData(), next.size());
+    quint8 type;
+    quint32 channel;
+    QCOMPARE(receiver.peekFrame(&type, &channel), QScriptDebuggerFrameCodec::FrameAvailable);
+    QCOMPARE(int(type), int(QScriptDebuggerProtocol::CommandFrame));
+    QDataStream &in = receiver.beginRead();
+    qint32 id;
+    qint32 commandType;
+    QMap<int, QVariant> attributes;
+    in >> id >> commandType >> attributes;
+    QCOMPARE(id, 42);
+    QVERIFY(!receiver.endRead());
+    QVERIFY(!receiver.errorString().isEmpty());
+    // reading stopped at the end of the frame, so the next one is intact
+    QCOMPARE(decodeFrame(receiver, &type, &channel), QByteArray("next"));
+}
+
+void tst_QScriptDebuggerFrameCodec::invalidFrameSize()
+{
+    QScriptDebuggerFrameCodec receiver;
+    // shorter than the frame header
+    const char tooSmall[] = { 0, 0, 0, 2, 0, 0 };
+    receiver.append(tooSmall, sizeof(tooSmall));
+    quint8 type;
+    quint32 channel;
+    QCOMPARE(receiver.peekFrame(&type, &channel), QScriptDebuggerFrameCodec::FrameError);
+    QVERIFY(!receiver.errorString().isEmpty());
+
+    QScriptDebuggerFrameCodec limited(1024);
+    const char tooLarge[] = { 0, 0, 0x10, 0, 0 };
+    limited.append(tooLarge, sizeof(tooLarge));
+    QCOMPARE(limited.peekFrame(&type, &channel), QScriptDebuggerFrameCodec::FrameError);
+}
+
+QTEST_MAIN(tst_QScriptDebuggerFrameCodec)
+#include "tst_qscriptdebuggerframecodec.moc"
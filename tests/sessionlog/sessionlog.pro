@@ -0,0 +1,12 @@
+TEMPLATE = app
+TARGET = tst_qscriptdebuggersessionlog
+DEPENDPATH += .
+INCLUDEPATH += .
+QT -= gui
+CONFIG += qtestlib
+win32: CONFIG += console
+mac:CONFIG -= app_bundle
+INCLUDEPATH += ../../src
+SOURCES += tst_qscriptdebuggersessionlog.cpp ../../src/qscriptdebuggersessionlog.cpp
+HEADERS += ../../src/qscriptdebuggersessionlog_p.h ../../src/qscriptdebuggerprotocol_p.h
+DEFINES += QT_BUILD_INTERNAL
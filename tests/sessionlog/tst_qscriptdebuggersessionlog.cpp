@@ -0,0 +1,174 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+
+#include <QtTest/QtTest>
+
+#include "qscriptdebuggersessionlog_p.h"
+#include "qscriptdebuggerprotocol_p.h"
+
+class tst_QScriptDebuggerSessionLog : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void replayAfterAcknowledgement();
+    void controlFrames();
+    void severalFramesAtOnce();
+    void logOverflow();
+    void acknowledgementInterval();
+    void reset();
+};
+
+// Builds a frame as it goes over the wire: its size, type and channel,
+// followed by \a payload.
+static QByteArray makeFrame(quint8 type, quint32 channel, const QByteArray &payload)
+{
+    QByteArray frame;
+    QDataStream out(&frame, QIODevice::WriteOnly);
+    out << quint32(QScriptDebuggerProtocol::FrameHeaderSize + payload.size())
+        << type << channel;
+    out.writeRawData(payload.constData(), payload.size());
+    return frame;
+}
+
+static void recordFrame(QScriptDebuggerSessionLog &log, quint8 type, const QByteArray &payload)
+{
+    QByteArray frame = makeFrame(type, 1, payload);
+    log.recordSent(frame.constData(), frame.size());
+}
+
+// Returns the payloads of the frames replayed after frame \a count.
+static QList<QByteArray> replayedPayloads(const QScriptDebuggerSessionLog &log, quint32 count)
+{
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    log.replay(count, &buffer);
+
+    QList<QByteArray> payloads;
+    QDataStream in(buffer.data());
+    while (!in.atEnd()) {
+        quint32 size;
+        quint8 type;
+        quint32 channel;
+        in >> size >> type >> channel;
+        QByteArray payload;
+        payload.resize(int(size) - QScriptDebuggerProtocol::FrameHeaderSize);
+        if (in.readRawData(payload.data(), payload.size()) != payload.size())
+            break;
+        payloads.append(payload);
+    }
+    return payloads;
+}
+
+void tst_QScriptDebuggerSessionLog::replayAfterAcknowledgement()
+{
+    QScriptDebuggerSessionLog log;
+    for (int i = 1; i <= 5; ++i)
+        recordFrame(log, QScriptDebuggerProtocol::EventFrame, QByteArray::number(i));
+    QCOMPARE(log.sentCount(), quint32(5));
+
+    log.acknowledge(2);
+    QVERIFY(!log.canReplay(1));
+    QVERIFY(log.canReplay(2));
+    QVERIFY(log.canReplay(4));
+    QVERIFY(log.canReplay(5));
+    QVERIFY(!log.canReplay(6));
+
+    QCOMPARE(replayedPayloads(log, 2), QList<QByteArray>() << "3" << "4" << "5");
+    QCOMPARE(replayedPayloads(log, 4), QList<QByteArray>() << "5");
+    QVERIFY(replayedPayloads(log, 5).isEmpty());
+
+    log.acknowledge(5);
+    QVERIFY(log.canReplay(5));
+    QVERIFY(!log.canReplay(4));
+}
+
+void tst_QScriptDebuggerSessionLog::controlFrames()
+{
+    QScriptDebuggerSessionLog log;
+    recordFrame(log, QScriptDebuggerProtocol::EventFrame, "a");
+    recordFrame(log, QScriptDebuggerProtocol::AckFrame, "ack");
+    recordFrame(log, QScriptDebuggerProtocol::HeartbeatFrame, "beat");
+    recordFrame(log, QScriptDebuggerProtocol::EventFrame | QScriptDebuggerProtocol::CompressedFrameFlag, "b");
+    recordFrame(log, QScriptDebuggerProtocol::AckFrame | QScriptDebuggerProtocol::CompressedFrameFlag, "ack");
+    QCOMPARE(log.sentCount(), quint32(2));
+    QCOMPARE(replayedPayloads(log, 0), QList<QByteArray>() << "a" << "b");
+}
+
+void tst_QScriptDebuggerSessionLog::severalFramesAtOnce()
+{
+    QScriptDebuggerSessionLog log;
+    QByteArray data = makeFrame(QScriptDebuggerProtocol::EventFrame, 1, "x")
+                      + makeFrame(QScriptDebuggerProtocol::HeartbeatFrame, 0, QByteArray())
+                      + makeFrame(QScriptDebuggerProtocol::OutputFrame, 2, "yz");
+    log.recordSent(data.constData(), data.size());
+    QCOMPARE(log.sentCount(), quint32(2));
+    QCOMPARE(replayedPayloads(log, 0), QList<QByteArray>() << "x" << "yz");
+}
+
+void tst_QScriptDebuggerSessionLog::logOverflow()
+{
+    QScriptDebuggerSessionLog log;
+    QByteArray payload(1024 * 1024, 'x');
+    for (int i = 0; i < 9; ++i)
+        recordFrame(log, QScriptDebuggerProtocol::OutputFrame, payload);
+    QCOMPARE(log.sentCount(), quint32(9));
+
+    // the first two frames have been dropped to stay within MaxLogSize
+    QVERIFY(!log.canReplay(0));
+    QVERIFY(!log.canReplay(1));
+    QVERIFY(log.canReplay(2));
+    QCOMPARE(replayedPayloads(log, 2).size(), 7);
+}
+
+void tst_QScriptDebuggerSessionLog::acknowledgementInterval()
+{
+    QScriptDebuggerSessionLog log;
+    for (int i = 1; i < QScriptDebuggerSessionLog::AckInterval; ++i) {
+        log.recordReceived();
+        QVERIFY(!log.needsAcknowledgement());
+    }
+    log.recordReceived();
+    QVERIFY(log.needsAcknowledgement());
+    QCOMPARE(log.receivedCount(), quint32(QScriptDebuggerSessionLog::AckInterval));
+
+    log.setAcknowledged();
+    QVERIFY(!log.needsAcknowledgement());
+    log.recordReceived();
+    QVERIFY(!log.needsAcknowledgement());
+    QCOMPARE(log.receivedCount(), quint32(QScriptDebuggerSessionLog::AckInterval + 1));
+}
+
+void tst_QScriptDebuggerSessionLog::reset()
+{
+    QScriptDebuggerSessionLog log;
+    recordFrame(log, QScriptDebuggerProtocol::EventFrame, "a");
+    log.recordReceived();
+    log.reset();
+    QCOMPARE(log.sentCount(), quint32(0));
+    QCOMPARE(log.receivedCount(), quint32(0));
+    QVERIFY(log.canReplay(0));
+    QVERIFY(replayedPayloads(log, 0).isEmpty());
+}
+
+QTEST_MAIN(tst_QScriptDebuggerSessionLog)
+#include "tst_qscriptdebuggersessionlog.moc"
@@ -0,0 +1,268 @@
+/****************************************************************************
+**
+** Copyright (C) 2009 Nokia Corporation and/or its subsidiary(-ies).
+** Contact: Qt Software Information (qt-info@nokia.com)
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 or 3.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** If you are unsure which license is appropriate for your use, please
+** contact the sales department at qt-sales@nokia.com.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+// Plays back a trace written by QScriptDebuggerEngine::startRecording()
+// or QScriptRemoteTargetDebugger::startRecording():
+//
+//   tracereplay FILE              into a debugger window
+//   tracereplay --listen=ADDRESS  as a stand-in target that a debugger
+//                                 (e.g. examples/debugger) attaches to
+//   tracereplay --dump FILE       lists the records
+//
+// --fast plays the frames as fast as they are read instead of at the
+// recorded pace, and --benchmark (which implies --fast) prints how long
+// the debugger took to take in the whole session and quits.
+
+#include <QtCore>
+#include <QtGui>
+#include <QtScript>
+#include <qscriptremotetargetdebugger.h>
+#include <qscriptdebuggerprotocol_p.h>
+#include <qscriptdebuggertrace_p.h>
+#include <qscriptdebuggertransport_p.h>
+
+#include <stdio.h>
+
+void qScriptDebugRegisterMetaTypes();
+
+static const char *recordName(quint8 type)
+{
+    switch (type) {
+    case QScriptDebuggerProtocol::BackendFrameRecord: return "backend";
+    case QScriptDebuggerProtocol::FrontendFrameRecord: return "frontend";
+    case QScriptDebuggerProtocol::HandshakeRecord: return "handshake";
+    }
+    return "unknown";
+}
+
+static int dump(const QString &fileName)
+{
+    QScriptDebuggerTraceReader reader;
+    if (!reader.open(fileName)) {
+        fprintf(stderr, "%s\n", qPrintable(reader.errorString()));
+        return 1;
+    }
+    fprintf(stdout, "started %s\n", qPrintable(reader.startTime().toString(Qt::ISODate)));
+    fprintf(stdout, "%10s %-10s %6s %8s %10s\n", "ms", "sender", "type", "channel", "bytes");
+    QScriptDebuggerTraceReader::Record record;
+    int frames = 0;
+    qint64 bytes = 0;
+    while (reader.readRecord(&record)) {
+        const uchar *data = reinterpret_cast<const uchar*>(record.data);
+        if (record.type == QScriptDebuggerProtocol::HandshakeRecord) {
+            fprintf(stdout, "%10u %-10s capabilities 0x%x\n", record.time, recordName(record.type),
+                    record.size == 4 ? qFromLittleEndian<quint32>(data) : 0);
+            continue;
+        }
+        int headerSize = int(sizeof(quint32)) + QScriptDebuggerProtocol::FrameHeaderSize;
+        if (record.size < headerSize)
+            continue;
+        quint8 type = data[sizeof(quint32)];
+        quint32 channel = qFromBigEndian<quint32>(data + sizeof(quint32) + 1);
+        fprintf(stdout, "%10u %-10s %5d%s %8u %10d\n", record.time, recordName(record.type),
+                type & ~QScriptDebuggerProtocol::CompressedFrameFlag,
+                (type & QScriptDebuggerProtocol::CompressedFrameFlag) ? "z" : " ",
+                channel, record.size);
+        ++frames;
+        bytes += record.size;
+    }
+    fprintf(stdout, "%d frames, %lld bytes\n", frames, bytes);
+    return 0;
+}
+
+// Plays the backend's side of the trace to a debugger that attaches over
+// a real transport.
+class StandInTarget : public QObject
+{
+    Q_OBJECT
+public:
+    StandInTarget(QScriptDebuggerTransport *transport, QScriptDebuggerTracePlayer *player)
+        : m_transport(transport), m_player(player), m_handshaken(false)
+    {
+        QObject::connect(transport, SIGNAL(connected()), this, SLOT(onConnected()));
+        QObject::connect(transport, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+        QObject::connect(transport, SIGNAL(disconnected()), this, SLOT(onDisconnected()));
+        QObject::connect(player, SIGNAL(frameReady(const char*,int)),
+                         this, SLOT(onFrameReady(const char*,int)));
+        QObject::connect(player, SIGNAL(finished()), this, SLOT(onFinished()));
+    }
+
+private slots:
+    void onConnected()
+    {
+        fprintf(stdout, "debugger attached\n");
+        m_handshaken = false;
+        m_timer.start();
+    }
+    void onReadyRead()
+    {
+        QIODevice *device = m_transport->device();
+        if (m_handshaken) {
+            // the debugger's commands; the recorded responses follow anyway
+            device->readAll();
+            return;
+        }
+        if (device->bytesAvailable() < QScriptDebuggerProtocol::HandshakeSize)
+            return;
+        QByteArray handshake = QScriptDebuggerProtocol::handshakeData();
+        if (device->read(handshake.size()) != handshake) {
+            fprintf(stderr, "not a debugger\n");
+            m_transport->disconnectFromPeer();
+            return;
+        }
+        device->read(sizeof(quint16) + sizeof(quint32));
+        uchar field[sizeof(quint16) + sizeof(quint32)];
+        qToBigEndian<quint16>(QScriptDebuggerProtocol::ProtocolVersion, field);
+        qToBigEndian<quint32>(m_player->capabilities(), field + sizeof(quint16));
+        device->write(handshake);
+        device->write(reinterpret_cast<const char*>(field), sizeof(field));
+        m_handshaken = true;
+        m_player->start();
+    }
+    void onFrameReady(const char *data, int size)
+    {
+        if (QIODevice *device = m_transport->device())
+            device->write(data, size);
+    }
+    void onFinished()
+    {
+        fprintf(stdout, "played %d frames in %d ms\n", m_player->framesPlayed(), m_timer.elapsed());
+    }
+    void onDisconnected()
+    {
+        m_player->stop();
+        fprintf(stdout, "debugger detached\n");
+    }
+
+private:
+    QScriptDebuggerTransport *m_transport;
+    QScriptDebuggerTracePlayer *m_player;
+    bool m_handshaken;
+    QTime m_timer;
+};
+
+class ReplayTimer : public QObject
+{
+    Q_OBJECT
+public:
+    ReplayTimer(bool quitWhenFinished) : m_quit(quitWhenFinished) { m_timer.start(); }
+
+public slots:
+    void onFinished()
+    {
+        fprintf(stdout, "replayed in %d ms\n", m_timer.elapsed());
+        if (m_quit)
+            QCoreApplication::quit();
+    }
+    void onError()
+    {
+        fprintf(stderr, "replay failed\n");
+        QCoreApplication::exit(1);
+    }
+
+private:
+    bool m_quit;
+    QTime m_timer;
+};
+
+int main(int argc, char **argv)
+{
+    QString fileName;
+    QString listenAddress;
+    QScriptDebuggerTransport::Type transportType = QScriptDebuggerTransport::TcpTransport;
+    bool listen = false;
+    bool dumpOnly = false;
+    bool fast = false;
+    bool benchmark = false;
+    bool usage = false;
+    for (int i = 1; i < argc; ++i) {
+        QString arg = QString::fromLocal8Bit(argv[i]);
+        if (arg == QLatin1String("--dump")) {
+            dumpOnly = true;
+        } else if (arg == QLatin1String("--fast")) {
+            fast = true;
+        } else if (arg == QLatin1String("--benchmark")) {
+            benchmark = fast = true;
+        } else if (arg.startsWith(QLatin1String("--listen="))) {
+            listen = true;
+            listenAddress = arg.mid(9);
+        } else if (arg.startsWith(QLatin1String("--transport="))) {
+            QString name = arg.mid(12);
+            if (name == QLatin1String("tcp"))
+                transportType = QScriptDebuggerTransport::TcpTransport;
+            else if (name == QLatin1String("local"))
+                transportType = QScriptDebuggerTransport::LocalSocketTransport;
+            else if (name == QLatin1String("shm"))
+                transportType = QScriptDebuggerTransport::SharedMemoryTransport;
+            else
+                usage = true;
+        } else if (!arg.startsWith(QLatin1String("--")) && fileName.isEmpty()) {
+            fileName = arg;
+        } else {
+            usage = true;
+        }
+    }
+    if (usage || fileName.isEmpty()) {
+        fprintf(stdout, "Usage: tracereplay [--fast] [--benchmark] FILE\n"
+                        "       tracereplay --listen=ADDRESS [--transport=tcp|local|shm] [--fast] FILE\n"
+                        "       tracereplay --dump FILE\n");
+        return 0;
+    }
+
+    if (dumpOnly) {
+        QCoreApplication app(argc, argv);
+        return dump(fileName);
+    }
+
+    if (listen) {
+        QCoreApplication app(argc, argv);
+        QScriptDebuggerTracePlayer player;
+        if (!player.open(fileName)) {
+            fprintf(stderr, "%s\n", qPrintable(player.errorString().isEmpty()
+                                               ? QString::fromLatin1("no session in %0").arg(fileName)
+                                               : player.errorString()));
+            return 1;
+        }
+        player.setFullSpeed(fast);
+        QScriptDebuggerTransport *transport = QScriptDebuggerTransport::create(transportType);
+        StandInTarget target(transport, &player);
+        if (!transport->listen(listenAddress)) {
+            fprintf(stderr, "%s\n", qPrintable(transport->errorString()));
+            return 1;
+        }
+        int ret = app.exec();
+        delete transport;
+        return ret;
+    }
+
+    QApplication app(argc, argv);
+    qScriptDebugRegisterMetaTypes();
+    QScriptRemoteTargetDebugger debugger;
+    ReplayTimer timer(benchmark);
+    QObject::connect(&debugger, SIGNAL(replayFinished()), &timer, SLOT(onFinished()));
+    QObject::connect(&debugger, SIGNAL(error(QScriptRemoteTargetDebugger::Error)),
+                     &timer, SLOT(onError()));
+    debugger.replay(fileName, fast ? QScriptRemoteTargetDebugger::FullSpeed
+                                   : QScriptRemoteTargetDebugger::RecordedSpeed);
+    return app.exec();
+}
+
+#include "main.moc"
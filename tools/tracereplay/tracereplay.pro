@@ -0,0 +1,9 @@
+TEMPLATE = app
+TARGET = 
+DEPENDPATH += .
+INCLUDEPATH += .
+QT += network script scripttools
+win32: CONFIG += console
+mac:CONFIG -= app_bundle
+include(../../src/remotetargetdebugger.pri)
+SOURCES += main.cpp